@@ -0,0 +1,50 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/allocator.h"
+#include <spdlog/fmt/fmt.h>
+
+namespace vox::benchmark {
+// Per-frame temporaries: a batch of arrays of mixed sizes is allocated, then released
+static void allocator_churn(::benchmark::State &state, size_t batch_size, bool use_cache) {
+    Allocator allocator{device()};
+    if (!use_cache) {
+        allocator.set_cache_limit(0);
+    }
+
+    std::vector<Buffer> buffers;
+    buffers.reserve(batch_size);
+    auto get_size = [](size_t i) {
+        // from a few floats up to a few pages
+        return size_t(16) << (i % 11);
+    };
+
+    for ([[maybe_unused]] auto _ : state) {
+        for (size_t i = 0; i < batch_size; i++) {
+            buffers.push_back(allocator.malloc(get_size(i), true));
+        }
+        for (auto &buffer : buffers) {
+            allocator.free(buffer);
+        }
+        buffers.clear();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(batch_size));
+}
+
+void AllocatorChurn::register_benchmarks(LatencyMeasureMode mode) {
+    for (size_t batch_size : {64, 1024, 4096}) {
+        for (bool use_cache : {false, true}) {
+            std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "allocator_churn",
+                                                batch_size, use_cache ? "cached" : "uncached");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), allocator_churn, batch_size, use_cache)
+                ->Unit(::benchmark::kMicrosecond);
+        }
+    }
+}
+
+}// namespace vox::benchmark
@@ -35,4 +35,49 @@ class Reduce : public BenchmarkAPI {
 public:
     void register_benchmarks(LatencyMeasureMode mode) override;
 };
+
+class Scan : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class Sort : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class HashGridBuild : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class Histogram : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class SegmentedReduce : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class KernelLaunch : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class DispatchOverlap : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class GraphReplay : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
+
+class AllocatorChurn : public BenchmarkAPI {
+public:
+    void register_benchmarks(LatencyMeasureMode mode) override;
+};
 }// namespace vox::benchmark
\ No newline at end of file
@@ -0,0 +1,65 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/kernel.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <chrono>
+
+namespace vox::benchmark {
+// Independent row reductions of one input into their own outputs. Ordered leaves the input ReadWrite,
+// so every dispatch waits for the one before it, annotated reads it and the dispatches run together.
+static void dispatch_overlap(::benchmark::State &state, bool annotated, uint num_dispatches, uint rows) {
+    constexpr uint row_size = 4096;
+    Array in(std::vector<float>(size_t(rows) * row_size, 1.f), float32);
+    std::vector<Array> outs;
+    for (uint i = 0; i < num_dispatches; i++) {
+        outs.emplace_back(std::vector<int>{int(rows)}, float32, nullptr, std::vector<Array>{});
+        outs.back().allocate();
+    }
+
+    auto kernel = Kernel::builder().entry("row_reduce_sumfloat32").build();
+    kernel.set_thread_groups(rows);
+    kernel.set_threads_per_thread_group(32);
+    if (annotated) {
+        kernel.set_argument_usage({ResourceUsage::Read, ResourceUsage::Write});
+    }
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (auto &out : outs) {
+            kernel.launch(0, in, out, uint64_t(rows), uint64_t(row_size), uint64_t(1));
+        }
+        synchronize(true);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        state.SetIterationTime(elapsed_seconds.count());
+    }
+    EXPECT_EQ(outs.back().data<float>(rows - 1), float(row_size));
+
+    state.counters["Dispatches"] =
+        ::benchmark::Counter(num_dispatches,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void DispatchOverlap::register_benchmarks(LatencyMeasureMode mode) {
+    constexpr uint num_dispatches = 64;
+    for (uint rows : {1, 16}) {
+        for (bool annotated : {false, true}) {
+            std::string test_name = fmt::format("{}/{}/{}/{}/{}", device().name(), "dispatch_overlap", num_dispatches,
+                                                rows, annotated ? "annotated" : "ordered");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), dispatch_overlap, annotated, num_dispatches, rows)
+                ->UseManualTime()
+                ->Unit(::benchmark::kMicrosecond);
+        }
+    }
+}
+}// namespace vox::benchmark
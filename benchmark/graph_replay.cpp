@@ -0,0 +1,91 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/command_graph.h"
+#include "runtime/device.h"
+#include "runtime/typed_kernel.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <cstddef>
+
+namespace vox::benchmark {
+struct alignas(8) SubstepArguments {
+    DeviceArray<uint32_t> out;
+    DeviceArray<const uint32_t> a;
+    DeviceArray<const uint32_t> b;
+    DeviceArray<const uint32_t> c;
+    uint64_t size;
+    uint64_t stride;
+    float dt;
+    uint32_t substep;
+
+    static constexpr auto arrays() {
+        return std::make_tuple(&SubstepArguments::out, &SubstepArguments::a, &SubstepArguments::b, &SubstepArguments::c);
+    }
+};
+
+// Encode cost of a substep of num_dispatches launches, the work itself is excluded. Replay records
+// the graph captured from the launches once, after updating the substep uniform of every node.
+static void graph_replay(::benchmark::State &state, bool replay, uint num_dispatches) {
+    std::vector<Array> arrays;
+    for (int i = 0; i < 4; i++) {
+        arrays.emplace_back(std::vector<int>{1024}, uint32, nullptr, std::vector<Array>{});
+        arrays.back().allocate();
+    }
+    TypedKernel<SubstepArguments> kernel{Kernel::builder().entry("isumuint32").build()};
+    kernel.set_threads(1);
+    kernel.set_threads_per_thread_group(1);
+
+    auto substep = [&](uint32_t index) {
+        for (uint dispatch = 0; dispatch < num_dispatches; dispatch++) {
+            kernel({DeviceArray<uint32_t>{arrays[0]}, DeviceArray<const uint32_t>{arrays[1]},
+                    DeviceArray<const uint32_t>{arrays[2]}, DeviceArray<const uint32_t>{arrays[3]}, 1024, 4, 0.01f,
+                    index});
+        }
+    };
+    CommandGraph graph;
+    device().stream(0).begin_capture(graph);
+    substep(0);
+    device().stream(0).end_capture();
+
+    uint32_t index = 0;
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        index++;
+        if (replay) {
+            for (size_t node = 0; node < graph.size(); node++) {
+                graph.set_uniform(node, offsetof(SubstepArguments, substep), index);
+            }
+            graph.replay(0);
+        } else {
+            substep(index);
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        state.SetIterationTime(elapsed_seconds.count());
+
+        synchronize(true);
+    }
+    state.counters["Dispatches"] =
+        ::benchmark::Counter(num_dispatches,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void GraphReplay::register_benchmarks(LatencyMeasureMode mode) {
+    constexpr uint num_dispatches = 40;
+    for (bool replay : {false, true}) {
+        std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "graph_replay", num_dispatches,
+                                            replay ? "replay" : "launch");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), graph_replay, replay, num_dispatches)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMicrosecond);
+    }
+}
+}// namespace vox::benchmark
@@ -0,0 +1,123 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/hash_grid.h"
+#include "runtime/neighbor_list.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace vox::benchmark {
+// Points of a box holding about 8 points per cell of the grid
+static std::vector<simd::float3> generate_points(uint num_element, float cell_width) {
+    std::mt19937 rng(num_element);
+    const float extent = std::cbrt(float(num_element) / 8.f) * cell_width;
+    std::uniform_real_distribution<float> dist(0.f, extent);
+    std::vector<simd::float3> points(num_element);
+    for (auto &p : points) {
+        p = simd::float3{dist(rng), dist(rng), dist(rng)};
+    }
+    return points;
+}
+
+static void hash_grid_build(::benchmark::State &state, LatencyMeasureMode mode, uint num_element) {
+    constexpr float cell_width = 1.f;
+    //===-------------------------------------------------------------------===/
+    // Set source buffer data
+    //===-------------------------------------------------------------------===/
+    auto init = generate_points(num_element, cell_width);
+    auto src_buffer = Array(init.data(), {int(num_element)}, float3);
+    HashGrid grid(128, 128, 128);
+    grid.reserve(int(num_element));
+
+    //===-------------------------------------------------------------------===/
+    // Verify destination buffer data
+    //===-------------------------------------------------------------------===/
+    grid.build(src_buffer, cell_width);
+    synchronize(true);
+    size_t total = 0;
+    for (int cell = 0; cell < grid.num_cells(); cell++) {
+        total += grid.cell_ends().data<int32_t>(cell) - grid.cell_starts().data<int32_t>(cell);
+    }
+    EXPECT_EQ(total, num_element) << "cell ranges don't cover the points";
+
+    //===-------------------------------------------------------------------===/
+    // Benchmarking
+    //===-------------------------------------------------------------------===/
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        grid.build(src_buffer, cell_width);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Points"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+// Count, scan and fill of the neighbors of every point, the grid is built once
+static void neighbor_list_build(::benchmark::State &state, LatencyMeasureMode mode, uint num_element) {
+    constexpr float cell_width = 1.f;
+    auto init = generate_points(num_element, cell_width);
+    auto src_buffer = Array(init.data(), {int(num_element)}, float3);
+    HashGrid grid(128, 128, 128);
+    grid.build(src_buffer, cell_width);
+    NeighborList neighbors;
+    neighbors.build(grid, src_buffer, 0.8f * cell_width, 0.2f * cell_width);
+    synchronize(true);
+    EXPECT_EQ(neighbors.offsets().data<int32_t>(num_element), neighbors.num_neighbors());
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        neighbors.build(grid, src_buffer, 0.8f * cell_width, 0.2f * cell_width);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Points"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+    state.counters["Neighbors"] = double(neighbors.num_neighbors()) / num_element;
+}
+
+void HashGridBuild::register_benchmarks(LatencyMeasureMode mode) {
+    for (uint num_element : {1u << 16, 1u << 20}) {
+        std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "hash_grid_build", num_element, "xf3");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), hash_grid_build, mode, num_element)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMillisecond);
+
+        test_name = fmt::format("{}/{}/{}/{}", device().name(), "neighbor_list_build", num_element, "xf3");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), neighbor_list_build, mode, num_element)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMillisecond);
+    }
+}
+}// namespace vox::benchmark
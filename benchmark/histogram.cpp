@@ -0,0 +1,106 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/primitives/histogram.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace vox::benchmark {
+// Values in [0, 1), uniform or with most of them in one narrow peak which makes every thread hit the same bin
+static std::vector<float> generate_values(uint num_element, bool peaked) {
+    std::mt19937 rng(num_element);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<float> values(num_element);
+    for (auto &v : values) {
+        v = peaked && rng() % 100 < 95 ? 0.5f : dist(rng);
+    }
+    return values;
+}
+
+static void histogram(::benchmark::State &state, LatencyMeasureMode mode, uint num_element, int bins, bool peaked) {
+    //===-------------------------------------------------------------------===/
+    // Set source buffer data
+    //===-------------------------------------------------------------------===/
+    auto init = generate_values(num_element, peaked);
+    auto src_buffer = Array(init.data(), {int(num_element)}, float32);
+
+    //===-------------------------------------------------------------------===/
+    // Verify destination buffer data
+    //===-------------------------------------------------------------------===/
+    auto counts = vox::histogram(src_buffer, bins, 0, 1);
+    synchronize(true);
+    size_t total = 0;
+    for (int bin = 0; bin < bins; bin++) {
+        total += counts.data<uint32_t>(bin);
+    }
+    EXPECT_EQ(total, num_element) << "counts don't add up to the values";
+
+    //===-------------------------------------------------------------------===/
+    // Benchmarking
+    //===-------------------------------------------------------------------===/
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        auto dst_buffer = vox::histogram(src_buffer, bins, 0, 1);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Values"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+// Single threaded loop over one histogram, the baseline of the host backend
+static void histogram_reference(::benchmark::State &state, uint num_element, int bins, bool peaked) {
+    auto init = generate_values(num_element, peaked);
+    std::vector<uint32_t> counts(bins);
+    for ([[maybe_unused]] auto _ : state) {
+        std::fill(counts.begin(), counts.end(), 0u);
+        for (auto v : init) {
+            counts[std::min(uint32_t(v * float(bins)), uint32_t(bins - 1))]++;
+        }
+        ::benchmark::DoNotOptimize(counts.data());
+    }
+    state.counters["Values"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void Histogram::register_benchmarks(LatencyMeasureMode mode) {
+    constexpr uint num_element = 1u << 22;
+    for (bool peaked : {false, true}) {
+        const char *distribution = peaked ? "peaked" : "uniform";
+        for (int bins : {16, 256, 4096, 65536}) {
+            std::string test_name = fmt::format("{}/{}/{}/{}bins/{}/{}", device().name(), "histogram", num_element,
+                                                bins, distribution, "xf32");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), histogram, mode, num_element, bins, peaked)
+                ->UseManualTime()
+                ->Unit(::benchmark::kMillisecond);
+
+            test_name = fmt::format("{}/{}/{}/{}bins/{}/{}", "Reference", "histogram", num_element, bins,
+                                    distribution, "xf32");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), histogram_reference, num_element, bins, peaked)
+                ->Unit(::benchmark::kMillisecond);
+        }
+    }
+}
+}// namespace vox::benchmark
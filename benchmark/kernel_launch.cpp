@@ -0,0 +1,98 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/typed_kernel.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace vox::benchmark {
+enum class LaunchPath { Vector, Variadic, Typed };
+
+struct alignas(8) LaunchArguments {
+    DeviceArray<uint32_t> out;
+    DeviceArray<uint32_t> a;
+    DeviceArray<uint32_t> b;
+    DeviceArray<uint32_t> c;
+    uint64_t size;
+    uint64_t stride;
+    float scale;
+    uint32_t flags;
+
+    static constexpr auto arrays() {
+        return std::make_tuple(&LaunchArguments::out, &LaunchArguments::a, &LaunchArguments::b, &LaunchArguments::c);
+    }
+};
+
+template<typename T>
+static UniformArgument uniform(const T &value) {
+    UniformArgument bytes(sizeof(value));
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    return bytes;
+}
+
+// Encode cost of num_launches dispatches with four Arrays and four uniforms, the work itself is excluded.
+// The kernel only reads the first Array, the other arguments are there to be encoded.
+static void kernel_launch(::benchmark::State &state, LaunchPath path, uint num_launches) {
+    std::vector<Array> arrays;
+    for (int i = 0; i < 4; i++) {
+        arrays.emplace_back(std::vector<int>{1024}, uint32, nullptr, std::vector<Array>{});
+        arrays.back().allocate();
+    }
+    TypedKernel<LaunchArguments> kernel{Kernel::builder().entry("isumuint32").build()};
+    kernel.set_threads(1);
+    kernel.set_threads_per_thread_group(1);
+    const uint64_t size = 1024;
+    const uint64_t stride = 4;
+    const float scale = 0.5f;
+    const uint32_t flags = 3;
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (uint launch = 0; launch < num_launches; launch++) {
+            switch (path) {
+                case LaunchPath::Vector:
+                    kernel.Kernel::operator()({arrays[0], arrays[1], arrays[2], arrays[3], uniform(size), uniform(stride),
+                                               uniform(scale), uniform(flags)});
+                    break;
+                case LaunchPath::Variadic:
+                    kernel.launch(0, arrays[0], arrays[1], arrays[2], arrays[3], size, stride, scale, flags);
+                    break;
+                case LaunchPath::Typed:
+                    kernel({DeviceArray<uint32_t>{arrays[0]}, DeviceArray<uint32_t>{arrays[1]},
+                            DeviceArray<uint32_t>{arrays[2]}, DeviceArray<uint32_t>{arrays[3]}, size, stride, scale,
+                            flags});
+                    break;
+            }
+        }
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        state.SetIterationTime(elapsed_seconds.count());
+
+        synchronize(true);
+    }
+    state.counters["Launches"] =
+        ::benchmark::Counter(num_launches,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void KernelLaunch::register_benchmarks(LatencyMeasureMode mode) {
+    constexpr uint num_launches = 1000;
+    const std::pair<LaunchPath, const char *> paths[] = {
+        {LaunchPath::Vector, "vector"}, {LaunchPath::Variadic, "variadic"}, {LaunchPath::Typed, "typed"}};
+    for (auto [path, name] : paths) {
+        std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "kernel_launch", num_launches, name);
+        ::benchmark::RegisterBenchmark(test_name.c_str(), kernel_launch, path, num_launches)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMicrosecond);
+    }
+}
+}// namespace vox::benchmark
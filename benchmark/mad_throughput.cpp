@@ -7,19 +7,34 @@
 #include "benchmark_api.h"
 #include "runtime/device.h"
 #include "runtime/array.h"
-#include "runtime/kernel.h"
-#include "runtime/extension/debug_capture_ext.h"
+#include "runtime/typed_kernel.h"
 #include "data_type_util.h"
+#ifdef ARCHE_USE_METAL
+#include "runtime/extension/debug_capture_ext.h"
 #include "counter.h"
+#endif
 #include <spdlog/fmt/fmt.h>
 #include <gtest/gtest.h>
 
 namespace vox::benchmark {
+// Arguments of shader/builtin/mad_throughput.metal
+struct alignas(8) MadThroughputArguments {
+    DeviceArray<const simd::float4> input_a;
+    DeviceArray<const simd::float4> input_b;
+    DeviceArray<simd::float4> output;
+
+    static constexpr auto arrays() {
+        return std::make_tuple(&MadThroughputArguments::input_a, &MadThroughputArguments::input_b,
+                               &MadThroughputArguments::output);
+    }
+};
+static_assert(sizeof(MadThroughputArguments) == 24);
+
 static void throughput(::benchmark::State &state,
                        LatencyMeasureMode mode,
                        const std::string &kernel_name,
                        int num_element, int loop_count, Dtype data_type) {
-    auto throughput = Kernel::builder().entry(kernel_name).build();
+    TypedKernel<MadThroughputArguments> throughput{Kernel::builder().entry(kernel_name).build()};
     throughput.set_threads(num_element / 4);
     throughput.set_threads_per_thread_group(32);
 
@@ -45,10 +60,10 @@ static void throughput(::benchmark::State &state,
 
     if (data_type == float16) {
         for (size_t i = 0; i < num_element; i++) {
-            src0_buffer.data<float16_t>(i) = fp16(getSrc0(i)).get_value();
+            src0_buffer.data<float16_t>(i) = float16_t(getSrc0(i));
         }
         for (size_t i = 0; i < num_element; i++) {
-            src1_buffer.data<float16_t>(i) = fp16(getSrc1(i)).get_value();
+            src1_buffer.data<float16_t>(i) = float16_t(getSrc1(i));
         }
     } else if (data_type == float32) {
         for (size_t i = 0; i < num_element; i++) {
@@ -62,7 +77,8 @@ static void throughput(::benchmark::State &state,
     //===-------------------------------------------------------------------===/
     // Dispatch
     //===-------------------------------------------------------------------===/
-    throughput({src0_buffer, src1_buffer, dst_buffer});
+    throughput({DeviceArray<const simd::float4>{src0_buffer}, DeviceArray<const simd::float4>{src1_buffer},
+                DeviceArray<simd::float4>{dst_buffer}});
     synchronize(true);
 
     //===-------------------------------------------------------------------===/
@@ -72,10 +88,10 @@ static void throughput(::benchmark::State &state,
     if (data_type == float16) {
         for (size_t i = 0; i < num_element; i++) {
             float limit = getSrc1(i) * (1.f / (1.f - getSrc0(i)));
-            EXPECT_NEAR(fp16(dst_buffer.data<float16_t>(i)).to_float(), limit, 0.5f)
+            EXPECT_NEAR(float(dst_buffer.data<float16_t>(i)), limit, 0.5f)
                 << "destination buffer element #" << i
                 << " has incorrect value: expected to be " << limit
-                << " but found " << fp16(dst_buffer.data<float16_t>(i)).to_float();
+                << " but found " << float(dst_buffer.data<float16_t>(i));
         }
     } else if (data_type == float32) {
         for (size_t i = 0; i < num_element; i++) {
@@ -91,28 +107,38 @@ static void throughput(::benchmark::State &state,
     // Benchmarking
     //===-------------------------------------------------------------------===/
     {
+#ifdef ARCHE_USE_METAL
         std::unique_ptr<Counter> gpu_counter;
         bool use_timestamp = mode == LatencyMeasureMode::kGpuTimestamp;
         if (use_timestamp) {
             gpu_counter = std::make_unique<Counter>(2);
         }
+#endif
 
         for ([[maybe_unused]] auto _ : state) {
+#ifdef ARCHE_USE_METAL
             auto capture_scope = DebugCaptureExt::create_scope("arche-capture");
+#endif
 
             auto start_time = std::chrono::high_resolution_clock::now();
 
+#ifdef ARCHE_USE_METAL
             capture_scope.start_debug_capture();
             capture_scope.mark_begin();
             if (use_timestamp) {
                 gpu_counter->sample_counters_in_buffer(0);
             }
-            throughput({src0_buffer, src1_buffer, dst_buffer});
+#endif
+            throughput({DeviceArray<const simd::float4>{src0_buffer}, DeviceArray<const simd::float4>{src1_buffer},
+                        DeviceArray<simd::float4>{dst_buffer}});
+#ifdef ARCHE_USE_METAL
             if (use_timestamp) {
                 gpu_counter->sample_counters_in_buffer(1);
                 gpu_counter->update_start_times();
             }
+#endif
             synchronize();
+#ifdef ARCHE_USE_METAL
             capture_scope.mark_end();
             capture_scope.stop_debug_capture();
 
@@ -120,6 +146,7 @@ static void throughput(::benchmark::State &state,
             if (use_timestamp) {
                 gpu_counter->update_final_times();
             }
+#endif
             auto end_time = std::chrono::high_resolution_clock::now();
             auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
             switch (mode) {
@@ -127,7 +154,11 @@ static void throughput(::benchmark::State &state,
                     state.SetIterationTime(elapsed_seconds.count());
                     break;
                 case LatencyMeasureMode::kGpuTimestamp:
+#ifdef ARCHE_USE_METAL
                     state.SetIterationTime(gpu_counter->calculate_elapsed_seconds_between(0, 1));
+#else
+                    state.SkipWithError("GPU timestamps are only available on Metal");
+#endif
                     break;
             }
         }
@@ -143,7 +174,8 @@ static void throughput(::benchmark::State &state,
 }
 
 void MADThroughPut::register_benchmarks(LatencyMeasureMode mode) {
-    const size_t num_element = 1024 * 1024;
+    // the host backend is orders of magnitude slower, keep a single iteration in seconds
+    const size_t num_element = device().name() == "Host" ? 4096 : 1024 * 1024;
     const int min_loop_count = 100000;
     const int max_loop_count = min_loop_count * 2;
 
@@ -151,7 +183,7 @@ void MADThroughPut::register_benchmarks(LatencyMeasureMode mode) {
          loop_count += min_loop_count) {
         std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "mad_throughput", num_element, loop_count);
 
-        ::benchmark::RegisterBenchmark(test_name, throughput, mode, fmt::format("mad_throughput_{}", loop_count),
+        ::benchmark::RegisterBenchmark(test_name.c_str(), throughput, mode, fmt::format("mad_throughput_{}", loop_count),
                                        num_element, loop_count, float32)
             ->UseManualTime()
             ->Unit(::benchmark::kMicrosecond)
@@ -4,6 +4,7 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <memory>
 #include "benchmark_api.h"
 
 int main(int argc, char **argv) {
@@ -12,5 +13,35 @@ int main(int argc, char **argv) {
     auto app = std::make_unique<vox::benchmark::MADThroughPut>();
     app->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
 
+    auto reduce = std::make_unique<vox::benchmark::Reduce>();
+    reduce->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto scan = std::make_unique<vox::benchmark::Scan>();
+    scan->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto sort = std::make_unique<vox::benchmark::Sort>();
+    sort->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto hash_grid = std::make_unique<vox::benchmark::HashGridBuild>();
+    hash_grid->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto histogram = std::make_unique<vox::benchmark::Histogram>();
+    histogram->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto segmented_reduce = std::make_unique<vox::benchmark::SegmentedReduce>();
+    segmented_reduce->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto kernel_launch = std::make_unique<vox::benchmark::KernelLaunch>();
+    kernel_launch->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto dispatch_overlap = std::make_unique<vox::benchmark::DispatchOverlap>();
+    dispatch_overlap->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto graph_replay = std::make_unique<vox::benchmark::GraphReplay>();
+    graph_replay->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
+    auto allocator = std::make_unique<vox::benchmark::AllocatorChurn>();
+    allocator->register_benchmarks(vox::benchmark::LatencyMeasureMode::kSystemSubmit);
+
     ::benchmark::RunSpecifiedBenchmarks();
 }
\ No newline at end of file
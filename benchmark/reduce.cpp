@@ -8,9 +8,13 @@
 #include "runtime/device.h"
 #include "runtime/array.h"
 #include "runtime/kernel.h"
+#include "runtime/primitives/reduce.h"
+#ifdef ARCHE_USE_METAL
 #include "runtime/extension/debug_capture_ext.h"
+#endif
 #include <spdlog/fmt/fmt.h>
 #include <gtest/gtest.h>
+#include <numeric>
 
 namespace vox::benchmark {
 template<typename T>
@@ -18,45 +22,53 @@ T generate_data(size_t i);
 
 template<>
 float generate_data(size_t i) {
-    return float(i % 9 - 4) * 0.5f;
+    return float(int(i % 9) - 4) * 0.5f;
 }
 
 template<>
-size_t generate_data(size_t i) {
-    return i % 13 - 7;
+int32_t generate_data(size_t i) {
+    return int32_t(i % 13) - 7;
+}
+
+template<typename T>
+T reference(ReduceType reduce_type, const std::vector<T> &data) {
+    switch (reduce_type) {
+        case ReduceType::Sum:
+            return std::accumulate(data.begin(), data.end(), T(0));
+        case ReduceType::Min:
+            return *std::min_element(data.begin(), data.end());
+        case ReduceType::Max:
+            return *std::max_element(data.begin(), data.end());
+        default:
+            return T(0);
+    }
 }
 
 template<typename T>
 static void reduce(::benchmark::State &state,
                    LatencyMeasureMode mode,
-                   const std::string &kernel_name,
+                   ReduceType reduce_type,
                    uint num_element) {
-    auto reduce = Kernel::builder().entry(kernel_name).build();
-
     //===-------------------------------------------------------------------===/
     // Set source buffer data
     //===-------------------------------------------------------------------===/
     std::vector<T> init(num_element, 0);
-    auto src_buffer = Array(init, TypeToDtype<T>());
-    auto dst_buffer = Array(init, TypeToDtype<T>());
-
     for (size_t i = 0; i < num_element; i++) {
-        src_buffer.data<T>(i) = generate_data<T>(i);
+        init[i] = generate_data<T>(i);
     }
+    auto src_buffer = Array(init, TypeToDtype<T>());
+    auto dst_buffer = Array(T(0), TypeToDtype<T>());
 
     //===-------------------------------------------------------------------===/
     // Dispatch
     //===-------------------------------------------------------------------===/
-    reduce({src_buffer, dst_buffer});
+    vox::reduce(src_buffer, dst_buffer, reduce_type);
     synchronize(true);
 
     //===-------------------------------------------------------------------===/
     // Verify destination buffer data
     //===-------------------------------------------------------------------===/
-    T total = 0;
-    for (size_t i = 0; i < num_element; i++) {
-        total += generate_data<T>(i);
-    };
+    T total = reference(reduce_type, init);
     EXPECT_NEAR(dst_buffer.data<T>(0), total, 0.01f)
         << "destination buffer element #0 has incorrect value: "
            "expected to be "
@@ -66,16 +78,22 @@ static void reduce(::benchmark::State &state,
     // Benchmarking
     //===-------------------------------------------------------------------===/
     for ([[maybe_unused]] auto _ : state) {
+#ifdef ARCHE_USE_METAL
         auto capture_scope = DebugCaptureExt::create_scope("arche-capture");
+#endif
 
         auto start_time = std::chrono::high_resolution_clock::now();
 
+#ifdef ARCHE_USE_METAL
         capture_scope.start_debug_capture();
         capture_scope.mark_begin();
-        reduce({src_buffer, dst_buffer});
-        synchronize();
+#endif
+        vox::reduce(src_buffer, dst_buffer, reduce_type);
+        synchronize(true);
+#ifdef ARCHE_USE_METAL
         capture_scope.mark_end();
         capture_scope.stop_debug_capture();
+#endif
 
         // prepare convert
         auto end_time = std::chrono::high_resolution_clock::now();
@@ -96,14 +114,40 @@ static void reduce(::benchmark::State &state,
                              ::benchmark::Counter::kIs1000);
 }
 
+// Single threaded std::accumulate, the baseline of the host backend
+template<typename T>
+static void reduce_reference(::benchmark::State &state, ReduceType reduce_type, uint num_element) {
+    std::vector<T> init(num_element, 0);
+    for (size_t i = 0; i < num_element; i++) {
+        init[i] = generate_data<T>(i);
+    }
+    for ([[maybe_unused]] auto _ : state) {
+        ::benchmark::DoNotOptimize(reference(reduce_type, init));
+    }
+    state.SetBytesProcessed(state.iterations() * num_element * sizeof(T));
+}
+
 void Reduce::register_benchmarks(LatencyMeasureMode mode) {
     const size_t total_elements = 1 << 22;// 4M
 
-    std::string test_name = fmt::format("{}/{}/{}", device().name(), "reduce", "xf32");
-    ::benchmark::RegisterBenchmark(test_name, reduce<float>, mode, fmt::format("reduce"),
-                                   total_elements)
+    for (auto [reduce_type, op_name] : {std::pair{ReduceType::Sum, "sum"},
+                                        std::pair{ReduceType::Min, "min"},
+                                        std::pair{ReduceType::Max, "max"}}) {
+        std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "reduce", op_name, "xf32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), reduce<float>, mode, reduce_type,
+                                       total_elements)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMicrosecond)
+            ->MinTime(std::numeric_limits<float>::epsilon());// use cache make calculation fast after warmup
+
+        test_name = fmt::format("{}/{}/{}/{}", "Reference", "reduce", op_name, "xf32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), reduce_reference<float>, reduce_type, total_elements)
+            ->Unit(::benchmark::kMicrosecond);
+    }
+
+    std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "reduce", "sum", "xi32");
+    ::benchmark::RegisterBenchmark(test_name.c_str(), reduce<int32_t>, mode, ReduceType::Sum, total_elements)
         ->UseManualTime()
-        ->Unit(::benchmark::kMicrosecond)
-        ->MinTime(std::numeric_limits<float>::epsilon());// use cache make calculation fast after warmup
+        ->Unit(::benchmark::kMicrosecond);
 }
 }// namespace vox::benchmark
\ No newline at end of file
@@ -0,0 +1,89 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/array.h"
+#include "runtime/primitives/scan.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <numeric>
+
+namespace vox::benchmark {
+static void scan(::benchmark::State &state, LatencyMeasureMode mode, uint num_element) {
+    //===-------------------------------------------------------------------===/
+    // Set source buffer data
+    //===-------------------------------------------------------------------===/
+    std::vector<int32_t> init(num_element);
+    for (size_t i = 0; i < num_element; i++) {
+        init[i] = int32_t(i % 13) - 7;
+    }
+    auto src_buffer = Array(init.data(), {int(num_element)}, int32);
+
+    //===-------------------------------------------------------------------===/
+    // Verify destination buffer data
+    //===-------------------------------------------------------------------===/
+    auto dst_buffer = vox::scan(src_buffer, ReduceType::Sum);
+    synchronize(true);
+    std::vector<int32_t> expected(num_element);
+    std::inclusive_scan(init.begin(), init.end(), expected.begin());
+    EXPECT_EQ(dst_buffer.data<int32_t>(num_element - 1), expected.back())
+        << "destination buffer last element has incorrect value";
+
+    //===-------------------------------------------------------------------===/
+    // Benchmarking
+    //===-------------------------------------------------------------------===/
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        auto result = vox::scan(src_buffer, ReduceType::Sum);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    // read and written once
+    state.SetBytesProcessed(state.iterations() * num_element * sizeof(int32_t) * 2);
+    state.counters["Elements"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+// Single threaded std::inclusive_scan, the baseline of the host backend
+static void scan_reference(::benchmark::State &state, uint num_element) {
+    std::vector<int32_t> init(num_element);
+    for (size_t i = 0; i < num_element; i++) {
+        init[i] = int32_t(i % 13) - 7;
+    }
+    std::vector<int32_t> out(num_element);
+    for ([[maybe_unused]] auto _ : state) {
+        std::inclusive_scan(init.begin(), init.end(), out.begin());
+        ::benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * num_element * sizeof(int32_t) * 2);
+}
+
+void Scan::register_benchmarks(LatencyMeasureMode mode) {
+    for (uint num_element : {1u << 16, 1u << 20, 1u << 24}) {
+        std::string test_name = fmt::format("{}/{}/{}/{}", device().name(), "scan", num_element, "xi32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), scan, mode, num_element)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMicrosecond);
+
+        test_name = fmt::format("{}/{}/{}/{}", "Reference", "scan", num_element, "xi32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), scan_reference, num_element)
+            ->Unit(::benchmark::kMicrosecond);
+    }
+}
+}// namespace vox::benchmark
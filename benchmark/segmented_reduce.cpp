@@ -0,0 +1,182 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/primitives/segmented_reduce.h"
+#include "runtime/transforms.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace vox::benchmark {
+enum class SegmentLengths { Uniform, Skewed, Single };
+
+static const char *segment_lengths_name(SegmentLengths lengths) {
+    switch (lengths) {
+        case SegmentLengths::Uniform:
+            return "uniform";
+        case SegmentLengths::Skewed:
+            return "skewed";
+        case SegmentLengths::Single:
+            return "single";
+    }
+    return "";
+}
+
+// Segments of 32 elements, of power law lengths from 1 to the whole input, or one segment
+static std::vector<uint32_t> generate_offsets(uint num_element, SegmentLengths lengths) {
+    std::mt19937 rng(num_element);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<uint32_t> offsets{0};
+    while (offsets.back() < num_element) {
+        uint32_t length = num_element;
+        if (lengths == SegmentLengths::Uniform) {
+            length = 32;
+        } else if (lengths == SegmentLengths::Skewed) {
+            length = uint32_t(std::pow(float(num_element) / 4.f, std::pow(dist(rng), 4.f)));
+        }
+        offsets.push_back(std::min(offsets.back() + length, num_element));
+    }
+    return offsets;
+}
+
+static std::vector<float> generate_values(uint num_element) {
+    std::mt19937 rng(num_element);
+    std::vector<float> values(num_element);
+    for (auto &v : values) {
+        v = float(rng() % 16);
+    }
+    return values;
+}
+
+static void segmented_reduce(::benchmark::State &state, LatencyMeasureMode mode, uint num_element,
+                             SegmentLengths lengths) {
+    //===-------------------------------------------------------------------===/
+    // Set source buffer data
+    //===-------------------------------------------------------------------===/
+    auto init = generate_values(num_element);
+    auto offsets = generate_offsets(num_element, lengths);
+    auto src_buffer = Array(init.data(), {int(num_element)}, float32);
+    auto offset_buffer = Array(offsets.data(), {int(offsets.size())}, uint32);
+
+    //===-------------------------------------------------------------------===/
+    // Verify destination buffer data
+    //===-------------------------------------------------------------------===/
+    auto sums = vox::segmented_reduce(src_buffer, offset_buffer, ReduceType::Sum);
+    synchronize(true);
+    double total = 0;
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        total += sums.data<float>(s);
+    }
+    // Long segments are summed in float by tiles
+    const double expected = std::accumulate(init.begin(), init.end(), 0.0);
+    EXPECT_NEAR(total, expected, expected * 1e-5) << "segment sums don't add up";
+
+    //===-------------------------------------------------------------------===/
+    // Benchmarking
+    //===-------------------------------------------------------------------===/
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        auto dst_buffer = vox::segmented_reduce(src_buffer, offset_buffer, ReduceType::Sum);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Elements"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+    state.counters["Segments"] = double(offsets.size() - 1);
+}
+
+// Runs of equal keys with the lengths of the segments
+static void reduce_by_key(::benchmark::State &state, LatencyMeasureMode mode, uint num_element,
+                          SegmentLengths lengths) {
+    auto init = generate_values(num_element);
+    auto offsets = generate_offsets(num_element, lengths);
+    std::vector<uint32_t> keys(num_element);
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        std::fill(keys.begin() + offsets[s], keys.begin() + offsets[s + 1], uint32_t(s));
+    }
+    auto key_buffer = Array(keys.data(), {int(num_element)}, uint32);
+    auto src_buffer = Array(init.data(), {int(num_element)}, float32);
+    auto [unique_keys, sums, count] = vox::reduce_by_key(key_buffer, src_buffer, ReduceType::Sum);
+    synchronize(true);
+    EXPECT_EQ(count.data<uint32_t>(0), offsets.size() - 1) << "wrong number of runs";
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        auto dst_buffers = vox::reduce_by_key(key_buffer, src_buffer, ReduceType::Sum);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Elements"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+// Single threaded loop over the segments, the baseline of the host backend
+static void segmented_reduce_reference(::benchmark::State &state, uint num_element, SegmentLengths lengths) {
+    auto init = generate_values(num_element);
+    auto offsets = generate_offsets(num_element, lengths);
+    std::vector<float> sums(offsets.size() - 1);
+    for ([[maybe_unused]] auto _ : state) {
+        for (size_t s = 0; s < sums.size(); s++) {
+            sums[s] = std::accumulate(init.begin() + offsets[s], init.begin() + offsets[s + 1], 0.f);
+        }
+        ::benchmark::DoNotOptimize(sums.data());
+    }
+    state.counters["Elements"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void SegmentedReduce::register_benchmarks(LatencyMeasureMode mode) {
+    constexpr uint num_element = 1u << 22;
+    for (auto lengths : {SegmentLengths::Uniform, SegmentLengths::Skewed, SegmentLengths::Single}) {
+        const char *name = segment_lengths_name(lengths);
+        std::string test_name = fmt::format("{}/{}/{}/{}/{}", device().name(), "segmented_reduce", num_element,
+                                            name, "xf32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), segmented_reduce, mode, num_element, lengths)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMillisecond);
+
+        test_name = fmt::format("{}/{}/{}/{}/{}", device().name(), "reduce_by_key", num_element, name, "xf32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), reduce_by_key, mode, num_element, lengths)
+            ->UseManualTime()
+            ->Unit(::benchmark::kMillisecond);
+
+        test_name = fmt::format("{}/{}/{}/{}/{}", "Reference", "segmented_reduce", num_element, name, "xf32");
+        ::benchmark::RegisterBenchmark(test_name.c_str(), segmented_reduce_reference, num_element, lengths)
+            ->Unit(::benchmark::kMillisecond);
+    }
+}
+}// namespace vox::benchmark
@@ -0,0 +1,100 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "benchmark_api.h"
+#include "runtime/device.h"
+#include "runtime/array.h"
+#include "runtime/primitives/sort.h"
+#include <spdlog/fmt/fmt.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+namespace vox::benchmark {
+static std::vector<uint32_t> generate_keys(uint num_element, int key_bits) {
+    std::mt19937 rng(num_element);
+    std::vector<uint32_t> keys(num_element);
+    for (auto &key : keys) {
+        key = key_bits == 32 ? rng() : rng() & ((1u << key_bits) - 1);
+    }
+    return keys;
+}
+
+static void radix_sort(::benchmark::State &state, LatencyMeasureMode mode, uint num_element, int key_bits) {
+    //===-------------------------------------------------------------------===/
+    // Set source buffer data
+    //===-------------------------------------------------------------------===/
+    auto init = generate_keys(num_element, key_bits);
+    auto src_buffer = Array(init.data(), {int(num_element)}, uint32);
+
+    //===-------------------------------------------------------------------===/
+    // Verify destination buffer data
+    //===-------------------------------------------------------------------===/
+    auto dst_buffer = vox::radix_sort(src_buffer, key_bits);
+    synchronize(true);
+    std::sort(init.begin(), init.end());
+    EXPECT_TRUE(std::equal(init.begin(), init.end(), dst_buffer.data<uint32_t>()))
+        << "destination buffer is not sorted";
+
+    //===-------------------------------------------------------------------===/
+    // Benchmarking
+    //===-------------------------------------------------------------------===/
+    for ([[maybe_unused]] auto _ : state) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        auto result = vox::radix_sort(src_buffer, key_bits);
+        synchronize(true);
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end_time - start_time);
+        switch (mode) {
+            case LatencyMeasureMode::kSystemSubmit:
+                state.SetIterationTime(elapsed_seconds.count());
+                break;
+            case LatencyMeasureMode::kGpuTimestamp:
+                break;
+        }
+    }
+    state.counters["Keys"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+// Single threaded std::sort, the baseline of the host backend
+static void sort_reference(::benchmark::State &state, uint num_element, int key_bits) {
+    auto init = generate_keys(num_element, key_bits);
+    std::vector<uint32_t> keys(num_element);
+    for ([[maybe_unused]] auto _ : state) {
+        state.PauseTiming();
+        keys = init;
+        state.ResumeTiming();
+        std::sort(keys.begin(), keys.end());
+        ::benchmark::DoNotOptimize(keys.data());
+    }
+    state.counters["Keys"] =
+        ::benchmark::Counter(num_element,
+                             ::benchmark::Counter::kIsIterationInvariant |
+                                 ::benchmark::Counter::kIsRate,
+                             ::benchmark::Counter::kIs1000);
+}
+
+void Sort::register_benchmarks(LatencyMeasureMode mode) {
+    for (uint num_element : {1u << 20, 1u << 22}) {
+        for (int key_bits : {32, 20}) {
+            std::string test_name = fmt::format("{}/{}/{}/{}bits/{}", device().name(), "radix_sort", num_element,
+                                                key_bits, "xu32");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), radix_sort, mode, num_element, key_bits)
+                ->UseManualTime()
+                ->Unit(::benchmark::kMillisecond);
+
+            test_name = fmt::format("{}/{}/{}/{}bits/{}", "Reference", "std_sort", num_element, key_bits, "xu32");
+            ::benchmark::RegisterBenchmark(test_name.c_str(), sort_reference, num_element, key_bits)
+                ->Unit(::benchmark::kMillisecond);
+        }
+    }
+}
+}// namespace vox::benchmark
@@ -204,7 +204,7 @@ void from_bytes(const std::vector<std::byte> &bytes, std::vector<T> &object) {
     std::copy(bytes.begin(), bytes.end(), begin_object);
 }
 
-[[nodiscard]] inline auto align(size_t s, size_t a) noexcept {
+[[nodiscard]] constexpr auto align(size_t s, size_t a) noexcept {
     return (s + (a - 1)) & ~(a - 1);
 }
 }// namespace vox
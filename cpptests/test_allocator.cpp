@@ -0,0 +1,323 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include "runtime/allocator.h"
+#include "runtime/host/host_device.h"
+#include "runtime/host/host_kernel.h"
+#include "runtime/host/host_stream.h"
+
+using namespace vox;
+
+namespace {
+size_t page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Keeps the stream busy long enough for malloc_or_wait to find the work in flight
+void sleep_kernel(const std::byte *, const ThreadgroupContext &) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+// Buffer freed when the stream releases the command buffer retaining it
+struct InFlightBuffer {
+    InFlightBuffer(Allocator &allocator, Buffer buffer) : allocator{allocator}, buffer{buffer} {}
+    InFlightBuffer(const InFlightBuffer &) = delete;
+    Allocator &allocator;
+    Buffer buffer;
+    ~InFlightBuffer() {
+        allocator.free(buffer);
+    }
+};
+
+// Simulates a kernel still reading buffer, the stream owns it from now on
+void launch_with(HostDevice &host, Allocator &allocator, Buffer buffer) {
+    auto &stream = host.stream(0);
+    auto encoder = stream.get_command_encoder();
+    encoder->set_pipeline(host.get_kernel("test_sleep"));
+    encoder->dispatch_thread_groups(Size3{1, 1, 1}, Size3{1, 1, 1});
+    stream.retain(std::make_shared<InFlightBuffer>(allocator, buffer));
+    stream.synchronize();
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_sleep", sleep_kernel);
+
+TEST(Allocator, Empty) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    auto empty = allocator.malloc(0);
+    EXPECT_EQ(empty.ptr(), nullptr);
+    allocator.free(empty);
+    EXPECT_EQ(allocator.cache_size(), 0u);
+}
+
+TEST(Allocator, SizeClass) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    auto small = allocator.malloc(100);
+    ASSERT_NE(small.ptr(), nullptr);
+    EXPECT_EQ(small.size(), 128u);
+    EXPECT_EQ(small.address(), reinterpret_cast<uint64_t>(small.raw_ptr()));
+
+    auto large = allocator.malloc(page_size() + 1);
+    EXPECT_EQ(large.size(), 2 * page_size());
+    EXPECT_EQ(large.offset(), 0u);
+    EXPECT_EQ(large.slab(), nullptr);
+
+    allocator.free(small);
+    allocator.free(large);
+}
+
+TEST(Allocator, Reuse) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    auto buffer = allocator.malloc(3 * page_size());
+    auto ptr = buffer.ptr();
+    allocator.free(buffer);
+    EXPECT_EQ(allocator.cache_size(), 3 * page_size());
+    EXPECT_EQ(host.current_allocated_size(), 3 * page_size());
+
+    // best fit within the same size class
+    buffer = allocator.malloc(3 * page_size() - 10);
+    EXPECT_EQ(buffer.ptr(), ptr);
+    EXPECT_EQ(allocator.cache_size(), 0u);
+
+    // too large to be wasted on a small request
+    allocator.free(buffer);
+    auto small = allocator.malloc(64);
+    EXPECT_NE(small.ptr(), ptr);
+    EXPECT_EQ(allocator.cache_size(), 3 * page_size());
+
+    allocator.free(small);
+    allocator.clear_cache();
+    EXPECT_EQ(allocator.cache_size(), 0u);
+    EXPECT_EQ(host.current_allocated_size(), 0u);
+}
+
+TEST(Allocator, CacheLimit) {
+    HostDevice host{1};
+    Allocator allocator{host};
+    allocator.set_cache_limit(2 * page_size());
+
+    auto a = allocator.malloc(page_size());
+    auto b = allocator.malloc(page_size());
+    auto c = allocator.malloc(page_size());
+    auto b_ptr = b.ptr();
+    auto c_ptr = c.ptr();
+
+    // the least recently freed buffer is released first
+    allocator.free(a);
+    allocator.free(b);
+    allocator.free(c);
+    EXPECT_EQ(allocator.cache_size(), 2 * page_size());
+    EXPECT_EQ(host.current_allocated_size(), 2 * page_size());
+
+    a = allocator.malloc(page_size());
+    b = allocator.malloc(page_size());
+    EXPECT_TRUE((a.ptr() == b_ptr && b.ptr() == c_ptr) || (a.ptr() == c_ptr && b.ptr() == b_ptr));
+
+    // a limit of 0 disables the cache
+    EXPECT_EQ(allocator.set_cache_limit(0), 2 * page_size());
+    allocator.free(a);
+    allocator.free(b);
+    EXPECT_EQ(allocator.cache_size(), 0u);
+    EXPECT_EQ(host.current_allocated_size(), 0u);
+}
+
+TEST(Allocator, SubAllocation) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    // tiny arrays share a slab
+    auto a = allocator.malloc(4);
+    auto b = allocator.malloc(4);
+    auto c = allocator.malloc(64);
+    ASSERT_NE(a.slab(), nullptr);
+    EXPECT_EQ(a.slab(), b.slab());
+    EXPECT_NE(a.slab(), c.slab());
+    EXPECT_EQ(a.ptr(), b.ptr());
+    EXPECT_NE(a.offset(), b.offset());
+    EXPECT_EQ(b.raw_ptr(), static_cast<std::byte *>(a.raw_ptr()) - a.offset() + b.offset());
+    EXPECT_EQ(b.address(), reinterpret_cast<uint64_t>(b.raw_ptr()));
+
+    // freed slots are reused
+    auto b_offset = b.offset();
+    allocator.free(b);
+    b = allocator.malloc(16);
+    EXPECT_EQ(b.offset(), b_offset);
+
+    allocator.free(a);
+    allocator.free(b);
+    allocator.free(c);
+    EXPECT_GT(host.current_allocated_size(), 0u);
+    allocator.clear_cache();
+    EXPECT_EQ(host.current_allocated_size(), 0u);
+}
+
+TEST(Allocator, SlabHeap) {
+    HostDevice host{1};
+    SlabHeap heap{host, 1024};
+
+    // a slab holds 1024 / 256 slots
+    std::vector<Buffer> buffers;
+    for (size_t i = 0; i < 5; i++) {
+        buffers.push_back(heap.malloc(256));
+        EXPECT_EQ(buffers.back().offset(), (i % 4) * 256);
+    }
+    EXPECT_EQ(heap.slab_count(), 2u);
+
+    // an empty slab is released once another one of the class has room
+    for (size_t i = 0; i < 4; i++) {
+        heap.free(buffers[i]);
+    }
+    EXPECT_EQ(heap.slab_count(), 1u);
+    heap.free(buffers[4]);
+    EXPECT_EQ(heap.slab_count(), 1u);
+
+    heap.release_empty_slabs();
+    EXPECT_EQ(heap.slab_count(), 0u);
+    EXPECT_EQ(host.current_allocated_size(), 0u);
+}
+
+TEST(Allocator, Stats) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    auto a = allocator.malloc(100);
+    auto b = allocator.malloc(3 * page_size());
+    auto stats = allocator.stats();
+    EXPECT_EQ(stats.active_memory, 128 + 3 * page_size());
+    EXPECT_EQ(stats.peak_memory, stats.active_memory);
+    EXPECT_EQ(stats.num_allocations, 2u);
+    EXPECT_EQ(stats.num_active_allocations, 2u);
+    EXPECT_EQ(stats.size_class_histogram[128], 1u);
+    // the rest of the slab is available for reuse
+    EXPECT_EQ(stats.cache_memory, (1u << 16) - 128);
+
+    allocator.free(b);
+    stats = allocator.stats();
+    EXPECT_EQ(stats.active_memory, 128u);
+    EXPECT_EQ(stats.peak_memory, 128 + 3 * page_size());
+    EXPECT_EQ(stats.cache_memory, (1u << 16) - 128 + 3 * page_size());
+    EXPECT_EQ(stats.num_active_allocations, 1u);
+
+    allocator.reset_peak();
+    EXPECT_EQ(allocator.stats().peak_memory, 128u);
+    allocator.free(a);
+}
+
+TEST(Allocator, Tags) {
+    HostDevice host{1};
+    Allocator allocator{host};
+
+    Buffer a{nullptr}, b{nullptr}, c{nullptr};
+    {
+        AllocationTag tag("solver");
+        a = allocator.malloc(64);
+        {
+            AllocationTag nested("collision");
+            b = allocator.malloc(page_size() * 2);
+        }
+        c = allocator.malloc(64);
+    }
+    auto untagged = allocator.malloc(64);
+
+    auto stats = allocator.stats();
+    EXPECT_EQ(stats.tag_active_memory["solver"], 128u);
+    EXPECT_EQ(stats.tag_active_memory["collision"], 2 * page_size());
+
+    allocator.free(a);
+    allocator.free(b);
+    stats = allocator.stats();
+    EXPECT_EQ(stats.tag_active_memory["solver"], 64u);
+    EXPECT_EQ(stats.tag_active_memory["collision"], 0u);
+
+    allocator.free(c);
+    allocator.free(untagged);
+}
+
+TEST(Allocator, MemoryLimit) {
+    HostDevice host{1};
+    Allocator allocator{host};
+    allocator.set_cache_limit(0);
+    allocator.set_memory_limit(8 * page_size());
+
+    auto a = allocator.malloc(4 * page_size());
+    ASSERT_NE(a.ptr(), nullptr);
+    EXPECT_EQ(allocator.malloc(4 * page_size()).ptr(), nullptr);
+
+    // Swap keeps the previous behaviour and goes past the limit
+    EXPECT_EQ(allocator.memory_pressure_policy(), MemoryPressurePolicy::Swap);
+    auto b = allocator.malloc_or_wait(4 * page_size());
+    EXPECT_NE(b.ptr(), nullptr);
+    allocator.free(b);
+
+    allocator.set_memory_pressure_policy(MemoryPressurePolicy::Throw);
+    EXPECT_EQ(allocator.malloc_or_wait(4 * page_size()).ptr(), nullptr);
+    allocator.free(a);
+}
+
+TEST(Allocator, MemoryLimitSmall) {
+    // Slabs count towards the limit even if every allocation is small
+    HostDevice host{1};
+    Allocator allocator{host};
+    allocator.set_cache_limit(0);
+    allocator.set_memory_limit(2 * (1 << 16));
+
+    // The first slab of the class fits, the second one would reach the limit
+    std::vector<Buffer> buffers;
+    for (size_t i = 0; i < (1 << 16) / 2048; i++) {
+        buffers.push_back(allocator.malloc(2048));
+        ASSERT_NE(buffers.back().ptr(), nullptr);
+    }
+    EXPECT_EQ(allocator.malloc(2048).ptr(), nullptr);
+    EXPECT_EQ(allocator.malloc(16).ptr(), nullptr);
+    EXPECT_EQ(host.current_allocated_size(), size_t(1 << 16));
+
+    allocator.set_memory_pressure_policy(MemoryPressurePolicy::Throw);
+    EXPECT_EQ(allocator.malloc_or_wait(2048).ptr(), nullptr);
+    allocator.set_memory_pressure_policy(MemoryPressurePolicy::Swap);
+    buffers.push_back(allocator.malloc_or_wait(2048));
+    EXPECT_NE(buffers.back().ptr(), nullptr);
+
+    for (auto &buffer : buffers) {
+        allocator.free(buffer);
+    }
+    allocator.clear_cache();
+    EXPECT_EQ(host.current_allocated_size(), 0u);
+}
+
+TEST(Allocator, Backpressure) {
+    HostDevice host{1};
+    Allocator allocator{host};
+    allocator.set_memory_limit(8 * page_size());
+    allocator.set_memory_pressure_policy(MemoryPressurePolicy::Backpressure);
+
+    // The cache is evicted first
+    allocator.free(allocator.malloc(4 * page_size()));
+    EXPECT_EQ(allocator.cache_size(), 4 * page_size());
+    auto a = allocator.malloc_or_wait(6 * page_size());
+    ASSERT_NE(a.ptr(), nullptr);
+    EXPECT_EQ(allocator.cache_size(), 0u);
+    allocator.free(a);
+    allocator.clear_cache();
+
+    // Then the streams retire the work keeping the memory alive
+    launch_with(host, allocator, allocator.malloc(6 * page_size()));
+    EXPECT_EQ(allocator.stats().active_memory, 6 * page_size());
+    auto b = allocator.malloc_or_wait(6 * page_size());
+    ASSERT_NE(b.ptr(), nullptr);
+    EXPECT_EQ(allocator.stats().active_memory, 6 * page_size());
+    EXPECT_LT(host.current_allocated_size(), 8 * page_size());
+    allocator.free(b);
+}
@@ -0,0 +1,114 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "runtime/arena.h"
+#include "runtime/array.h"
+#include "runtime/host/host_device.h"
+#include "runtime/host/host_stream.h"
+
+using namespace vox;
+
+namespace {
+// Keeps the command buffer in flight while the test drops its copies of the Arrays
+void busy_kernel(const std::byte *, const ThreadgroupContext &) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_arena_busy", busy_kernel);
+
+TEST(Arena, Bump) {
+    HostDevice host{1};
+    Allocator allocator{host};
+    Arena arena{4096, allocator};
+    EXPECT_EQ(arena.capacity(), 4096u);
+
+    auto a = arena.allocate(4);
+    auto b = arena.allocate(100);
+    EXPECT_EQ(a.ptr(), b.ptr());
+    EXPECT_EQ(b.offset() - a.offset(), Arena::alignment);
+    EXPECT_EQ(b.address() % Arena::alignment, 0u);
+    EXPECT_EQ(arena.used(), Arena::alignment + 128);
+    arena.release(a);
+    arena.release(b);
+
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.high_water_mark(), Arena::alignment + 128);
+
+    // memory is reused from the start after a reset
+    auto c = arena.allocate(8);
+    EXPECT_EQ(c.offset(), a.offset());
+    arena.release(c);
+    arena.reset();
+}
+
+TEST(Arena, Overflow) {
+    HostDevice host{1};
+    Allocator allocator{host};
+    Arena arena{4096, allocator};
+
+    auto a = arena.allocate(3000);
+    auto b = arena.allocate(3000);
+    EXPECT_NE(a.ptr(), b.ptr());
+    EXPECT_EQ(arena.high_water_mark(), 6016u);
+    arena.release(a);
+    arena.release(b);
+
+    // the slab grows to the high-water mark
+    arena.reset();
+    EXPECT_GE(arena.capacity(), 6016u);
+    a = arena.allocate(3000);
+    b = arena.allocate(3000);
+    EXPECT_EQ(a.ptr(), b.ptr());
+    arena.release(a);
+    arena.release(b);
+    arena.reset();
+}
+
+TEST(Arena, Array) {
+    Arena arena{1 << 16};
+    {
+        ArenaScope scope(arena);
+        Array scratch({16, 4}, float32, arena);
+        EXPECT_EQ(scratch.size(), 64u);
+        for (size_t i = 0; i < scratch.size(); i++) {
+            scratch.data<float>(i) = float(i);
+        }
+        Array other({3}, uint32, arena);
+        EXPECT_EQ(other.buffer().offset(), scratch.buffer().offset() + 256);
+        EXPECT_EQ(arena.used(), 256u + Arena::alignment);
+    }
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.high_water_mark(), 256u + Arena::alignment);
+}
+
+TEST(Arena, ReleaseFromStreams) {
+    // The streams release the Arrays they retained on their own threads, while the test allocates more
+    HostDevice host{2};
+    Allocator allocator{host};
+    Arena arena{1 << 12, allocator};
+    for (int step = 0; step < 20; step++) {
+        for (int i = 0; i < 32; i++) {
+            auto &stream = host.stream(i % 2);
+            Array scratch({16}, float32, arena);
+            auto encoder = stream.get_command_encoder();
+            encoder->set_pipeline(host.get_kernel("test_arena_busy"));
+            encoder->dispatch_thread_groups(Size3{1, 1, 1}, Size3{1, 1, 1});
+            stream.retain(scratch.data_shared_ptr());
+            stream.synchronize();
+        }
+        EXPECT_EQ(arena.used(), 32 * Arena::alignment);
+        host.stream(0).synchronize(true);
+        host.stream(1).synchronize(true);
+        arena.reset();
+        EXPECT_EQ(arena.used(), 0u);
+    }
+    EXPECT_EQ(arena.high_water_mark(), 32 * Arena::alignment);
+}
@@ -0,0 +1,147 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include "runtime/ops.h"
+#include "runtime/primitives/arg_reduce.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+// Few distinct values so every reduction has ties
+template<typename T>
+std::vector<T> make_data(size_t size) {
+    std::vector<T> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = T(int(i * 7919 % 13) - (std::is_signed_v<T> ? 6 : 0));
+    }
+    return data;
+}
+
+template<typename T>
+void check_flat(Dtype dtype) {
+    for (size_t size : {1, 17, 5000, (1 << 20) + 3}) {
+        auto data = make_data<T>(size);
+        Array src(data.data(), {int(size)}, dtype);
+        auto min_index = argmin(src);
+        auto max_index = argmax(src);
+        synchronize(true);
+
+        EXPECT_EQ(min_index.dtype(), uint32);
+        EXPECT_EQ(min_index.data<uint32_t>(0), std::min_element(data.begin(), data.end()) - data.begin())
+            << "size " << size;
+        EXPECT_EQ(max_index.data<uint32_t>(0), std::max_element(data.begin(), data.end()) - data.begin())
+            << "size " << size;
+    }
+}
+}// namespace
+
+TEST(ArgReduce, Flat) {
+    check_flat<float>(float32);
+    check_flat<int32_t>(int32);
+    check_flat<uint8_t>(uint8);
+    check_flat<int64_t>(int64);
+    check_flat<float16_t>(float16);
+}
+
+TEST(ArgReduce, LowestIndexOfTies) {
+    // the identities of min and max
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<float> data(10000, inf);
+    data[7000] = -inf;
+    data[9000] = -inf;
+    Array src(data.data(), {int(data.size())}, float32);
+    auto max_index = argmax(src);
+    auto min_index = argmin(src);
+    auto rows = argmin(reshape(src, {10, 1000}), 1);
+    synchronize(true);
+    EXPECT_EQ(max_index.data<uint32_t>(0), 0);
+    EXPECT_EQ(min_index.data<uint32_t>(0), 7000);
+    EXPECT_EQ(rows.data<uint32_t>(3), 0);
+    EXPECT_EQ(rows.data<uint32_t>(9), 0);
+}
+
+TEST(ArgReduce, Axes) {
+    const std::vector<int> shape{6, 35, 9};
+    auto data = make_data<float>(6 * 35 * 9);
+    Array src(data.data(), shape, float32);
+
+    for (int axis = 0; axis < 3; axis++) {
+        auto indices = argmax(src, axis);
+        auto kept = argmin(src, axis, true);
+        // the same elements read through the strides of a transpose
+        auto transposed = argmax(transpose(src, {2, 0, 1}), (axis + 1) % 3);
+        synchronize(true);
+
+        std::vector<int> out_shape = shape;
+        out_shape.erase(out_shape.begin() + axis);
+        ASSERT_EQ(indices.shape(), out_shape);
+        ASSERT_EQ(kept.shape(), (std::vector<int>{axis == 0 ? 1 : 6, axis == 1 ? 1 : 35, axis == 2 ? 1 : 9}));
+
+        const int64_t stride = axis == 0 ? 35 * 9 : axis == 1 ? 9 : 1;
+        for (int i = 0; i < 6; i++) {
+            for (int j = 0; j < 35; j++) {
+                for (int k = 0; k < 9; k++) {
+                    int coords[3] = {i, j, k};
+                    if (coords[axis] != 0) {
+                        continue;
+                    }
+                    const int64_t base = i * 35 * 9 + j * 9 + k;
+                    uint32_t best_max = 0;
+                    uint32_t best_min = 0;
+                    for (int r = 1; r < shape[axis]; r++) {
+                        best_max = data[base + r * stride] > data[base + best_max * stride] ? r : best_max;
+                        best_min = data[base + r * stride] < data[base + best_min * stride] ? r : best_min;
+                    }
+                    size_t out = 0;
+                    for (int d = 0; d < 3; d++) {
+                        if (d != axis) {
+                            out = out * shape[d] + coords[d];
+                        }
+                    }
+                    ASSERT_EQ(indices.data<uint32_t>(out), best_max) << "axis " << axis << " output " << out;
+                    ASSERT_EQ(kept.data<uint32_t>(out), best_min) << "axis " << axis << " output " << out;
+
+                    // dimension d of the transpose is dimension t_axes[d] of src
+                    const int t_axes[3] = {2, 0, 1};
+                    size_t t_out = 0;
+                    for (int d = 0; d < 3; d++) {
+                        if (t_axes[d] != axis) {
+                            t_out = t_out * shape[t_axes[d]] + coords[t_axes[d]];
+                        }
+                    }
+                    ASSERT_EQ(transposed.data<uint32_t>(t_out), best_max) << "axis " << axis << " output " << out;
+                }
+            }
+        }
+    }
+}
+
+TEST(ArgReduce, TransposedColumns) {
+    std::vector<float> data{3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8};
+    Array src(data.data(), {3, 4}, float32);
+    // argmax over the rows of the transpose is over the columns of src
+    auto indices = argmax(transpose(src), 1);
+    auto flat = argmin(transpose(src));
+    synchronize(true);
+    // the first column has two 5
+    EXPECT_EQ(indices.data<uint32_t>(0), 1);
+    EXPECT_EQ(indices.data<uint32_t>(1), 1);
+    EXPECT_EQ(indices.data<uint32_t>(2), 2);
+    EXPECT_EQ(indices.data<uint32_t>(3), 2);
+    // transpose is [[3, 5, 5], [1, 9, 3], [4, 2, 5], [1, 6, 8]], the first 1 is at 3
+    EXPECT_EQ(flat.data<uint32_t>(0), 3);
+}
+
+TEST(ArgReduce, Invalid) {
+    Array empty(std::vector<int>{0, 3}, float32, nullptr, {});
+    EXPECT_THROW(argmin(empty), std::invalid_argument);
+    EXPECT_THROW(argmax(empty, 0), std::invalid_argument);
+    EXPECT_THROW(argmax(empty, 2), std::invalid_argument);
+}
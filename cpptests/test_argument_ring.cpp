@@ -0,0 +1,145 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include "runtime/argument_ring.h"
+#include "runtime/array.h"
+#include "runtime/host/host_device.h"
+#include "runtime/kernel.h"
+
+using namespace vox;
+
+namespace {
+constexpr size_t large_uniform_count = 32768;
+
+// Arguments larger than the 64 KB the argument buffer used to be limited to
+struct LargeArguments {
+    uint32_t *out;
+    uint32_t values[large_uniform_count];
+};
+
+void sum_uniform(const std::byte *arguments, const ThreadgroupContext &context) {
+    auto args = reinterpret_cast<const LargeArguments *>(arguments);
+    uint32_t sum = 0;
+    for (auto value : args->values) {
+        sum += value;
+    }
+    *args->out = sum;
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_sum_uniform", sum_uniform);
+
+TEST(ArgumentRing, Recycle) {
+    HostDevice host{1};
+    ArgumentRing ring{host, 4096};
+    EXPECT_EQ(ring.capacity(), 0u);
+
+    auto a = ring.allocate(4);
+    EXPECT_EQ(ring.capacity(), 4096u);
+    auto b = ring.allocate(100);
+    EXPECT_EQ(a.buffer.ptr(), b.buffer.ptr());
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(b.offset, ArgumentRing::alignment);
+    EXPECT_EQ(b.data - a.data, ArgumentRing::alignment);
+    auto mark = ring.commit();
+    EXPECT_EQ(ring.in_flight(), 2 * ArgumentRing::alignment);
+
+    ring.release(mark);
+    EXPECT_EQ(ring.in_flight(), 0u);
+
+    // Goes around the buffer, the released bytes are reused in place
+    for (size_t i = 0; i < 4096 / ArgumentRing::alignment; i++) {
+        auto c = ring.allocate(ArgumentRing::alignment);
+        EXPECT_EQ(c.offset, (i + 2) * ArgumentRing::alignment % 4096);
+    }
+    EXPECT_EQ(ring.capacity(), 4096u);
+    EXPECT_EQ(host.current_allocated_size(), 4096u);
+    ring.release(ring.commit());
+}
+
+TEST(ArgumentRing, Grow) {
+    HostDevice host{1};
+    ArgumentRing ring{host, 4096};
+
+    std::vector<ArgumentRing::Allocation> allocations;
+    for (uint32_t i = 0; i < 4096 / ArgumentRing::alignment; i++) {
+        allocations.push_back(ring.allocate(sizeof(i)));
+        std::memcpy(allocations.back().data, &i, sizeof(i));
+    }
+    auto mark = ring.commit();
+
+    // Every byte is in flight, the next allocation moves to a larger buffer
+    auto next = ring.allocate(8);
+    EXPECT_EQ(next.offset, 0u);
+    EXPECT_NE(next.buffer.ptr(), allocations[0].buffer.ptr());
+    EXPECT_EQ(ring.capacity(), 8192u);
+    EXPECT_EQ(host.current_allocated_size(), 4096u + 8192u);
+
+    // The in flight bytes are untouched until their command buffer completed
+    for (uint32_t i = 0; i < allocations.size(); i++) {
+        uint32_t value;
+        std::memcpy(&value, allocations[i].data, sizeof(value));
+        EXPECT_EQ(value, i);
+    }
+    ring.release(mark);
+    EXPECT_EQ(host.current_allocated_size(), 4096u + 8192u);
+
+    // The previous buffer goes with the first command buffer committed after the move
+    ring.release(ring.commit());
+    EXPECT_EQ(host.current_allocated_size(), 8192u);
+    EXPECT_EQ(ring.in_flight(), 0u);
+}
+
+TEST(ArgumentRing, Large) {
+    HostDevice host{1};
+    ArgumentRing ring{host, 4096};
+
+    // An idle ring moves to the larger buffer at once
+    auto allocation = ring.allocate(100000);
+    EXPECT_EQ(allocation.offset, 0u);
+    EXPECT_GE(ring.capacity(), 100000u);
+    EXPECT_EQ(host.current_allocated_size(), ring.capacity());
+    ring.release(ring.commit());
+}
+
+TEST(ArgumentRing, Stream) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    auto &ring = device().stream(0).argument_ring();
+    auto values = std::make_unique<std::array<uint32_t, large_uniform_count>>();
+    for (uint32_t i = 0; i < large_uniform_count; i++) {
+        (*values)[i] = i;
+    }
+    std::vector<uint32_t> init(1, 0);
+    Array out(init, uint32);
+
+    auto kernel = Kernel::builder().entry("test_sum_uniform").build();
+    kernel.set_thread_groups(1);
+    kernel.set_threads_per_thread_group(1);
+    const uint32_t expected = large_uniform_count * (large_uniform_count - 1) / 2;
+
+    // The argument bytes are recycled once their command buffer completed, the ring stops growing
+    // once it holds the arguments of a command buffer
+    size_t capacity = 0;
+    for (uint32_t i = 0; i < 40; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+            kernel.launch(0, out, *values);
+        }
+        synchronize(true);
+        EXPECT_EQ(out.data<uint32_t>(0), expected);
+        EXPECT_EQ(ring.in_flight(), 0u);
+        if (i == 10) {
+            capacity = ring.capacity();
+            EXPECT_LE(capacity, 4 * 4 * sizeof(LargeArguments));
+        } else if (i > 10) {
+            EXPECT_EQ(ring.capacity(), capacity);
+        }
+    }
+}
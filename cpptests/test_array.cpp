@@ -0,0 +1,196 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <unistd.h>
+#include "runtime/array.h"
+#include "runtime/ops.h"
+#include "runtime/primitives/scan.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+size_t page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+}// namespace
+
+TEST(Array, ZeroCopy) {
+    const size_t count = page_size() / sizeof(float);
+    auto data = static_cast<float *>(std::aligned_alloc(page_size(), page_size()));
+    for (size_t i = 0; i < count; i++) {
+        data[i] = float(i);
+    }
+
+    int deleted = 0;
+    {
+        Array array(data, {int(count)}, float32, [&](void *ptr) {
+            EXPECT_EQ(ptr, data);
+            deleted++;
+            std::free(ptr);
+        });
+        EXPECT_EQ(array.data<float>(), data);
+        EXPECT_EQ(array.data<float>(7), 7.f);
+        EXPECT_EQ(deleted, 0);
+
+        // shared with the caller, no copy was made
+        data[7] = 42.f;
+        EXPECT_EQ(array.data<float>(7), 42.f);
+
+        // copies share the wrapped memory as well
+        Array copy = array;
+        EXPECT_EQ(copy.data<float>(), data);
+    }
+    EXPECT_EQ(deleted, 1);
+}
+
+TEST(Array, ZeroCopyFallback) {
+    // unaligned memory is copied when the backend can't map it, either way the deleter runs once
+    std::vector<uint32_t> storage{0, 1, 2, 3, 4};
+    int deleted = 0;
+    {
+        Array array(storage.data() + 1, {4}, uint32, [&](void *) { deleted++; });
+        for (uint32_t i = 0; i < 4; i++) {
+            EXPECT_EQ(array.data<uint32_t>(i), i + 1);
+        }
+        if (array.data<uint32_t>() != storage.data() + 1) {
+            EXPECT_EQ(deleted, 1);
+        }
+    }
+    EXPECT_EQ(deleted, 1);
+}
+
+TEST(Array, ZeroCopyBorrowed) {
+    // without a deleter the memory stays with the caller, it is never recycled for other Arrays
+    std::vector<int32_t> storage(1024, 7);
+    {
+        Array array(storage.data(), {1024}, int32, {});
+        EXPECT_EQ(array.data<int32_t>(1023), 7);
+    }
+    Array next({1024}, int32, nullptr, {});
+    next.allocate();
+    EXPECT_NE(next.data<int32_t>(), storage.data());
+
+    // the unaligned fallback copies and leaves the memory alone as well
+    {
+        Array array(storage.data() + 1, {1023}, int32, {});
+        EXPECT_EQ(array.data<int32_t>(0), 7);
+    }
+    EXPECT_EQ(storage[1], 7);
+}
+
+TEST(Array, Slice) {
+    std::vector<uint32_t> init(12);
+    std::iota(init.begin(), init.end(), 0);
+    Array a(init.data(), {3, 4}, uint32);
+
+    // rows 1..2, every second column
+    auto s = slice(a, {1, 0}, {3, 4}, {1, 2});
+    EXPECT_EQ(s.shape(), (std::vector<int>{2, 2}));
+    EXPECT_EQ(s.strides(), (std::vector<int64_t>{4, 2}));
+    EXPECT_FALSE(s.is_contiguous());
+    EXPECT_EQ(s.data_shared_ptr(), a.data_shared_ptr());
+    EXPECT_EQ(s.offset(), a.offset() + 4 * sizeof(uint32_t));
+    EXPECT_EQ(s.address(), a.address() + 4 * sizeof(uint32_t));
+
+    // writes are visible through the base array
+    s.data<uint32_t>(2) = 100;
+    EXPECT_EQ(a.data<uint32_t>(6), 100u);
+
+    // negative indices and strides count from the end
+    auto reversed = slice(a, {-1, -1}, {-4, -5}, {-1, -1});
+    EXPECT_EQ(reversed.shape(), (std::vector<int>{3, 4}));
+    EXPECT_EQ(contiguous(reversed).data<uint32_t>(0), 11u);
+    EXPECT_EQ(contiguous(reversed).data<uint32_t>(11), 0u);
+
+    auto row = take(a, -1);
+    EXPECT_EQ(row.shape(), (std::vector<int>{4}));
+    EXPECT_TRUE(row.is_contiguous());
+    EXPECT_EQ(row.data<uint32_t>(0), 8u);
+
+    EXPECT_EQ(slice(a, {2, 0}, {1, 4}).size(), 0u);
+    EXPECT_THROW(take(a, 3), std::invalid_argument);
+}
+
+TEST(Array, TransposeReshape) {
+    std::vector<float> init(6);
+    std::iota(init.begin(), init.end(), 0.f);
+    Array a(init.data(), {2, 3}, float32);
+
+    auto t = transpose(a);
+    EXPECT_EQ(t.shape(), (std::vector<int>{3, 2}));
+    EXPECT_EQ(t.strides(), (std::vector<int64_t>{1, 3}));
+    EXPECT_FALSE(t.is_contiguous());
+
+    // contiguous arrays reshape in place
+    auto r = reshape(a, {3, -1});
+    EXPECT_EQ(r.shape(), (std::vector<int>{3, 2}));
+    EXPECT_EQ(r.data<float>(), a.data<float>());
+
+    // the others are copied in row major order
+    auto flat = reshape(t, {-1});
+    EXPECT_NE(flat.data_shared_ptr(), a.data_shared_ptr());
+    const std::vector<float> expected{0, 3, 1, 4, 2, 5};
+    for (uint32_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(flat.data<float>(i), expected[i]);
+    }
+
+    EXPECT_THROW(reshape(a, {4, -1}), std::invalid_argument);
+
+    // the size of the inferred dimension is ambiguous next to an empty one
+    Array empty(std::vector<float>{}, float32);
+    EXPECT_EQ(reshape(empty, {0, 3}).shape(), (std::vector<int>{0, 3}));
+    EXPECT_EQ(reshape(empty, {-1}).shape(), (std::vector<int>{0}));
+    EXPECT_THROW(reshape(empty, {0, -1}), std::invalid_argument);
+    EXPECT_THROW(reshape(a, {0, -1}), std::invalid_argument);
+    EXPECT_THROW(transpose(a, {0, 0}), std::invalid_argument);
+}
+
+TEST(Array, ContiguousPending) {
+    // the scan is encoded eagerly, the copy must wait for it without an explicit synchronize
+    auto sums = scan(Array(std::vector<uint32_t>(4096 * 3, 1), uint32), ReduceType::Sum);
+    auto flat = reshape(transpose(reshape(sums, {3, 4096})), {-1});
+    EXPECT_TRUE(flat.is_contiguous());
+    EXPECT_EQ(flat.data<uint32_t>(0), 1u);
+    EXPECT_EQ(flat.data<uint32_t>(1), 4097u);
+    EXPECT_EQ(flat.data<uint32_t>(2), 8193u);
+    EXPECT_EQ(flat.data<uint32_t>(4096 * 3 - 1), 4096u * 3);
+}
+
+TEST(Array, PendingView) {
+    // the layout of a view is known before its data exists
+    LazyEvaluation lazy;
+    auto sums = scan(Array(std::vector<uint32_t>(6, 1), uint32), ReduceType::Sum);
+    auto t = transpose(reshape(sums, {2, 3}));
+    EXPECT_TRUE(t.has_primitive());
+    EXPECT_EQ(t.strides(), (std::vector<int64_t>{1, 3}));
+    EXPECT_FALSE(t.is_contiguous());
+    EXPECT_TRUE(transpose(t).is_contiguous());
+    t.eval();
+    synchronize(true);
+    auto copy = contiguous(t);
+    EXPECT_EQ(copy.data<uint32_t>(1), 4u);
+    EXPECT_EQ(copy.data<uint32_t>(2), 2u);
+
+    // nothing to take a view of
+    EXPECT_THROW(transpose(Array({2, 2}, float32, nullptr, {})), std::invalid_argument);
+}
+
+TEST(Array, BroadcastTo) {
+    Array a(std::vector<int32_t>{1, 2, 3}, int32);
+
+    auto b = broadcast_to(a, {4, 3});
+    EXPECT_EQ(b.shape(), (std::vector<int>{4, 3}));
+    EXPECT_EQ(b.strides(), (std::vector<int64_t>{0, 1}));
+    EXPECT_EQ(b.data<int32_t>(), a.data<int32_t>());
+    auto copy = contiguous(b);
+    EXPECT_EQ(copy.size(), 12u);
+    EXPECT_EQ(copy.data<int32_t>(10), 2);
+
+    EXPECT_THROW(broadcast_to(a, {4, 2}), std::invalid_argument);
+}
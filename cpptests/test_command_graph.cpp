@@ -0,0 +1,184 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "runtime/command_graph.h"
+#include "runtime/array.h"
+#include "runtime/kernel.h"
+#include "runtime/host/host_device.h"
+#include "runtime/host/host_stream.h"
+
+using namespace vox;
+
+namespace {
+// Every argument of a launch starts 8 bytes aligned
+struct ScaleAddArguments {
+    float *data;
+    alignas(8) float scale;
+    alignas(8) float offset;
+};
+
+void scale_add(const std::byte *arguments, const ThreadgroupContext &context) {
+    ScaleAddArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        args.data[tpig.x] = args.data[tpig.x] * args.scale + args.offset;
+    });
+}
+
+// The waiting kernel gives up after a while, seen is 1 if the flag was set while it was running
+struct FlagArguments {
+    std::atomic<uint32_t> *flag;
+    uint32_t *seen;
+};
+
+void wait_flag(const std::byte *arguments, const ThreadgroupContext &context) {
+    FlagArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (args.flag->load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    *args.seen = args.flag->load();
+}
+
+void set_flag(const std::byte *arguments, const ThreadgroupContext &context) {
+    FlagArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    args.flag->store(1);
+}
+
+void encode_flag(HostDevice &host, const std::string &entry, const FlagArguments &args, const Buffer &written) {
+    auto &stream = host.stream(0);
+    auto arguments = stream.argument_ring().allocate(sizeof(args));
+    std::memcpy(arguments.data, &args, sizeof(args));
+    auto encoder = stream.encoder();
+    encoder->set_pipeline(host.get_kernel(entry));
+    encoder->use_resource(written, ResourceUsage::Write);
+    encoder->set_buffer(arguments.buffer, arguments.offset, arguments.size, 0);
+    encoder->dispatch_thread_groups(Size3{1, 1, 1}, Size3{1, 1, 1});
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_graph_scale_add", scale_add);
+REGISTER_HOST_KERNEL("test_graph_wait_flag", wait_flag);
+REGISTER_HOST_KERNEL("test_graph_set_flag", set_flag);
+
+TEST(CommandGraph, Replay) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    constexpr uint32_t count = 100;
+    Array data(std::vector<float>(count, 1.f), float32);
+    auto kernel = Kernel::builder().entry("test_graph_scale_add").build();
+    kernel.set_threads(count);
+    kernel.set_threads_per_thread_group(32);
+
+    CommandGraph graph;
+    auto &stream = device().stream(0);
+    stream.begin_capture(graph);
+    kernel.launch(0, data, 2.f, 1.f);
+    kernel.launch(0, data, 1.f, 3.f);
+    stream.end_capture();
+    EXPECT_EQ(graph.size(), 2u);
+
+    // Capturing doesn't run anything
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(count - 1), 1.f);
+
+    graph.replay(0);
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(count - 1), 6.f);
+
+    // The uniforms of the recorded launches are updated in place
+    constexpr auto offset = detail::argument_offsets<Array, float, float>()[2];
+    graph.set_uniform(1, offset, 0.f);
+    graph.replay(0);
+    graph.replay(0);
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(0), 27.f);
+    EXPECT_EQ(data.data<float>(count - 1), 27.f);
+
+    // Launches after a replay see its writes
+    kernel.launch(0, data, 1.f, 1.f);
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(count - 1), 28.f);
+
+    EXPECT_THROW(graph.set_uniform(1, offset + sizeof(uint64_t), 0.f), std::out_of_range);
+    EXPECT_THROW(graph.set_uniform(2, offset, 0.f), std::out_of_range);
+}
+
+TEST(CommandGraph, CaptureUnwound) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    constexpr uint32_t count = 100;
+    Array data(std::vector<float>(count, 1.f), float32);
+    auto kernel = Kernel::builder().entry("test_graph_scale_add").build();
+    kernel.set_threads(count);
+    kernel.set_threads_per_thread_group(32);
+
+    // An exception leaves the scope of the graph before end_capture
+    auto &stream = device().stream(0);
+    try {
+        CommandGraph graph;
+        stream.begin_capture(graph);
+        kernel.launch(0, data, 2.f, 1.f);
+        throw std::runtime_error("capture failed");
+    } catch (const std::runtime_error &) {
+    }
+
+    // The stream encodes again and can start another capture
+    kernel.launch(0, data, 1.f, 1.f);
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(count - 1), 2.f);
+
+    CommandGraph graph;
+    stream.begin_capture(graph);
+    kernel.launch(0, data, 2.f, 0.f);
+    stream.end_capture();
+    graph.replay(0);
+    synchronize(true);
+    EXPECT_EQ(data.data<float>(count - 1), 4.f);
+}
+
+TEST(CommandGraph, HostOverlap) {
+    HostDevice host{2};
+    auto flag_buffer = host.new_buffer(64);
+    auto seen_buffer = host.new_buffer(64);
+    auto flag = new (flag_buffer.raw_ptr()) std::atomic<uint32_t>{0};
+    auto seen = static_cast<uint32_t *>(seen_buffer.raw_ptr());
+    const FlagArguments args{flag, seen};
+    auto &stream = host.stream(0);
+
+    // The independent nodes of a graph still run together
+    CommandGraph both;
+    stream.begin_capture(both);
+    encode_flag(host, "test_graph_wait_flag", args, seen_buffer);
+    encode_flag(host, "test_graph_set_flag", args, flag_buffer);
+    stream.end_capture();
+    stream.replay(both);
+    stream.synchronize(true);
+    EXPECT_EQ(*seen, 1u);
+
+    // A dispatch after a replay waits for the graph, whatever it uses
+    CommandGraph wait;
+    stream.begin_capture(wait);
+    encode_flag(host, "test_graph_wait_flag", args, seen_buffer);
+    stream.end_capture();
+    flag->store(0);
+    stream.replay(wait);
+    encode_flag(host, "test_graph_set_flag", args, flag_buffer);
+    stream.synchronize(true);
+    EXPECT_EQ(*seen, 0u);
+
+    host.release_buffer(flag_buffer);
+    host.release_buffer(seen_buffer);
+}
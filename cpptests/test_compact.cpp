@@ -0,0 +1,172 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <tuple>
+#include "runtime/ops.h"
+#include "runtime/primitives/compact.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+const std::vector<size_t> sizes{0, 1, 255, 4097, 100000, (1 << 20) + 3};
+
+std::vector<uint8_t> make_mask(size_t size, uint32_t percent) {
+    std::mt19937 rng(size + percent);
+    std::vector<uint8_t> mask(size);
+    for (auto &m : mask) {
+        m = rng() % 100 < percent ? uint8_t(1 + rng() % 255) : 0;
+    }
+    return mask;
+}
+}// namespace
+
+TEST(Compact, Mask) {
+    for (auto size : sizes) {
+        for (uint32_t percent : {0, 3, 50, 100}) {
+            std::vector<int32_t> values(size);
+            for (size_t i = 0; i < size; i++) {
+                values[i] = int32_t(i * 7);
+            }
+            auto mask = make_mask(size, percent);
+            auto [selected, count] = compact(Array(values.data(), {int(size)}, int32),
+                                             Array(mask.data(), {int(size)}, uint8));
+            synchronize(true);
+
+            ASSERT_EQ(selected.size(), size);
+            size_t expected = 0;
+            for (size_t i = 0; i < size; i++) {
+                if (mask[i]) {
+                    ASSERT_EQ(selected.data<int32_t>(expected), values[i]) << "size " << size << " index " << i;
+                    expected++;
+                }
+            }
+            ASSERT_EQ(count.data<uint32_t>(0), expected) << "size " << size << " percent " << percent;
+        }
+    }
+}
+
+TEST(Compact, Compare) {
+    std::mt19937 rng(42);
+    std::vector<float> values(50000);
+    for (auto &v : values) {
+        v = float(int(rng() % 200) - 100) * 0.5f;
+    }
+    Array src(values.data(), {int(values.size())}, float32);
+    const std::vector<std::pair<CompareType, std::function<bool(float)>>> cases{
+        {CompareType::Equal, [](float v) { return v == 1.5f; }},
+        {CompareType::NotEqual, [](float v) { return v != 1.5f; }},
+        {CompareType::Less, [](float v) { return v < 1.5f; }},
+        {CompareType::LessEqual, [](float v) { return v <= 1.5f; }},
+        {CompareType::Greater, [](float v) { return v > 1.5f; }},
+        {CompareType::GreaterEqual, [](float v) { return v >= 1.5f; }},
+    };
+    for (auto &[compare_type, predicate] : cases) {
+        auto [selected, count] = compact(src, compare_type, 1.5);
+        synchronize(true);
+        std::vector<float> expected;
+        std::copy_if(values.begin(), values.end(), std::back_inserter(expected), predicate);
+        ASSERT_EQ(count.data<uint32_t>(0), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(selected.data<float>(i), expected[i]) << "index " << i;
+        }
+    }
+
+    // integer elements are compared with the value as is
+    std::vector<uint16_t> ids{0, 5, 65535, 7, 2};
+    auto [selected, count] = compact(Array(ids.data(), {5}, uint16), CompareType::Greater, 4.9);
+    synchronize(true);
+    ASSERT_EQ(count.data<uint32_t>(0), 3u);
+    EXPECT_EQ(selected.data<uint16_t>(0), 5);
+    EXPECT_EQ(selected.data<uint16_t>(1), 65535);
+    EXPECT_EQ(selected.data<uint16_t>(2), 7);
+}
+
+TEST(Compact, CompareInteger) {
+    std::vector<int32_t> values{0, 1, -1, 2, -3, 5};
+    Array src(values.data(), {int(values.size())}, int32);
+    std::vector<uint32_t> unsigned_values{0, 1, 2, 4294967295u};
+    Array unsigned_src(unsigned_values.data(), {int(unsigned_values.size())}, uint32);
+    const std::vector<std::tuple<const Array *, CompareType, double, uint32_t>> cases{
+        // fractional values
+        {&src, CompareType::Less, 0.5, 3},
+        {&src, CompareType::LessEqual, -0.5, 2},
+        {&src, CompareType::Greater, -0.5, 4},
+        {&src, CompareType::GreaterEqual, 1.5, 2},
+        {&src, CompareType::Equal, 1.5, 0},
+        {&src, CompareType::NotEqual, 1.5, 6},
+        {&src, CompareType::Less, -2.5, 1},
+        // out of the range of the elements
+        {&src, CompareType::Greater, -1e10, 6},
+        {&src, CompareType::Less, 1e10, 6},
+        {&src, CompareType::GreaterEqual, 1e10, 0},
+        {&src, CompareType::Equal, 1e10, 0},
+        {&src, CompareType::Less, std::nan(""), 0},
+        {&src, CompareType::NotEqual, std::nan(""), 6},
+        {&unsigned_src, CompareType::Greater, -1.0, 4},
+        {&unsigned_src, CompareType::LessEqual, -0.5, 0},
+        {&unsigned_src, CompareType::NotEqual, -1.0, 4},
+        {&unsigned_src, CompareType::GreaterEqual, 4294967295.0, 1},
+        {&unsigned_src, CompareType::Greater, 4294967295.0, 0},
+        {&unsigned_src, CompareType::Less, 4294967296.5, 4},
+    };
+    for (auto &[array, compare_type, value, expected] : cases) {
+        auto [selected, count] = compact(*array, compare_type, value);
+        synchronize(true);
+        EXPECT_EQ(count.data<uint32_t>(0), expected) << "compare " << int(compare_type) << " with " << value;
+    }
+
+    auto [selected, count] = compact(src, CompareType::Less, 0.5);
+    synchronize(true);
+    ASSERT_EQ(count.data<uint32_t>(0), 3u);
+    EXPECT_EQ(selected.data<int32_t>(0), 0);
+    EXPECT_EQ(selected.data<int32_t>(1), -1);
+    EXPECT_EQ(selected.data<int32_t>(2), -3);
+}
+
+TEST(Compact, Vectors) {
+    std::vector<simd::float3> positions(10000);
+    for (size_t i = 0; i < positions.size(); i++) {
+        positions[i] = simd::float3{float(i), float(i) + 0.5f, -float(i)};
+    }
+    auto active = make_mask(positions.size(), 30);
+    auto [selected, count] = compact(Array(positions.data(), {int(positions.size())}, float3),
+                                     Array(active.data(), {int(active.size())}, uint8));
+    synchronize(true);
+    size_t expected = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        if (active[i]) {
+            ASSERT_EQ(selected.data<simd::float3>(expected).x, positions[i].x);
+            ASSERT_EQ(selected.data<simd::float3>(expected).z, positions[i].z);
+            expected++;
+        }
+    }
+    ASSERT_EQ(count.data<uint32_t>(0), expected);
+}
+
+TEST(Compact, Invalid) {
+    std::vector<int32_t> values{3, 1, 2};
+    std::vector<uint8_t> mask{1, 0};
+    Array src(values.data(), {3}, int32);
+    EXPECT_THROW(compact(src, Array(mask.data(), {2}, uint8)), std::invalid_argument);
+    EXPECT_THROW(compact(src, src), std::invalid_argument);
+    EXPECT_THROW(compact(Array(std::vector<int>{4}, float3, nullptr, {}), CompareType::Less, 0), std::invalid_argument);
+
+    // rejected when the compaction is created, before anything was recorded
+    LazyEvaluation lazy;
+    std::vector<int32_t> grid{3, 1, 2, 0};
+    std::vector<uint8_t> grid_mask{1, 0, 1, 0};
+    auto transposed = transpose(Array(grid.data(), {2, 2}, int32));
+    EXPECT_THROW(compact(transposed, CompareType::Less, 2), std::invalid_argument);
+    EXPECT_THROW(compact(transposed, Array(grid_mask.data(), {2, 2}, uint8)), std::invalid_argument);
+    EXPECT_THROW(compact(Array(grid.data(), {2, 2}, int32), transpose(Array(grid_mask.data(), {2, 2}, uint8))),
+                 std::invalid_argument);
+}
@@ -0,0 +1,48 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include "runtime/device.h"
+#include "runtime/host/host_device.h"
+
+using namespace vox;
+
+namespace {
+void noop(const std::byte *arguments, const ThreadgroupContext &context) {}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_noop", noop);
+
+TEST(Device, Selection) {
+    EXPECT_TRUE(is_available(DeviceType::Host));
+    EXPECT_EQ(device(DeviceType::Host).name(), "Host");
+    if (!is_available(DeviceType::Metal)) {
+        EXPECT_THROW(device(DeviceType::Metal), std::invalid_argument);
+        EXPECT_THROW(set_default_device(DeviceType::Metal), std::invalid_argument);
+    }
+
+    // the default is fixed once it is in use
+    auto &d = device();
+    auto type = d.name() == "Host" ? DeviceType::Host : DeviceType::Metal;
+    EXPECT_NO_THROW(set_default_device(type));
+    if (is_available(DeviceType::Metal)) {
+        auto other = type == DeviceType::Host ? DeviceType::Metal : DeviceType::Host;
+        EXPECT_THROW(set_default_device(other), std::runtime_error);
+    }
+}
+
+TEST(Device, KernelCache) {
+    HostDevice host{2};
+    auto pso = host.get_kernel("test_noop");
+    EXPECT_EQ(host.get_kernel("test_noop"), pso);
+
+    // hash_name is the cache key
+    auto specialized = host.get_kernel("test_noop", "metal_kernel", "test_noop_specialized");
+    EXPECT_NE(specialized, pso);
+    EXPECT_EQ(host.get_kernel("test_noop", "metal_kernel", "test_noop_specialized"), specialized);
+
+    EXPECT_THROW(host.get_kernel("not_registered"), std::runtime_error);
+}
@@ -0,0 +1,206 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "runtime/hash_grid.h"
+#include "runtime/neighbor_list.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+std::vector<simd::float3> make_points(size_t size, float extent) {
+    std::mt19937 rng(size);
+    std::uniform_real_distribution<float> dist(-extent, extent);
+    std::vector<simd::float3> points(size);
+    for (auto &p : points) {
+        p = simd::float3{dist(rng), dist(rng), dist(rng)};
+    }
+    return points;
+}
+
+int cell_index(const HashGridDescriptor &grid, int x, int y, int z) {
+    const int origin = 1 << 20;
+    x = std::max(0, x + origin);
+    y = std::max(0, y + origin);
+    z = std::max(0, z + origin);
+    return (z % grid.dim_z) * (grid.dim_x * grid.dim_y) + (y % grid.dim_y) * grid.dim_x + (x % grid.dim_x);
+}
+
+// hash_grid_query and hash_grid_query_next of shader/hash_grid.h over the descriptor of id()
+std::vector<int> query(uint64_t id, simd::float3 pos, float radius) {
+    const auto &grid = *reinterpret_cast<const HashGridDescriptor *>(id);
+    const auto *point_ids = reinterpret_cast<const int *>(grid.point_ids);
+    const auto *cell_starts = reinterpret_cast<const int *>(grid.cell_starts);
+    const auto *cell_ends = reinterpret_cast<const int *>(grid.cell_ends);
+    const int x_start = int((pos.x - radius) * grid.cell_width_inv);
+    const int y_start = int((pos.y - radius) * grid.cell_width_inv);
+    const int z_start = int((pos.z - radius) * grid.cell_width_inv);
+    const int x_end = std::min(int((pos.x + radius) * grid.cell_width_inv), x_start + grid.dim_x - 1);
+    const int y_end = std::min(int((pos.y + radius) * grid.cell_width_inv), y_start + grid.dim_y - 1);
+    const int z_end = std::min(int((pos.z + radius) * grid.cell_width_inv), z_start + grid.dim_z - 1);
+
+    std::vector<int> result;
+    for (int z = z_start; z <= z_end; z++) {
+        for (int y = y_start; y <= y_end; y++) {
+            for (int x = x_start; x <= x_end; x++) {
+                const int cell = cell_index(grid, x, y, z);
+                for (int i = cell_starts[cell]; i < cell_ends[cell]; i++) {
+                    result.push_back(point_ids[i]);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+float distance(simd::float3 a, simd::float3 b) {
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+}// namespace
+
+TEST(HashGrid, CellRanges) {
+    HashGrid grid(8, 8, 8);
+    for (size_t size : {1, 100, 5000}) {
+        auto points = make_points(size, 4.f);
+        grid.build(Array(points.data(), {int(size)}, float3), 0.5f);
+        synchronize(true);
+        ASSERT_EQ(grid.num_points(), size);
+
+        auto point_cells = grid.point_cells();
+        auto point_ids = grid.point_ids();
+        std::vector<int> seen(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            if (i > 0) {
+                ASSERT_LE(point_cells.data<uint32_t>(i - 1), point_cells.data<uint32_t>(i));
+            }
+            const uint32_t id = point_ids.data<uint32_t>(i);
+            ASSERT_LT(id, size);
+            seen[id]++;
+            const int cell = int(point_cells.data<uint32_t>(i));
+            ASSERT_LE(grid.cell_starts().data<int32_t>(cell), int(i));
+            ASSERT_GT(grid.cell_ends().data<int32_t>(cell), int(i));
+        }
+        ASSERT_TRUE(std::all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }));
+
+        size_t total = 0;
+        for (int cell = 0; cell < grid.num_cells(); cell++) {
+            total += grid.cell_ends().data<int32_t>(cell) - grid.cell_starts().data<int32_t>(cell);
+        }
+        ASSERT_EQ(total, size);
+    }
+}
+
+TEST(HashGrid, Neighbors) {
+    const float radius = 0.6f;
+    HashGrid grid(16, 16, 16);
+    auto points = make_points(20000, 5.f);
+    grid.build(Array(points.data(), {int(points.size())}, float3), radius);
+    synchronize(true);
+
+    for (size_t i = 0; i < points.size(); i += 97) {
+        auto candidates = query(grid.id(), points[i], radius);
+        std::vector<int> neighbors;
+        for (int candidate : candidates) {
+            if (distance(points[candidate], points[i]) <= radius) {
+                neighbors.push_back(candidate);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+
+        std::vector<int> expected;
+        for (size_t j = 0; j < points.size(); j++) {
+            if (distance(points[j], points[i]) <= radius) {
+                expected.push_back(int(j));
+            }
+        }
+        ASSERT_EQ(neighbors, expected) << "point " << i;
+    }
+}
+
+TEST(HashGrid, Reserve) {
+    HashGrid grid(4, 4, 4);
+    grid.reserve(1000);
+    const uint64_t id = grid.id();
+    const uint64_t cells = grid.point_cells().address();
+
+    auto points = make_points(1000, 2.f);
+    grid.build(Array(points.data(), {1000}, float3), 0.5f);
+    grid.build(Array(points.data(), {500}, float3), 0.5f);
+    synchronize(true);
+    EXPECT_EQ(grid.max_points(), 1000);
+    EXPECT_EQ(grid.num_points(), 500);
+    EXPECT_EQ(grid.id(), id);
+    EXPECT_EQ(grid.point_cells().address(), cells);
+    EXPECT_EQ(reinterpret_cast<const HashGridDescriptor *>(id)->num_points, 500);
+
+    grid.build(Array(points.data(), {0}, float3), 0.5f);
+    synchronize(true);
+    EXPECT_EQ(reinterpret_cast<const HashGridDescriptor *>(id)->num_points, 0);
+    EXPECT_EQ(query(id, points[0], 1.f).size(), 0);
+
+    EXPECT_THROW(grid.build(Array(points.data(), {10}, float3), 0.f), std::invalid_argument);
+    EXPECT_THROW(HashGrid(0, 4, 4), std::invalid_argument);
+}
+
+TEST(NeighborList, BruteForce) {
+    const float radius = 0.4f;
+    const float skin = 0.1f;
+    for (size_t size : {1, 300, 8000}) {
+        auto points = make_points(size, 3.f);
+        Array points_array(points.data(), {int(size)}, float3);
+        HashGrid grid(16, 16, 16);
+        grid.build(points_array, radius + skin);
+        NeighborList neighbors;
+        neighbors.build(grid, points_array, radius, skin);
+        synchronize(true);
+
+        auto offsets = neighbors.offsets();
+        auto indices = neighbors.indices();
+        ASSERT_EQ(offsets.size(), size + 1);
+        ASSERT_EQ(offsets.data<int32_t>(0), 0);
+        ASSERT_EQ(offsets.data<int32_t>(size), neighbors.num_neighbors());
+        for (size_t i = 0; i < size; i++) {
+            std::vector<int> row(&indices.data<int32_t>(0) + offsets.data<int32_t>(i),
+                                 &indices.data<int32_t>(0) + offsets.data<int32_t>(i + 1));
+            std::sort(row.begin(), row.end());
+            std::vector<int> expected;
+            for (size_t j = 0; j < size; j++) {
+                if (distance(points[j], points[i]) <= radius + skin) {
+                    expected.push_back(int(j));
+                }
+            }
+            ASSERT_EQ(row, expected) << "size " << size << " point " << i;
+        }
+    }
+}
+
+TEST(NeighborList, Skin) {
+    auto points = make_points(1000, 2.f);
+    Array points_array(points.data(), {int(points.size())}, float3);
+    HashGrid grid(8, 8, 8);
+    NeighborList neighbors;
+    EXPECT_TRUE(neighbors.needs_rebuild(points_array));
+
+    grid.build(points_array, 0.5f);
+    neighbors.build(grid, points_array, 0.4f, 0.1f);
+    EXPECT_FALSE(neighbors.needs_rebuild(points_array));
+
+    // Within half the skin the list still holds every pair closer than the radius
+    auto moved = points;
+    moved[10].x += 0.04f;
+    EXPECT_FALSE(neighbors.needs_rebuild(Array(moved.data(), {int(moved.size())}, float3)));
+    moved[20].y -= 0.06f;
+    EXPECT_TRUE(neighbors.needs_rebuild(Array(moved.data(), {int(moved.size())}, float3)));
+    EXPECT_TRUE(neighbors.needs_rebuild(Array(moved.data(), {10}, float3)));
+
+    EXPECT_THROW(neighbors.build(grid, Array(moved.data(), {10}, float3), 0.4f), std::invalid_argument);
+    EXPECT_THROW(neighbors.build(grid, points_array, -1.f), std::invalid_argument);
+}
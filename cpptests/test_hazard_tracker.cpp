@@ -0,0 +1,136 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "runtime/hazard_tracker.h"
+#include "runtime/allocator.h"
+#include "runtime/host/host_device.h"
+#include "runtime/host/host_stream.h"
+
+using namespace vox;
+
+namespace {
+Buffer range(uint64_t address, size_t size) {
+    return Buffer{nullptr, nullptr, address, size};
+}
+
+bool dispatch(HazardTracker &tracker, std::initializer_list<std::pair<Buffer, ResourceUsage>> usages) {
+    for (auto &[buffer, usage] : usages) {
+        tracker.use(buffer, usage);
+    }
+    return tracker.end_dispatch();
+}
+
+// The waiting kernel gives up after a while, seen is 1 if the flag was set while it was running
+struct FlagArguments {
+    std::atomic<uint32_t> *flag;
+    uint32_t *seen;
+};
+
+void wait_flag(const std::byte *arguments, const ThreadgroupContext &context) {
+    FlagArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (args.flag->load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    *args.seen = args.flag->load();
+}
+
+void set_flag(const std::byte *arguments, const ThreadgroupContext &context) {
+    FlagArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    args.flag->store(1);
+}
+
+void encode_flag(HostDevice &host, const std::string &entry, const FlagArguments &args,
+                 std::initializer_list<std::pair<Buffer, ResourceUsage>> usages) {
+    auto &stream = host.stream(0);
+    auto arguments = stream.argument_ring().allocate(sizeof(args));
+    std::memcpy(arguments.data, &args, sizeof(args));
+    auto encoder = stream.get_command_encoder();
+    encoder->set_pipeline(host.get_kernel(entry));
+    for (auto &[buffer, usage] : usages) {
+        encoder->use_resource(buffer, usage);
+    }
+    encoder->set_buffer(arguments.buffer, arguments.offset, arguments.size, 0);
+    encoder->dispatch_thread_groups(Size3{1, 1, 1}, Size3{1, 1, 1});
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_wait_flag", wait_flag);
+REGISTER_HOST_KERNEL("test_set_flag", set_flag);
+
+TEST(HazardTracker, Conflicts) {
+    HazardTracker tracker;
+    const auto a = range(0x1000, 256);
+    const auto b = range(0x2000, 256);
+    // Overlaps the end of a
+    const auto c = range(0x10f0, 64);
+
+    EXPECT_FALSE(dispatch(tracker, {{a, ResourceUsage::Read}, {b, ResourceUsage::Write}}));
+    // Read after read
+    EXPECT_FALSE(dispatch(tracker, {{a, ResourceUsage::Read}}));
+    // Write after read, through an overlapping range
+    EXPECT_TRUE(dispatch(tracker, {{c, ResourceUsage::Write}}));
+    // Write after write
+    EXPECT_TRUE(dispatch(tracker, {{c, ResourceUsage::ReadWrite}}));
+    // Disjoint ranges of the same buffer
+    EXPECT_FALSE(dispatch(tracker, {{range(0x1000, 128), ResourceUsage::Write}}));
+    // Read after write
+    EXPECT_TRUE(dispatch(tracker, {{range(0x1100, 16), ResourceUsage::Read}}));
+
+    tracker.reset();
+    EXPECT_FALSE(dispatch(tracker, {{c, ResourceUsage::Write}}));
+}
+
+TEST(HazardTracker, Undeclared) {
+    HazardTracker tracker;
+    const auto a = range(0x1000, 256);
+    const auto b = range(0x2000, 256);
+
+    EXPECT_FALSE(dispatch(tracker, {{a, ResourceUsage::Read}}));
+    // A dispatch without usages may access anything, it waits and the next one waits for it
+    EXPECT_TRUE(dispatch(tracker, {}));
+    EXPECT_TRUE(dispatch(tracker, {{b, ResourceUsage::Read}}));
+    EXPECT_FALSE(dispatch(tracker, {{a, ResourceUsage::Read}}));
+}
+
+TEST(HazardTracker, HostOverlap) {
+    HostDevice host{2};
+    auto flag_buffer = host.new_buffer(64);
+    auto seen_buffer = host.new_buffer(64);
+    auto flag = new (flag_buffer.raw_ptr()) std::atomic<uint32_t>{0};
+    auto seen = static_cast<uint32_t *>(seen_buffer.raw_ptr());
+    const FlagArguments args{flag, seen};
+
+    // A dispatch without usages waits for the previous ones
+    encode_flag(host, "test_wait_flag", args, {{flag_buffer, ResourceUsage::Read}, {seen_buffer, ResourceUsage::Write}});
+    encode_flag(host, "test_set_flag", args, {});
+    host.stream(0).synchronize(true);
+    EXPECT_EQ(*seen, 0u);
+
+    // Independent dispatches run together, the first one sees the flag of the second one
+    flag->store(0);
+    encode_flag(host, "test_wait_flag", args, {{seen_buffer, ResourceUsage::Write}});
+    encode_flag(host, "test_set_flag", args, {{flag_buffer, ResourceUsage::Write}});
+    host.stream(0).synchronize(true);
+    EXPECT_EQ(*seen, 1u);
+
+    // The write of the flag waits for the dispatch reading it
+    flag->store(0);
+    encode_flag(host, "test_wait_flag", args, {{flag_buffer, ResourceUsage::Read}, {seen_buffer, ResourceUsage::Write}});
+    encode_flag(host, "test_set_flag", args, {{flag_buffer, ResourceUsage::Write}});
+    host.stream(0).synchronize(true);
+    EXPECT_EQ(*seen, 0u);
+
+    host.release_buffer(flag_buffer);
+    host.release_buffer(seen_buffer);
+}
@@ -0,0 +1,94 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "runtime/ops.h"
+#include "runtime/primitives/histogram.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+// Same float32 binning as the kernels
+template<typename T>
+std::vector<uint32_t> reference(const std::vector<T> &values, int bins, float lower, float upper) {
+    std::vector<uint32_t> counts(bins);
+    const float scale = float(double(bins) / (double(upper) - double(lower)));
+    for (auto v : values) {
+        const auto x = float(v);
+        if (x >= lower && x <= upper) {
+            counts[std::min(uint32_t((x - lower) * scale), uint32_t(bins - 1))]++;
+        }
+    }
+    return counts;
+}
+}// namespace
+
+TEST(Histogram, Integers) {
+    for (size_t size : {0, 1, 255, 4097, 100000, (1 << 20) + 3}) {
+        std::mt19937 rng(size);
+        std::vector<uint8_t> values(size);
+        for (auto &v : values) {
+            v = uint8_t(rng());
+        }
+        // one bin per value
+        auto counts = histogram(Array(values.data(), {int(size)}, uint8), 256, 0, 256);
+        synchronize(true);
+        ASSERT_EQ(counts.dtype(), uint32);
+        ASSERT_EQ(counts.size(), 256);
+        std::vector<uint32_t> expected(256);
+        for (auto v : values) {
+            expected[v]++;
+        }
+        for (int bin = 0; bin < 256; bin++) {
+            ASSERT_EQ(counts.data<uint32_t>(bin), expected[bin]) << "size " << size << " bin " << bin;
+        }
+    }
+
+    // out of range values are dropped, upper belongs to the last bin
+    std::vector<int32_t> ids{-5, 0, 1, 9, 10, 11, 4, 5};
+    auto counts = histogram(Array(ids.data(), {int(ids.size())}, int32), 2, 0, 10);
+    synchronize(true);
+    EXPECT_EQ(counts.data<uint32_t>(0), 3u);
+    EXPECT_EQ(counts.data<uint32_t>(1), 3u);
+}
+
+TEST(Histogram, Floats) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> normal(0.f, 2.f);
+    std::vector<float> values(300000);
+    for (auto &v : values) {
+        v = normal(rng);
+    }
+    values[17] = NAN;
+    values[18] = INFINITY;
+    Array src(values.data(), {int(values.size())}, float32);
+    for (int bins : {1, 7, 64, 4096, 65536}) {
+        auto counts = histogram(src, bins, -4.0, 3.5);
+        synchronize(true);
+        auto expected = reference(values, bins, -4.f, 3.5f);
+        for (int bin = 0; bin < bins; bin++) {
+            ASSERT_EQ(counts.data<uint32_t>(bin), expected[bin]) << "bins " << bins << " bin " << bin;
+        }
+    }
+}
+
+TEST(Histogram, Invalid) {
+    std::vector<float> values{1.f, 2.f};
+    Array src(values.data(), {2}, float32);
+    EXPECT_THROW(histogram(src, 0, 0, 1), std::invalid_argument);
+    EXPECT_THROW(histogram(src, 4, 1, 1), std::invalid_argument);
+    EXPECT_THROW(histogram(src, 4, 0, INFINITY), std::invalid_argument);
+    EXPECT_THROW(histogram(Array(std::vector<int>{2}, float2, nullptr, {}), 4, 0, 1), std::invalid_argument);
+
+    // rejected when the histogram is created, before anything was recorded
+    LazyEvaluation lazy;
+    std::vector<float> grid{0.f, 1.f, 2.f, 3.f};
+    EXPECT_THROW(histogram(transpose(Array(grid.data(), {2, 2}, float32)), 4, 0, 4), std::invalid_argument);
+}
@@ -0,0 +1,409 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include "runtime/host/host_device.h"
+#include "runtime/host/host_stream.h"
+#include "runtime/host/thread_pool.h"
+#include "runtime/array.h"
+#include "runtime/kernel.h"
+#include "runtime/ops.h"
+#include "runtime/typed_kernel.h"
+
+using namespace vox;
+
+namespace {
+struct FillArguments {
+    uint32_t *buffer;
+    uint32_t value;
+};
+
+void fill_index(const std::byte *arguments, const ThreadgroupContext &context) {
+    FillArguments args{};
+    std::memcpy(&args, arguments, sizeof(FillArguments));
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        auto index = tpig.x + tpig.y * context.threads_per_grid.x;
+        args.buffer[index] = index + args.value;
+    });
+}
+
+// Same layout as the shader struct, scale starts 16 bytes aligned after bias
+struct ScaleBias4Arguments {
+    simd::float4 *data;
+    float bias;
+    simd::float4 scale;
+};
+
+void scale_bias4(const std::byte *arguments, const ThreadgroupContext &context) {
+    ScaleBias4Arguments args{};
+    std::memcpy(&args, arguments, sizeof(ScaleBias4Arguments));
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        auto &value = args.data[tpig.x];
+        for (int i = 0; i < 4; i++) {
+            value[i] = value[i] * args.scale[i] + args.bias;
+        }
+    });
+}
+
+void increment(const std::byte *arguments, const ThreadgroupContext &context) {
+    uint32_t *buffer;
+    std::memcpy(&buffer, arguments, sizeof(buffer));
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        buffer[tpig.x] += 1;
+    });
+}
+// Set by the test, the kernel writes 42 once it sees it or after a while
+std::atomic<uint32_t> release_flag{0};
+
+void wait_then_write(const std::byte *arguments, const ThreadgroupContext &context) {
+    uint32_t *value;
+    std::memcpy(&value, arguments, sizeof(value));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (release_flag.load() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    *value = 42;
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_fill_index", fill_index);
+REGISTER_HOST_KERNEL("test_wait_then_write", wait_then_write);
+REGISTER_HOST_KERNEL("test_increment", increment);
+REGISTER_HOST_KERNEL("test_scale_bias4", scale_bias4);
+
+TEST(Host, ThreadPoolParallelFor) {
+    ThreadPool pool{4};
+    std::vector<std::atomic<uint32_t>> hits(10000);
+    pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto &hit : hits) {
+        EXPECT_EQ(hit.load(), 1u);
+    }
+}
+
+TEST(Host, ThreadPoolParallelForThrows) {
+    ThreadPool pool{4};
+    std::atomic<uint32_t> count{0};
+    EXPECT_THROW(pool.parallel_for(1000,
+                                   [&](size_t i) {
+                                       count++;
+                                       if (i % 100 == 7) {
+                                           throw std::runtime_error("task failed");
+                                       }
+                                   }),
+                 std::runtime_error);
+    EXPECT_EQ(count.load(), 1000u);
+
+    // The workers survived the exceptions
+    std::vector<std::atomic<uint32_t>> hits(1000);
+    pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto &hit : hits) {
+        EXPECT_EQ(hit.load(), 1u);
+    }
+}
+
+TEST(Host, ThreadPoolNestedSubmit) {
+    ThreadPool pool{4};
+    std::atomic<uint32_t> count{0};
+    for (uint32_t i = 0; i < 64; i++) {
+        pool.submit([&] {
+            for (uint32_t j = 0; j < 64; j++) {
+                pool.submit([&] { count++; });
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(count.load(), 64u * 64u);
+}
+
+TEST(Host, DispatchThreads) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    // not a multiple of the threadgroup size, the last groups are clipped
+    const uint32_t width = 37, height = 5;
+    std::vector<uint32_t> init(width * height, 0);
+    Array array(init, uint32);
+
+    auto kernel = Kernel::builder().entry("test_fill_index").build();
+    kernel.set_threads(width, height);
+    kernel.set_threads_per_thread_group(8, 2);
+
+    uint32_t value = 3;
+    std::vector<uint8_t> uniform(sizeof(value));
+    std::memcpy(uniform.data(), &value, sizeof(value));
+    kernel({array, uniform});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), i + value);
+    }
+}
+
+TEST(Host, VariadicLaunch) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    // 8 bytes per Array, the uniform starts at the next multiple of 8
+    constexpr auto offsets = detail::argument_offsets<uint32_t, Array, uint8_t>();
+    static_assert(offsets[0] == 0 && offsets[1] == 8 && offsets[2] == 16 && offsets[3] == 24);
+
+    const uint32_t width = 37, height = 5;
+    std::vector<uint32_t> init(width * height, 0);
+    Array array(init, uint32);
+
+    auto kernel = Kernel::builder().entry("test_fill_index").build();
+    kernel.set_threads(width, height);
+    kernel.set_threads_per_thread_group(8, 2);
+    kernel.launch(0, array, uint32_t(7));
+    synchronize(true);
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), i + 7);
+    }
+}
+
+// Same layout as the arguments of test_fill_index
+struct alignas(8) FillIndexArguments {
+    DeviceArray<uint32_t> buffer;
+    uint32_t value;
+
+    static constexpr auto arrays() {
+        return std::make_tuple(&FillIndexArguments::buffer);
+    }
+};
+
+TEST(Host, TypedLaunch) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    static_assert(offsetof(FillIndexArguments, value) == 8 && sizeof(FillIndexArguments) == 16);
+
+    const uint32_t width = 37, height = 5;
+    std::vector<uint32_t> init(width * height, 0);
+    Array array(init, uint32);
+
+    TypedKernel<FillIndexArguments> kernel{Kernel::builder().entry("test_fill_index").build()};
+    kernel.set_threads(width, height);
+    kernel.set_threads_per_thread_group(8, 2);
+    kernel({DeviceArray<uint32_t>{array}, 11});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < width * height; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), i + 11);
+    }
+}
+
+TEST(Host, VariadicLaunchAligned) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    // The float4 starts 16 bytes aligned after the float, the bytes are padded like the struct
+    constexpr auto offsets = detail::argument_offsets<Array, float, simd::float4>();
+    static_assert(offsets[1] == offsetof(ScaleBias4Arguments, bias) &&
+                  offsets[2] == offsetof(ScaleBias4Arguments, scale) && offsets[3] == sizeof(ScaleBias4Arguments));
+    static_assert(detail::argument_offsets<float, simd::float4, float>()[3] == 48);
+
+    Array array(std::vector<simd::float4>(10, simd::float4{1.f, 2.f, 3.f, 4.f}));
+    auto kernel = Kernel::builder().entry("test_scale_bias4").build();
+    kernel.set_threads(10);
+    kernel.set_threads_per_thread_group(4);
+    kernel.launch(0, array, 1.f, simd::float4{2.f, 3.f, 4.f, 5.f});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        const auto &value = array.data<simd::float4>(i);
+        EXPECT_EQ(value.x, 3.f);
+        EXPECT_EQ(value.y, 7.f);
+        EXPECT_EQ(value.z, 13.f);
+        EXPECT_EQ(value.w, 21.f);
+    }
+}
+
+// float4 members make the struct 16 bytes aligned, like in the shader
+struct alignas(16) ScaleBias4TypedArguments {
+    DeviceArray<simd::float4> data;
+    float bias;
+    simd::float4 scale;
+
+    static constexpr auto arrays() {
+        return std::make_tuple(&ScaleBias4TypedArguments::data);
+    }
+};
+
+TEST(Host, TypedLaunchAligned) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    static_assert(offsetof(ScaleBias4TypedArguments, scale) == offsetof(ScaleBias4Arguments, scale) &&
+                  sizeof(ScaleBias4TypedArguments) == sizeof(ScaleBias4Arguments));
+
+    Array array(std::vector<simd::float4>(10, simd::float4{1.f, 2.f, 3.f, 4.f}));
+    TypedKernel<ScaleBias4TypedArguments> kernel{Kernel::builder().entry("test_scale_bias4").build()};
+    kernel.set_threads(10);
+    kernel.set_threads_per_thread_group(4);
+    kernel({DeviceArray<simd::float4>{array}, 1.f, simd::float4{2.f, 3.f, 4.f, 5.f}});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        const auto &value = array.data<simd::float4>(i);
+        EXPECT_EQ(value.x, 3.f);
+        EXPECT_EQ(value.y, 7.f);
+        EXPECT_EQ(value.z, 13.f);
+        EXPECT_EQ(value.w, 21.f);
+    }
+}
+
+TEST(Host, DispatchOrder) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    const uint32_t num_element = 4096;
+    std::vector<uint32_t> init(num_element, 0);
+    Array array(init, uint32);
+
+    auto kernel = Kernel::builder().entry("test_increment").build();
+    kernel.set_thread_groups(num_element / 64);
+    kernel.set_threads_per_thread_group(64);
+
+    // dispatches of a stream run in order, across command buffers as well
+    for (uint32_t i = 0; i < 10; i++) {
+        kernel({array});
+        kernel({array});
+        synchronize();
+    }
+    synchronize(true);
+
+    for (uint32_t i = 0; i < num_element; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), 20u);
+    }
+}
+
+TEST(Host, StreamWaitFor) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    Array value(std::vector<uint32_t>{0}, uint32);
+    auto write = Kernel::builder().entry("test_wait_then_write").build();
+    write.set_threads(1);
+    auto increment = Kernel::builder().entry("test_increment").build();
+    increment.set_threads(1);
+
+    // The host goes on while the first stream is still running
+    release_flag = 0;
+    const auto start = std::chrono::steady_clock::now();
+    write({value}, 0);
+    device().stream(1).wait_for(device().stream(0));
+    increment({value}, 1);
+    synchronize(false, 1);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(value.data<uint32_t>(0), 0u);
+
+    // The second stream starts once the first one completed
+    release_flag = 1;
+    synchronize(true, 1);
+    EXPECT_EQ(value.data<uint32_t>(0), 43u);
+    synchronize(true);
+}
+
+TEST(Host, SubAllocatedArguments) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    // both arrays live in the same slab, the kernel must see the offset address
+    Array first(std::vector<uint32_t>{0, 0, 0, 0}, uint32);
+    Array second(std::vector<uint32_t>{0, 0, 0, 0}, uint32);
+    ASSERT_EQ(first.buffer().ptr(), second.buffer().ptr());
+
+    auto kernel = Kernel::builder().entry("test_increment").build();
+    kernel.set_threads(4);
+    kernel.set_threads_per_thread_group(4);
+    kernel({second});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        EXPECT_EQ(first.data<uint32_t>(i), 0u);
+        EXPECT_EQ(second.data<uint32_t>(i), 1u);
+    }
+}
+
+TEST(Host, DispatchIndirect) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    const uint32_t num_element = 256;
+    std::vector<uint32_t> init(num_element, 0);
+    Array array(init, uint32);
+    Array indirect(std::vector<uint32_t>{2, 1, 1}, uint32);
+
+    auto kernel = Kernel::builder().entry("test_increment").build();
+    kernel.set_indirect_threads(indirect);
+    kernel.set_threads_per_thread_group(32);
+    kernel({array});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < num_element; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), i < 64 ? 1u : 0u);
+    }
+}
+
+TEST(Host, MissingKernel) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    EXPECT_THROW(Kernel::builder().entry("not_registered").build(), std::runtime_error);
+}
+
+TEST(Host, ZeroCopyArguments) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto data = static_cast<uint32_t *>(std::aligned_alloc(size, size));
+    std::fill_n(data, 64, 1u);
+    std::atomic<int> deleted{0};
+
+    auto kernel = Kernel::builder().entry("test_increment").build();
+    kernel.set_threads(64);
+    kernel.set_threads_per_thread_group(64);
+    {
+        Array array(data, {64}, uint32, [&](void *) { deleted++; });
+        kernel({array});
+    }
+    // the command buffer keeps the wrapped memory alive until it ran
+    synchronize(true);
+    EXPECT_EQ(deleted.load(), 1);
+    for (uint32_t i = 0; i < 64; i++) {
+        EXPECT_EQ(data[i], 2u);
+    }
+    std::free(data);
+}
+
+TEST(Host, ViewArguments) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    // the kernel sees the address of the first element of the view
+    Array array(std::vector<uint32_t>(8, 0), uint32);
+    auto row = take(reshape(array, {2, 4}), 1);
+
+    auto kernel = Kernel::builder().entry("test_increment").build();
+    kernel.set_threads(4);
+    kernel.set_threads_per_thread_group(4);
+    kernel({row});
+    synchronize(true);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        EXPECT_EQ(array.data<uint32_t>(i), i < 4 ? 0u : 1u);
+    }
+}
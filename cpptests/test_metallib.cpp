@@ -7,14 +7,18 @@
 #include <gtest/gtest.h>
 #include "runtime/device.h"
 #include "runtime/array.h"
+#ifdef ARCHE_USE_METAL
 #include "runtime/extension/debug_capture_ext.h"
+#endif
 #include "runtime/kernel.h"
 #include <fmt/format.h>
 
 using namespace vox;
 
 TEST(Metal, Metallib) {
+#ifdef ARCHE_USE_METAL
     auto capture_scope = DebugCaptureExt::create_scope("arche-capture");
+#endif
 
     const size_t num_element = 1024;
     std::vector<float> init(num_element, 0);
@@ -45,14 +49,18 @@ TEST(Metal, Metallib) {
     kernel.set_threads(num_element / 4);
     kernel.set_threads_per_thread_group(32);
 
+#ifdef ARCHE_USE_METAL
     capture_scope.start_debug_capture();
     capture_scope.mark_begin();
+#endif
     {
         kernel({src0_array, src1_array, dst_array});
         synchronize(true);
     }
+#ifdef ARCHE_USE_METAL
     capture_scope.mark_end();
     capture_scope.stop_debug_capture();
+#endif
 
     for (size_t i = 0; i < num_element; i++) {
         float limit = getSrc1(i) * (1.f / (1.f - getSrc0(i)));
@@ -0,0 +1,239 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include "runtime/ops.h"
+#include "runtime/primitives/reduce.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+const std::vector<size_t> sizes{1, 17, 1000, (1 << 20) + 3};
+
+// Small values so sums and products stay exact in every type
+template<typename T>
+std::vector<T> make_data(size_t size, ReduceType reduce_type) {
+    std::vector<T> data(size);
+    for (size_t i = 0; i < size; i++) {
+        if (reduce_type == ReduceType::Prod) {
+            // a few signs and at most 64 in every type
+            const bool negate = std::is_signed_v<T> && i < 2000 && i % 97 == 5;
+            data[i] = T(negate ? -1 : (i < 100 && i % 17 == 3 ? 2 : 1));
+        } else {
+            data[i] = T(int(i * 7 % 11) - 3);
+        }
+    }
+    if (std::is_unsigned_v<T> && reduce_type != ReduceType::Prod) {
+        for (auto &v : data) {
+            v = T(int(v) & 0x3);
+        }
+    }
+    return data;
+}
+
+template<typename T>
+double reference(const std::vector<T> &data, ReduceType reduce_type) {
+    switch (reduce_type) {
+        case ReduceType::And:
+            return std::all_of(data.begin(), data.end(), [](T v) { return v != T(0); });
+        case ReduceType::Or:
+            return std::any_of(data.begin(), data.end(), [](T v) { return v != T(0); });
+        case ReduceType::Sum:
+            return std::accumulate(data.begin(), data.end(), 0.0, [](double a, T b) { return a + double(b); });
+        case ReduceType::Prod:
+            return std::accumulate(data.begin(), data.end(), 1.0, [](double a, T b) { return a * double(b); });
+        case ReduceType::Min:
+            return double(*std::min_element(data.begin(), data.end()));
+        case ReduceType::Max:
+            return double(*std::max_element(data.begin(), data.end()));
+    }
+    return 0;
+}
+
+template<typename T>
+void check(Dtype dtype, size_t max_size = sizes.back()) {
+    for (auto reduce_type : {ReduceType::And, ReduceType::Or, ReduceType::Sum,
+                             ReduceType::Prod, ReduceType::Min, ReduceType::Max}) {
+        for (auto size : sizes) {
+            if (size > max_size) {
+                continue;
+            }
+            auto data = make_data<T>(size, reduce_type);
+            if (reduce_type == ReduceType::And && size > 1) {
+                // all true but the last element
+                std::replace(data.begin(), data.end(), T(0), T(1));
+                data.back() = T(0);
+            }
+            Array src(data.data(), {int(size)}, dtype);
+            auto result = reduce(src, reduce_type);
+            synchronize(true);
+
+            auto expected = reference(data, reduce_type);
+            if constexpr (std::is_unsigned_v<T> && sizeof(T) < 8) {
+                // unsigned sums wrap around
+                if (reduce_type == ReduceType::Sum) {
+                    expected = double(T(uint64_t(expected)));
+                }
+            }
+            if constexpr (std::is_integral_v<T> && sizeof(T) < 4) {
+                if (reduce_type == ReduceType::Sum) {
+                    expected = double(T(int64_t(expected)));
+                }
+            }
+            EXPECT_EQ(static_cast<double>(result.template data<T>(0)), expected)
+                << "op " << int(reduce_type) << " size " << size;
+        }
+    }
+}
+}// namespace
+
+TEST(Reduce, Float32) {
+    check<float>(float32);
+}
+
+TEST(Reduce, Integers) {
+    check<int32_t>(int32);
+    check<uint32_t>(uint32);
+    check<int64_t>(int64);
+    check<uint64_t>(uint64);
+    check<int16_t>(int16);
+    check<uint8_t>(uint8);
+}
+
+TEST(Reduce, Float16) {
+    // half accumulates in half on Metal, keep the sums exact
+    check<float16_t>(float16, 1000);
+}
+
+TEST(Reduce, IntoDst) {
+    std::vector<float> data(4096, 0.5f);
+    Array src(data, float32);
+    Array dst(std::vector<float>{0.f, 0.f}, float32);
+    reduce(src, dst, ReduceType::Sum);
+    synchronize(true);
+    EXPECT_EQ(dst.data<float>(0), 2048.f);
+
+    // recorded until evaluated
+    {
+        LazyEvaluation lazy;
+        reduce(src, dst, ReduceType::Max);
+    }
+    EXPECT_TRUE(dst.has_primitive());
+    dst.eval();
+    synchronize(true);
+    EXPECT_EQ(dst.data<float>(0), 0.5f);
+}
+
+namespace {
+// Reference over the axes of a row major shape, in double
+std::vector<double> reference_axes(const std::vector<float> &data, const std::vector<int> &shape,
+                                   const std::vector<int> &axes, ReduceType reduce_type) {
+    std::vector<bool> reduced(shape.size(), false);
+    for (auto axis : axes) {
+        reduced[axis < 0 ? axis + shape.size() : axis] = true;
+    }
+    size_t out_size = 1;
+    for (size_t d = 0; d < shape.size(); d++) {
+        out_size *= reduced[d] ? 1 : shape[d];
+    }
+    std::vector<std::vector<float>> groups(out_size);
+    for (size_t i = 0; i < data.size(); i++) {
+        size_t index = i;
+        size_t out_index = 0;
+        size_t out_stride = 1;
+        for (int d = int(shape.size()) - 1; d >= 0; d--) {
+            if (!reduced[d]) {
+                out_index += index % shape[d] * out_stride;
+                out_stride *= shape[d];
+            }
+            index /= shape[d];
+        }
+        groups[out_index].push_back(data[i]);
+    }
+    std::vector<double> expected;
+    for (auto &group : groups) {
+        expected.push_back(reference(group, reduce_type));
+    }
+    return expected;
+}
+
+void check_axes(const std::vector<int> &shape, const std::vector<int> &axes) {
+    size_t size = 1;
+    for (auto s : shape) {
+        size *= s;
+    }
+    for (auto reduce_type : {ReduceType::And, ReduceType::Or, ReduceType::Sum,
+                             ReduceType::Prod, ReduceType::Min, ReduceType::Max}) {
+        auto data = make_data<float>(size, reduce_type);
+        Array src(data.data(), shape, float32);
+        auto result = reduce(src, axes, reduce_type);
+        synchronize(true);
+
+        auto expected = reference_axes(data, shape, axes, reduce_type);
+        ASSERT_EQ(result.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(result.data<float>(i), expected[i]) << "op " << int(reduce_type) << " output " << i;
+        }
+    }
+}
+}// namespace
+
+TEST(Reduce, Rows) {
+    check_axes({5, 37, 19}, {2});
+    check_axes({5, 37, 19}, {1, 2});
+    check_axes({3, 10000}, {-1});
+}
+
+TEST(Reduce, Columns) {
+    check_axes({5, 37, 19}, {0});
+    check_axes({5, 37, 19}, {1});
+    check_axes({5, 37, 19}, {0, 1});
+    check_axes({4000, 3}, {0});
+}
+
+TEST(Reduce, GeneralAxes) {
+    check_axes({5, 37, 19}, {0, 2});
+    check_axes({2, 3, 4, 5, 6}, {0, 2, 4});
+    check_axes({5, 1, 19}, {0, 2});
+}
+
+TEST(Reduce, AxesOfViews) {
+    std::vector<float> data(6 * 8);
+    std::iota(data.begin(), data.end(), 0.f);
+    Array src(data.data(), {6, 8}, float32);
+
+    // columns of the transpose, read through its strides
+    auto rows = reduce(transpose(src), {0}, ReduceType::Sum);
+    auto broadcast = reduce(broadcast_to(reshape(src, {6, 1, 8}), {6, 3, 8}), {1, 2}, ReduceType::Max);
+    auto all = reduce(slice(src, {0, 0}, {6, 8}, {2, 3}), ReduceType::Sum);
+    synchronize(true);
+
+    ASSERT_EQ(rows.shape(), std::vector<int>{6});
+    ASSERT_EQ(broadcast.shape(), std::vector<int>{6});
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(rows.data<float>(i), float(8 * 8 * i + 28));
+        EXPECT_EQ(broadcast.data<float>(i), float(8 * i + 7));
+    }
+    // rows 0, 2, 4 and columns 0, 3, 6
+    EXPECT_EQ(all.data<float>(0), 3.f * (0 + 3 + 6) + 3.f * 8 * (0 + 2 + 4));
+}
+
+TEST(Reduce, KeepDims) {
+    std::vector<float> data(2 * 3 * 4, 1.f);
+    Array src(data.data(), {2, 3, 4}, float32);
+    auto kept = reduce(src, {1, -1}, ReduceType::Sum, true);
+    auto empty = reduce(Array(std::vector<int>{4, 0}, float32, nullptr, {}), {1}, ReduceType::Max);
+    synchronize(true);
+    EXPECT_EQ(kept.shape(), (std::vector<int>{2, 1, 1}));
+    EXPECT_EQ(kept.data<float>(1), 12.f);
+    EXPECT_EQ(empty.shape(), std::vector<int>{4});
+    EXPECT_EQ(empty.data<float>(3), -std::numeric_limits<float>::infinity());
+    EXPECT_THROW(reduce(src, {3}, ReduceType::Sum), std::invalid_argument);
+}
@@ -0,0 +1,140 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include "runtime/ops.h"
+#include "runtime/primitives/scan.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+const std::vector<size_t> sizes{1, 17, 4097, 100000, (1 << 20) + 3};
+
+// Sums stay exact in every type, products only see a few signs
+template<typename T>
+std::vector<T> make_data(size_t size, ReduceType reduce_type) {
+    std::vector<T> data(size);
+    for (size_t i = 0; i < size; i++) {
+        if (reduce_type == ReduceType::Prod) {
+            data[i] = T(std::is_signed_v<T> && i % 97 == 5 ? -1 : 1);
+        } else {
+            data[i] = T(int(i * 7 % 11) - (std::is_signed_v<T> ? 3 : 0));
+        }
+    }
+    return data;
+}
+
+template<typename T>
+std::vector<T> reference(const std::vector<T> &data, const std::vector<uint8_t> &flags, ReduceType reduce_type,
+                         bool inclusive) {
+    auto op = [reduce_type](T a, T b) {
+        switch (reduce_type) {
+            case ReduceType::Sum:
+                return T(a + b);
+            case ReduceType::Prod:
+                return T(a * b);
+            case ReduceType::Min:
+                return std::min(a, b);
+            default:
+                return std::max(a, b);
+        }
+    };
+    // the identities, infinities for floats
+    using limits = std::numeric_limits<T>;
+    const T init = reduce_type == ReduceType::Sum    ? T(0)
+                   : reduce_type == ReduceType::Prod ? T(1)
+                   : reduce_type == ReduceType::Min  ? (limits::has_infinity ? limits::infinity() : limits::max())
+                                                     : (limits::has_infinity ? -limits::infinity() : limits::lowest());
+    std::vector<T> out(data.size());
+    T running = init;
+    for (size_t i = 0; i < data.size(); i++) {
+        if (!flags.empty() && flags[i]) {
+            running = init;
+        }
+        if (inclusive) {
+            running = op(running, data[i]);
+            out[i] = running;
+        } else {
+            out[i] = running;
+            running = op(running, data[i]);
+        }
+    }
+    return out;
+}
+
+template<typename T>
+void check(Dtype dtype, bool segmented) {
+    for (auto reduce_type : {ReduceType::Sum, ReduceType::Prod, ReduceType::Min, ReduceType::Max}) {
+        for (auto size : sizes) {
+            for (bool inclusive : {true, false}) {
+                auto data = make_data<T>(size, reduce_type);
+                std::vector<uint8_t> flags;
+                if (segmented) {
+                    // segments from 1 to a few chunks long
+                    flags.resize(size);
+                    for (size_t i = 0; i < size; i += 1 + i * 31 % 9000) {
+                        flags[i] = 1;
+                    }
+                }
+                Array src(data.data(), {int(size)}, dtype);
+                auto result = segmented ? segmented_scan(src, Array(flags.data(), {int(size)}, uint8), reduce_type,
+                                                         inclusive)
+                                        : scan(src, reduce_type, inclusive);
+                synchronize(true);
+
+                auto expected = reference(data, flags, reduce_type, inclusive);
+                for (size_t i = 0; i < size; i++) {
+                    ASSERT_EQ(result.template data<T>(i), expected[i])
+                        << "op " << int(reduce_type) << " size " << size << " inclusive " << inclusive
+                        << " index " << i;
+                }
+            }
+        }
+    }
+}
+}// namespace
+
+TEST(Scan, Float32) {
+    check<float>(float32, false);
+}
+
+TEST(Scan, Integers) {
+    check<int32_t>(int32, false);
+    check<uint32_t>(uint32, false);
+    check<int64_t>(int64, false);
+    check<uint8_t>(uint8, false);
+}
+
+TEST(Scan, Segmented) {
+    check<float>(float32, true);
+    check<int32_t>(int32, true);
+}
+
+TEST(Scan, Invalid) {
+    std::vector<float> data(16, 1.f);
+    Array src(data.data(), {4, 4}, float32);
+    EXPECT_THROW(scan(src, ReduceType::And), std::invalid_argument);
+    EXPECT_THROW(segmented_scan(src, Array(std::vector<int>{16}, float32, nullptr, {}), ReduceType::Sum),
+                 std::invalid_argument);
+    EXPECT_THROW(scan(Array(std::vector<int>{4}, float2, nullptr, {}), ReduceType::Sum), std::invalid_argument);
+
+    // rejected when the scan is created, before anything was recorded
+    {
+        LazyEvaluation lazy;
+        EXPECT_THROW(scan(transpose(src), ReduceType::Sum), std::invalid_argument);
+        auto flags = transpose(reshape(Array(std::vector<uint8_t>(16, 0), uint8), {4, 4}));
+        EXPECT_THROW(segmented_scan(src, flags, ReduceType::Sum), std::invalid_argument);
+    }
+
+    // flattened
+    auto result = scan(src, ReduceType::Sum);
+    synchronize(true);
+    EXPECT_EQ(result.shape(), std::vector<int>{16});
+    EXPECT_EQ(result.data<float>(15), 16.f);
+}
@@ -0,0 +1,130 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include "runtime/ops.h"
+#include "runtime/primitives/segmented_reduce.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+// Mostly short or empty segments and a few spanning many tiles
+std::vector<uint32_t> make_offsets(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> offsets{0};
+    while (offsets.back() < size) {
+        const uint32_t length = rng() % 50 == 0 ? rng() % 40000 : rng() % 8;
+        offsets.push_back(uint32_t(std::min<size_t>(offsets.back() + length, size)));
+    }
+    return offsets;
+}
+}// namespace
+
+TEST(SegmentedReduce, Sum) {
+    for (size_t size : {0, 1, 255, 8193, 100000, (1 << 20) + 3}) {
+        std::mt19937 rng(size);
+        std::vector<int32_t> values(size);
+        for (auto &v : values) {
+            v = int32_t(rng() % 200) - 100;
+        }
+        auto offsets = make_offsets(size, uint32_t(size));
+        auto sums = segmented_reduce(Array(values.data(), {int(size)}, int32),
+                                     Array(offsets.data(), {int(offsets.size())}, uint32), ReduceType::Sum);
+        synchronize(true);
+        ASSERT_EQ(sums.size(), offsets.size() - 1);
+        for (size_t s = 0; s + 1 < offsets.size(); s++) {
+            int32_t expected = 0;
+            for (uint32_t i = offsets[s]; i < offsets[s + 1]; i++) {
+                expected += values[i];
+            }
+            ASSERT_EQ(sums.data<int32_t>(s), expected) << "size " << size << " segment " << s;
+        }
+    }
+}
+
+TEST(SegmentedReduce, MinMax) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    std::vector<float> values(200000);
+    for (auto &v : values) {
+        v = dist(rng);
+    }
+    // the elements outside of the segments are skipped
+    std::vector<int32_t> offsets{10, 10, 11, 20000, 20000, 150000, 150003};
+    Array src(values.data(), {int(values.size())}, float32);
+    Array segments(offsets.data(), {int(offsets.size())}, int32);
+    auto mins = segmented_reduce(src, segments, ReduceType::Min);
+    auto maxs = segmented_reduce(src, segments, ReduceType::Max);
+    synchronize(true);
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        auto begin = values.begin() + offsets[s];
+        auto end = values.begin() + offsets[s + 1];
+        const float expected_min = begin == end ? std::numeric_limits<float>::infinity() : *std::min_element(begin, end);
+        const float expected_max = begin == end ? -std::numeric_limits<float>::infinity() : *std::max_element(begin, end);
+        EXPECT_EQ(mins.data<float>(s), expected_min) << "segment " << s;
+        EXPECT_EQ(maxs.data<float>(s), expected_max) << "segment " << s;
+    }
+}
+
+TEST(SegmentedReduce, ByKey) {
+    for (size_t size : {0, 1, 4097, 300000}) {
+        std::mt19937 rng(size);
+        // runs of skewed lengths, like the bodies after sorting by body id
+        std::vector<uint32_t> keys(size);
+        uint32_t key = 3;
+        for (size_t i = 0; i < size; i++) {
+            if (rng() % (rng() % 2 ? 4 : 5000) == 0) {
+                key += 1 + rng() % 3;
+            }
+            keys[i] = key;
+        }
+        std::vector<float> masses(size);
+        for (auto &m : masses) {
+            m = float(rng() % 16) * 0.25f;
+        }
+        auto [unique_keys, totals, count] = reduce_by_key(Array(keys.data(), {int(size)}, uint32),
+                                                          Array(masses.data(), {int(size)}, float32), ReduceType::Sum);
+        synchronize(true);
+
+        size_t runs = 0;
+        for (size_t i = 0; i < size;) {
+            size_t end = i;
+            float expected = 0.f;
+            while (end < size && keys[end] == keys[i]) {
+                expected += masses[end++];
+            }
+            ASSERT_EQ(unique_keys.data<uint32_t>(runs), keys[i]) << "size " << size << " run " << runs;
+            // quarters are summed exactly in any order
+            ASSERT_EQ(totals.data<float>(runs), expected) << "size " << size << " run " << runs;
+            runs++;
+            i = end;
+        }
+        ASSERT_EQ(count.data<uint32_t>(0), runs) << "size " << size;
+    }
+}
+
+TEST(SegmentedReduce, Invalid) {
+    std::vector<int32_t> values{3, 1, 2};
+    std::vector<uint32_t> offsets{0, 3};
+    Array src(values.data(), {3}, int32);
+    Array segments(offsets.data(), {2}, uint32);
+    EXPECT_THROW(segmented_reduce(src, segments, ReduceType::And), std::invalid_argument);
+    EXPECT_THROW(segmented_reduce(src, Array(values.data(), {3}, float32), ReduceType::Sum), std::invalid_argument);
+    EXPECT_THROW(reduce_by_key(src, segments, ReduceType::Sum), std::invalid_argument);
+    EXPECT_THROW(reduce_by_key(Array(values.data(), {3}, float32), src, ReduceType::Sum), std::invalid_argument);
+
+    // rejected when the reduction is created, before anything was recorded
+    LazyEvaluation lazy;
+    std::vector<uint32_t> every_other{0, 0, 3, 0};
+    auto strided = slice(Array(every_other.data(), {4}, uint32), {0}, {4}, {2});
+    auto transposed = transpose(Array(every_other.data(), {2, 2}, uint32));
+    EXPECT_THROW(segmented_reduce(src, strided, ReduceType::Sum), std::invalid_argument);
+    EXPECT_THROW(reduce_by_key(transposed, Array(every_other.data(), {4}, uint32), ReduceType::Sum),
+                 std::invalid_argument);
+}
@@ -0,0 +1,107 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include "runtime/ops.h"
+#include "runtime/primitives/sort.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+const std::vector<size_t> sizes{1, 255, 4097, 100000, (1 << 20) + 3};
+
+template<typename K>
+std::vector<K> make_keys(size_t size, uint64_t range) {
+    std::mt19937_64 rng(size);
+    std::vector<K> keys(size);
+    for (auto &key : keys) {
+        const uint64_t r = rng() % range;
+        if constexpr (std::is_same_v<K, float>) {
+            key = float(int64_t(r) - int64_t(range / 2)) * 0.25f;
+        } else if constexpr (std::is_signed_v<K>) {
+            key = K(int64_t(r) - int64_t(range / 2));
+        } else {
+            key = K(r);
+        }
+    }
+    return keys;
+}
+
+template<typename K>
+void check(Dtype dtype, uint64_t range, int key_bits = 0) {
+    for (auto size : sizes) {
+        auto keys = make_keys<K>(size, range);
+        std::vector<uint32_t> values(size);
+        std::iota(values.begin(), values.end(), 0u);
+
+        auto sorted = radix_sort(Array(keys.data(), {int(size)}, dtype), key_bits);
+        auto [pair_keys, pair_values] = radix_sort(Array(keys.data(), {int(size)}, dtype),
+                                                   Array(values.data(), {int(size)}, uint32), key_bits);
+        synchronize(true);
+
+        // stable, equal keys keep the order of their indices
+        std::stable_sort(values.begin(), values.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        for (size_t i = 0; i < size; i++) {
+            ASSERT_EQ(sorted.template data<K>(i), keys[values[i]]) << "size " << size << " index " << i;
+            ASSERT_EQ(pair_keys.template data<K>(i), keys[values[i]]) << "size " << size << " index " << i;
+            ASSERT_EQ(pair_values.template data<uint32_t>(i), values[i]) << "size " << size << " index " << i;
+        }
+    }
+}
+}// namespace
+
+TEST(RadixSort, Uint32) {
+    check<uint32_t>(uint32, uint64_t(1) << 32);
+    // many duplicates
+    check<uint32_t>(uint32, 100);
+}
+
+TEST(RadixSort, PartialKeyBits) {
+    check<uint32_t>(uint32, 1 << 20, 20);
+    check<uint32_t>(uint32, 1 << 5, 5);
+}
+
+TEST(RadixSort, Uint64) {
+    check<uint64_t>(uint64, ~uint64_t(0));
+}
+
+TEST(RadixSort, SignedAndFloat) {
+    check<int32_t>(int32, uint64_t(1) << 32);
+    check<float>(float32, 1 << 16);
+}
+
+TEST(RadixSort, Invalid) {
+    std::vector<int32_t> keys{3, 1, 2};
+    Array src(keys.data(), {3}, int32);
+    EXPECT_THROW(radix_sort(src, 16), std::invalid_argument);
+    EXPECT_THROW(radix_sort(Array(std::vector<int>{4}, float16, nullptr, {})), std::invalid_argument);
+    EXPECT_THROW(radix_sort(src, Array(std::vector<int>{2}, uint32, nullptr, {})), std::invalid_argument);
+
+    // rejected when the sort is created, before anything was recorded
+    LazyEvaluation lazy;
+    std::vector<uint32_t> grid{3, 1, 2, 0};
+    auto transposed = transpose(Array(grid.data(), {2, 2}, uint32));
+    EXPECT_THROW(radix_sort(transposed), std::invalid_argument);
+    EXPECT_THROW(radix_sort(Array(grid.data(), {2, 2}, uint32), transposed), std::invalid_argument);
+}
+
+TEST(RadixSort, LazyOutputs) {
+    std::vector<uint32_t> keys{5, 3, 9, 1};
+    std::vector<uint32_t> values{0, 1, 2, 3};
+    LazyEvaluation lazy;
+    // the sorted keys are dropped before evaluation
+    auto sorted_values = radix_sort(Array(keys.data(), {4}, uint32), Array(values.data(), {4}, uint32)).second;
+    EXPECT_TRUE(sorted_values.has_primitive());
+    sorted_values.eval();
+    synchronize(true);
+    EXPECT_FALSE(sorted_values.has_primitive());
+    EXPECT_EQ(sorted_values.data<uint32_t>(0), 3u);
+    EXPECT_EQ(sorted_values.data<uint32_t>(3), 2u);
+}
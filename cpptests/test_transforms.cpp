@@ -0,0 +1,124 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include "runtime/host/host_kernel.h"
+#include "runtime/primitives/primitive.h"
+#include "runtime/kernel.h"
+#include "runtime/ops.h"
+#include "runtime/transforms.h"
+
+using namespace vox;
+
+namespace {
+std::atomic<uint32_t> dispatch_count{0};
+
+void add_one(const std::byte *arguments, const ThreadgroupContext &context) {
+    struct {
+        const float *src;
+        float *dst;
+    } args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    if (context.threadgroup_position_in_grid.x == 0) {
+        dispatch_count++;
+    }
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        args.dst[tpig.x] = args.src[tpig.x] + 1.f;
+    });
+}
+
+class AddOne final : public Primitive {
+public:
+    using Primitive::Primitive;
+
+    void eval(const std::vector<Array> &inputs, Array &out) override {
+        out.allocate();
+        auto kernel = Kernel::builder().entry("test_add_one").build();
+        kernel.set_threads(out.size());
+        kernel.set_threads_per_thread_group(32);
+        kernel({inputs[0], out}, stream());
+    }
+
+    [[nodiscard]] std::string name() const override {
+        return "AddOne";
+    }
+};
+
+Array add_one(const Array &a, uint32_t stream = 0) {
+    return apply_primitive(a.shape(), a.dtype(), std::make_shared<AddOne>(stream), {a});
+}
+
+Array iota(int size) {
+    std::vector<float> init(size);
+    std::iota(init.begin(), init.end(), 0.f);
+    return Array(init, float32);
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("test_add_one", add_one);
+
+TEST(Transforms, Eager) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    EXPECT_FALSE(lazy_evaluation());
+    auto b = add_one(iota(64));
+    EXPECT_FALSE(b.has_primitive());
+    synchronize(true);
+    EXPECT_EQ(b.data<float>(10), 11.f);
+}
+
+TEST(Transforms, Lazy) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    auto a = iota(64);
+    const auto allocations = allocator().stats().num_active_allocations;
+    dispatch_count = 0;
+
+    Array d = a;
+    {
+        LazyEvaluation lazy;
+        d = add_one(add_one(add_one(a)));
+        // the second stream waits for the first one
+        d = add_one(d, 1);
+    }
+    EXPECT_TRUE(d.has_primitive());
+    EXPECT_EQ(d.inputs().size(), 1u);
+    synchronize(true);
+    EXPECT_EQ(dispatch_count.load(), 0u);
+
+    eval({d});
+    synchronize(true, 1);
+    EXPECT_EQ(dispatch_count.load(), 4u);
+    EXPECT_FALSE(d.has_primitive());
+    EXPECT_TRUE(d.inputs().empty());
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(d.data<float>(i), float(i + 4));
+    }
+
+    // the intermediates died with their last user
+    synchronize(true);
+    EXPECT_EQ(allocator().stats().num_active_allocations, allocations + 1);
+}
+
+TEST(Transforms, LazyView) {
+    if (device().name() != "Host") {
+        GTEST_SKIP();
+    }
+    LazyEvaluation lazy;
+    auto b = add_one(iota(64));
+    auto row = take(reshape(b, {8, 8}), 2);
+    EXPECT_TRUE(row.has_primitive());
+
+    row.eval();
+    synchronize(true);
+    EXPECT_EQ(row.data_shared_ptr(), b.data_shared_ptr());
+    EXPECT_EQ(row.data<float>(0), 17.f);
+}
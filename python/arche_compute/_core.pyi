@@ -15,7 +15,36 @@
 from __future__ import annotations
 import pybind11_stubgen.typing_ext
 import typing
-__all__ = ['Array', 'DEVELOPER_TOOLS', 'DebugCaptureOption', 'DebugCaptureOptionOutput', 'DebugCaptureScope', 'Dtype', 'GPU_TRACE_DOCUMENT', 'Kernel', 'KernelBuilder', 'float16', 'float2', 'float2x2', 'float3', 'float32', 'float3x3', 'float4', 'float4x4', 'int16', 'int32', 'int64', 'int8', 'quat', 'spatial_matrix', 'spatial_vector', 'synchronize', 'transform', 'uint16', 'uint32', 'uint64', 'uint8']
+__all__ = ['AllocationTag', 'AllocatorStats', 'Array', 'DEVELOPER_TOOLS', 'DebugCaptureOption', 'DebugCaptureOptionOutput', 'DebugCaptureScope', 'DeviceType', 'Dtype', 'GPU_TRACE_DOCUMENT', 'Host', 'Kernel', 'KernelBuilder', 'Metal', 'device_name', 'float16', 'float2', 'float2x2', 'float3', 'float32', 'float3x3', 'float4', 'float4x4', 'int16', 'int32', 'int64', 'int8', 'is_available', 'memory_stats', 'quat', 'reset_peak_memory', 'set_default_device', 'spatial_matrix', 'spatial_vector', 'synchronize', 'transform', 'uint16', 'uint32', 'uint64', 'uint8']
+class AllocationTag:
+    def __enter__(self) -> None:
+        ...
+    def __exit__(self, arg0: typing.Any, arg1: typing.Any, arg2: typing.Any) -> None:
+        ...
+    def __init__(self, name: str) -> None:
+        ...
+class AllocatorStats:
+    @property
+    def active_memory(self) -> int:
+        ...
+    @property
+    def cache_memory(self) -> int:
+        ...
+    @property
+    def num_active_allocations(self) -> int:
+        ...
+    @property
+    def num_allocations(self) -> int:
+        ...
+    @property
+    def peak_memory(self) -> int:
+        ...
+    @property
+    def size_class_histogram(self) -> dict[int, int]:
+        ...
+    @property
+    def tag_active_memory(self) -> dict[str, int]:
+        ...
 class Array:
     """
     An N-dimensional array object.
@@ -27,6 +56,12 @@ class Array:
                     __init__(self: array, val: Union[scalar, list, tuple, numpy.ndarray, array], dtype: Optional[Dtype] = None)
                   
         """
+    def __getitem__(self, index: typing.Any) -> Array:
+        """
+                    Index with integers, slices and ``...``.
+        
+                    The result is a view sharing the memory of the array, no data is copied.
+        """
     def __len__(self) -> int:
         ...
     def item(self) -> typing.Any:
@@ -135,6 +170,43 @@ class DebugCaptureScope:
         ...
     def stop_debug_capture(self) -> None:
         ...
+class DeviceType:
+    """
+    Members:
+    
+      Metal
+    
+      Host
+    """
+    Host: typing.ClassVar[DeviceType]  # value = <DeviceType.Host: 1>
+    Metal: typing.ClassVar[DeviceType]  # value = <DeviceType.Metal: 0>
+    __members__: typing.ClassVar[dict[str, DeviceType]]  # value = {'Metal': <DeviceType.Metal: 0>, 'Host': <DeviceType.Host: 1>}
+    def __eq__(self, other: typing.Any) -> bool:
+        ...
+    def __getstate__(self) -> int:
+        ...
+    def __hash__(self) -> int:
+        ...
+    def __index__(self) -> int:
+        ...
+    def __init__(self, value: int) -> None:
+        ...
+    def __int__(self) -> int:
+        ...
+    def __ne__(self, other: typing.Any) -> bool:
+        ...
+    def __repr__(self) -> str:
+        ...
+    def __setstate__(self, state: int) -> None:
+        ...
+    def __str__(self) -> str:
+        ...
+    @property
+    def name(self) -> str:
+        ...
+    @property
+    def value(self) -> int:
+        ...
 class Dtype:
     """
     
@@ -172,10 +244,22 @@ class KernelBuilder:
         ...
     def source(self, arg0: str) -> KernelBuilder:
         ...
+def device_name() -> str:
+    ...
+def is_available(type: DeviceType) -> bool:
+    ...
+def memory_stats() -> AllocatorStats:
+    ...
+def reset_peak_memory() -> None:
+    ...
+def set_default_device(type: DeviceType) -> None:
+    ...
 def synchronize(wait: bool, stream: int = 0) -> None:
     ...
 DEVELOPER_TOOLS: DebugCaptureOptionOutput  # value = <DebugCaptureOptionOutput.DEVELOPER_TOOLS: 0>
 GPU_TRACE_DOCUMENT: DebugCaptureOptionOutput  # value = <DebugCaptureOptionOutput.GPU_TRACE_DOCUMENT: 1>
+Host: DeviceType  # value = <DeviceType.Host: 1>
+Metal: DeviceType  # value = <DeviceType.Metal: 0>
 float16: Dtype  # value = arc.float16
 float2: Dtype  # value = arc.float2
 float2x2: Dtype  # value = arc.float2x2
@@ -4,8 +4,11 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <mutex>
 #include <sstream>
 #include <utility>
+#include <vector>
+#include <unistd.h>
 
 #include <pybind11/numpy.h>
 #include "runtime/dtypes.h"
@@ -23,7 +26,7 @@ enum PyScalarT {
 };
 
 template<typename T>
-py::list to_list(Array &a, size_t index, int dim) {
+py::list to_list(Array &a, int64_t index, int dim) {
     py::list pl;
     auto stride = a.strides()[dim];
     for (int i = 0; i < a.shape(dim); ++i) {
@@ -268,27 +271,70 @@ Array array_from_list(T pl, std::optional<Dtype> dtype) {
 // Numpy -> MLX
 ///////////////////////////////////////////////////////////////////////////////
 
+// The numpy arrays shared with Arrays which died on a stream thread, dropped on the interpreter thread. Taking the
+// GIL on the stream thread would deadlock with a Python thread holding it while waiting on the stream, like an
+// allocation waiting for memory under MemoryPressurePolicy::Backpressure.
+struct DeferredRelease {
+    std::mutex mtx;
+    std::vector<py::object *> owners;
+    bool scheduled{false};
+};
+
+DeferredRelease &deferred_release() {
+    // Leaked, stream threads can release Arrays during the interpreter shutdown
+    static auto *deferred = new DeferredRelease;
+    return *deferred;
+}
+
+int release_deferred(void *) {
+    auto &deferred = deferred_release();
+    std::vector<py::object *> owners;
+    {
+        std::lock_guard<std::mutex> lock(deferred.mtx);
+        owners.swap(deferred.owners);
+        deferred.scheduled = false;
+    }
+    for (auto *owner : owners) {
+        delete owner;
+    }
+    return 0;
+}
+
+void release_owner(py::object *owner) {
+    if (PyGILState_Check()) {
+        delete owner;
+        return;
+    }
+    // Py_AddPendingCall needs neither the GIL nor a thread state, a full queue is retried by the next release
+    auto &deferred = deferred_release();
+    std::lock_guard<std::mutex> lock(deferred.mtx);
+    deferred.owners.push_back(owner);
+    if (!deferred.scheduled) {
+        deferred.scheduled = Py_AddPendingCall(&release_deferred, nullptr) == 0;
+    }
+}
+
 template<typename T>
 Array np_array_to_mlx_contiguous(
     py::array_t<T, py::array::c_style | py::array::forcecast> np_array,
     const std::vector<int> &shape,
     Dtype dtype) {
-    // Make a copy of the numpy buffer
-    // Get buffer ptr pass to array constructor
     py::buffer_info buf = np_array.request();
-    const T *data_ptr = static_cast<T *>(buf.ptr);
-    return Array(data_ptr, shape, dtype);
-
-    // Note: Leaving the following memoryless copy from np to mx commented
-    // out for the time being since it is unsafe given that the incoming
-    // numpy array may change the underlying data
-
-    // // Share underlying numpy buffer
-    // // Copy to increase ref count
-    // auto deleter = [np_array](void*) {};
-    // void* data_ptr = np_array.mutable_data();
-    // // Use buffer from numpy
-    // return array(data_ptr, deleter, shape, dtype);
+    T *data_ptr = static_cast<T *>(buf.ptr);
+
+    // Share the numpy buffer when the device can map it as is, like torch.from_numpy
+    // writes on either side are visible to the other
+    if constexpr (!std::is_same_v<T, double>) {
+        const auto page_size = static_cast<uintptr_t>(getpagesize());
+        if (dtype == Dtype(TypeToDtype<T>()) && reinterpret_cast<uintptr_t>(data_ptr) % page_size == 0) {
+            // The deleter can run on a stream thread once the last kernel using it completed
+            auto owner = new py::object(std::move(np_array));
+            return Array(data_ptr, shape, dtype, [owner](void *) { release_owner(owner); });
+        }
+    }
+
+    // Make a copy of the numpy buffer
+    return Array(static_cast<const T *>(data_ptr), shape, dtype);
 }
 
 Array np_array_to_mlx(const py::array &np_array, std::optional<Dtype> dtype) {
@@ -379,15 +425,92 @@ std::optional<std::string> buffer_format(const Array &a) {
     }
 }
 
-std::vector<size_t> buffer_strides(const Array &a) {
-    std::vector<size_t> py_strides;
+std::vector<py::ssize_t> buffer_strides(const Array &a) {
+    std::vector<py::ssize_t> py_strides;
     py_strides.reserve(a.strides().size());
-    for (const size_t stride : a.strides()) {
+    for (const int64_t stride : a.strides()) {
         py_strides.push_back(stride * a.itemsize());
     }
     return py_strides;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Indexing
+///////////////////////////////////////////////////////////////////////////////
+
+// Basic indexing only, ints, slices and an Ellipsis give a view of the array
+Array get_item(const Array &a, const py::object &obj) {
+    std::vector<py::object> indices;
+    if (py::isinstance<py::tuple>(obj)) {
+        for (auto index : obj.cast<py::tuple>()) {
+            indices.push_back(py::reinterpret_borrow<py::object>(index));
+        }
+    } else {
+        indices.push_back(obj);
+    }
+
+    size_t indexed_dims = 0;
+    bool has_ellipsis = false;
+    for (auto &index : indices) {
+        if (index.is(py::ellipsis())) {
+            if (has_ellipsis) {
+                throw std::invalid_argument("An index can only have a single ellipsis (\"...\").");
+            }
+            has_ellipsis = true;
+        } else if (py::isinstance<py::int_>(index) || py::isinstance<py::slice>(index)) {
+            indexed_dims++;
+        } else {
+            throw std::invalid_argument("Only integers, slices and ellipsis are valid indices.");
+        }
+    }
+    if (indexed_dims > a.ndim()) {
+        std::ostringstream msg;
+        msg << "Too many indices for array with " << a.ndim() << " dimensions.";
+        throw std::invalid_argument(msg.str());
+    }
+
+    std::vector<int> shape;
+    std::vector<int64_t> strides;
+    int64_t offset = 0;
+    bool empty = false;
+    int dim = 0;
+    for (auto &index : indices) {
+        if (index.is(py::ellipsis())) {
+            for (size_t i = 0; i < a.ndim() - indexed_dims; i++, dim++) {
+                shape.push_back(a.shape(dim));
+                strides.push_back(a.strides()[dim]);
+            }
+        } else if (py::isinstance<py::int_>(index)) {
+            const int n = a.shape(dim);
+            auto i = index.cast<int>();
+            if (i < -n || i >= n) {
+                throw py::index_error("Index out of bounds.");
+            }
+            offset += (i < 0 ? i + n : i) * a.strides()[dim];
+            dim++;
+        } else {
+            py::ssize_t start, stop, step, length;
+            if (!index.cast<py::slice>().compute(a.shape(dim), &start, &stop, &step, &length)) {
+                throw py::error_already_set();
+            }
+            shape.push_back(static_cast<int>(length));
+            strides.push_back(a.strides()[dim] * step);
+            if (length > 0) {
+                offset += start * a.strides()[dim];
+            } else {
+                empty = true;
+            }
+            dim++;
+        }
+    }
+    // Trailing dimensions are kept whole
+    for (; dim < a.ndim(); dim++) {
+        shape.push_back(a.shape(dim));
+        strides.push_back(a.strides()[dim]);
+    }
+    return a.view(shape, strides, empty ? 0 : offset);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Module
 ///////////////////////////////////////////////////////////////////////////////
@@ -540,6 +663,15 @@ void init_array(py::module_ &m) {
                 The value type of the list corresponding to the last dimension is either
                 ``int`` or ``float`` depending on the ``dtype`` of the array.
           )pbdoc")
+        .def(
+            "__getitem__",
+            &get_item,
+            "index"_a,
+            R"pbdoc(
+            Index with integers, slices and ``...``.
+
+            The result is a view sharing the memory of the array, no data is copied.
+          )pbdoc")
         .def(
             "__len__",
             [](const Array &a) {
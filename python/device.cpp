@@ -9,8 +9,12 @@
 #include <pybind11/cast.h>
 
 #include "runtime/array.h"
+#include "runtime/device.h"
+#include "runtime/allocator.h"
 #include "runtime/kernel.h"
+#ifdef ARCHE_USE_METAL
 #include "runtime/extension/debug_capture_ext.h"
+#endif
 
 namespace py = pybind11;
 using namespace py::literals;
@@ -33,10 +37,45 @@ PYBIND11_MODULE(_core, m) {
 
     init_array(m);
 
+    py::enum_<vox::DeviceType>(m, "DeviceType")
+        .value("Metal", vox::DeviceType::Metal)
+        .value("Host", vox::DeviceType::Host)
+        .export_values();
+
+    m.def("is_available", &vox::is_available, "type"_a);
+    m.def("set_default_device", &vox::set_default_device, "type"_a);
+    m.def("device_name", [] { return vox::device().name(); });
+
+    // memory statistics
+    {
+        py::class_<vox::AllocatorStats>(m, "AllocatorStats")
+            .def_readonly("active_memory", &vox::AllocatorStats::active_memory)
+            .def_readonly("cache_memory", &vox::AllocatorStats::cache_memory)
+            .def_readonly("peak_memory", &vox::AllocatorStats::peak_memory)
+            .def_readonly("num_allocations", &vox::AllocatorStats::num_allocations)
+            .def_readonly("num_active_allocations", &vox::AllocatorStats::num_active_allocations)
+            .def_readonly("size_class_histogram", &vox::AllocatorStats::size_class_histogram)
+            .def_readonly("tag_active_memory", &vox::AllocatorStats::tag_active_memory);
+
+        m.def("memory_stats", [] { return vox::allocator().stats(); });
+        m.def("reset_peak_memory", [] { vox::allocator().reset_peak(); });
+
+        // with arche_compute.AllocationTag("solver"): ...
+        struct PyAllocationTag {
+            std::string name;
+        };
+        py::class_<PyAllocationTag>(m, "AllocationTag")
+            .def(py::init<std::string>(), "name"_a)
+            .def("__enter__", [](PyAllocationTag &tag) { vox::push_allocation_tag(tag.name); })
+            .def("__exit__", [](PyAllocationTag &, py::object, py::object, py::object) { vox::pop_allocation_tag(); });
+    }
+
+    // Waiting doesn't need the GIL, the other Python threads run meanwhile
     m.def("synchronize",
           &vox::synchronize,
           "wait"_a,
-          "stream"_a = 0);
+          "stream"_a = 0,
+          py::call_guard<py::gil_scoped_release>());
 
     // pre define
     auto kernel = py::class_<vox::Kernel>(m, "Kernel");
@@ -51,8 +90,10 @@ PYBIND11_MODULE(_core, m) {
              "thread_groups_per_grid"_a,
              "threads_per_thread_group"_a,
              "args"_a,
-             "stream"_a = 0);
+             "stream"_a = 0,
+             py::call_guard<py::gil_scoped_release>());
 
+#ifdef ARCHE_USE_METAL
     // debug capture
     {
         py::class_<vox::DebugCaptureScope>(m, "DebugCaptureScope")
@@ -71,4 +112,5 @@ PYBIND11_MODULE(_core, m) {
             .def_readwrite("output", &vox::DebugCaptureOption::output)
             .def_readwrite("file_name", &vox::DebugCaptureOption::file_name);
     }
+#endif
 }
\ No newline at end of file
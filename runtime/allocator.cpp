@@ -4,26 +4,296 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <algorithm>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unistd.h>
 
 #include "allocator.h"
 #include "device.h"
-#include "metal.h"
 
 namespace vox {
-void *Buffer::raw_ptr() {
-    return ptr_->contents();
+namespace {
+size_t page_size() {
+    static const auto size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
 }
 
-uint64_t Buffer::address() const {
-    return ptr_->gpuAddress();
+// Allocations below a page share power of two size classes, larger ones are rounded up
+// to whole pages, so freed buffers can serve later requests of a similar size.
+size_t size_class(size_t size) {
+    if (size > page_size()) {
+        return page_size() * ((size + page_size() - 1) / page_size());
+    }
+    size_t result = 16;
+    while (result < size) {
+        result <<= 1;
+    }
+    return result;
+}
+}// namespace
+
+BufferCache::BufferCache(Device &device)
+    : device_(device) {}
+
+BufferCache::~BufferCache() {
+    clear();
+}
+
+void BufferCache::clear() {
+    for (auto &[size, holder] : buffer_pool_) {
+        device_.release_buffer(holder->buf);
+        delete holder;
+    }
+    buffer_pool_.clear();
+    pool_size_ = 0;
+    head_ = nullptr;
+    tail_ = nullptr;
+}
+
+Buffer BufferCache::reuse_from_cache(size_t size) {
+    // Find the closest buffer in pool
+    Buffer pbuf{nullptr};
+
+    // Make sure we use most of the available memory
+    auto it = buffer_pool_.lower_bound(size);
+    if (it != buffer_pool_.end() && it->first < std::min(2 * size, size + 2 * page_size())) {
+        pbuf = it->second->buf;
+        pool_size_ -= it->first;
+        remove_from_list(it->second);
+        delete it->second;
+        buffer_pool_.erase(it);
+    }
+
+    return pbuf;
+}
+
+void BufferCache::recycle_to_cache(Buffer buffer) {
+    // Add to cache
+    if (buffer.ptr()) {
+        auto *bh = new BufferHolder(buffer);
+        add_at_head(bh);
+        pool_size_ += buffer.size();
+        buffer_pool_.insert({buffer.size(), bh});
+    }
+}
+
+void BufferCache::release_cached_buffers(size_t min_bytes_to_free) {
+    if (min_bytes_to_free >= 0.9 * pool_size_) {
+        clear();
+        return;
+    }
+
+    size_t total_bytes_freed = 0;
+    while (tail_ && (total_bytes_freed < min_bytes_to_free)) {
+        // Release the least recently used buffer
+        auto size = tail_->buf.size();
+        auto [first, last] = buffer_pool_.equal_range(size);
+        for (auto it = first; it != last; ++it) {
+            if (it->second == tail_) {
+                buffer_pool_.erase(it);
+                break;
+            }
+        }
+        total_bytes_freed += size;
+        pool_size_ -= size;
+
+        auto *to_release = tail_;
+        remove_from_list(tail_);
+        device_.release_buffer(to_release->buf);
+        delete to_release;
+    }
+}
+
+void BufferCache::add_at_head(BufferCache::BufferHolder *to_add) {
+    if (!to_add) return;
+
+    if (!head_) {
+        head_ = to_add;
+        tail_ = to_add;
+    } else {
+        head_->prev = to_add;
+        to_add->next = head_;
+        head_ = to_add;
+    }
+}
+
+void BufferCache::remove_from_list(BufferCache::BufferHolder *to_remove) {
+    if (!to_remove) return;
+
+    // If in the middle
+    if (to_remove->prev && to_remove->next) {
+        to_remove->prev->next = to_remove->next;
+        to_remove->next->prev = to_remove->prev;
+    } else if (to_remove->prev && to_remove == tail_) {// If tail
+        tail_ = to_remove->prev;
+        tail_->next = nullptr;
+    } else if (to_remove == head_ && to_remove->next) {// If head
+        head_ = to_remove->next;
+        head_->prev = nullptr;
+    } else if (to_remove == head_ && to_remove == tail_) {// If only element
+        head_ = nullptr;
+        tail_ = nullptr;
+    }
+
+    to_remove->prev = nullptr;
+    to_remove->next = nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+struct Slab {
+    Buffer buffer;
+    size_t slot_size;
+    size_t used{0};
+    std::vector<uint32_t> free_slots;
+
+    Slab(Buffer buffer, size_t slot_size, size_t slot_count)
+        : buffer(buffer), slot_size(slot_size) {
+        // pop_back hands out the lowest offsets first
+        free_slots.resize(slot_count);
+        for (size_t i = 0; i < slot_count; i++) {
+            free_slots[i] = uint32_t(slot_count - 1 - i);
+        }
+    }
+};
+
+SlabHeap::SlabHeap(Device &device, size_t slab_size)
+    : device_(device),
+      slab_size_(slab_size),
+      available_(class_index(max_size) + 1) {}
+
+SlabHeap::~SlabHeap() {
+    // Live sub-allocations are leaked with their slab, like the buffers of live Arrays
+    release_empty_slabs();
+}
+
+size_t SlabHeap::class_index(size_t size) {
+    size_t index = 0;
+    for (size_t s = min_size; s < size; s <<= 1) {
+        index++;
+    }
+    return index;
+}
+
+Buffer SlabHeap::malloc(size_t size) {
+    return malloc(size, [&](size_t slab_size) { return device_.new_buffer(slab_size); });
+}
+
+Buffer SlabHeap::malloc(size_t size, const std::function<Buffer(size_t)> &new_slab) {
+    auto &slabs = available_[class_index(size)];
+    if (slabs.empty()) {
+        auto buffer = new_slab(slab_size_);
+        if (!buffer.ptr()) {
+            return buffer;
+        }
+        slabs.push_back(new Slab(buffer, size, slab_size_ / size));
+        slab_count_++;
+    }
+
+    auto *slab = slabs.back();
+    auto slot = slab->free_slots.back();
+    slab->free_slots.pop_back();
+    slab->used++;
+    if (slab->free_slots.empty()) {
+        slabs.pop_back();
+    }
+
+    Buffer buffer = slab->buffer;
+    buffer.size_ = size;
+    buffer.offset_ = slot * size;
+    buffer.slab_ = slab;
+    return buffer;
+}
+
+void SlabHeap::free(Buffer buffer) {
+    auto *slab = buffer.slab_;
+    auto &slabs = available_[class_index(slab->slot_size)];
+    if (slab->free_slots.empty()) {
+        slabs.push_back(slab);
+    }
+    slab->free_slots.push_back(uint32_t(buffer.offset_ / slab->slot_size));
+    slab->used--;
+
+    // Keep one empty slab per class so a single Array doesn't create and release slabs in a loop
+    if (slab->used == 0 && slabs.size() > 1) {
+        slabs.erase(std::find(slabs.begin(), slabs.end(), slab));
+        device_.release_buffer(slab->buffer);
+        delete slab;
+        slab_count_--;
+    }
+}
+
+void SlabHeap::release_empty_slabs() {
+    for (auto &slabs : available_) {
+        auto it = std::remove_if(slabs.begin(), slabs.end(), [&](Slab *slab) {
+            if (slab->used > 0) {
+                return false;
+            }
+            device_.release_buffer(slab->buffer);
+            delete slab;
+            slab_count_--;
+            return true;
+        });
+        slabs.erase(it, slabs.end());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+namespace {
+struct AllocationTagRegistry {
+    // id 0 is the untagged memory
+    std::vector<std::string> names{""};
+    std::unordered_map<std::string, uint32_t> ids;
+    std::mutex mtx;
+};
+
+AllocationTagRegistry &tag_registry() {
+    static AllocationTagRegistry registry;
+    return registry;
+}
+
+thread_local std::vector<uint32_t> tag_stack;
+
+uint32_t allocation_tag_id(const std::string &name) {
+    auto &r = tag_registry();
+    const std::lock_guard<std::mutex> lock(r.mtx);
+    auto [it, inserted] = r.ids.insert({name, uint32_t(r.names.size())});
+    if (inserted) {
+        r.names.push_back(name);
+    }
+    return it->second;
+}
+}// namespace
+
+void push_allocation_tag(const std::string &name) {
+    tag_stack.push_back(allocation_tag_id(name));
+}
+
+void pop_allocation_tag() {
+    if (!tag_stack.empty()) {
+        tag_stack.pop_back();
+    }
+}
+
+uint32_t current_allocation_tag() {
+    return tag_stack.empty() ? 0 : tag_stack.back();
 }
 
-Allocator::Allocator()
-    : device_(vox::device().handle()),
-      peak_allocated_size_(0),
-      block_limit_(1.5 * device_->recommendedMaxWorkingSetSize()),
-      gc_limit_(0.95 * device_->recommendedMaxWorkingSetSize()) {}
+std::string allocation_tag_name(uint32_t tag) {
+    auto &r = tag_registry();
+    const std::lock_guard<std::mutex> lock(r.mtx);
+    return r.names.at(tag);
+}
+
+Allocator::Allocator(Device &device)
+    : device_(&device),
+      buffer_cache_(device),
+      heap_(device),
+      recommended_working_set_size_(device_->recommended_max_working_set_size()),
+      block_limit_(1.5 * recommended_working_set_size_),
+      gc_limit_(0.95 * recommended_working_set_size_),
+      max_pool_size_(gc_limit_) {}
 
 Buffer Allocator::malloc(size_t size, bool allow_swap /* = false */) {
     // Metal doesn't like empty buffers
@@ -31,41 +301,194 @@ Buffer Allocator::malloc(size_t size, bool allow_swap /* = false */) {
         return Buffer{nullptr};
     }
 
-    // Align up memory
-    if (size > vm_page_size) {
-        size = vm_page_size * ((size + vm_page_size - 1) / vm_page_size);
+    size = size_class(size);
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    // New slabs are subject to the memory limit like the large allocations
+    Buffer buf = size <= small_size_limit
+                     ? heap_.malloc(size, [&](size_t slab_size) { return malloc_large_(slab_size, allow_swap); })
+                     : malloc_large_(size, allow_swap);
+    if (buf.ptr()) {
+        record_malloc_(buf);
     }
+    return buf;
+}
 
-    // If there is too much memory pressure, fail (likely causes a wait).
-    if (!allow_swap && device_->currentAllocatedSize() + size >= block_limit_) {
-        return Buffer{nullptr};
+Buffer Allocator::malloc_large_(size_t size, bool allow_swap) {
+    // Try the cache
+    Buffer buf = buffer_cache_.reuse_from_cache(size);
+    if (buf.ptr()) {
+        return buf;
+    }
+
+    // If there is a lot of memory pressure, reclaim memory from the cache
+    size_t mem_required = device_->current_allocated_size() + size;
+    if (mem_required >= gc_limit_) {
+        buffer_cache_.release_cached_buffers(mem_required - gc_limit_);
     }
 
-    auto thread_pool = new_scoped_memory_pool();
+    // If there is still too much memory pressure, fail (likely causes a wait).
+    if (!allow_swap && device_->current_allocated_size() + size >= block_limit_) {
+        return Buffer{nullptr};
+    }
 
     // Allocate new buffer if needed
-    size_t res_opt = MTL::ResourceStorageModeShared;
-    res_opt |= MTL::ResourceHazardTrackingModeTracked;
-    auto buf = device_->newBuffer(size, res_opt);
+    return device_->new_buffer(size);
+}
+
+Buffer Allocator::malloc_or_wait(size_t size) {
+    Buffer buf = malloc(size);
+    if (buf.ptr() || size == 0) {
+        return buf;
+    }
 
-    peak_allocated_size_ =
-        std::max(peak_allocated_size_, device_->currentAllocatedSize());
+    switch (memory_pressure_policy()) {
+        case MemoryPressurePolicy::Swap:
+            return malloc(size, /* allow_swap */ true);
+        case MemoryPressurePolicy::Throw:
+            return buf;
+        case MemoryPressurePolicy::Backpressure:
+            break;
+    }
+
+    // The cache only gives back what it holds beyond gc_limit_ on a miss
+    clear_cache();
+    buf = malloc(size);
+    if (buf.ptr()) {
+        return buf;
+    }
+
+    // In-flight command buffers keep their arguments alive, retiring them frees the buffers
+    device_->synchronize(/* wait */ true);
+    clear_cache();
+    buf = malloc(size);
+    if (buf.ptr()) {
+        return buf;
+    }
+
+    // Nothing left to wait for, the working set itself is over the limit
+    return malloc(size, /* allow_swap */ true);
+}
 
-    return Buffer{buf};
+MemoryPressurePolicy Allocator::set_memory_pressure_policy(MemoryPressurePolicy policy) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::swap(policy, policy_);
+    return policy;
+}
+
+MemoryPressurePolicy Allocator::memory_pressure_policy() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return policy_;
+}
+
+size_t Allocator::set_memory_limit(size_t limit) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::swap(limit, block_limit_);
+    gc_limit_ = std::min(size_t(0.95 * recommended_working_set_size_), block_limit_);
+    return limit;
+}
+
+void Allocator::record_malloc_(Buffer &buffer) {
+    const auto size = buffer.size();
+    active_memory_ += size;
+    peak_memory_ = std::max(peak_memory_, active_memory_);
+    num_allocations_++;
+    num_active_allocations_++;
+    if (buffer.slab()) {
+        heap_active_memory_ += size;
+    }
+
+    // bucket by the next power of two, page rounded sizes would give one entry per page count
+    size_t bucket = 1;
+    while (bucket < size) {
+        bucket <<= 1;
+    }
+    size_class_histogram_[bucket]++;
+
+    buffer.tag_ = current_allocation_tag();
+    if (buffer.tag_) {
+        if (tag_active_memory_.size() <= buffer.tag_) {
+            tag_active_memory_.resize(buffer.tag_ + 1, 0);
+        }
+        tag_active_memory_[buffer.tag_] += size;
+    }
 }
 
 void Allocator::free(Buffer buffer) {
-    buffer.ptr()->release();
+    if (!buffer.ptr()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    active_memory_ -= buffer.size();
+    num_active_allocations_--;
+    if (buffer.tag_) {
+        tag_active_memory_[buffer.tag_] -= buffer.size();
+    }
+
+    if (buffer.slab()) {
+        heap_active_memory_ -= buffer.size();
+        heap_.free(buffer);
+        return;
+    }
+    if (buffer.size() > max_pool_size_) {
+        device_->release_buffer(buffer);
+        return;
+    }
+    buffer_cache_.recycle_to_cache(buffer);
+    if (buffer_cache_.cache_size() > max_pool_size_) {
+        buffer_cache_.release_cached_buffers(buffer_cache_.cache_size() - max_pool_size_);
+    }
+}
+
+AllocatorStats Allocator::stats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    AllocatorStats stats;
+    stats.active_memory = active_memory_;
+    stats.cache_memory = buffer_cache_.cache_size() + heap_.slab_count() * heap_.slab_size() - heap_active_memory_;
+    stats.peak_memory = peak_memory_;
+    stats.num_allocations = num_allocations_;
+    stats.num_active_allocations = num_active_allocations_;
+    stats.size_class_histogram = size_class_histogram_;
+    for (uint32_t tag = 1; tag < tag_active_memory_.size(); tag++) {
+        stats.tag_active_memory[allocation_tag_name(tag)] = tag_active_memory_[tag];
+    }
+    return stats;
+}
+
+void Allocator::reset_peak() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    peak_memory_ = active_memory_;
+}
+
+size_t Allocator::cache_size() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return buffer_cache_.cache_size();
+}
+
+size_t Allocator::set_cache_limit(size_t limit) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::swap(limit, max_pool_size_);
+    if (buffer_cache_.cache_size() > max_pool_size_) {
+        buffer_cache_.release_cached_buffers(buffer_cache_.cache_size() - max_pool_size_);
+    }
+    return limit;
+}
+
+void Allocator::clear_cache() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    buffer_cache_.clear();
+    heap_.release_empty_slabs();
 }
 
 Allocator &allocator() {
-    static Allocator allocator_;
+    static Allocator allocator_{device()};
     return allocator_;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 Buffer malloc(size_t size) {
-    auto buffer = allocator().malloc(size, /* allow_swap */ true);
+    auto buffer = allocator().malloc_or_wait(size);
     if (size && !buffer.ptr()) {
         std::ostringstream msg;
         msg << "[malloc] Unable to allocate " << size << " bytes.";
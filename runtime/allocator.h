@@ -6,54 +6,263 @@
 
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <map>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <cstdlib>
 #include "device.h"
 
 namespace vox {
+struct Slab;
 
 // Simple wrapper around buffer pointers
 // WARNING: Only Buffer objects constructed from and those that wrap
 //          raw pointers from mlx::allocator are supported.
 class Buffer final {
 private:
-    MTL::Buffer *ptr_;
+    // Backend handle (MTL::Buffer on Metal)
+    void *ptr_;
+    // Cached at creation, both are stable for the lifetime of the buffer
+    void *contents_{nullptr};
+    uint64_t address_{0};
+    size_t size_{0};
+    // Sub-allocations share the handle of their slab, starting at offset_
+    size_t offset_{0};
+    Slab *slab_{nullptr};
+    // Allocation tag the bytes are accounted to, 0 if untagged
+    uint32_t tag_{0};
+
+    friend class SlabHeap;
+    friend class Arena;
+    friend class Allocator;
 
 public:
-    explicit Buffer(MTL::Buffer *ptr) : ptr_(ptr){};
+    explicit Buffer(void *ptr, void *contents = nullptr, uint64_t address = 0, size_t size = 0)
+        : ptr_(ptr), contents_(contents), address_(address), size_(size){};
 
     // Get the raw data pointer from the buffer
-    void *raw_ptr();
+    void *raw_ptr() {
+        return static_cast<std::byte *>(contents_) + offset_;
+    };
+    [[nodiscard]] const void *raw_ptr() const {
+        return static_cast<const std::byte *>(contents_) + offset_;
+    };
+
+    // Address used to bind the buffer in kernel arguments
+    [[nodiscard]] uint64_t address() const {
+        return address_ + offset_;
+    };
+
+    // Offset of the data inside the backend buffer
+    [[nodiscard]] size_t offset() const {
+        return offset_;
+    };
 
-    [[nodiscard]] uint64_t address() const;
+    // nullptr if the buffer owns its backend buffer
+    [[nodiscard]] Slab *slab() const {
+        return slab_;
+    };
+
+    // Size of the allocation, can be larger than the requested size
+    [[nodiscard]] size_t size() const {
+        return size_;
+    };
 
     // Get the buffer pointer from the buffer
-    [[nodiscard]] const MTL::Buffer *ptr() const {
+    [[nodiscard]] const void *ptr() const {
         return ptr_;
     };
-    MTL::Buffer *ptr() {
+    void *ptr() {
         return ptr_;
     };
 };
 
+// Freed buffers ordered by size, the least recently used ones are released first
+class BufferCache {
+public:
+    explicit BufferCache(Device &device);
+    ~BufferCache();
+
+    BufferCache(const BufferCache &) = delete;
+    BufferCache &operator=(const BufferCache &) = delete;
+
+    // Smallest cached buffer which fits size without wasting more than it needs, or a null Buffer
+    Buffer reuse_from_cache(size_t size);
+    void recycle_to_cache(Buffer buffer);
+    void release_cached_buffers(size_t min_bytes_to_free);
+    void clear();
+
+    [[nodiscard]] size_t cache_size() const {
+        return pool_size_;
+    }
+
+private:
+    struct BufferHolder {
+    public:
+        explicit BufferHolder(Buffer buf) : buf(buf), prev(nullptr), next(nullptr) {}
+
+        BufferHolder *prev;
+        BufferHolder *next;
+        Buffer buf;
+    };
+
+    void add_at_head(BufferHolder *to_add);
+    void remove_from_list(BufferHolder *to_remove);
+
+    Device &device_;
+    std::multimap<size_t, BufferHolder *> buffer_pool_;
+    BufferHolder *head_{nullptr};
+    BufferHolder *tail_{nullptr};
+    size_t pool_size_{0};
+};
+
+// Carves small allocations out of large device buffers, one slab holds slots of a single size class
+class SlabHeap {
+public:
+    explicit SlabHeap(Device &device, size_t slab_size = 1 << 16);
+    ~SlabHeap();
+
+    SlabHeap(const SlabHeap &) = delete;
+    SlabHeap &operator=(const SlabHeap &) = delete;
+
+    // size must be a power of two between min_size and max_size, null Buffer if the device is out of memory
+    Buffer malloc(size_t size);
+    // Same, the buffer of a new slab comes from new_slab, which can return a null Buffer
+    Buffer malloc(size_t size, const std::function<Buffer(size_t)> &new_slab);
+    void free(Buffer buffer);
+
+    // Give the slabs without live allocations back to the device
+    void release_empty_slabs();
+
+    [[nodiscard]] size_t slab_count() const {
+        return slab_count_;
+    }
+
+    [[nodiscard]] size_t slab_size() const {
+        return slab_size_;
+    }
+
+    static constexpr size_t min_size = 16;
+    static constexpr size_t max_size = 2048;
+
+private:
+    static size_t class_index(size_t size);
+
+    Device &device_;
+    size_t slab_size_;
+    size_t slab_count_{0};
+    // Slabs with at least one free slot, per size class
+    std::vector<std::vector<Slab *>> available_;
+};
+
+struct AllocatorStats {
+    // Bytes of the live allocations, rounded up to their size class
+    size_t active_memory{0};
+    // Bytes kept for reuse by the buffer cache and the free slots of the slabs
+    size_t cache_memory{0};
+    // Highest active_memory since creation or the last reset_peak()
+    size_t peak_memory{0};
+    // Calls to malloc which returned memory
+    size_t num_allocations{0};
+    size_t num_active_allocations{0};
+    // Number of allocations by size, keyed by the next power of two
+    std::map<size_t, size_t> size_class_histogram;
+    // Active bytes of the allocations made while a tag was pushed
+    std::map<std::string, size_t> tag_active_memory;
+};
+
+// What malloc_or_wait does when an allocation would exceed the memory limit
+enum class MemoryPressurePolicy {
+    // Allocate past the limit and let the system page
+    Swap,
+    // Return a null Buffer
+    Throw,
+    // Evict the cache, then wait for the streams to retire their work before retrying
+    Backpressure,
+};
+
 class Allocator final {
 public:
+    explicit Allocator(Device &device);
+
     Buffer malloc(size_t size, bool allow_swap = false);
     void free(Buffer buffer);
 
+    // malloc which applies the memory pressure policy when the limit is reached
+    Buffer malloc_or_wait(size_t size);
+
+    MemoryPressurePolicy set_memory_pressure_policy(MemoryPressurePolicy policy);
+    MemoryPressurePolicy memory_pressure_policy();
+
+    // Device bytes beyond which large allocations fail, returns the previous limit
+    size_t set_memory_limit(size_t limit);
+
+    AllocatorStats stats();
+
+    // Start measuring the peak from the current active memory, e.g. per phase
+    void reset_peak();
+
+    // Bytes held by the cache, they count towards the device allocated size
+    size_t cache_size();
+
+    // Allocations up to this size are sub-allocated from slabs
+    static constexpr size_t small_size_limit = SlabHeap::max_size;
+
+    // Returns the previous limit, a limit of 0 disables the cache
+    size_t set_cache_limit(size_t limit);
+
+    // Also releases the slabs without live allocations
+    void clear_cache();
+
 private:
-    MTL::Device *device_;
-    Allocator();
-    friend Allocator &allocator();
+    Buffer malloc_large_(size_t size, bool allow_swap);
+    void record_malloc_(Buffer &buffer);
+
+    Device *device_;
+    BufferCache buffer_cache_;
+    SlabHeap heap_;
+    std::mutex mutex_;
 
     // Allocation stats
-    size_t peak_allocated_size_;
+    size_t active_memory_{0};
+    size_t heap_active_memory_{0};
+    size_t peak_memory_{0};
+    size_t num_allocations_{0};
+    size_t num_active_allocations_{0};
+    std::map<size_t, size_t> size_class_histogram_;
+    std::vector<size_t> tag_active_memory_;
+    size_t recommended_working_set_size_;
     size_t block_limit_;
     size_t gc_limit_;
+    size_t max_pool_size_;
+    MemoryPressurePolicy policy_{MemoryPressurePolicy::Swap};
 };
 
+// Allocator of the default device
 Allocator &allocator();
 
+// Account the allocations of the calling thread to name until the matching pop
+void push_allocation_tag(const std::string &name);
+void pop_allocation_tag();
+uint32_t current_allocation_tag();
+std::string allocation_tag_name(uint32_t tag);
+
+class AllocationTag {
+public:
+    explicit AllocationTag(const std::string &name) {
+        push_allocation_tag(name);
+    }
+    ~AllocationTag() {
+        pop_allocation_tag();
+    }
+
+    AllocationTag(const AllocationTag &) = delete;
+    AllocationTag &operator=(const AllocationTag &) = delete;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 Buffer malloc(size_t size);
 
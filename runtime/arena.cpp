@@ -0,0 +1,83 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cassert>
+#include <sstream>
+
+#include "arena.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+Buffer allocate_slab(Allocator &allocator, size_t size) {
+    auto buffer = allocator.malloc(size, /* allow_swap */ true);
+    if (size && !buffer.ptr()) {
+        std::ostringstream msg;
+        msg << "[Arena] Unable to allocate " << size << " bytes.";
+        throw std::runtime_error(msg.str());
+    }
+    return buffer;
+}
+}// namespace
+
+Arena::Arena(size_t capacity, Allocator &allocator)
+    : allocator_(allocator),
+      slab_(allocate_slab(allocator, align(capacity, alignment))) {}
+
+Arena::~Arena() {
+    assert(live_.load() == 0 && "Arrays built from an Arena must not outlive it");
+    for (auto &buffer : overflow_) {
+        allocator_.free(buffer);
+    }
+    allocator_.free(slab_);
+}
+
+Buffer Arena::allocate(size_t size) {
+    size = align(std::max(size, size_t(1)), alignment);
+    live_.fetch_add(1, std::memory_order_relaxed);
+    used_ += size;
+
+    if (offset_ + size <= slab_.size()) {
+        Buffer buffer = slab_;
+        buffer.offset_ += offset_;
+        buffer.size_ = size;
+        offset_ += size;
+        return buffer;
+    }
+
+    // Out of slab, the next reset grows it to the high-water mark
+    overflow_.push_back(allocate_slab(allocator_, size));
+    return overflow_.back();
+}
+
+void Arena::release(const Buffer &buffer) {
+    [[maybe_unused]] auto live = live_.fetch_sub(1, std::memory_order_release);
+    assert(live > 0);
+}
+
+void Arena::reset() {
+    assert(live_.load(std::memory_order_acquire) == 0 && "Arrays built from an Arena are still alive on reset");
+    high_water_mark_ = std::max(high_water_mark_, used_);
+
+    if (!overflow_.empty()) {
+        for (auto &buffer : overflow_) {
+            allocator_.free(buffer);
+        }
+        overflow_.clear();
+        allocator_.free(slab_);
+        slab_ = allocate_slab(allocator_, high_water_mark_);
+    }
+
+    offset_ = 0;
+    used_ = 0;
+}
+
+ArenaScope::~ArenaScope() {
+    synchronize(true, stream_);
+    arena_.reset();
+}
+
+}// namespace vox
@@ -0,0 +1,91 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "allocator.h"
+
+namespace vox {
+/**
+ * @brief Bump allocator for scratch Arrays which share the lifetime of a step.
+ *
+ * Allocations are carved out of one slab and released all at once by reset(). When a step
+ * needs more than the slab, overflow chunks are taken from the Allocator and the slab grows
+ * to the high-water mark on the next reset, so steady state runs out of a single buffer.
+ */
+class Arena {
+public:
+    explicit Arena(size_t capacity, Allocator &allocator = vox::allocator());
+
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Buffer allocate(size_t size);
+
+    // Called by the Arrays built from the arena when they die, from any thread: the last copy of an Array
+    // may be dropped by the stream which retained it once its command buffer completed
+    void release(const Buffer &buffer);
+
+    // Every Array built from the arena must be dead and the GPU done with them
+    void reset();
+
+    // Bytes handed out since the last reset
+    [[nodiscard]] size_t used() const {
+        return used_;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return slab_.size();
+    }
+
+    // Largest number of bytes used between two resets
+    [[nodiscard]] size_t high_water_mark() const {
+        return std::max(high_water_mark_, used_);
+    }
+
+    static constexpr size_t alignment = 64;
+
+private:
+    Allocator &allocator_;
+    Buffer slab_{nullptr};
+    size_t offset_{0};
+    size_t used_{0};
+    size_t high_water_mark_{0};
+    // The only state release() touches, the rest belongs to the thread allocating and resetting
+    std::atomic<size_t> live_{0};
+    std::vector<Buffer> overflow_;
+};
+
+/**
+ * @brief Reset the arena once the work of a step is done
+ *
+ * Ex.
+ * {
+ *     ArenaScope scope(arena);
+ *     Array partials({num_groups}, float32, arena);
+ *     ...
+ * } // waits for the stream, then resets the arena
+ */
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena, uint32_t stream = 0)
+        : arena_(arena), stream_(stream) {}
+
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    Arena &arena_;
+    uint32_t stream_;
+};
+
+}// namespace vox
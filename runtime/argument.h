@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <variant>
+#include <vector>
 #include <memory>
 
 namespace vox {
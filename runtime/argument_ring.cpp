@@ -0,0 +1,110 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <sstream>
+
+#include "argument_ring.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+Buffer allocate_ring(Device &device, size_t size) {
+    auto buffer = device.new_buffer(size);
+    if (!buffer.ptr()) {
+        std::ostringstream msg;
+        msg << "[ArgumentRing] Unable to allocate " << size << " bytes.";
+        throw std::runtime_error(msg.str());
+    }
+    return buffer;
+}
+}// namespace
+
+ArgumentRing::ArgumentRing(Device &device, size_t capacity)
+    : device_(device),
+      initial_capacity_(align(std::max(capacity, alignment), alignment)) {}
+
+ArgumentRing::~ArgumentRing() {
+    for (auto &[buffer, generation] : retired_) {
+        device_.release_buffer(buffer);
+    }
+    if (buffer_.ptr()) {
+        device_.release_buffer(buffer_);
+    }
+}
+
+ArgumentRing::Allocation ArgumentRing::allocate(size_t requested) {
+    const size_t size = align(std::max(requested, size_t(1)), alignment);
+
+    const std::lock_guard<std::mutex> lock(mtx_);
+    // Streams which never launch a Kernel don't take device memory
+    if (!buffer_.ptr()) {
+        buffer_ = allocate_ring(device_, initial_capacity_);
+    }
+
+    size_t start = head_;
+    // Allocations are contiguous, skip the end of the buffer when they don't fit in it
+    const size_t offset = head_ % buffer_.size();
+    if (offset + size > buffer_.size()) {
+        start += buffer_.size() - offset;
+    }
+    if (start + size - tail_ > buffer_.size()) {
+        grow(size);
+        start = head_;
+    }
+    head_ = start + size;
+
+    auto data = static_cast<std::byte *>(buffer_.raw_ptr()) + start % buffer_.size();
+    return {data, buffer_, start % buffer_.size(), requested};
+}
+
+void ArgumentRing::grow(size_t size) {
+    size_t capacity = buffer_.size() * 2;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+
+    // The allocations of the recording command buffer are in flight too, an idle buffer has no users
+    if (head_ == tail_) {
+        device_.release_buffer(buffer_);
+    } else {
+        retired_.emplace_back(buffer_, generation_ + 1);
+    }
+    buffer_ = allocate_ring(device_, capacity);
+    generation_++;
+    head_ = 0;
+    tail_ = 0;
+}
+
+ArgumentRing::Mark ArgumentRing::commit() {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    return {generation_, head_};
+}
+
+void ArgumentRing::release(Mark mark) {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    if (mark.generation == generation_) {
+        tail_ = mark.position;
+    }
+
+    // Every command buffer which could use a retired buffer was committed before the mark
+    auto it = retired_.begin();
+    for (; it != retired_.end() && it->second <= mark.generation; ++it) {
+        device_.release_buffer(it->first);
+    }
+    retired_.erase(retired_.begin(), it);
+}
+
+size_t ArgumentRing::in_flight() const {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    return head_ - tail_;
+}
+
+size_t ArgumentRing::capacity() const {
+    const std::lock_guard<std::mutex> lock(mtx_);
+    return buffer_.size();
+}
+
+}// namespace vox
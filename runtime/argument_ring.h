@@ -0,0 +1,81 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "allocator.h"
+
+namespace vox {
+/**
+ * @brief Mapped device buffer the argument bytes of the dispatches of a stream are carved out of.
+ *
+ * Allocations go around the buffer in order. The stream takes a mark when it commits a command buffer
+ * and releases it once the command buffer completed, which frees everything allocated before the mark.
+ * When the bytes still in flight don't leave room for an allocation, the ring moves to a larger buffer
+ * and the previous one is released with the last command buffer using it, so it never waits on the GPU.
+ */
+class ArgumentRing {
+public:
+    explicit ArgumentRing(Device &device, size_t capacity = default_capacity);
+
+    ~ArgumentRing();
+
+    ArgumentRing(const ArgumentRing &) = delete;
+    ArgumentRing &operator=(const ArgumentRing &) = delete;
+
+    struct Allocation {
+        std::byte *data;
+        // Buffer to bind at offset, owned by the ring
+        Buffer buffer;
+        size_t offset;
+        // Bytes asked for
+        size_t size;
+    };
+
+    // End of the allocations of a command buffer
+    struct Mark {
+        uint64_t generation;
+        size_t position;
+    };
+
+    // Valid until the mark taken after it is released
+    Allocation allocate(size_t requested);
+
+    // Called when the stream commits a command buffer
+    Mark commit();
+
+    // Called once the command buffer of mark completed, command buffers of a stream complete in order
+    void release(Mark mark);
+
+    // Bytes allocated and not released yet, alignment and the skipped end of the buffer included
+    [[nodiscard]] size_t in_flight() const;
+
+    // 0 until the first allocation
+    [[nodiscard]] size_t capacity() const;
+
+    // Constant buffer offsets of every Metal GPU family
+    static constexpr size_t alignment = 256;
+    static constexpr size_t default_capacity = 1 << 18;
+
+private:
+    void grow(size_t size);
+
+    Device &device_;
+    size_t initial_capacity_;
+    Buffer buffer_{nullptr};
+    // Incremented by every grow, marks of previous generations don't own bytes of buffer_
+    uint64_t generation_{0};
+    // Monotonic positions, position % capacity is the offset in buffer_
+    size_t head_{0};
+    size_t tail_{0};
+    // Previous buffers with the generation which replaced them
+    std::vector<std::pair<Buffer, uint64_t>> retired_;
+    mutable std::mutex mtx_;
+};
+
+}// namespace vox
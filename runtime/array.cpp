@@ -5,13 +5,15 @@
 //  property of any third parties.
 
 #include "array.h"
+#include "primitives/primitive.h"
+#include "transforms.h"
 
 namespace vox {
 
 namespace {
 
-std::pair<size_t, std::vector<size_t>> cum_prod(const std::vector<int> &shape) {
-    std::vector<size_t> strides(shape.size());
+std::pair<size_t, std::vector<int64_t>> cum_prod(const std::vector<int> &shape) {
+    std::vector<int64_t> strides(shape.size());
     size_t cum_prod = 1;
     for (int i = shape.size() - 1; i >= 0; --i) {
         strides[i] = cum_prod;
@@ -20,6 +22,18 @@ std::pair<size_t, std::vector<size_t>> cum_prod(const std::vector<int> &shape) {
     return {cum_prod, strides};
 }
 
+bool is_row_contiguous(const std::vector<int> &shape, const std::vector<int64_t> &strides) {
+    int64_t expected = 1;
+    for (int i = shape.size() - 1; i >= 0; --i) {
+        // the stride of a dimension of size 1 is never used
+        if (shape[i] != 1 && strides[i] != expected) {
+            return false;
+        }
+        expected *= shape[i];
+    }
+    return true;
+}
+
 }// namespace
 
 Array::Array(std::initializer_list<float> data)
@@ -29,9 +43,132 @@ Array::Array(std::initializer_list<float> data)
     init(data.begin());
 }
 
+Array::Array(const std::vector<int> &shape, Dtype dtype, Arena &arena)
+    : array_desc_(std::make_shared<ArrayDesc>(shape, dtype)) {
+    array_desc_->data = std::make_shared<Data>(nbytes(), arena);
+    array_desc_->data_ptr = array_desc_->data->buffer.raw_ptr();
+}
+
+Array::Array(void *data, const std::vector<int> &shape, Dtype dtype, Deleter deleter)
+    : array_desc_(std::make_shared<ArrayDesc>(shape, dtype)) {
+    auto buffer = nbytes() ? device().new_buffer_no_copy(data, nbytes()) : Buffer{nullptr};
+    if (buffer.ptr()) {
+        array_desc_->data = std::make_shared<Data>(buffer, std::move(deleter));
+        array_desc_->data_ptr = data;
+    } else {
+        init(static_cast<const std::byte *>(data));
+        if (deleter) {
+            deleter(data);
+        }
+    }
+}
+
+Array::Array(const std::vector<int> &shape,
+             Dtype dtype,
+             std::shared_ptr<Primitive> primitive,
+             std::vector<Array> inputs)
+    : array_desc_(std::make_shared<ArrayDesc>(shape, dtype)) {
+    array_desc_->primitive = std::move(primitive);
+    array_desc_->inputs = std::move(inputs);
+}
+
+void Array::set_primitive(std::shared_ptr<Primitive> primitive, std::vector<Array> inputs) {
+    array_desc_->primitive = std::move(primitive);
+    array_desc_->inputs = std::move(inputs);
+}
+
+std::vector<Array> Array::make_arrays(const std::vector<std::vector<int>> &shapes,
+                                     const std::vector<Dtype> &dtypes,
+                                     const std::shared_ptr<Primitive> &primitive,
+                                     const std::vector<Array> &inputs) {
+    auto siblings = std::make_shared<std::vector<Sibling>>();
+    std::vector<Array> outputs;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        outputs.emplace_back(shapes[i], dtypes[i], primitive, inputs);
+        outputs.back().array_desc_->siblings = siblings;
+        siblings->push_back(Sibling{outputs.back().array_desc_, shapes[i], dtypes[i]});
+    }
+    return outputs;
+}
+
+std::vector<Array> Array::outputs() const {
+    if (!array_desc_->siblings) {
+        return {*this};
+    }
+    std::vector<Array> outputs;
+    for (auto &sibling : *array_desc_->siblings) {
+        if (auto array_desc = sibling.array_desc.lock()) {
+            outputs.push_back(Array(std::move(array_desc)));
+        } else {
+            outputs.emplace_back(sibling.shape, sibling.dtype, nullptr, std::vector<Array>{});
+        }
+    }
+    return outputs;
+}
+
+void Array::detach() {
+    if (auto siblings = std::move(array_desc_->siblings)) {
+        for (auto &sibling : *siblings) {
+            if (auto array_desc = sibling.array_desc.lock()) {
+                array_desc->primitive = nullptr;
+                array_desc->inputs.clear();
+                array_desc->siblings = nullptr;
+            }
+        }
+    }
+    array_desc_->primitive = nullptr;
+    array_desc_->inputs.clear();
+}
+
+void Array::allocate() {
+    if (!array_desc_->data) {
+        array_desc_->data = std::make_shared<Data>(nbytes());
+        array_desc_->data_ptr = array_desc_->data->buffer.raw_ptr();
+    }
+}
+
+void Array::copy_shared_buffer(const Array &other) {
+    array_desc_->data = other.array_desc_->data;
+    array_desc_->data_ptr = other.array_desc_->data_ptr;
+    array_desc_->strides = other.array_desc_->strides;
+    array_desc_->contiguous = other.array_desc_->contiguous;
+}
+
+void Array::eval() {
+    vox::eval({*this});
+}
+
+Array Array::view(const std::vector<int> &shape,
+                  const std::vector<int64_t> &strides,
+                  int64_t offset) const {
+    if (shape.size() != strides.size()) {
+        throw std::invalid_argument("[Array::view] Shape and strides must have the same size.");
+    }
+    if (!array_desc_->data) {
+        if (!has_primitive()) {
+            throw std::invalid_argument("[Array::view] The array has no data and no primitive, allocate it first.");
+        }
+        // The data doesn't exist yet, the view is taken when it is evaluated. Its layout is known already.
+        Array out{shape, dtype(), std::make_shared<View>(primitive().stream(), shape, strides, offset), {*this}};
+        out.array_desc_->strides = strides;
+        out.array_desc_->contiguous = is_row_contiguous(shape, strides);
+        return out;
+    }
+    Array out = *this;
+    out.array_desc_ = std::make_shared<ArrayDesc>(shape, strides, dtype());
+    out.array_desc_->data = array_desc_->data;
+    out.array_desc_->data_ptr = static_cast<std::byte *>(array_desc_->data_ptr) + offset * int64_t(itemsize());
+    return out;
+}
+
 Array::ArrayDesc::ArrayDesc(const std::vector<int> &shape, Dtype dtype)
     : shape(shape), dtype(dtype) {
     std::tie(size, strides) = cum_prod(shape);
 }
 
+Array::ArrayDesc::ArrayDesc(const std::vector<int> &shape, const std::vector<int64_t> &strides, Dtype dtype)
+    : dtype(dtype), shape(shape), strides(strides), contiguous(is_row_contiguous(shape, strides)) {
+    size = cum_prod(shape).first;
+}
+
 }// namespace vox
@@ -6,10 +6,17 @@
 
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <functional>
+#include <vector>
 #include "dtypes.h"
 #include "allocator.h"
+#include "arena.h"
 
 namespace vox {
+class Primitive;
+
 class Array {
 public:
     /** Construct a scalar Array with zero dimensions. */
@@ -38,6 +45,24 @@ public:
           const std::vector<int> &shape,
           Dtype dtype = TypeToDtype<T>());
 
+    /** Uninitialized scratch Array, must die before the next arena.reset(). */
+    Array(const std::vector<int> &shape, Dtype dtype, Arena &arena);
+
+    using Deleter = std::function<void(void *)>;
+
+    /**
+   *  Use the caller owned data without copying it, deleter(data) runs once the
+   *  device is done with it. An empty deleter leaves data with the caller, which
+   *  must keep it alive as long as the Array. Metal needs data to be page aligned,
+   *  otherwise the data is copied and deleter runs immediately. */
+    Array(void *data, const std::vector<int> &shape, Dtype dtype, Deleter deleter);
+
+    /** Unevaluated Array computed by primitive from inputs, see eval(). */
+    Array(const std::vector<int> &shape,
+          Dtype dtype,
+          std::shared_ptr<Primitive> primitive,
+          std::vector<Array> inputs);
+
     /** Assignment to rvalue does not compile. */
     Array &operator=(const Array &other) && = delete;
     Array &operator=(Array &&other) && = delete;
@@ -88,11 +113,36 @@ public:
         return shape().at(dim < 0 ? dim + ndim() : dim);
     };
 
-    /** The strides of the Array. */
-    [[nodiscard]] const std::vector<size_t> &strides() const {
+    /** The strides of the Array in elements, negative for reversed views and 0 for broadcast dimensions. */
+    [[nodiscard]] const std::vector<int64_t> &strides() const {
         return array_desc_->strides;
     };
 
+    /** True if the elements are laid out in row major order without gaps. */
+    [[nodiscard]] bool is_contiguous() const {
+        return array_desc_->contiguous;
+    };
+
+    /** Byte offset of the first element inside the buffer shared with the other views. */
+    [[nodiscard]] size_t offset() const {
+        return static_cast<const std::byte *>(array_desc_->data_ptr) -
+               static_cast<const std::byte *>(buffer().raw_ptr());
+    };
+
+    /** Address of the first element, used to bind the Array in kernel arguments. */
+    [[nodiscard]] uint64_t address() const {
+        return buffer().address() + offset();
+    };
+
+    /**
+   *  An Array sharing the Data of this one, writes through either are visible to both.
+   *
+   *  offset is in elements from the first element of this Array and may not address
+   *  memory outside of the shared buffer, see slice, reshape, transpose and broadcast_to. */
+    [[nodiscard]] Array view(const std::vector<int> &shape,
+                             const std::vector<int64_t> &strides,
+                             int64_t offset = 0) const;
+
     /** Get the Arrays data type. */
     [[nodiscard]] Dtype dtype() const {
         return array_desc_->dtype;
@@ -103,14 +153,69 @@ public:
         return reinterpret_cast<std::uintptr_t>(array_desc_.get());
     }
 
+    /** True until eval() encoded the primitive computing the Array. */
+    [[nodiscard]] bool has_primitive() const {
+        return array_desc_->primitive != nullptr;
+    };
+
+    [[nodiscard]] Primitive &primitive() const {
+        return *array_desc_->primitive;
+    };
+
+    [[nodiscard]] const std::vector<Array> &inputs() const {
+        return array_desc_->inputs;
+    };
+
+    /** The Array is written by primitive from inputs on the next eval(), its Data is kept. */
+    void set_primitive(std::shared_ptr<Primitive> primitive, std::vector<Array> inputs);
+
+    /** Arrays computed together by one primitive, it writes them through out.outputs(). */
+    static std::vector<Array> make_arrays(const std::vector<std::vector<int>> &shapes,
+                                          const std::vector<Dtype> &dtypes,
+                                          const std::shared_ptr<Primitive> &primitive,
+                                          const std::vector<Array> &inputs);
+
+    /**
+     *  Every output of the primitive in order, {*this} unless made by make_arrays.
+     *  The outputs which were dropped are replaced by uninitialized Arrays. */
+    [[nodiscard]] std::vector<Array> outputs() const;
+
+    /** Drop the primitive and the inputs once encoded, the inputs can die with their last user. */
+    void detach();
+
+    /** Give the Array its own Data, does nothing if it already has one. */
+    void allocate();
+
+    /** Share the Data of other, used by primitives computing views. */
+    void copy_shared_buffer(const Array &other);
+
+    /** Encode the pending primitives this Array depends on, see eval(std::vector<Array>). */
+    void eval();
+
     struct Data {
         Buffer buffer;
+        Arena *arena{nullptr};
+        // Memory wrapped from the caller, released by the device and not recycled
+        bool no_copy{false};
+        Deleter deleter;
         explicit Data(size_t size) : buffer(malloc(size)){};
+        Data(size_t size, Arena &arena) : buffer(arena.allocate(size)), arena(&arena){};
+        Data(Buffer buffer, Deleter deleter) : buffer(buffer), no_copy(true), deleter(std::move(deleter)){};
         // Not copyable
         Data(const Data &d) = delete;
         Data &operator=(const Data &d) = delete;
         ~Data() {
-            free(buffer);
+            if (arena) {
+                arena->release(buffer);
+            } else if (no_copy) {
+                auto ptr = buffer.raw_ptr();
+                device().release_buffer(buffer);
+                if (deleter) {
+                    deleter(ptr);
+                }
+            } else {
+                free(buffer);
+            }
         }
     };
 
@@ -145,15 +250,27 @@ public:
     };
 
 private:
+    struct ArrayDesc;
+
+    explicit Array(std::shared_ptr<ArrayDesc> array_desc) : array_desc_(std::move(array_desc)) {}
+
     // Initialize the Arrays data
     template<typename It>
     void init(It src);
 
+    // An output of a primitive with several, weak so each one can die on its own
+    struct Sibling {
+        std::weak_ptr<ArrayDesc> array_desc;
+        std::vector<int> shape;
+        Dtype dtype;
+    };
+
     struct ArrayDesc {
         Dtype dtype;
         std::vector<int> shape;
-        std::vector<size_t> strides;
+        std::vector<int64_t> strides;
         size_t size{};
+        bool contiguous{true};
 
         // This is a shared pointer so that *different* Arrays
         // can share the underlying data buffer.
@@ -162,7 +279,14 @@ private:
         // Properly offset data pointer
         void *data_ptr{nullptr};
 
+        // Computes the data from the inputs, null once evaluated
+        std::shared_ptr<Primitive> primitive{nullptr};
+        std::vector<Array> inputs;
+        // All the outputs of the primitive if it has several, shared by them until detached
+        std::shared_ptr<std::vector<Sibling>> siblings;
+
         explicit ArrayDesc(const std::vector<int> &shape, Dtype dtype);
+        ArrayDesc(const std::vector<int> &shape, const std::vector<int64_t> &strides, Dtype dtype);
     };
 
     // The ArrayDesc contains the details of the materialized Array including the
@@ -0,0 +1,154 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "command_graph.h"
+#include "argument_ring.h"
+#include "device.h"
+#include "helpers.h"
+
+namespace vox {
+// Encoder of a stream during a capture, every dispatch adds a node with what was set since the previous one
+class CommandGraph::Recorder final : public CommandEncoder {
+public:
+    explicit Recorder(CommandGraph &graph) : _graph{graph} {}
+
+    void set_pipeline(Pipeline *pipeline) override {
+        _pipeline = pipeline;
+    }
+
+    // The bytes are copied, the argument ring recycles them once the stream committed
+    void set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) override {
+        if (index != 0) {
+            return;
+        }
+        auto &arguments = _graph._arguments;
+        _argument_offset = align(arguments.size(), ArgumentRing::alignment);
+        _argument_size = size;
+        arguments.resize(_argument_offset + align(std::max(size, size_t(1)), ArgumentRing::alignment));
+        std::memcpy(arguments.data() + _argument_offset, static_cast<const std::byte *>(buffer.raw_ptr()) + offset, size);
+    }
+
+    void use_resource(const Buffer &buffer, ResourceUsage usage) override {
+        _graph._resources.push_back({buffer, usage});
+    }
+
+    void dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) override {
+        auto &node = add_node(DispatchKind::ThreadGroups, threads_per_thread_group);
+        node.size = thread_groups;
+    }
+
+    void dispatch_threads(Size3 threads, Size3 threads_per_thread_group) override {
+        auto &node = add_node(DispatchKind::Threads, threads_per_thread_group);
+        node.size = threads;
+    }
+
+    void dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) override {
+        auto &node = add_node(DispatchKind::Indirect, threads_per_thread_group);
+        node.indirect = indirect;
+        node.indirect_offset = offset;
+    }
+
+private:
+    Node &add_node(DispatchKind kind, Size3 threads_per_thread_group) {
+        auto &node = _graph._nodes.emplace_back();
+        node.pipeline = _pipeline;
+        node.argument_offset = _argument_offset;
+        node.argument_size = _argument_size;
+        node.resource_begin = _resource_begin;
+        node.resource_end = _graph._resources.size();
+        node.kind = kind;
+        node.threads_per_thread_group = threads_per_thread_group;
+        _resource_begin = node.resource_end;
+        return node;
+    }
+
+    CommandGraph &_graph;
+    Pipeline *_pipeline{nullptr};
+    size_t _argument_offset{0};
+    size_t _argument_size{0};
+    size_t _resource_begin{0};
+};
+
+CommandGraph::CommandGraph()
+    : _retained{std::make_shared<std::vector<std::shared_ptr<void>>>()},
+      _recorder{std::make_unique<Recorder>(*this)} {}
+
+CommandGraph::~CommandGraph() {
+    if (_capturing) {
+        _capturing->end_capture();
+    }
+}
+
+void CommandGraph::replay(uint32_t stream) const {
+    device().stream(stream).replay(*this);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+CommandEncoder *Stream::encoder() {
+    return _capture ? _capture->_recorder.get() : get_command_encoder();
+}
+
+void Stream::retain(std::shared_ptr<void> resource) {
+    if (_capture) {
+        _capture->_retained->push_back(std::move(resource));
+    } else {
+        retain_resource(std::move(resource));
+    }
+}
+
+void Stream::begin_capture(CommandGraph &graph) {
+    if (_capture) {
+        throw std::runtime_error("[Stream::begin_capture] The stream is already capturing.");
+    }
+    _capture = &graph;
+    graph._capturing = this;
+    graph._resolved.reset();
+}
+
+void Stream::end_capture() {
+    if (_capture) {
+        _capture->_capturing = nullptr;
+    }
+    _capture = nullptr;
+}
+
+void Stream::replay(const CommandGraph &graph) {
+    if (graph.empty()) {
+        return;
+    }
+    const auto &bytes = graph.arguments();
+    auto arguments = argument_ring().allocate(bytes.size());
+    std::memcpy(arguments.data, bytes.data(), bytes.size());
+
+    auto encoder = this->encoder();
+    const auto &resources = graph.resources();
+    Pipeline *pipeline = nullptr;
+    for (const auto &node : graph.nodes()) {
+        if (node.pipeline != pipeline) {
+            pipeline = node.pipeline;
+            encoder->set_pipeline(pipeline);
+        }
+        for (size_t index = node.resource_begin; index < node.resource_end; index++) {
+            encoder->use_resource(resources[index].buffer, resources[index].usage);
+        }
+        encoder->set_buffer(arguments.buffer, arguments.offset + node.argument_offset, node.argument_size, 0u);
+        switch (node.kind) {
+            case CommandGraph::DispatchKind::ThreadGroups:
+                encoder->dispatch_thread_groups(node.size, node.threads_per_thread_group);
+                break;
+            case CommandGraph::DispatchKind::Threads:
+                encoder->dispatch_threads(node.size, node.threads_per_thread_group);
+                break;
+            case CommandGraph::DispatchKind::Indirect:
+                encoder->dispatch_indirect(node.indirect, node.indirect_offset, node.threads_per_thread_group);
+                break;
+        }
+    }
+    retain(graph.retained());
+}
+
+}// namespace vox
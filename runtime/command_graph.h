@@ -0,0 +1,142 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "allocator.h"
+#include "stream.h"
+
+namespace vox {
+/**
+ * @brief Kernel launches recorded once and replayed without encoding their arguments again.
+ *
+ * Between Stream::begin_capture and Stream::end_capture, the launches on the stream go to the graph:
+ * the pipeline, a copy of the argument bytes, the declared resources and the dispatch size of every
+ * launch. A replay copies the argument bytes of every node at once and records the dispatches after
+ * the work of the stream, set_uniform changes the bytes used by the next replays.
+ * Ex.
+ *   CommandGraph graph;
+ *   device().stream(0).begin_capture(graph);
+ *   kernel.launch(0, positions, velocities, dt);
+ *   device().stream(0).end_capture();
+ *   graph.set_uniform(0, offsetof(Arguments, dt), 0.01f);
+ *   graph.replay(0);
+ *
+ * The graph keeps the Arrays of the launches alive, the device addresses in the bytes stay valid.
+ * Replays of one graph from several threads at once are not safe.
+ */
+class CommandGraph {
+public:
+    enum class DispatchKind : uint8_t {
+        ThreadGroups,
+        Threads,
+        Indirect,
+    };
+
+    struct Resource {
+        Buffer buffer;
+        ResourceUsage usage;
+    };
+
+    struct Node {
+        Pipeline *pipeline{nullptr};
+        // Bytes of the node in arguments()
+        size_t argument_offset{0};
+        size_t argument_size{0};
+        // Range of the node in resources()
+        size_t resource_begin{0};
+        size_t resource_end{0};
+        DispatchKind kind{DispatchKind::ThreadGroups};
+        // Thread groups or threads per grid, depending on kind
+        Size3 size{1, 1, 1};
+        Size3 threads_per_thread_group{1, 1, 1};
+        Buffer indirect{nullptr};
+        size_t indirect_offset{0};
+    };
+
+    CommandGraph();
+
+    ~CommandGraph();
+
+    // The recorder encoding into the graph refers to it
+    CommandGraph(const CommandGraph &) = delete;
+    CommandGraph &operator=(const CommandGraph &) = delete;
+
+    [[nodiscard]] size_t size() const {
+        return _nodes.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return _nodes.empty();
+    }
+
+    [[nodiscard]] const std::vector<Node> &nodes() const {
+        return _nodes;
+    }
+
+    [[nodiscard]] const std::vector<Resource> &resources() const {
+        return _resources;
+    }
+
+    // Argument bytes of every node, each one starts ArgumentRing::alignment aligned
+    [[nodiscard]] const std::vector<std::byte> &arguments() const {
+        return _arguments;
+    }
+
+    // Everything the launches retained, a replay keeps it alive until its command buffer completed
+    [[nodiscard]] const std::shared_ptr<std::vector<std::shared_ptr<void>>> &retained() const {
+        return _retained;
+    }
+
+    // Overwrites the argument bytes of node at offset, the replays after it use value
+    template<typename T>
+    void set_uniform(size_t node, size_t offset, const T &value);
+
+    // Same as device().stream(stream).replay(*this)
+    void replay(uint32_t stream = 0) const;
+
+    /**
+     * @brief Backend commands derived from the nodes by the first replay, reused by the next ones.
+     *
+     * Dropped when a capture adds nodes to the graph.
+     */
+    template<typename Resolved, typename Resolve>
+    const Resolved &resolved(Resolve &&resolve) const {
+        if (!_resolved) {
+            _resolved = std::make_shared<Resolved>(resolve(*this));
+        }
+        return *static_cast<const Resolved *>(_resolved.get());
+    }
+
+private:
+    friend class Stream;
+    class Recorder;
+
+    std::vector<Node> _nodes;
+    std::vector<Resource> _resources;
+    std::vector<std::byte> _arguments;
+    std::shared_ptr<std::vector<std::shared_ptr<void>>> _retained;
+    std::unique_ptr<Recorder> _recorder;
+    mutable std::shared_ptr<void> _resolved;
+    // Stream capturing into the graph, its capture ends with the graph
+    Stream *_capturing{nullptr};
+};
+
+template<typename T>
+void CommandGraph::set_uniform(size_t node, size_t offset, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Uniforms are copied as bytes");
+    if (node >= _nodes.size() || offset + sizeof(T) > _nodes[node].argument_size) {
+        throw std::out_of_range("[CommandGraph::set_uniform] The uniform is outside the arguments of the node.");
+    }
+    std::memcpy(_arguments.data() + _nodes[node].argument_offset + offset, &value, sizeof(T));
+}
+
+}// namespace vox
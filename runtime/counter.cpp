@@ -5,8 +5,8 @@
 //  property of any third parties.
 
 #include "counter.h"
-#include "device.h"
-#include "stream.h"
+#include "metal/metal_device.h"
+#include "metal/metal_stream.h"
 #include "common/logging.h"
 
 namespace vox {
@@ -18,7 +18,7 @@ Counter::Counter(uint32_t sampleCount,
     sampleBufferDesc->setCounterSet(get_counter_set(counterSetName));
 
     NS::Error *error{nullptr};
-    buffer = device().handle()->newCounterSampleBuffer(sampleBufferDesc, &error);
+    buffer = metal_device().handle()->newCounterSampleBuffer(sampleBufferDesc, &error);
     if (error != nullptr) {
         ERROR("Error: could not create sample buffer: {}",
               error->description()->cString(NS::StringEncoding::UTF8StringEncoding));
@@ -26,7 +26,7 @@ Counter::Counter(uint32_t sampleCount,
 }
 
 MTL::CounterSet *Counter::get_counter_set(MTL::CommonCounterSet counterSetName) {
-    auto device = vox::device().handle();
+    auto device = vox::metal_device().handle();
     auto count = device->counterSets()->count();
     for (int i = 0; i < count; ++i) {
         auto counterSet = static_cast<MTL::CounterSet *>(device->counterSets()->object(i));
@@ -67,7 +67,7 @@ std::vector<MTL::CounterSamplingPoint> Counter::sampling_boundaries() {
 
     std::vector<MTL::CounterSamplingPoint> boundaries;
     for (auto boundary : allBoundaries) {
-        if (device().handle()->supportsCounterSampling(boundary)) {
+        if (metal_device().handle()->supportsCounterSampling(boundary)) {
             // Add the boundary to the return-value array.
             boundaries.push_back(boundary);
         }
@@ -85,7 +85,7 @@ void Counter::update_start_times() {
     MTL::Timestamp cpuStartTimestamp = 0;
     MTL::Timestamp gpuStartTimestamp = 0;
 
-    device().handle()->sampleTimestamps(&cpuStartTimestamp, &gpuStartTimestamp);
+    metal_device().handle()->sampleTimestamps(&cpuStartTimestamp, &gpuStartTimestamp);
     cpuStart = (double)cpuStartTimestamp;
     gpuStart = (double)gpuStartTimestamp;
 }
@@ -95,7 +95,7 @@ void Counter::update_final_times() {
     MTL::Timestamp cpuFinalTimestamp = 0;
     MTL::Timestamp gpuFinalTimestamp = 0;
 
-    device().handle()->sampleTimestamps(&cpuFinalTimestamp, &gpuFinalTimestamp);
+    metal_device().handle()->sampleTimestamps(&cpuFinalTimestamp, &gpuFinalTimestamp);
 
     cpuTimeSpan = (double)cpuFinalTimestamp - cpuStart;
     gpuTimeSpan = (double)gpuFinalTimestamp - gpuStart;
@@ -143,7 +143,7 @@ double Counter::micro_seconds_between(MTL::Timestamp begin, MTL::Timestamp end)
 }
 
 void Counter::sample_counters_in_buffer(std::uintptr_t index, uint32_t stream) const {
-    auto encoder = vox::stream(stream).get_command_encoder();
+    auto encoder = metal_stream(stream).get_command_encoder()->handle();
     encoder->sampleCountersInBuffer(get_handle(), index, false);
 }
 
@@ -6,7 +6,7 @@
 
 #pragma once
 
-#include "device.h"
+#include "metal/metal_device.h"
 
 namespace vox {
 class Counter {
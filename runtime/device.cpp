@@ -4,384 +4,137 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <atomic>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
+
 #include "device.h"
-#include "stream.h"
-#include "common/logging.h"
-#include "metal.h"
-#include <dlfcn.h>
-#include <filesystem>
+#include "host/host_device.h"
+#ifdef ARCHE_USE_METAL
+#include "metal/metal_device.h"
+#endif
 
 namespace vox {
-inline std::string get_colocated_mtllib_path(const std::string &lib_name) {
-    Dl_info info;
-    std::string mtllib_path;
-    std::string lib_ext = lib_name + ".metallib";
-
-    int success = dladdr((void *)get_colocated_mtllib_path, &info);
-    if (success) {
-        auto mtllib = std::filesystem::path(info.dli_fname).remove_filename() / lib_ext;
-        mtllib_path = mtllib.c_str();
-    }
-
-    return mtllib_path;
-}
-
-namespace {
-
-constexpr const char *default_mtllib_path = METAL_PATH;
-
-auto load_device() {
-    auto devices = MTL::CopyAllDevices();
-    auto device = static_cast<MTL::Device *>(devices->object(0));
-    if (!device) {
-        throw std::runtime_error("Failed to load device");
-    }
-    return device;
-}
-
-std::pair<MTL::Library *, NS::Error *> load_library_from_path(
-    MTL::Device *device,
-    const char *path) {
-    auto library = NS::String::string(path, NS::UTF8StringEncoding);
-    NS::Error *error;
-    auto lib = device->newLibrary(library, &error);
-
-    return std::make_pair(lib, error);
-}
-
-MTL::Library *load_library(
-    MTL::Device *device,
-    const std::string &lib_name = "metal_kernel",
-    const char *lib_path = default_mtllib_path) {
-    // Firstly, search for the metallib in the same path as this binary
-    std::string first_path = get_colocated_mtllib_path(lib_name);
-    if (!first_path.empty()) {
-        auto [lib, error] = load_library_from_path(device, first_path.c_str());
-        if (lib) {
-            return lib;
-        }
-    }
-
-    // Couldn't find it so let's load it from default_mtllib_path
-    {
-        auto [lib, error] = load_library_from_path(device, lib_path);
-        if (!lib) {
-            ERROR("{}", error->localizedDescription()->utf8String());
-        }
-        return lib;
-    }
-}
-
-}// namespace
-
-Device::Device()
-    : _device{load_device()} {
-    library_map_ = {{"metal_kernel", load_library(_device)}};
-}
-
-Device::~Device() {
-    _device->release();
-}
-
-MTL::Device *Device::handle() {
-    return _device;
-}
-
-std::string Device::name() {
-    return _device->name()->utf8String();
-}
-
 Stream &Device::stream(uint32_t index) {
+    // Multiple threads can ask the device for streams
+    const std::lock_guard<std::mutex> lock(stream_mtx_);
     if (auto it = stream_map_.find(index); it != stream_map_.end()) {
         return *it->second;
     } else {
-        auto new_stream = new Stream(index);
-        stream_map_.insert({index, new_stream});
-        return *new_stream;
-    }
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-void Device::register_library(const std::string &lib_name,
-                              const std::string &lib_path) {
-    if (auto it = library_map_.find(lib_name); it == library_map_.end()) {
-        auto new_lib = load_library(_device, lib_name, lib_path.c_str());
-        library_map_.insert({lib_name, new_lib});
-    }
-}
-
-void Device::register_library(const std::string &lib_name,
-                              const std::function<std::string(const std::string &)> &lib_path_func) {
-    if (auto it = library_map_.find(lib_name); it == library_map_.end()) {
-        std::string new_lib_path = lib_path_func(lib_name);
-        auto new_lib = load_library(_device, lib_name, new_lib_path.c_str());
-        library_map_.insert({lib_name, new_lib});
-    }
-}
-
-MTL::Library *Device::get_library_cache_(const std::string &lib_name) {
-    // Search for cached metal lib
-    MTL::Library *mtl_lib;
-    if (auto it = library_map_.find(lib_name); it != library_map_.end()) {
-        mtl_lib = it->second;
-    } else {// Look for metallib alongside library
-        register_library(lib_name, get_colocated_mtllib_path);
-        mtl_lib = library_map_[lib_name];
-    }
-
-    return mtl_lib;
-}
-
-MTL::Function *Device::get_function_(const std::string &name,
-                                     MTL::Library *mtl_lib) {
-    // Pull kernel from library
-    auto ns_name = NS::String::string(name.c_str(), NS::ASCIIStringEncoding);
-    auto mtl_function = mtl_lib->newFunction(ns_name);
-
-    return mtl_function;
-}
-
-MTL::Function *Device::get_function_(const std::string &name,
-                                     const std::string &specialized_name,
-                                     const MTLFCList &func_consts,
-                                     MTL::Library *mtl_lib) {
-    if (func_consts.empty() && (specialized_name == name)) {
-        return get_function_(name, mtl_lib);
-    }
-
-    // Prepare function constants
-    auto mtl_func_consts = MTL::FunctionConstantValues::alloc()->init();
-
-    for (auto [value, type, index] : func_consts) {
-        mtl_func_consts->setConstantValue(value, type, index);
-    }
-
-    // Prepare function desc
-    auto desc = MTL::FunctionDescriptor::functionDescriptor();
-    desc->setName(NS::String::string(name.c_str(), NS::ASCIIStringEncoding));
-    desc->setSpecializedName(
-        NS::String::string(specialized_name.c_str(), NS::ASCIIStringEncoding));
-    desc->setConstantValues(mtl_func_consts);
-
-    // Pull kernel from library
-    NS::Error *error = nullptr;
-    auto mtl_function = mtl_lib->newFunction(desc, &error);
-
-    // Throw error if unable to build metal function
-    if (!mtl_function) {
-        ERROR("[metal::Device] Unable to load function {}", name);
-        ERROR("{}", error->localizedDescription()->utf8String());
-    }
-
-    mtl_func_consts->release();
-    desc->release();
-
-    return mtl_function;
-}
-
-MTL::Function *Device::get_function(const std::string &base_name,
-                                    MTL::Library *mtl_lib,
-                                    const std::string &specialized_name /* = "" */,
-                                    const MTLFCList &func_consts /* = {} */) {
-    return get_function_(base_name, specialized_name, func_consts, mtl_lib);
-}
-
-MTL::Function *Device::get_function(const std::string &base_name,
-                                    const std::string &lib_name /* = "mlx" */,
-                                    const std::string &specialized_name /*  = "" */,
-                                    const MTLFCList &func_consts /* = {} */) {
-    // Search for cached metal lib
-    MTL::Library *mtl_lib = get_library_cache_(lib_name);
-
-    return get_function(base_name, mtl_lib, specialized_name, func_consts);
-}
-
-MTL::LinkedFunctions *Device::get_linked_functions_(const std::vector<MTL::Function *> &funcs) {
-    if (funcs.empty()) {
-        return nullptr;
-    }
-
-    auto lfuncs = MTL::LinkedFunctions::linkedFunctions();
-
-    std::vector<NS::Object *> objs(funcs.size());
-    for (int i = 0; i < funcs.size(); i++) {
-        objs[i] = funcs[i];
-    }
-
-    NS::Array *funcs_arr = NS::Array::array(objs.data(), funcs.size());
-
-    lfuncs->setPrivateFunctions(funcs_arr);
-
-    return lfuncs;
-}
-
-MTL::ComputePipelineState *Device::get_kernel_(const std::string &name,
-                                               const MTL::Function *mtl_function) {
-    // Compile kernel to compute pipeline
-    NS::Error *error = nullptr;
-    MTL::ComputePipelineState *kernel;
-
-    if (mtl_function) {
-        kernel = _device->newComputePipelineState(mtl_function, &error);
-    }
-
-    // Throw error if unable to compile metal function
-    if (!mtl_function || !kernel) {
-        ERROR("[metal::Device] Unable to load kernel {}", name);
-        ERROR("{}", error->localizedDescription()->utf8String());
+        auto result = new_stream(index);
+        auto &s = *result;
+        stream_map_.insert({index, std::move(result)});
+        return s;
     }
-
-    return kernel;
 }
 
-MTL::ComputePipelineState *Device::get_kernel_(const std::string &name,
-                                               const MTL::Function *mtl_function,
-                                               const MTL::LinkedFunctions *linked_functions) {
-    // Check inputs
-    if (!linked_functions) {
-        return get_kernel_(name, mtl_function);
-    }
-
-    if (!mtl_function) {
-        ERROR("[metal::Device] Unable to load kernel {}", name);
+void Device::synchronize(bool wait) {
+    const std::lock_guard<std::mutex> lock(stream_mtx_);
+    for (auto &[index, s] : stream_map_) {
+        s->synchronize(wait);
     }
-
-    // Prepare compute pipeline state descriptor
-    auto desc = MTL::ComputePipelineDescriptor::alloc()->init();
-    desc->setComputeFunction(mtl_function);
-    desc->setLinkedFunctions(linked_functions);
-
-    // Compile kernel to compute pipeline
-    NS::Error *error = nullptr;
-    auto kernel = _device->newComputePipelineState(
-        desc, MTL::PipelineOptionNone, nullptr, &error);
-
-    // Throw error if unable to compile metal function
-    if (!kernel) {
-        ERROR("[metal::Device] Unable to load kernel {}", name);
-        ERROR("{}", error->localizedDescription()->utf8String());
-    }
-
-    return kernel;
 }
 
-MTL::ComputePipelineState *Device::get_kernel(const std::string &base_name,
-                                              MTL::Library *mtl_lib,
-                                              const std::string &hash_name /* = "" */,
-                                              const MTLFCList &func_consts /* = {} */,
-                                              const std::vector<MTL::Function *> &linked_functions /* = {} */) {
-    auto pool = new_scoped_memory_pool();
-
+Pipeline *Device::get_kernel(const std::string &base_name,
+                             const std::string &lib_name,
+                             const std::string &hash_name,
+                             const FunctionConstantList &func_consts,
+                             const std::vector<std::string> &linked_functions) {
     // Look for cached kernel
     const auto &kname = hash_name.empty() ? base_name : hash_name;
+    const std::lock_guard<std::mutex> lock(kernel_mtx_);
     if (auto it = kernel_map_.find(kname); it != kernel_map_.end()) {
-        return it->second;
+        return it->second.get();
     }
 
-    // Pull kernel from library
-    auto mtl_function = get_function_(base_name, kname, func_consts, mtl_lib);
-
-    // Compile kernel to compute pipeline
-    auto mtl_linked_funcs = get_linked_functions_(linked_functions);
-    auto kernel = get_kernel_(kname, mtl_function, mtl_linked_funcs);
-    mtl_function->release();
-    mtl_linked_funcs->release();
-
-    // Add kernel to cache
-    kernel_map_.insert({kname, kernel});
-    return kernel;
+    auto kernel = new_kernel(base_name, lib_name, kname, func_consts, linked_functions);
+    auto [it, _] = kernel_map_.insert({kname, std::move(kernel)});
+    return it->second.get();
 }
 
-MTL::ComputePipelineState *Device::get_kernel(const std::string &base_name,
-                                              const std::string &lib_name /* = "mlx" */,
-                                              const std::string &hash_name /*  = "" */,
-                                              const MTLFCList &func_consts /*  = {} */,
-                                              const std::vector<MTL::Function *> &linked_functions /*  = {} */) {
-    // Look for cached kernel
-    const auto &kname = hash_name.empty() ? base_name : hash_name;
-    if (auto it = kernel_map_.find(kname); it != kernel_map_.end()) {
-        return it->second;
+//----------------------------------------------------------------------------------------------------------------------
+namespace {
+struct DefaultDevice {
+    std::optional<DeviceType> type;
+    // resolved once, read without locking on every dispatch
+    std::atomic<Device *> device{nullptr};
+    std::mutex mtx;
+};
+
+DefaultDevice &default_device() {
+    static DefaultDevice default_device;
+    return default_device;
+}
+
+DeviceType default_device_type() {
+    if (auto env = std::getenv("ARCHE_DEVICE")) {
+        std::string name{env};
+        if (name == "host") {
+            return DeviceType::Host;
+        } else if (name == "metal") {
+            return DeviceType::Metal;
+        }
+        throw std::invalid_argument("[device] ARCHE_DEVICE must be metal or host, got " + name);
     }
-
-    // Search for cached metal lib
-    MTL::Library *mtl_lib = get_library_cache_(lib_name);
-
-    return get_kernel(base_name, mtl_lib, kname, func_consts, linked_functions);
+    return is_available(DeviceType::Metal) ? DeviceType::Metal : DeviceType::Host;
 }
+}// namespace
 
-MTL::Library *Device::get_library_(const std::string &source_string) {
-    auto pool = new_scoped_memory_pool();
-
-    auto ns_code =
-        NS::String::string(source_string.c_str(), NS::ASCIIStringEncoding);
-
-    NS::Error *error = nullptr;
-    auto mtl_lib = _device->newLibrary(ns_code, nullptr, &error);
-
-    // Throw error if unable to compile library
-    if (!mtl_lib) {
-        ERROR("[metal::Device] Unable to build metal library from source");
-        ERROR("{}", error->localizedDescription()->utf8String());
+bool is_available(DeviceType type) {
+    switch (type) {
+        case DeviceType::Metal:
+#ifdef ARCHE_USE_METAL
+            return true;
+#else
+            return false;
+#endif
+        case DeviceType::Host:
+            return true;
     }
-
-    return mtl_lib;
+    return false;
 }
 
-MTL::Library *Device::get_library_(const MTL::StitchedLibraryDescriptor *desc) {
-    auto pool = new_scoped_memory_pool();
-
-    NS::Error *error = nullptr;
-    auto mtl_lib = _device->newLibrary(desc, &error);
-
-    // Throw error if unable to compile library
-    if (!mtl_lib) {
-        ERROR("[metal::Device] Unable to load build stitched metal library");
-        ERROR("{}", error->localizedDescription()->utf8String());
+Device &device(DeviceType type) {
+    switch (type) {
+        case DeviceType::Metal:
+#ifdef ARCHE_USE_METAL
+            return metal_device();
+#else
+            throw std::invalid_argument("[device] Metal backend is not available in this build");
+#endif
+        case DeviceType::Host:
+            return host_device();
     }
-
-    return mtl_lib;
+    throw std::invalid_argument("[device] Unknown device type");
 }
 
-MTL::Library *Device::get_library(const std::string &name,
-                                  const std::string &source,
-                                  bool cache /* = true */) {
-    if (cache) {
-        if (auto it = library_map_.find(name); it != library_map_.end()) {
-            return it->second;
-        }
+void set_default_device(DeviceType type) {
+    if (!is_available(type)) {
+        throw std::invalid_argument("[set_default_device] Device type is not available in this build");
     }
-
-    auto mtl_lib = get_library_(source);
-
-    if (cache) {
-        library_map_.insert({name, mtl_lib});
+    auto &d = default_device();
+    const std::lock_guard<std::mutex> lock(d.mtx);
+    if (d.device && d.type != type) {
+        throw std::runtime_error("[set_default_device] The default device is already in use");
     }
-
-    return mtl_lib;
+    d.type = type;
 }
 
-MTL::Library *Device::get_library(const std::string &name,
-                                  const MTL::StitchedLibraryDescriptor *desc,
-                                  bool cache /* = true */) {
-    if (cache) {
-        if (auto it = library_map_.find(name); it != library_map_.end()) {
-            return it->second;
-        }
+Device &device() {
+    auto &d = default_device();
+    if (auto result = d.device.load(std::memory_order_acquire)) {
+        return *result;
     }
 
-    auto mtl_lib = get_library_(desc);
-
-    if (cache) {
-        library_map_.insert({name, mtl_lib});
+    const std::lock_guard<std::mutex> lock(d.mtx);
+    if (!d.device.load(std::memory_order_relaxed)) {
+        if (!d.type) {
+            d.type = default_device_type();
+        }
+        d.device.store(&device(*d.type), std::memory_order_release);
     }
-
-    return mtl_lib;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-Device &device() {
-    static Device metal_device;
-    return metal_device;
+    return *d.device.load(std::memory_order_relaxed);
 }
 
 Stream &stream(uint32_t index) {
@@ -392,4 +145,4 @@ void synchronize(bool wait, uint32_t index) {
     stream(index).synchronize(wait);
 }
 
-}// namespace vox
\ No newline at end of file
+}// namespace vox
@@ -6,110 +6,113 @@
 
 #pragma once
 
-#include <Metal/Metal.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "stream.h"
 
 namespace vox {
-class Stream;
+class Buffer;
 class Kernel;
 
-using MTLFCList = std::vector<std::tuple<const void *, MTL::DataType, NS::UInteger>>;
+// (value, data type, index), the data type is backend defined (MTL::DataType on Metal)
+using FunctionConstantList = std::vector<std::tuple<const void *, uint64_t, uint64_t>>;
 
-class Device {
+// A compiled kernel entry which can be bound to a CommandEncoder.
+class Pipeline {
 public:
-    Device();
+    virtual ~Pipeline() = default;
 
-    ~Device();
+    [[nodiscard]] virtual size_t max_total_threads_per_threadgroup() const = 0;
+};
 
-    MTL::Device *handle();
+enum class DeviceType {
+    Metal,
+    Host,
+};
 
-    std::string name();
+class Device {
+public:
+    Device() = default;
 
-    Stream &stream(uint32_t index);
+    virtual ~Device() = default;
 
-private:
-    friend class Kernel;
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
 
-private:
-    void register_library(
-        const std::string &lib_name,
-        const std::string &lib_path);
+    virtual std::string name() = 0;
 
-    void register_library(
-        const std::string &lib_name,
-        const std::function<std::string(const std::string &)> &lib_path_func);
+    Stream &stream(uint32_t index);
 
-    MTL::Library *get_library_cache_(const std::string &name);
+    // Commit the recorded work of every stream, the streams must not be recording on other threads
+    void synchronize(bool wait = false);
 
-private:
-    static MTL::Function *get_function_(const std::string &name, MTL::Library *mtl_lib);
+public:
+    // Raw device memory, Allocator is responsible for pooling it.
+    virtual Buffer new_buffer(size_t size) = 0;
 
-    static MTL::Function *get_function_(
-        const std::string &name,
-        const std::string &specialized_name,
-        const MTLFCList &func_consts,
-        MTL::Library *mtl_lib);
+    // Wrap caller owned memory without copying it, null Buffer if the backend can't use the pointer.
+    // release_buffer only drops the wrapper, the memory stays with the caller.
+    virtual Buffer new_buffer_no_copy(void *ptr, size_t size) = 0;
 
-    static MTL::Function *get_function(
-        const std::string &base_name,
-        MTL::Library *mtl_lib,
-        const std::string &specialized_name = "",
-        const MTLFCList &func_consts = {});
+    virtual void release_buffer(Buffer buffer) = 0;
 
-    MTL::Function *get_function(
-        const std::string &base_name,
-        const std::string &lib_name = "metal_kernel",
-        const std::string &specialized_name = "",
-        const MTLFCList &func_consts = {});
+    [[nodiscard]] virtual size_t current_allocated_size() const = 0;
 
-private:
-    static MTL::LinkedFunctions *get_linked_functions_(
-        const std::vector<MTL::Function *> &funcs);
+    [[nodiscard]] virtual size_t recommended_max_working_set_size() const = 0;
 
-    MTL::ComputePipelineState *get_kernel_(
-        const std::string &name,
-        const MTL::Function *mtl_function);
+    // Kernels can combine the results of threadgroups with device atomics, otherwise primitives take
+    // their atomics-free path
+    [[nodiscard]] virtual bool supports_atomics() const = 0;
 
-    MTL::ComputePipelineState *get_kernel_(
-        const std::string &name,
-        const MTL::Function *mtl_function,
-        const MTL::LinkedFunctions *linked_functions);
+public:
+    // Make the kernels in source available under lib_name
+    virtual void register_source(const std::string &lib_name, const std::string &source) = 0;
 
-    MTL::ComputePipelineState *get_kernel(
+    // Pipelines are cached by hash_name (base_name if empty) and live as long as the device
+    Pipeline *get_kernel(
         const std::string &base_name,
-        MTL::Library *mtl_lib,
+        const std::string &lib_name = "metal_kernel",
         const std::string &hash_name = "",
-        const MTLFCList &func_consts = {},
-        const std::vector<MTL::Function *> &linked_functions = {});
+        const FunctionConstantList &func_consts = {},
+        const std::vector<std::string> &linked_functions = {});
+
+protected:
+    virtual std::unique_ptr<Stream> new_stream(uint32_t index) = 0;
 
-    MTL::ComputePipelineState *get_kernel(
+    // Build the pipeline on a cache miss, kname is the resolved cache key
+    virtual std::unique_ptr<Pipeline> new_kernel(
         const std::string &base_name,
-        const std::string &lib_name = "metal_kernel",
-        const std::string &hash_name = "",
-        const MTLFCList &func_consts = {},
-        const std::vector<MTL::Function *> &linked_functions = {});
+        const std::string &lib_name,
+        const std::string &kname,
+        const FunctionConstantList &func_consts,
+        const std::vector<std::string> &linked_functions) = 0;
 
-private:
-    MTL::Library *get_library_(const std::string &source_string);
+protected:
+    // Backends must clear the streams and kernels before releasing the resources they depend on
+    std::unordered_map<uint32_t, std::unique_ptr<Stream>> stream_map_;
+    std::mutex stream_mtx_;
 
-    MTL::Library *get_library_(const MTL::StitchedLibraryDescriptor *desc);
+    std::unordered_map<std::string, std::unique_ptr<Pipeline>> kernel_map_;
+    std::mutex kernel_mtx_;
+};
 
-    MTL::Library *get_library(
-        const std::string &name,
-        const std::string &source_string,
-        bool cache = true);
+/// false if the backend was not built (Metal off Apple platforms)
+bool is_available(DeviceType type);
 
-    MTL::Library *get_library(
-        const std::string &name,
-        const MTL::StitchedLibraryDescriptor *desc,
-        bool cache = true);
+Device &device(DeviceType type);
 
-private:
-    MTL::Device *_device{nullptr};
-    std::unordered_map<std::string, MTL::ComputePipelineState *> kernel_map_;
-    std::unordered_map<std::string, MTL::Library *> library_map_;
-    std::unordered_map<uint32_t, Stream *> stream_map_;
-};
+/**
+ * @brief Select the backend used by device(), stream() and every Kernel.
+ *
+ * Without a call the ARCHE_DEVICE environment variable ("metal" or "host") is used,
+ * otherwise Metal when available. The choice is fixed by the first call to device(),
+ * since Arrays keep buffers of the device they were allocated on.
+ */
+void set_default_device(DeviceType type);
 
 Device &device();
 
@@ -117,4 +120,4 @@ Stream &stream(uint32_t index);
 
 void synchronize(bool wait = false, uint32_t index = 0);
 
-}// namespace vox
\ No newline at end of file
+}// namespace vox
@@ -5,8 +5,8 @@
 //  property of any third parties.
 
 #include "debug_capture_ext.h"
-#include "stream.h"
-#include "device.h"
+#include "metal/metal_stream.h"
+#include "metal/metal_device.h"
 #include <fmt/format.h>
 
 namespace vox {
@@ -54,11 +54,11 @@ template<typename Object>
 
 DebugCaptureScope DebugCaptureExt::create_scope(
     std::string_view label, const DebugCaptureOption &option) {
-    return detail::create_capture_scope(label, option, device().handle());
+    return detail::create_capture_scope(label, option, metal_device().handle());
 }
 
 DebugCaptureScope DebugCaptureExt::create_scope(uint32_t stream, std::string_view label, const DebugCaptureOption &option) {
-    return detail::create_capture_scope(label, option, vox::stream(stream).queue());
+    return detail::create_capture_scope(label, option, metal_stream(stream).queue());
 }
 
 DebugCaptureScope::DebugCaptureScope(MTL::CaptureDescriptor *descriptor,
@@ -0,0 +1,124 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "hash_grid.h"
+#include "kernel.h"
+#include "ops.h"
+#include "transforms.h"
+#include "primitives/sort.h"
+#include "primitives/primitive_utils.h"
+
+namespace vox {
+namespace {
+int checked_num_cells(int dim_x, int dim_y, int dim_z) {
+    if (dim_x <= 0 || dim_y <= 0 || dim_z <= 0) {
+        throw std::invalid_argument("[HashGrid] The dimensions must be positive.");
+    }
+    return dim_x * dim_y * dim_z;
+}
+
+void dispatch(const std::string &entry, size_t threads, const std::vector<Argument> &args, uint32_t stream) {
+    auto kernel = Kernel::builder().entry(entry).build();
+    kernel.set_threads(threads);
+    kernel.set_threads_per_thread_group(std::min(threads, size_t(kernel.max_total_threads_per_threadgroup())));
+    kernel(args, stream);
+}
+}// namespace
+
+HashGrid::HashGrid(int dim_x, int dim_y, int dim_z, uint32_t stream)
+    : _dim_x{dim_x}, _dim_y{dim_y}, _dim_z{dim_z}, _stream{stream},
+      _descriptor(scratch(sizeof(HashGridDescriptor), uint8)),
+      _point_cells(scratch(0, uint32)),
+      _point_ids(scratch(0, uint32)),
+      _unsorted_cells(scratch(0, uint32)),
+      _unsorted_ids(scratch(0, uint32)),
+      _cell_starts(scratch(checked_num_cells(dim_x, dim_y, dim_z), int32)),
+      _cell_ends(scratch(checked_num_cells(dim_x, dim_y, dim_z), int32)) {
+    // Queries before the first build visit empty cells and find no points
+    std::memset(_cell_starts.data<int32_t>(), 0, _cell_starts.nbytes());
+    std::memset(_cell_ends.data<int32_t>(), 0, _cell_ends.nbytes());
+    HashGridDescriptor descriptor{};
+    descriptor.cell_starts = _cell_starts.address();
+    descriptor.cell_ends = _cell_ends.address();
+    descriptor.dim_x = dim_x;
+    descriptor.dim_y = dim_y;
+    descriptor.dim_z = dim_z;
+    std::memcpy(_descriptor.data<uint8_t>(), &descriptor, sizeof(descriptor));
+}
+
+void HashGrid::reserve(int max_points) {
+    if (max_points <= _max_points) {
+        return;
+    }
+    // The kernels using the old Arrays keep them alive until they complete
+    _point_cells = scratch(max_points, uint32);
+    _point_ids = scratch(max_points, uint32);
+    _unsorted_cells = scratch(max_points, uint32);
+    _unsorted_ids = scratch(max_points, uint32);
+    _max_points = max_points;
+}
+
+void HashGrid::build(const Array &points, float cell_width) {
+    if (points.dtype() != float3 || !points.is_contiguous()) {
+        throw std::invalid_argument("[HashGrid::build] The points must be a contiguous float3 Array.");
+    }
+    if (cell_width <= 0.f) {
+        throw std::invalid_argument("[HashGrid::build] The cell width must be positive.");
+    }
+    const int num_points = int(points.size());
+    reserve(num_points);
+    _num_points = num_points;
+    _cell_width = cell_width;
+
+    HashGridDescriptor descriptor{};
+    descriptor.cell_width = cell_width;
+    descriptor.cell_width_inv = 1.f / cell_width;
+    descriptor.point_cells = _point_cells.address();
+    descriptor.point_ids = _point_ids.address();
+    descriptor.cell_starts = _cell_starts.address();
+    descriptor.cell_ends = _cell_ends.address();
+    descriptor.dim_x = _dim_x;
+    descriptor.dim_y = _dim_y;
+    descriptor.dim_z = _dim_z;
+    descriptor.num_points = num_points;
+    descriptor.max_points = _max_points;
+
+    // The cell of every point, the first thread also publishes the descriptor
+    dispatch("hash_grid_point_cells", std::max(num_points, 1),
+             {points, _unsorted_cells, _unsorted_ids, _descriptor, uniform(descriptor)}, _stream);
+    dispatch("hash_grid_clear_cells", num_cells(), {uniform(uint64_t(0)), _cell_starts, _cell_ends, uniform(uint64_t(num_cells()))},
+             _stream);
+    if (num_points == 0) {
+        return;
+    }
+
+    // Sort into the reserved Arrays, only the bits of the largest cell index take part
+    int key_bits = 1;
+    while (key_bits < 32 && (uint64_t(num_cells()) - 1) >> key_bits) {
+        key_bits++;
+    }
+    auto sorted = Array::make_arrays({{num_points}, {num_points}}, {uint32, uint32},
+                                     std::make_shared<RadixSort>(_stream, key_bits),
+                                     std::vector<Array>{slice(_unsorted_cells, {0}, {num_points}),
+                                                        slice(_unsorted_ids, {0}, {num_points})});
+    sorted[0].copy_shared_buffer(_point_cells);
+    sorted[1].copy_shared_buffer(_point_ids);
+    eval(sorted);
+
+    dispatch("hash_grid_cell_ranges", num_points,
+             {_point_cells, _cell_starts, _cell_ends, uniform(uint64_t(num_points))}, _stream);
+}
+
+Array HashGrid::point_cells() const {
+    return slice(_point_cells, {0}, {_num_points});
+}
+
+Array HashGrid::point_ids() const {
+    return slice(_point_ids, {0}, {_num_points});
+}
+
+}// namespace vox
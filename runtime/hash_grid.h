@@ -0,0 +1,102 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "array.h"
+
+namespace vox {
+// same layout as HashGrid in shader/hash_grid.h, the pointers are device addresses
+struct alignas(8) HashGridDescriptor {
+    float cell_width;
+    float cell_width_inv;
+    uint64_t point_cells;
+    uint64_t point_ids;
+    uint64_t cell_starts;
+    uint64_t cell_ends;
+    int32_t dim_x;
+    int32_t dim_y;
+    int32_t dim_z;
+    int32_t num_points;
+    int32_t max_points;
+};
+
+/**
+ * @brief Points bucketed by the cells of a uniform grid, the cells are hashed into dim_x * dim_y * dim_z.
+ *
+ * build() encodes the cell of every point, a key/value radix sort of the points by cell and the
+ * detection of the cell ranges. Kernels take id() and visit the points around a position with
+ * hash_grid_query and hash_grid_query_next from shader/hash_grid.h.
+ */
+class HashGrid {
+public:
+    HashGrid(int dim_x, int dim_y, int dim_z, uint32_t stream = 0);
+
+    /// Grow the point Arrays to hold max_points, the builds which fit don't allocate them again
+    void reserve(int max_points);
+
+    /// Bucket the float3 points in cells of cell_width, reserves if they don't fit
+    void build(const Array &points, float cell_width);
+
+    /// Device address of the descriptor, stable for the lifetime of the HashGrid
+    [[nodiscard]] uint64_t id() const {
+        return _descriptor.address();
+    }
+
+    [[nodiscard]] int num_points() const {
+        return _num_points;
+    }
+
+    [[nodiscard]] int max_points() const {
+        return _max_points;
+    }
+
+    [[nodiscard]] float cell_width() const {
+        return _cell_width;
+    }
+
+    [[nodiscard]] int num_cells() const {
+        return _dim_x * _dim_y * _dim_z;
+    }
+
+    /// Points sorted by cell, uint32 views of num_points elements
+    [[nodiscard]] Array point_cells() const;
+    [[nodiscard]] Array point_ids() const;
+
+    /// Range of the sorted points in each cell, int32 of num_cells() elements. Empty cells are [0, 0)
+    [[nodiscard]] const Array &cell_starts() const {
+        return _cell_starts;
+    }
+    [[nodiscard]] const Array &cell_ends() const {
+        return _cell_ends;
+    }
+
+    /// Arrays the kernels read through id(), see Kernel::set_referenced_arrays
+    [[nodiscard]] std::vector<Array> referenced_arrays() const {
+        return {_descriptor, _point_cells, _point_ids, _cell_starts, _cell_ends};
+    }
+
+private:
+    int _dim_x;
+    int _dim_y;
+    int _dim_z;
+    uint32_t _stream;
+    int _num_points{0};
+    int _max_points{0};
+    float _cell_width{0.f};
+
+    // Written by the first kernel of every build, ordered with the kernels using the previous one
+    Array _descriptor;
+    Array _point_cells;
+    Array _point_ids;
+    // Input of the sort
+    Array _unsorted_cells;
+    Array _unsorted_ids;
+    Array _cell_starts;
+    Array _cell_ends;
+};
+
+}// namespace vox
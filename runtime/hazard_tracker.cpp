@@ -0,0 +1,62 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+
+#include "hazard_tracker.h"
+#include "allocator.h"
+
+namespace vox {
+namespace {
+bool has(ResourceUsage usage, ResourceUsage flag) {
+    return static_cast<uint8_t>(usage) & static_cast<uint8_t>(flag);
+}
+
+template<typename Range>
+bool overlaps(const std::vector<Range> &ranges, const Range &range) {
+    return std::any_of(ranges.begin(), ranges.end(), [&](const Range &other) {
+        return range.begin < other.end && other.begin < range.end;
+    });
+}
+}// namespace
+
+void HazardTracker::use(const Buffer &buffer, ResourceUsage usage) {
+    const uint64_t begin = buffer.address();
+    current_.push_back({begin, begin + std::max(buffer.size(), size_t(1)), usage});
+}
+
+bool HazardTracker::end_dispatch() {
+    bool barrier = opaque_ || current_.empty() || reads_.size() + writes_.size() + current_.size() > max_ranges;
+    for (auto it = current_.begin(); it != current_.end() && !barrier; ++it) {
+        barrier = overlaps(writes_, *it) || (has(it->usage, ResourceUsage::Write) && overlaps(reads_, *it));
+    }
+    opaque_ = current_.empty();
+
+    if (barrier) {
+        reads_.clear();
+        writes_.clear();
+    }
+    for (auto &range : current_) {
+        (has(range.usage, ResourceUsage::Write) ? writes_ : reads_).push_back(range);
+    }
+    current_.clear();
+    return barrier;
+}
+
+void HazardTracker::reset() {
+    current_.clear();
+    reads_.clear();
+    writes_.clear();
+    opaque_ = false;
+}
+
+void HazardTracker::barrier() {
+    reads_.clear();
+    writes_.clear();
+    opaque_ = true;
+}
+
+}// namespace vox
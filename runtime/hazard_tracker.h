@@ -0,0 +1,53 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <vector>
+#include "stream.h"
+
+namespace vox {
+/**
+ * @brief Finds the dispatches of an encoder which must wait for the ones before them.
+ *
+ * Dispatches between two barriers can run concurrently. A dispatch needs a barrier when it reads bytes
+ * written since the last barrier (RAW), or writes bytes read or written since then (WAR, WAW). Buffers
+ * are compared by address range, so sub-allocations of a slab don't conflict unless they overlap.
+ * Shared by the concurrent Metal encoder and the host scheduler.
+ */
+class HazardTracker {
+public:
+    // Access of the next dispatch to buffer
+    void use(const Buffer &buffer, ResourceUsage usage);
+
+    // Ends the accesses of the dispatch, true if it must wait for the previous dispatches
+    bool end_dispatch();
+
+    // The next dispatch starts after every previous one, like the first dispatch of an encoder
+    void reset();
+
+    // The next dispatch waits for every previous one, like after work recorded without the tracker
+    void barrier();
+
+    // Beyond this many ranges since the last barrier a dispatch waits anyway, which bounds the cost of the checks
+    static constexpr size_t max_ranges = 64;
+
+private:
+    struct Range {
+        uint64_t begin;
+        uint64_t end;
+        ResourceUsage usage;
+    };
+
+    std::vector<Range> current_;
+    // Accesses since the last barrier
+    std::vector<Range> reads_;
+    std::vector<Range> writes_;
+    // A dispatch which declared nothing may access anything, the one after it waits as well
+    bool opaque_{false};
+};
+
+}// namespace vox
@@ -0,0 +1,100 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstdlib>
+#include <unistd.h>
+
+#include "host_device.h"
+#include "host_stream.h"
+#include "allocator.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+constexpr size_t host_buffer_alignment = 64;
+
+struct HostBuffer {
+    void *data;
+    size_t size;
+    // false for memory wrapped by new_buffer_no_copy
+    bool owned;
+};
+}// namespace
+
+HostDevice::HostDevice(uint32_t num_threads)
+    : _thread_pool{num_threads} {}
+
+HostDevice::~HostDevice() {
+    // streams wait on the thread pool
+    stream_map_.clear();
+    kernel_map_.clear();
+}
+
+std::string HostDevice::name() {
+    return "Host";
+}
+
+HostStream &HostDevice::stream(uint32_t index) {
+    return static_cast<HostStream &>(Device::stream(index));
+}
+
+std::unique_ptr<Stream> HostDevice::new_stream(uint32_t index) {
+    return std::make_unique<HostStream>(index, *this);
+}
+
+Buffer HostDevice::new_buffer(size_t size) {
+    auto data = std::aligned_alloc(host_buffer_alignment, align(size, host_buffer_alignment));
+    if (!data) {
+        return Buffer{nullptr};
+    }
+    _allocated_size += size;
+    auto buffer = new HostBuffer{data, size, true};
+    return Buffer{buffer, data, reinterpret_cast<uint64_t>(data), size};
+}
+
+Buffer HostDevice::new_buffer_no_copy(void *ptr, size_t size) {
+    // kernels read host memory directly, any pointer works
+    auto buffer = new HostBuffer{ptr, size, false};
+    return Buffer{buffer, ptr, reinterpret_cast<uint64_t>(ptr), size};
+}
+
+void HostDevice::release_buffer(Buffer buffer) {
+    auto host_buffer = static_cast<HostBuffer *>(buffer.ptr());
+    if (host_buffer->owned) {
+        _allocated_size -= host_buffer->size;
+        std::free(host_buffer->data);
+    }
+    delete host_buffer;
+}
+
+size_t HostDevice::current_allocated_size() const {
+    return _allocated_size.load();
+}
+
+size_t HostDevice::recommended_max_working_set_size() const {
+    return static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+std::unique_ptr<Pipeline> HostDevice::new_kernel(const std::string &base_name,
+                                                 const std::string &lib_name,
+                                                 const std::string &kname,
+                                                 const FunctionConstantList &func_consts,
+                                                 const std::vector<std::string> &linked_functions) {
+    auto function = find_host_kernel(base_name);
+    if (!function) {
+        throw std::runtime_error(
+            "[host::Device] Unable to find host kernel " + base_name);
+    }
+    return std::make_unique<HostPipeline>(kname, function);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+HostDevice &host_device() {
+    static HostDevice host_device;
+    return host_device;
+}
+
+}// namespace vox
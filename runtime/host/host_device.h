@@ -0,0 +1,92 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <atomic>
+#include "device.h"
+#include "host_kernel.h"
+#include "thread_pool.h"
+
+namespace vox {
+class HostStream;
+
+class HostPipeline final : public Pipeline {
+public:
+    HostPipeline(std::string name, HostKernelFunction function)
+        : _name{std::move(name)}, _function{function} {}
+
+    [[nodiscard]] size_t max_total_threads_per_threadgroup() const override {
+        return 1024;
+    }
+
+    [[nodiscard]] const std::string &name() const {
+        return _name;
+    }
+
+    [[nodiscard]] HostKernelFunction function() const {
+        return _function;
+    }
+
+private:
+    std::string _name;
+    HostKernelFunction _function;
+};
+
+/**
+ * @brief Device running kernels registered with register_host_kernel on a ThreadPool.
+ */
+class HostDevice final : public Device {
+public:
+    explicit HostDevice(uint32_t num_threads = 0);
+
+    ~HostDevice() override;
+
+    std::string name() override;
+
+    HostStream &stream(uint32_t index);
+
+    ThreadPool &thread_pool() {
+        return _thread_pool;
+    }
+
+public:
+    Buffer new_buffer(size_t size) override;
+
+    Buffer new_buffer_no_copy(void *ptr, size_t size) override;
+
+    void release_buffer(Buffer buffer) override;
+
+    [[nodiscard]] size_t current_allocated_size() const override;
+
+    [[nodiscard]] size_t recommended_max_working_set_size() const override;
+
+    // Host kernels run the atomics-free variants, which also keeps their results deterministic
+    [[nodiscard]] bool supports_atomics() const override {
+        return false;
+    }
+
+    // Metal source can't run on the host, the entries must be registered host kernels
+    void register_source(const std::string &lib_name, const std::string &source) override {}
+
+protected:
+    std::unique_ptr<Stream> new_stream(uint32_t index) override;
+
+    std::unique_ptr<Pipeline> new_kernel(
+        const std::string &base_name,
+        const std::string &lib_name,
+        const std::string &kname,
+        const FunctionConstantList &func_consts,
+        const std::vector<std::string> &linked_functions) override;
+
+private:
+    ThreadPool _thread_pool;
+    std::atomic<size_t> _allocated_size{0};
+};
+
+HostDevice &host_device();
+
+}// namespace vox
@@ -0,0 +1,39 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "host_kernel.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace vox {
+namespace {
+struct HostKernelRegistry {
+    std::unordered_map<std::string, HostKernelFunction> functions;
+    std::mutex mtx;
+};
+
+HostKernelRegistry &registry() {
+    static HostKernelRegistry registry;
+    return registry;
+}
+}// namespace
+
+void register_host_kernel(const std::string &name, HostKernelFunction function) {
+    auto &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mtx);
+    r.functions[name] = function;
+}
+
+HostKernelFunction find_host_kernel(const std::string &name) {
+    auto &r = registry();
+    const std::lock_guard<std::mutex> lock(r.mtx);
+    if (auto it = r.functions.find(name); it != r.functions.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+}// namespace vox
@@ -0,0 +1,72 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "stream.h"
+
+namespace vox {
+/**
+ * @brief Built-in variables of one threadgroup executed by the host backend,
+ *        named after the Metal shading language attributes.
+ */
+struct ThreadgroupContext {
+    Size3 threadgroup_position_in_grid;
+    Size3 threadgroups_per_grid;
+    Size3 threads_per_threadgroup;
+    Size3 threads_per_grid;
+
+    /**
+     * @brief Invoke func(thread_position_in_grid, thread_position_in_threadgroup)
+     *        for every thread of the group which lies inside the grid.
+     */
+    template<typename Func>
+    void for_each_thread(Func &&func) const {
+        for (uint32_t z = 0; z < threads_per_threadgroup.z; ++z) {
+            uint32_t gz = threadgroup_position_in_grid.z * threads_per_threadgroup.z + z;
+            if (gz >= threads_per_grid.z) break;
+            for (uint32_t y = 0; y < threads_per_threadgroup.y; ++y) {
+                uint32_t gy = threadgroup_position_in_grid.y * threads_per_threadgroup.y + y;
+                if (gy >= threads_per_grid.y) break;
+                for (uint32_t x = 0; x < threads_per_threadgroup.x; ++x) {
+                    uint32_t gx = threadgroup_position_in_grid.x * threads_per_threadgroup.x + x;
+                    if (gx >= threads_per_grid.x) break;
+                    func(Size3{gx, gy, gz}, Size3{x, y, z});
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Host implementation of a kernel entry, invoked once per threadgroup.
+ * @param arguments The bytes bound at index 0, device addresses are host pointers.
+ */
+using HostKernelFunction = void (*)(const std::byte *arguments, const ThreadgroupContext &context);
+
+/// Make function resolvable as the kernel entry name on the host backend
+void register_host_kernel(const std::string &name, HostKernelFunction function);
+
+/// nullptr if no kernel was registered under name
+HostKernelFunction find_host_kernel(const std::string &name);
+
+}// namespace vox
+
+#define VOX_HOST_KERNEL_CONCAT_IMPL(a, b) a##b
+#define VOX_HOST_KERNEL_CONCAT(a, b) VOX_HOST_KERNEL_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Register a host kernel during static initialization
+ *
+ * Ex. REGISTER_HOST_KERNEL("mad_throughput_100000", mad_throughput<100000>);
+ */
+#define REGISTER_HOST_KERNEL(name, function)                                                 \
+    static const bool VOX_HOST_KERNEL_CONCAT(host_kernel_registered_, __COUNTER__) = [] { \
+        ::vox::register_host_kernel(name, function);                                         \
+        return true;                                                                         \
+    }()
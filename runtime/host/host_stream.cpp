@@ -0,0 +1,328 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+
+#include "host_stream.h"
+#include "host_device.h"
+#include "thread_pool.h"
+#include "allocator.h"
+
+namespace vox {
+namespace {
+// Enough tasks per dispatch for stealing to balance uneven threadgroups
+constexpr size_t tasks_per_thread = 4;
+
+uint32_t ceil_div(uint32_t a, uint32_t b) {
+    return (a + b - 1) / b;
+}
+
+HostCommand thread_groups_command(HostPipeline *pipeline, Size3 thread_groups, Size3 threads_per_thread_group) {
+    HostCommand command;
+    command.function = pipeline->function();
+    command.thread_groups = thread_groups;
+    command.threads_per_thread_group = threads_per_thread_group;
+    command.threads = Size3{thread_groups.x * threads_per_thread_group.x,
+                            thread_groups.y * threads_per_thread_group.y,
+                            thread_groups.z * threads_per_thread_group.z};
+    return command;
+}
+
+HostCommand threads_command(HostPipeline *pipeline, Size3 threads, Size3 threads_per_thread_group) {
+    HostCommand command;
+    command.function = pipeline->function();
+    command.thread_groups = Size3{ceil_div(threads.x, threads_per_thread_group.x),
+                                  ceil_div(threads.y, threads_per_thread_group.y),
+                                  ceil_div(threads.z, threads_per_thread_group.z)};
+    command.threads_per_thread_group = threads_per_thread_group;
+    command.threads = threads;
+    return command;
+}
+
+HostCommand indirect_command(HostPipeline *pipeline, const Buffer &indirect, size_t offset,
+                             Size3 threads_per_thread_group) {
+    HostCommand command;
+    command.function = pipeline->function();
+    command.threads_per_thread_group = threads_per_thread_group;
+    command.indirect = static_cast<const std::byte *>(indirect.raw_ptr()) + offset;
+    return command;
+}
+
+// Commands of a CommandGraph with the offset of their arguments in the bytes of the graph
+struct ResolvedGraph {
+    std::vector<HostCommand> commands;
+    std::vector<size_t> argument_offsets;
+};
+
+ResolvedGraph resolve(const CommandGraph &graph) {
+    ResolvedGraph resolved;
+    HazardTracker hazards;
+    const auto &resources = graph.resources();
+    for (const auto &node : graph.nodes()) {
+        auto pipeline = static_cast<HostPipeline *>(node.pipeline);
+        HostCommand command;
+        switch (node.kind) {
+            case CommandGraph::DispatchKind::ThreadGroups:
+                command = thread_groups_command(pipeline, node.size, node.threads_per_thread_group);
+                break;
+            case CommandGraph::DispatchKind::Threads:
+                command = threads_command(pipeline, node.size, node.threads_per_thread_group);
+                break;
+            case CommandGraph::DispatchKind::Indirect:
+                command = indirect_command(pipeline, node.indirect, node.indirect_offset, node.threads_per_thread_group);
+                hazards.use(node.indirect, ResourceUsage::Read);
+                break;
+        }
+        for (size_t index = node.resource_begin; index < node.resource_end; index++) {
+            hazards.use(resources[index].buffer, resources[index].usage);
+        }
+        command.barrier = hazards.end_dispatch();
+        resolved.commands.push_back(command);
+        resolved.argument_offsets.push_back(node.argument_offset);
+    }
+    // The graph starts after the work recorded before it
+    resolved.commands.front().barrier = true;
+    return resolved;
+}
+}// namespace
+
+void HostCommandEncoder::set_pipeline(Pipeline *pipeline) {
+    _pipeline = static_cast<HostPipeline *>(pipeline);
+}
+
+void HostCommandEncoder::set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) {
+    if (index == 0) {
+        _arguments = static_cast<const std::byte *>(buffer.raw_ptr()) + offset;
+    }
+}
+
+void HostCommandEncoder::dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) {
+    auto command = thread_groups_command(_pipeline, thread_groups, threads_per_thread_group);
+    command.arguments = _arguments;
+    command.barrier = _hazards.end_dispatch();
+    _stream.record(command);
+}
+
+void HostCommandEncoder::dispatch_threads(Size3 threads, Size3 threads_per_thread_group) {
+    auto command = threads_command(_pipeline, threads, threads_per_thread_group);
+    command.arguments = _arguments;
+    command.barrier = _hazards.end_dispatch();
+    _stream.record(command);
+}
+
+void HostCommandEncoder::dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) {
+    auto command = indirect_command(_pipeline, indirect, offset, threads_per_thread_group);
+    command.arguments = _arguments;
+    _hazards.use(indirect, ResourceUsage::Read);
+    command.barrier = _hazards.end_dispatch();
+    _stream.record(command);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+HostStream::HostStream(uint32_t index, HostDevice &device)
+    : Stream{index}, _thread_pool{device.thread_pool()}, _argument_ring{device} {}
+
+HostStream::~HostStream() {
+    synchronize(true);
+}
+
+HostCommandEncoder *HostStream::get_command_encoder() {
+    if (!_encoder) {
+        _encoder = std::make_unique<HostCommandEncoder>(*this);
+    }
+    return _encoder.get();
+}
+
+void HostStream::record(HostCommand command) {
+    _recording.commands.push_back(command);
+}
+
+void HostStream::retain_resource(std::shared_ptr<void> resource) {
+    _recording.retained.push_back(std::move(resource));
+}
+
+void HostStream::replay(const CommandGraph &graph) {
+    // A graph replayed while capturing goes through the recorder like any launch
+    if (_capture || graph.empty()) {
+        Stream::replay(graph);
+        return;
+    }
+    const auto &resolved = graph.resolved<ResolvedGraph>(resolve);
+    const auto &bytes = graph.arguments();
+    auto arguments = _argument_ring.allocate(bytes.size());
+    std::memcpy(arguments.data, bytes.data(), bytes.size());
+
+    auto &commands = _recording.commands;
+    const size_t first = commands.size();
+    commands.insert(commands.end(), resolved.commands.begin(), resolved.commands.end());
+    for (size_t index = 0; index < resolved.commands.size(); index++) {
+        commands[first + index].arguments = arguments.data + resolved.argument_offsets[index];
+    }
+    // The encoder didn't see the resources of the graph, the next dispatch waits for it
+    get_command_encoder()->barrier();
+    _recording.retained.emplace_back(graph.retained());
+}
+
+void HostStream::synchronize(bool wait) {
+    bool start = false;
+    {
+        const std::lock_guard<std::mutex> lock(_mtx);
+        if (!_recording.empty()) {
+            _recording.arguments = _argument_ring.commit();
+            if (_encoder) {
+                _encoder->reset();
+            }
+            _committed.push_back(std::move(_recording));
+            _recording = {};
+            _committed_count++;
+            if (!_running) {
+                _running = true;
+                _current = &_committed.front();
+                start = true;
+            }
+        }
+    }
+    if (start) {
+        start_command_buffer();
+    }
+
+    if (wait) {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _cv.wait(lock, [this] { return !_running; });
+    }
+}
+
+void HostStream::wait_for(Stream &producer) {
+    if (&producer == this) {
+        return;
+    }
+    auto &host_producer = static_cast<HostStream &>(producer);
+    host_producer.synchronize();
+    // The work recorded so far doesn't wait
+    synchronize();
+
+    const std::lock_guard<std::mutex> lock(host_producer._mtx);
+    if (host_producer._completed_count < host_producer._committed_count) {
+        _recording.waits.emplace_back(&host_producer, host_producer._committed_count);
+    }
+}
+
+void HostStream::start_command_buffer() {
+    auto &waits = _current->waits;
+    while (!waits.empty()) {
+        auto [producer, fence] = waits.back();
+        waits.pop_back();
+        if (producer->notify_completed(fence, [this] { start_command_buffer(); })) {
+            return;
+        }
+    }
+    launch(0);
+}
+
+bool HostStream::notify_completed(uint64_t fence, std::function<void()> resume) {
+    const std::lock_guard<std::mutex> lock(_mtx);
+    if (_completed_count >= fence) {
+        return false;
+    }
+    _waiters.emplace_back(fence, std::move(resume));
+    return true;
+}
+
+void HostStream::launch(size_t command_index) {
+    auto &commands = _current->commands;
+
+    // Commands up to the next barrier run together, skipping the batches without threadgroups
+    size_t batch_end = command_index;
+    size_t task_count = 0;
+    while (task_count == 0) {
+        command_index = batch_end;
+        if (command_index == commands.size()) {
+            finish_command_buffer();
+            return;
+        }
+        do {
+            // Resolve indirect arguments now that the dispatches they depend on completed
+            auto &command = commands[batch_end];
+            if (command.indirect) {
+                uint32_t groups[3];
+                std::memcpy(groups, command.indirect, sizeof(groups));
+                command.thread_groups = Size3{groups[0], groups[1], groups[2]};
+                command.threads = Size3{groups[0] * command.threads_per_thread_group.x,
+                                        groups[1] * command.threads_per_thread_group.y,
+                                        groups[2] * command.threads_per_thread_group.z};
+            }
+            task_count += std::min(command.thread_groups.volume(), size_t(_thread_pool.size()) * tasks_per_thread);
+            batch_end++;
+        } while (batch_end < commands.size() && !commands[batch_end].barrier);
+    }
+    _remaining_tasks.store(task_count);
+
+    for (size_t index = command_index; index < batch_end; ++index) {
+        auto &command = commands[index];
+        const size_t group_count = command.thread_groups.volume();
+        const size_t command_tasks = std::min(group_count, size_t(_thread_pool.size()) * tasks_per_thread);
+        for (size_t task = 0; task < command_tasks; ++task) {
+            const size_t begin = group_count * task / command_tasks;
+            const size_t end = group_count * (task + 1) / command_tasks;
+            _thread_pool.submit([this, &command, batch_end, begin, end] {
+                const auto &groups = command.thread_groups;
+                ThreadgroupContext context{{}, groups, command.threads_per_thread_group, command.threads};
+                for (size_t group = begin; group < end; ++group) {
+                    context.threadgroup_position_in_grid = Size3{
+                        static_cast<uint32_t>(group % groups.x),
+                        static_cast<uint32_t>(group / groups.x % groups.y),
+                        static_cast<uint32_t>(group / (size_t(groups.x) * groups.y))};
+                    command.function(command.arguments, context);
+                }
+
+                // The last task of a batch starts the next one
+                if (_remaining_tasks.fetch_sub(1) == 1) {
+                    launch(batch_end);
+                }
+            });
+        }
+    }
+}
+
+void HostStream::finish_command_buffer() {
+    // Release before the stream reports idle, waiting threads may need the memory
+    _current->retained.clear();
+    _argument_ring.release(_current->arguments);
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _committed.pop_front();
+    _completed_count++;
+
+    // The streams waiting for this command buffer resume on this thread
+    std::vector<std::function<void()>> resumed;
+    auto waiting = std::partition(_waiters.begin(), _waiters.end(),
+                                  [this](const auto &waiter) { return waiter.first > _completed_count; });
+    for (auto it = waiting; it != _waiters.end(); ++it) {
+        resumed.push_back(std::move(it->second));
+    }
+    _waiters.erase(waiting, _waiters.end());
+
+    const bool next = !_committed.empty();
+    if (next) {
+        _current = &_committed.front();
+        lock.unlock();
+    } else {
+        _current = nullptr;
+        _running = false;
+        lock.unlock();
+        _cv.notify_all();
+    }
+
+    for (auto &resume : resumed) {
+        resume();
+    }
+    if (next) {
+        start_command_buffer();
+    }
+}
+
+}// namespace vox
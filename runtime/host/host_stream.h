@@ -0,0 +1,158 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "stream.h"
+#include "argument_ring.h"
+#include "command_graph.h"
+#include "hazard_tracker.h"
+#include "host_kernel.h"
+
+namespace vox {
+class HostDevice;
+class HostPipeline;
+class HostStream;
+class ThreadPool;
+
+struct HostCommand {
+    HostKernelFunction function{nullptr};
+    // Bytes bound at index 0, in the argument ring of the stream
+    const std::byte *arguments{nullptr};
+    Size3 thread_groups;
+    Size3 threads_per_thread_group;
+    // threads per grid, clips the last threadgroups of dispatch_threads
+    Size3 threads;
+    // MTLDispatchThreadgroupsIndirectArguments, resolved when the command starts
+    const void *indirect{nullptr};
+    // Waits for the previous commands, otherwise runs along with them
+    bool barrier{true};
+};
+
+struct HostCommandBuffer {
+    std::vector<HostCommand> commands;
+    // Released once every command completed
+    std::vector<std::shared_ptr<void>> retained;
+    ArgumentRing::Mark arguments{};
+    // Streams and the number of their command buffers which must complete before this one starts
+    std::vector<std::pair<HostStream *, uint64_t>> waits;
+
+    [[nodiscard]] bool empty() const {
+        return commands.empty() && retained.empty();
+    }
+};
+
+class HostCommandEncoder final : public CommandEncoder {
+public:
+    explicit HostCommandEncoder(HostStream &stream) : _stream{stream} {}
+
+    void set_pipeline(Pipeline *pipeline) override;
+
+    // Host kernels receive the bytes bound at index 0
+    void set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) override;
+
+    // Host memory is coherent, the usage only orders the dispatches
+    void use_resource(const Buffer &buffer, ResourceUsage usage) override {
+        _hazards.use(buffer, usage);
+    }
+
+    void dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) override;
+
+    void dispatch_threads(Size3 threads, Size3 threads_per_thread_group) override;
+
+    void dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) override;
+
+    // The next command buffer starts after every dispatch of the previous ones
+    void reset() {
+        _hazards.reset();
+    }
+
+    // The next dispatch waits for the commands recorded without the encoder
+    void barrier() {
+        _hazards.barrier();
+    }
+
+private:
+    HostStream &_stream;
+    HazardTracker _hazards;
+    HostPipeline *_pipeline{nullptr};
+    const std::byte *_arguments{nullptr};
+};
+
+/**
+ * @brief Stream executing dispatches on a ThreadPool.
+ *
+ * Commands are recorded until synchronize() commits them, committed command buffers
+ * run in order. Like a concurrent Metal compute encoder, consecutive dispatches without
+ * conflicting resource usages run together and the others wait for every dispatch before them.
+ */
+class HostStream final : public Stream {
+public:
+    HostStream(uint32_t index, HostDevice &device);
+
+    ~HostStream() override;
+
+    HostCommandEncoder *get_command_encoder() override;
+
+    void synchronize(bool wait = false) override;
+
+    // The next command buffer starts from the thread completing the work of producer
+    void wait_for(Stream &producer) override;
+
+    ArgumentRing &argument_ring() override {
+        return _argument_ring;
+    }
+
+    // Appends the commands resolved from the graph once, the pipelines and barriers aren't looked at again
+    void replay(const CommandGraph &graph) override;
+
+protected:
+    void retain_resource(std::shared_ptr<void> resource) override;
+
+private:
+    friend class HostCommandEncoder;
+
+    void record(HostCommand command);
+
+    // Run the dispatches of the current command buffer from command_index on, the ones up to the next barrier
+    // at once
+    void launch(size_t command_index);
+
+    // Start the current command buffer once the streams it waits for completed the work it depends on
+    void start_command_buffer();
+
+    void finish_command_buffer();
+
+    // Calls resume once fence command buffers completed, false without calling it if they already did
+    bool notify_completed(uint64_t fence, std::function<void()> resume);
+
+private:
+    ThreadPool &_thread_pool;
+    ArgumentRing _argument_ring;
+    std::unique_ptr<HostCommandEncoder> _encoder;
+    HostCommandBuffer _recording;
+
+    std::deque<HostCommandBuffer> _committed;
+    HostCommandBuffer *_current{nullptr};
+    bool _running{false};
+    std::atomic<size_t> _remaining_tasks{0};
+    // Command buffers committed and completed since the creation of the stream
+    uint64_t _committed_count{0};
+    uint64_t _completed_count{0};
+    // Command buffers of other streams waiting for _completed_count to reach a fence
+    std::vector<std::pair<uint64_t, std::function<void()>>> _waiters;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+};
+}// namespace vox
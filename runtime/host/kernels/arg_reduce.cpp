@@ -0,0 +1,168 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "host/host_kernel.h"
+#include "primitives/reduce.h"
+#include "reduce_ops.h"
+
+namespace vox {
+namespace {
+using host::highest;
+using host::lowest;
+
+// Independent candidates the compiler can keep in vector registers
+constexpr size_t lanes = 8;
+constexpr uint32_t no_index = std::numeric_limits<uint32_t>::max();
+
+// same layout as shader/builtin/arg_reduce.metal
+template<typename T>
+struct alignas(8) ArgReduceArguments {
+    const T *in;
+    const uint32_t *in_index;
+    T *out_value;
+    uint32_t *out_index;
+    uint64_t in_size;
+    uint64_t row_size;
+    uint64_t absolute_index;
+};
+
+template<typename T>
+struct alignas(8) GeneralArgReduceArguments {
+    const T *in;
+    uint32_t *out_index;
+    GeneralReduceLayout layout;
+};
+
+// a replaces b if it is strictly better, scanning in index order keeps the lowest index of ties
+struct ArgMin {
+    template<typename T>
+    static T init() { return highest<T>(); }
+    template<typename T>
+    static bool better(T a, T b) { return a < b; }
+};
+
+struct ArgMax {
+    template<typename T>
+    static T init() { return lowest<T>(); }
+    template<typename T>
+    static bool better(T a, T b) { return a > b; }
+};
+
+// One threadgroup per row, like the Metal kernel
+template<typename T, typename Op>
+void arg_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    ArgReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t row = context.threadgroup_position_in_grid.x;
+    const size_t begin = row * args.row_size;
+    const size_t end = std::min<size_t>(begin + args.row_size, args.in_size);
+    const size_t index_base = args.absolute_index ? 0 : begin;
+
+    T best_value = Op::template init<T>();
+    uint32_t best_index = no_index;
+    if (args.in_index) {
+        // Partial results, the indices aren't ordered
+        for (size_t i = begin; i < end; i++) {
+            const T value = args.in[i];
+            if (Op::better(value, best_value) || (value == best_value && args.in_index[i] < best_index)) {
+                best_value = value;
+                best_index = args.in_index[i];
+            }
+        }
+    } else {
+        T value[lanes];
+        size_t index[lanes];
+        std::fill_n(value, lanes, Op::template init<T>());
+        std::fill_n(index, lanes, size_t(no_index));
+        size_t i = begin;
+        for (; i + lanes <= end; i += lanes) {
+            for (size_t lane = 0; lane < lanes; lane++) {
+                const bool replace = Op::better(args.in[i + lane], value[lane]);
+                value[lane] = replace ? args.in[i + lane] : value[lane];
+                index[lane] = replace ? i + lane : index[lane];
+            }
+        }
+        for (; i < end; i++) {
+            if (Op::better(args.in[i], value[0])) {
+                value[0] = args.in[i];
+                index[0] = i;
+            }
+        }
+
+        // The lanes saw interleaved indices
+        size_t best = no_index;
+        for (size_t lane = 0; lane < lanes; lane++) {
+            if (index[lane] == no_index) {
+                continue;
+            }
+            if (best == no_index || Op::better(value[lane], best_value) ||
+                (value[lane] == best_value && index[lane] < best)) {
+                best_value = value[lane];
+                best = index[lane];
+            }
+        }
+        // Every element equals the identity, e.g. a row of infinities
+        best_index = uint32_t((best == no_index ? begin : best) - index_base);
+    }
+    args.out_value[row] = best_value;
+    args.out_index[row] = best_index;
+}
+
+template<typename T, typename Op>
+void general_arg_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    GeneralArgReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    const auto &layout = args.layout;
+
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        int64_t base = 0;
+        size_t index = tpig.x;
+        for (int d = layout.out_ndim - 1; d >= 0; d--) {
+            base += int64_t(index % layout.out_shape[d]) * layout.out_strides[d];
+            index /= layout.out_shape[d];
+        }
+
+        T best_value = Op::template init<T>();
+        uint32_t best_index = 0;
+        for (size_t r = 0; r < layout.reduction_size; r++) {
+            int64_t offset = base;
+            size_t reduce_index = r;
+            for (int d = layout.reduce_ndim - 1; d >= 0; d--) {
+                offset += int64_t(reduce_index % layout.reduce_shape[d]) * layout.reduce_strides[d];
+                reduce_index /= layout.reduce_shape[d];
+            }
+            if (Op::better(args.in[offset], best_value)) {
+                best_value = args.in[offset];
+                best_index = uint32_t(r);
+            }
+        }
+        args.out_index[tpig.x] = best_index;
+    });
+}
+}// namespace
+
+#define REGISTER_ARG_REDUCE(tname, type)                                                         \
+    REGISTER_HOST_KERNEL("arg_reduce_argmin" tname, (arg_reduce<type, ArgMin>));                 \
+    REGISTER_HOST_KERNEL("arg_reduce_argmax" tname, (arg_reduce<type, ArgMax>));                 \
+    REGISTER_HOST_KERNEL("general_arg_reduce_argmin" tname, (general_arg_reduce<type, ArgMin>)); \
+    REGISTER_HOST_KERNEL("general_arg_reduce_argmax" tname, (general_arg_reduce<type, ArgMax>))
+
+REGISTER_ARG_REDUCE("uint8", uint8_t);
+REGISTER_ARG_REDUCE("uint16", uint16_t);
+REGISTER_ARG_REDUCE("uint32", uint32_t);
+REGISTER_ARG_REDUCE("uint64", uint64_t);
+REGISTER_ARG_REDUCE("int8", int8_t);
+REGISTER_ARG_REDUCE("int16", int16_t);
+REGISTER_ARG_REDUCE("int32", int32_t);
+REGISTER_ARG_REDUCE("int64", int64_t);
+REGISTER_ARG_REDUCE("float16", float16_t);
+REGISTER_ARG_REDUCE("float32", float);
+
+}// namespace vox
@@ -0,0 +1,116 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "host/host_kernel.h"
+#include "types/half_types.h"
+#include "types/simd_types.h"
+
+namespace vox {
+namespace {
+// same layout as shader/builtin/compact.metal
+template<typename T>
+struct alignas(8) CompactArguments {
+    const T *in;
+    const uint8_t *mask;
+    T *out;
+    uint32_t *count;
+    uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+    uint64_t value;
+};
+
+struct Masked {
+    template<typename T>
+    static bool select(const CompactArguments<T> &args, size_t i) {
+        return args.mask[i] != 0;
+    }
+};
+
+// Compares every element with the value of the arguments
+template<typename Compare>
+struct Compared {
+    template<typename T>
+    static bool select(const CompactArguments<T> &args, size_t i) {
+        T value;
+        std::memcpy(&value, &args.value, sizeof(value));
+        return Compare{}(args.in[i], value);
+    }
+};
+
+// Selected elements of one block per threadgroup
+template<typename T, typename Predicate>
+void compact_count(const std::byte *arguments, const ThreadgroupContext &context) {
+    CompactArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+    uint32_t count = 0;
+    for (size_t i = begin; i < end; i++) {
+        count += Predicate::select(args, i) ? 1 : 0;
+    }
+    args.block_offsets[block] = count;
+    if (block == 0) {
+        args.block_offsets[context.threadgroups_per_grid.x] = 0;
+    }
+}
+
+// The selected elements of a block in order, after the ones of the previous blocks
+template<typename T, typename Predicate>
+void compact_scatter(const std::byte *arguments, const ThreadgroupContext &context) {
+    CompactArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    if (block == 0) {
+        *args.count = args.block_offsets[context.threadgroups_per_grid.x];
+    }
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+    T *out = args.out + args.block_offsets[block];
+    for (size_t i = begin; i < end; i++) {
+        if (Predicate::select(args, i)) {
+            *out++ = args.in[i];
+        }
+    }
+}
+}// namespace
+
+#define REGISTER_COMPACT(name, tname, type, predicate)                                          \
+    REGISTER_HOST_KERNEL("compact_count_" name tname, (compact_count<type, predicate>));     \
+    REGISTER_HOST_KERNEL("compact_scatter_" name tname, (compact_scatter<type, predicate>))
+
+#define REGISTER_COMPACT_PREDICATES(tname, type)                                     \
+    REGISTER_COMPACT("mask", tname, type, Masked);                                   \
+    REGISTER_COMPACT("eq", tname, type, Compared<std::equal_to<>>);                  \
+    REGISTER_COMPACT("ne", tname, type, Compared<std::not_equal_to<>>);              \
+    REGISTER_COMPACT("lt", tname, type, Compared<std::less<>>);                      \
+    REGISTER_COMPACT("le", tname, type, Compared<std::less_equal<>>);                \
+    REGISTER_COMPACT("gt", tname, type, Compared<std::greater<>>);                   \
+    REGISTER_COMPACT("ge", tname, type, Compared<std::greater_equal<>>)
+
+REGISTER_COMPACT_PREDICATES("uint8", uint8_t);
+REGISTER_COMPACT_PREDICATES("uint16", uint16_t);
+REGISTER_COMPACT_PREDICATES("uint32", uint32_t);
+REGISTER_COMPACT_PREDICATES("uint64", uint64_t);
+REGISTER_COMPACT_PREDICATES("int8", int8_t);
+REGISTER_COMPACT_PREDICATES("int16", int16_t);
+REGISTER_COMPACT_PREDICATES("int32", int32_t);
+REGISTER_COMPACT_PREDICATES("int64", int64_t);
+REGISTER_COMPACT_PREDICATES("float16", float16_t);
+REGISTER_COMPACT_PREDICATES("float32", float);
+
+// Vectors are only selected by a mask
+REGISTER_COMPACT("mask", "float2", simd::float2, Masked);
+REGISTER_COMPACT("mask", "float3", simd::float3, Masked);
+REGISTER_COMPACT("mask", "float4", simd::float4, Masked);
+
+}// namespace vox
@@ -0,0 +1,242 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include "hash_grid.h"
+#include "host/host_kernel.h"
+
+namespace vox {
+namespace {
+// same layout as shader/builtin/hash_grid.metal
+struct alignas(8) HashGridPointArguments {
+    const simd::float3 *points;
+    uint32_t *point_cells;
+    uint32_t *point_ids;
+    HashGridDescriptor *descriptor;
+    HashGridDescriptor grid;
+};
+
+struct alignas(8) HashGridCellArguments {
+    const uint32_t *point_cells;
+    int32_t *cell_starts;
+    int32_t *cell_ends;
+    uint64_t size;
+};
+
+struct alignas(8) NeighborListArguments {
+    const simd::float3 *points;
+    simd::float3 *reference;
+    int32_t *offsets;
+    int32_t *indices;
+    uint64_t grid;
+    uint64_t size;
+    float cutoff;
+};
+
+struct alignas(8) NeighborDisplacementArguments {
+    const simd::float3 *points;
+    const simd::float3 *reference;
+    float *displacement;
+    uint64_t size;
+};
+
+// hash_grid_index of shader/hash_grid.h
+int32_t hash_grid_index(const HashGridDescriptor &grid, int32_t x, int32_t y, int32_t z) {
+    constexpr int32_t origin = 1 << 20;
+    x = std::max(0, x + origin);
+    y = std::max(0, y + origin);
+    z = std::max(0, z + origin);
+    return (z % grid.dim_z) * (grid.dim_x * grid.dim_y) + (y % grid.dim_y) * grid.dim_x + (x % grid.dim_x);
+}
+
+int32_t hash_grid_index(const HashGridDescriptor &grid, const simd::float3 &p) {
+    return hash_grid_index(grid, int32_t(p.x * grid.cell_width_inv), int32_t(p.y * grid.cell_width_inv),
+                           int32_t(p.z * grid.cell_width_inv));
+}
+
+// hash_grid_query and hash_grid_query_next of shader/hash_grid.h
+class HashGridQuery {
+public:
+    HashGridQuery(uint64_t id, const simd::float3 &pos, float radius)
+        : _grid{*reinterpret_cast<const HashGridDescriptor *>(id)},
+          _point_ids{reinterpret_cast<const int32_t *>(_grid.point_ids)},
+          _cell_starts{reinterpret_cast<const int32_t *>(_grid.cell_starts)},
+          _cell_ends{reinterpret_cast<const int32_t *>(_grid.cell_ends)} {
+        const int32_t dims[3] = {_grid.dim_x, _grid.dim_y, _grid.dim_z};
+        for (int i = 0; i < 3; i++) {
+            _start[i] = int32_t((pos[i] - radius) * _grid.cell_width_inv);
+            _end[i] = std::min(int32_t((pos[i] + radius) * _grid.cell_width_inv), _start[i] + dims[i] - 1);
+            _current[i] = _start[i];
+        }
+        enter_cell();
+    }
+
+    bool next(int32_t &index) {
+        if (!_point_ids) {
+            return false;
+        }
+        while (_cell_index >= _cell_end) {
+            if (++_current[0] > _end[0]) {
+                _current[0] = _start[0];
+                if (++_current[1] > _end[1]) {
+                    _current[1] = _start[1];
+                    if (++_current[2] > _end[2]) {
+                        return false;
+                    }
+                }
+            }
+            enter_cell();
+        }
+        index = _point_ids[_cell_index++];
+        return true;
+    }
+
+private:
+    void enter_cell() {
+        const int32_t cell = hash_grid_index(_grid, _current[0], _current[1], _current[2]);
+        _cell_index = _cell_starts[cell];
+        _cell_end = _cell_ends[cell];
+    }
+
+    HashGridDescriptor _grid;
+    const int32_t *_point_ids;
+    const int32_t *_cell_starts;
+    const int32_t *_cell_ends;
+    int32_t _start[3]{};
+    int32_t _end[3]{};
+    int32_t _current[3]{};
+    int32_t _cell_index{0};
+    int32_t _cell_end{0};
+};
+
+float distance_squared(const simd::float3 &a, const simd::float3 &b) {
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void hash_grid_point_cells(const std::byte *arguments, const ThreadgroupContext &context) {
+    HashGridPointArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        if (gid.x == 0) {
+            std::memcpy(args.descriptor, &args.grid, sizeof(args.grid));
+        }
+        if (gid.x >= uint32_t(args.grid.num_points)) {
+            return;
+        }
+        args.point_cells[gid.x] = hash_grid_index(args.grid, args.points[gid.x]);
+        args.point_ids[gid.x] = gid.x;
+    });
+}
+
+void hash_grid_clear_cells(const std::byte *arguments, const ThreadgroupContext &context) {
+    HashGridCellArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        if (gid.x < args.size) {
+            args.cell_starts[gid.x] = 0;
+            args.cell_ends[gid.x] = 0;
+        }
+    });
+}
+
+void hash_grid_cell_ranges(const std::byte *arguments, const ThreadgroupContext &context) {
+    HashGridCellArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        const size_t i = gid.x;
+        if (i >= args.size) {
+            return;
+        }
+        const uint32_t cell = args.point_cells[i];
+        if (i == 0 || args.point_cells[i - 1] != cell) {
+            args.cell_starts[cell] = int32_t(i);
+        }
+        if (i == args.size - 1 || args.point_cells[i + 1] != cell) {
+            args.cell_ends[cell] = int32_t(i + 1);
+        }
+    });
+}
+
+// Consecutive threads take the points of the same cells, whose queries visit the same points
+int32_t point_in_cell_order(const NeighborListArguments &args, size_t thread) {
+    const auto &grid = *reinterpret_cast<const HashGridDescriptor *>(args.grid);
+    return reinterpret_cast<const int32_t *>(grid.point_ids)[thread];
+}
+
+void neighbor_list_count(const std::byte *arguments, const ThreadgroupContext &context) {
+    NeighborListArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        if (gid.x >= args.size) {
+            if (gid.x == args.size) {
+                args.offsets[gid.x] = 0;
+            }
+            return;
+        }
+        const int32_t i = point_in_cell_order(args, gid.x);
+        const simd::float3 p = args.points[i];
+        args.reference[i] = p;
+        const float cutoff_squared = args.cutoff * args.cutoff;
+        HashGridQuery query(args.grid, p, args.cutoff);
+        int32_t index;
+        int32_t count = 0;
+        // Without a branch on the distance, which is taken at random
+        while (query.next(index)) {
+            count += distance_squared(args.points[index], p) <= cutoff_squared;
+        }
+        args.offsets[i] = count;
+    });
+}
+
+void neighbor_list_fill(const std::byte *arguments, const ThreadgroupContext &context) {
+    NeighborListArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        if (gid.x >= args.size) {
+            return;
+        }
+        const int32_t i = point_in_cell_order(args, gid.x);
+        const simd::float3 p = args.points[i];
+        const float cutoff_squared = args.cutoff * args.cutoff;
+        HashGridQuery query(args.grid, p, args.cutoff);
+        int32_t index;
+        // Every candidate goes to the next slot, only the ones within cutoff keep it
+        int32_t next = args.offsets[i];
+        const int32_t end = args.offsets[i + 1];
+        while (next < end && query.next(index)) {
+            args.indices[next] = index;
+            next += distance_squared(args.points[index], p) <= cutoff_squared;
+        }
+    });
+}
+
+void neighbor_list_displacement(const std::byte *arguments, const ThreadgroupContext &context) {
+    NeighborDisplacementArguments args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    context.for_each_thread([&](Size3 gid, Size3) {
+        if (gid.x < args.size) {
+            args.displacement[gid.x] = distance_squared(args.points[gid.x], args.reference[gid.x]);
+        }
+    });
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("hash_grid_point_cells", hash_grid_point_cells);
+REGISTER_HOST_KERNEL("hash_grid_clear_cells", hash_grid_clear_cells);
+REGISTER_HOST_KERNEL("hash_grid_cell_ranges", hash_grid_cell_ranges);
+REGISTER_HOST_KERNEL("neighbor_list_count", neighbor_list_count);
+REGISTER_HOST_KERNEL("neighbor_list_fill", neighbor_list_fill);
+REGISTER_HOST_KERNEL("neighbor_list_displacement", neighbor_list_displacement);
+
+}// namespace vox
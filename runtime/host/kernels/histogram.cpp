@@ -0,0 +1,91 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "host/host_kernel.h"
+#include "types/half_types.h"
+
+namespace vox {
+namespace {
+// same layout as shader/builtin/histogram.metal, out holds one histogram per block
+template<typename T>
+struct alignas(8) HistogramArguments {
+    const T *in;
+    uint32_t *out;
+    uint64_t size;
+    uint64_t block_size;
+    uint64_t bins;
+    float lower;
+    float upper;
+    float scale;
+    float padding;
+};
+
+// Below this many bins every block counts in several interleaved copies, so that runs of equal
+// values don't wait on the increment of the same counter
+constexpr size_t max_interleaved_bins = 4096;
+constexpr size_t copies = 4;
+
+// Every threadgroup counts one block in its own histogram, nothing is shared between the threads
+template<typename T>
+void histogram_blocks(const std::byte *arguments, const ThreadgroupContext &context) {
+    HistogramArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    // The values outside the range go to an extra bin which is dropped
+    const size_t stride = args.bins + 1;
+    const size_t num_copies = args.bins <= max_interleaved_bins ? copies : 1;
+    std::vector<uint32_t> local(stride * num_copies);
+
+    const auto last = uint32_t(args.bins - 1);
+    const auto outside = uint32_t(args.bins);
+    const size_t begin = context.threadgroup_position_in_grid.x * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+    size_t i = begin;
+    auto bin = [&](size_t index) {
+        const auto x = float(args.in[index]);
+        const bool inside = x >= args.lower && x <= args.upper;
+        return inside ? std::min(uint32_t((x - args.lower) * args.scale), last) : outside;
+    };
+    if (num_copies == copies) {
+        for (; i + copies <= end; i += copies) {
+            for (size_t c = 0; c < copies; c++) {
+                local[c * stride + bin(i + c)]++;
+            }
+        }
+    }
+    for (; i < end; i++) {
+        local[bin(i)]++;
+    }
+
+    uint32_t *counts = args.out + context.threadgroup_position_in_grid.x * args.bins;
+    for (size_t b = 0; b < args.bins; b++) {
+        uint32_t count = 0;
+        for (size_t c = 0; c < num_copies; c++) {
+            count += local[c * stride + b];
+        }
+        counts[b] = count;
+    }
+}
+}// namespace
+
+#define REGISTER_HISTOGRAM(tname, type) \
+    REGISTER_HOST_KERNEL("histogram_blocks_" tname, histogram_blocks<type>)
+
+REGISTER_HISTOGRAM("uint8", uint8_t);
+REGISTER_HISTOGRAM("uint16", uint16_t);
+REGISTER_HISTOGRAM("uint32", uint32_t);
+REGISTER_HISTOGRAM("uint64", uint64_t);
+REGISTER_HISTOGRAM("int8", int8_t);
+REGISTER_HISTOGRAM("int16", int16_t);
+REGISTER_HISTOGRAM("int32", int32_t);
+REGISTER_HISTOGRAM("int64", int64_t);
+REGISTER_HISTOGRAM("float16", float16_t);
+REGISTER_HISTOGRAM("float32", float);
+
+}// namespace vox
@@ -0,0 +1,42 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "host/host_kernel.h"
+
+namespace vox {
+namespace {
+// same layout as shader/builtin/mad_throughput.metal
+struct alignas(8) Arguments {
+    float *inputA;
+    float *inputB;
+    float *output;
+};
+
+template<int kLoopSize>
+void mad_throughput(const std::byte *arguments, const ThreadgroupContext &context) {
+    Arguments args{};
+    std::memcpy(&args, arguments, sizeof(Arguments));
+
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        // one float4 per thread
+        const float *a = args.inputA + tpig.x * 4;
+        const float *b = args.inputB + tpig.x * 4;
+        float c[4] = {1.f, 1.f, 1.f, 1.f};
+        for (int i = 0; i < kLoopSize * 10; i++) {
+            for (int j = 0; j < 4; j++) {
+                c[j] = a[j] * c[j] + b[j];
+            }
+        }
+        std::memcpy(args.output + tpig.x * 4, c, sizeof(c));
+    });
+}
+}// namespace
+
+REGISTER_HOST_KERNEL("mad_throughput_100000", mad_throughput<100000>);
+REGISTER_HOST_KERNEL("mad_throughput_200000", mad_throughput<200000>);
+
+}// namespace vox
@@ -0,0 +1,110 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include "host/host_kernel.h"
+
+namespace vox {
+namespace {
+constexpr uint32_t radix_size = 256;
+
+// same layout as shader/builtin/radix_sort.metal
+template<typename K>
+struct alignas(8) RadixArguments {
+    const K *keys_in;
+    const uint32_t *values_in;
+    K *keys_out;
+    uint32_t *values_out;
+    uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+    uint64_t shift;
+};
+
+// Unsigned bits in the order of the keys
+uint32_t radix_bits(uint32_t key) {
+    return key;
+}
+
+uint64_t radix_bits(uint64_t key) {
+    return key;
+}
+
+uint32_t radix_bits(int32_t key) {
+    return uint32_t(key) ^ 0x80000000u;
+}
+
+uint32_t radix_bits(float key) {
+    uint32_t bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+}
+
+template<typename K>
+uint32_t radix_digit(K key, uint64_t shift) {
+    return uint32_t(radix_bits(key) >> shift) & (radix_size - 1);
+}
+
+// Digit counts of one block per threadgroup
+template<typename K>
+void radix_histogram(const std::byte *arguments, const ThreadgroupContext &context) {
+    RadixArguments<K> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    const size_t blocks = context.threadgroups_per_grid.x;
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+
+    uint32_t counts[radix_size] = {};
+    for (size_t i = begin; i < end; i++) {
+        counts[radix_digit(args.keys_in[i], args.shift)]++;
+    }
+    for (uint32_t digit = 0; digit < radix_size; digit++) {
+        args.block_offsets[digit * blocks + block] = counts[digit];
+    }
+}
+
+// The keys of a block in order, each after the ones of the previous digits and blocks
+template<typename K>
+void radix_scatter(const std::byte *arguments, const ThreadgroupContext &context) {
+    RadixArguments<K> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    const size_t blocks = context.threadgroups_per_grid.x;
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+
+    uint32_t next_offset[radix_size];
+    for (uint32_t digit = 0; digit < radix_size; digit++) {
+        next_offset[digit] = args.block_offsets[digit * blocks + block];
+    }
+    if (args.values_in) {
+        for (size_t i = begin; i < end; i++) {
+            const auto destination = next_offset[radix_digit(args.keys_in[i], args.shift)]++;
+            args.keys_out[destination] = args.keys_in[i];
+            args.values_out[destination] = args.values_in[i];
+        }
+    } else {
+        for (size_t i = begin; i < end; i++) {
+            args.keys_out[next_offset[radix_digit(args.keys_in[i], args.shift)]++] = args.keys_in[i];
+        }
+    }
+}
+}// namespace
+
+#define REGISTER_RADIX_SORT(tname, type)                                        \
+    REGISTER_HOST_KERNEL("radix_histogram_" tname, (radix_histogram<type>)); \
+    REGISTER_HOST_KERNEL("radix_scatter_" tname, (radix_scatter<type>))
+
+REGISTER_RADIX_SORT("uint32", uint32_t);
+REGISTER_RADIX_SORT("uint64", uint64_t);
+REGISTER_RADIX_SORT("int32", int32_t);
+REGISTER_RADIX_SORT("float32", float);
+
+}// namespace vox
@@ -0,0 +1,221 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include "host/host_kernel.h"
+#include "reduce_ops.h"
+
+namespace vox {
+namespace {
+using namespace host;
+
+// Independent accumulators the compiler can keep in one vector register
+constexpr size_t lanes = 8;
+
+// same layout as shader/builtin/reduce.metal
+template<typename T>
+struct InitReduceArguments {
+    T *out;
+};
+
+template<typename T>
+struct alignas(8) AllReduceArguments {
+    const T *in;
+    T *out;
+    uint64_t in_size;
+};
+
+// Input viewed as [out_size / reduction_stride, reduction_size, reduction_stride]
+template<typename T>
+struct alignas(8) StridedReduceArguments {
+    const T *in;
+    T *out;
+    uint64_t out_size;
+    uint64_t reduction_size;
+    uint64_t reduction_stride;
+};
+
+constexpr int max_reduce_dims = 8;
+
+template<typename T>
+struct alignas(8) GeneralReduceArguments {
+    const T *in;
+    T *out;
+    uint64_t out_size;
+    uint64_t reduction_size;
+    int32_t out_ndim;
+    int32_t reduce_ndim;
+    int32_t out_shape[max_reduce_dims];
+    int32_t reduce_shape[max_reduce_dims];
+    int64_t out_strides[max_reduce_dims];
+    int64_t reduce_strides[max_reduce_dims];
+};
+
+// Reduce n contiguous elements with one accumulator per lane
+template<typename U, typename Op, typename T>
+U reduce_contiguous(const T *in, size_t n) {
+    Op op;
+    U partial[lanes];
+    std::fill_n(partial, lanes, Op::template init<U>());
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        for (size_t lane = 0; lane < lanes; lane++) {
+            partial[lane] = op(partial[lane], U(in[i + lane]));
+        }
+    }
+    for (; i < n; i++) {
+        partial[0] = op(partial[0], U(in[i]));
+    }
+
+    U total = partial[0];
+    for (size_t lane = 1; lane < lanes; lane++) {
+        total = op(total, partial[lane]);
+    }
+    return total;
+}
+
+template<typename T, typename Op>
+void init_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    InitReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        args.out[tpig.x] = T(Op::template init<accumulator_t<T>>());
+    });
+}
+
+// Every threadgroup reduces one contiguous chunk and writes its partial result at its index
+template<typename T, typename Op>
+void all_reduce_no_atomics(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    AllReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t groups = context.threadgroups_per_grid.x;
+    const size_t group = context.threadgroup_position_in_grid.x;
+    const size_t chunk = (args.in_size + groups - 1) / groups;
+    const size_t begin = std::min<size_t>(group * chunk, args.in_size);
+    const size_t end = std::min<size_t>(begin + chunk, args.in_size);
+
+    U total = reduce_contiguous<U, Op>(args.in + begin, end - begin);
+    args.out[group] = T(total);
+}
+
+// One threadgroup per output row
+template<typename T, typename Op>
+void row_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    StridedReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t row = context.threadgroup_position_in_grid.x;
+    args.out[row] = T(reduce_contiguous<U, Op>(args.in + row * args.reduction_size, args.reduction_size));
+}
+
+// The threads of a group are neighbouring columns, accumulated together one input row at a time
+template<typename T, typename Op>
+void col_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    StridedReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    constexpr size_t max_columns = 1024;
+    const size_t stride = args.reduction_stride;
+    const size_t group_size = context.threads_per_threadgroup.x;
+    const size_t begin = size_t(context.threadgroup_position_in_grid.x) * group_size;
+    const size_t end = std::min<size_t>(begin + group_size, args.out_size);
+
+    Op op;
+    U partial[max_columns];
+    // Split the range of the group where it crosses into the next outer index
+    for (size_t first = begin; first < end;) {
+        const size_t outer = first / stride;
+        const size_t last = std::min(end, (outer + 1) * stride);
+        const size_t count = last - first;
+        const T *in = args.in + outer * args.reduction_size * stride + first % stride;
+
+        std::fill_n(partial, count, Op::template init<U>());
+        for (size_t i = 0; i < args.reduction_size; i++) {
+            const T *row = in + i * stride;
+            for (size_t column = 0; column < count; column++) {
+                partial[column] = op(partial[column], U(row[column]));
+            }
+        }
+        for (size_t column = 0; column < count; column++) {
+            args.out[first + column] = T(partial[column]);
+        }
+        first = last;
+    }
+}
+
+template<typename T, typename Op>
+void general_reduce(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    GeneralReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    Op op;
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        int64_t base = 0;
+        size_t index = tpig.x;
+        for (int d = args.out_ndim - 1; d >= 0; d--) {
+            base += int64_t(index % args.out_shape[d]) * args.out_strides[d];
+            index /= args.out_shape[d];
+        }
+
+        // The innermost reduced dimension is walked directly, the others through the index
+        const int inner_dim = args.reduce_ndim - 1;
+        const size_t inner_size = args.reduce_shape[inner_dim];
+        const int64_t inner_stride = args.reduce_strides[inner_dim];
+        U total = Op::template init<U>();
+        for (size_t r = 0; r < args.reduction_size; r += inner_size) {
+            int64_t offset = base;
+            size_t reduce_index = r / inner_size;
+            for (int d = inner_dim - 1; d >= 0; d--) {
+                offset += int64_t(reduce_index % args.reduce_shape[d]) * args.reduce_strides[d];
+                reduce_index /= args.reduce_shape[d];
+            }
+            const T *in = args.in + offset;
+            if (inner_stride == 1) {
+                total = op(total, reduce_contiguous<U, Op>(in, inner_size));
+            } else {
+                for (size_t i = 0; i < inner_size; i++) {
+                    total = op(total, U(in[int64_t(i) * inner_stride]));
+                }
+            }
+        }
+        args.out[tpig.x] = T(total);
+    });
+}
+}// namespace
+
+#define REGISTER_REDUCE(name, tname, type, op)                                                    \
+    REGISTER_HOST_KERNEL("i" name tname, (init_reduce<type, op>));                                \
+    REGISTER_HOST_KERNEL("all_reduce_no_atomics_" name tname, (all_reduce_no_atomics<type, op>)); \
+    REGISTER_HOST_KERNEL("row_reduce_" name tname, (row_reduce<type, op>));                       \
+    REGISTER_HOST_KERNEL("col_reduce_" name tname, (col_reduce<type, op>));                       \
+    REGISTER_HOST_KERNEL("general_reduce_" name tname, (general_reduce<type, op>))
+
+#define REGISTER_REDUCE_OPS(tname, type)         \
+    REGISTER_REDUCE("sum", tname, type, Sum);    \
+    REGISTER_REDUCE("prod", tname, type, Prod);  \
+    REGISTER_REDUCE("min_", tname, type, Min);   \
+    REGISTER_REDUCE("max_", tname, type, Max);   \
+    REGISTER_REDUCE("and", tname, type, And);    \
+    REGISTER_REDUCE("or", tname, type, Or)
+
+REGISTER_REDUCE_OPS("uint8", uint8_t);
+REGISTER_REDUCE_OPS("uint16", uint16_t);
+REGISTER_REDUCE_OPS("uint32", uint32_t);
+REGISTER_REDUCE_OPS("uint64", uint64_t);
+REGISTER_REDUCE_OPS("int8", int8_t);
+REGISTER_REDUCE_OPS("int16", int16_t);
+REGISTER_REDUCE_OPS("int32", int32_t);
+REGISTER_REDUCE_OPS("int64", int64_t);
+REGISTER_REDUCE_OPS("float16", float16_t);
+REGISTER_REDUCE_OPS("float32", float);
+
+}// namespace vox
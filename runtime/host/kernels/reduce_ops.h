@@ -0,0 +1,82 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <limits>
+#include <type_traits>
+#include "types/half_types.h"
+
+// Host counterparts of the operators in shader/builtin/reduce.h
+namespace vox {
+namespace host {
+// half is accumulated in float, the sum of many halves overflows quickly
+template<typename T>
+using accumulator_t = std::conditional_t<std::is_same_v<T, float16_t>, float, T>;
+
+template<typename U>
+constexpr U lowest() {
+    if constexpr (std::numeric_limits<U>::has_infinity) {
+        return -std::numeric_limits<U>::infinity();
+    } else {
+        return std::numeric_limits<U>::lowest();
+    }
+}
+
+template<typename U>
+constexpr U highest() {
+    if constexpr (std::numeric_limits<U>::has_infinity) {
+        return std::numeric_limits<U>::infinity();
+    } else {
+        return std::numeric_limits<U>::max();
+    }
+}
+
+struct Sum {
+    template<typename U>
+    static constexpr U init() { return U(0); }
+    template<typename U>
+    U operator()(U a, U b) const { return a + b; }
+};
+
+struct Prod {
+    template<typename U>
+    static constexpr U init() { return U(1); }
+    template<typename U>
+    U operator()(U a, U b) const { return a * b; }
+};
+
+struct Min {
+    template<typename U>
+    static constexpr U init() { return highest<U>(); }
+    template<typename U>
+    U operator()(U a, U b) const { return a < b ? a : b; }
+};
+
+struct Max {
+    template<typename U>
+    static constexpr U init() { return lowest<U>(); }
+    template<typename U>
+    U operator()(U a, U b) const { return a > b ? a : b; }
+};
+
+// Non zero values are true, the result is 0 or 1 like the Metal kernels
+struct And {
+    template<typename U>
+    static constexpr U init() { return U(1); }
+    template<typename U>
+    U operator()(U a, U b) const { return U(a != U(0) && b != U(0)); }
+};
+
+struct Or {
+    template<typename U>
+    static constexpr U init() { return U(0); }
+    template<typename U>
+    U operator()(U a, U b) const { return U(a != U(0) || b != U(0)); }
+};
+
+}// namespace host
+}// namespace vox
@@ -0,0 +1,122 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include "host/host_kernel.h"
+#include "reduce_ops.h"
+
+namespace vox {
+namespace {
+using namespace host;
+
+// same layout as the two level arguments of runtime/primitives/scan.cpp
+template<typename T>
+struct alignas(8) ScanArguments {
+    const T *in;
+    // Non zero where a segment starts, nullptr for a single segment
+    const uint8_t *flags;
+    T *out;
+    // Total and segment flag of every chunk
+    T *partials;
+    uint32_t *partial_flags;
+    uint64_t size;
+    uint64_t chunk_size;
+    uint64_t inclusive;
+};
+
+// First pass, one threadgroup per chunk
+template<typename T, typename Op>
+void scan_partials(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    ScanArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t chunk = context.threadgroup_position_in_grid.x;
+    const size_t begin = chunk * args.chunk_size;
+    const size_t end = std::min<size_t>(begin + args.chunk_size, args.size);
+
+    Op op;
+    U total = Op::template init<U>();
+    size_t first = begin;
+    uint32_t flag = 0;
+    if (args.flags) {
+        // Only the elements after the last segment start reach the next chunk
+        for (size_t i = end; i > begin; i--) {
+            if (args.flags[i - 1]) {
+                first = i - 1;
+                flag = 1;
+                break;
+            }
+        }
+    }
+    for (size_t i = first; i < end; i++) {
+        total = op(total, U(args.in[i]));
+    }
+    args.partials[chunk] = T(total);
+    args.partial_flags[chunk] = flag;
+}
+
+// Second pass, every chunk combines the partials before it then scans its elements
+template<typename T, typename Op>
+void scan_chunks(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    ScanArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t chunk = context.threadgroup_position_in_grid.x;
+    const size_t begin = chunk * args.chunk_size;
+    const size_t end = std::min<size_t>(begin + args.chunk_size, args.size);
+
+    Op op;
+    // Walk back until a chunk starts a segment, its partial only covers that segment
+    size_t previous = chunk;
+    while (previous > 0 && !args.partial_flags[previous - 1]) {
+        previous--;
+    }
+    U running = Op::template init<U>();
+    for (size_t i = previous > 0 ? previous - 1 : 0; i < chunk; i++) {
+        running = op(running, U(args.partials[i]));
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        if (args.flags && args.flags[i]) {
+            running = Op::template init<U>();
+        }
+        const U value = U(args.in[i]);
+        if (args.inclusive) {
+            running = op(running, value);
+            args.out[i] = T(running);
+        } else {
+            args.out[i] = T(running);
+            running = op(running, value);
+        }
+    }
+}
+}// namespace
+
+#define REGISTER_SCAN(name, tname, type, op)                                        \
+    REGISTER_HOST_KERNEL("scan_partials_" name tname, (scan_partials<type, op>)); \
+    REGISTER_HOST_KERNEL("scan_chunks_" name tname, (scan_chunks<type, op>))
+
+#define REGISTER_SCAN_OPS(tname, type)         \
+    REGISTER_SCAN("sum", tname, type, Sum);    \
+    REGISTER_SCAN("prod", tname, type, Prod);  \
+    REGISTER_SCAN("min_", tname, type, Min);   \
+    REGISTER_SCAN("max_", tname, type, Max)
+
+REGISTER_SCAN_OPS("uint8", uint8_t);
+REGISTER_SCAN_OPS("uint16", uint16_t);
+REGISTER_SCAN_OPS("uint32", uint32_t);
+REGISTER_SCAN_OPS("uint64", uint64_t);
+REGISTER_SCAN_OPS("int8", int8_t);
+REGISTER_SCAN_OPS("int16", int16_t);
+REGISTER_SCAN_OPS("int32", int32_t);
+REGISTER_SCAN_OPS("int64", int64_t);
+REGISTER_SCAN_OPS("float16", float16_t);
+REGISTER_SCAN_OPS("float32", float);
+
+}// namespace vox
@@ -0,0 +1,189 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cstring>
+#include "host/host_kernel.h"
+#include "reduce_ops.h"
+
+namespace vox {
+namespace {
+using namespace host;
+
+// same layout as shader/builtin/segmented_reduce.metal
+template<typename T>
+struct alignas(8) SegmentedReduceArguments {
+    const T *in;
+    const uint32_t *offsets;
+    T *out;
+    T *leading;
+    const uint32_t *segment_count;
+    uint64_t size;
+    uint64_t num_segments;
+    uint64_t tile_size;
+};
+
+template<typename K>
+struct alignas(8) ReduceByKeyArguments {
+    const K *keys;
+    K *keys_out;
+    uint32_t *offsets;
+    uint32_t *count;
+    uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+};
+
+template<typename T>
+size_t segment_count(const SegmentedReduceArguments<T> &args) {
+    return args.segment_count ? *args.segment_count : args.num_segments;
+}
+
+// One threadgroup per tile, walks the segments overlapping it. The segments starting in the tile are
+// written to out, the one which started before it to leading.
+template<typename T, typename Op>
+void segmented_reduce_tiles(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    SegmentedReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t tile = context.threadgroup_position_in_grid.x;
+    const size_t tile_begin = tile * args.tile_size;
+    const size_t tile_end = std::min<size_t>(tile_begin + args.tile_size, args.size);
+    const size_t segments = segment_count(args);
+    if (segments == 0) {
+        return;
+    }
+
+    // Last segment starting at or before the tile, the first one if none does
+    const uint32_t *first = std::upper_bound(args.offsets, args.offsets + segments, uint32_t(tile_begin));
+    Op op;
+    size_t index = tile_begin;
+    for (size_t s = first == args.offsets ? 0 : first - args.offsets - 1; s < segments; s++) {
+        const size_t begin = args.offsets[s];
+        index = std::max(index, begin);
+        if (index >= tile_end) {
+            break;
+        }
+        const size_t end = std::min<size_t>(args.offsets[s + 1], tile_end);
+        if (index >= end) {
+            continue;
+        }
+        U total = Op::template init<U>();
+        for (; index < end; index++) {
+            total = op(total, U(args.in[index]));
+        }
+        if (begin >= tile_begin) {
+            args.out[s] = T(total);
+        } else {
+            args.leading[tile] = T(total);
+        }
+    }
+}
+
+// Adds the leading reductions of the tiles every segment spans after its first one
+template<typename T, typename Op>
+void segmented_reduce_fixup(const std::byte *arguments, const ThreadgroupContext &context) {
+    using U = accumulator_t<T>;
+    SegmentedReduceArguments<T> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t segments = segment_count(args);
+    Op op;
+    context.for_each_thread([&](Size3 tpig, Size3) {
+        const size_t s = tpig.x;
+        if (s >= segments) {
+            return;
+        }
+        const size_t begin = args.offsets[s];
+        const size_t end = args.offsets[s + 1];
+        if (begin >= end) {
+            args.out[s] = T(Op::template init<U>());
+            return;
+        }
+        U total = U(args.out[s]);
+        for (size_t tile = begin / args.tile_size + 1; tile <= (end - 1) / args.tile_size; tile++) {
+            total = op(total, U(args.leading[tile]));
+        }
+        args.out[s] = T(total);
+    });
+}
+
+// Runs starting in one block per threadgroup
+template<typename K>
+void reduce_by_key_count(const std::byte *arguments, const ThreadgroupContext &context) {
+    ReduceByKeyArguments<K> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+    uint32_t count = begin == 0 && end > 0 ? 1 : 0;
+    for (size_t i = std::max<size_t>(begin, 1); i < end; i++) {
+        count += args.keys[i] != args.keys[i - 1] ? 1 : 0;
+    }
+    args.block_offsets[block] = count;
+    if (block == 0) {
+        args.block_offsets[context.threadgroups_per_grid.x] = 0;
+    }
+}
+
+// Key and first element of the runs of a block, after the ones of the previous blocks
+template<typename K>
+void reduce_by_key_scatter(const std::byte *arguments, const ThreadgroupContext &context) {
+    ReduceByKeyArguments<K> args{};
+    std::memcpy(&args, arguments, sizeof(args));
+
+    const size_t block = context.threadgroup_position_in_grid.x;
+    if (block == 0) {
+        const uint32_t runs = args.block_offsets[context.threadgroups_per_grid.x];
+        *args.count = runs;
+        args.offsets[runs] = uint32_t(args.size);
+    }
+    const size_t begin = block * args.block_size;
+    const size_t end = std::min<size_t>(begin + args.block_size, args.size);
+    size_t run = args.block_offsets[block];
+    for (size_t i = begin; i < end; i++) {
+        if (i == 0 || args.keys[i] != args.keys[i - 1]) {
+            args.keys_out[run] = args.keys[i];
+            args.offsets[run] = uint32_t(i);
+            run++;
+        }
+    }
+}
+}// namespace
+
+#define REGISTER_SEGMENTED_REDUCE(name, tname, type, op)                                           \
+    REGISTER_HOST_KERNEL("segmented_reduce_tiles_" name tname, (segmented_reduce_tiles<type, op>)); \
+    REGISTER_HOST_KERNEL("segmented_reduce_fixup_" name tname, (segmented_reduce_fixup<type, op>))
+
+#define REGISTER_SEGMENTED_REDUCE_OPS(tname, type)         \
+    REGISTER_SEGMENTED_REDUCE("sum", tname, type, Sum);    \
+    REGISTER_SEGMENTED_REDUCE("prod", tname, type, Prod);  \
+    REGISTER_SEGMENTED_REDUCE("min_", tname, type, Min);   \
+    REGISTER_SEGMENTED_REDUCE("max_", tname, type, Max)
+
+REGISTER_SEGMENTED_REDUCE_OPS("uint8", uint8_t);
+REGISTER_SEGMENTED_REDUCE_OPS("uint16", uint16_t);
+REGISTER_SEGMENTED_REDUCE_OPS("uint32", uint32_t);
+REGISTER_SEGMENTED_REDUCE_OPS("uint64", uint64_t);
+REGISTER_SEGMENTED_REDUCE_OPS("int8", int8_t);
+REGISTER_SEGMENTED_REDUCE_OPS("int16", int16_t);
+REGISTER_SEGMENTED_REDUCE_OPS("int32", int32_t);
+REGISTER_SEGMENTED_REDUCE_OPS("int64", int64_t);
+REGISTER_SEGMENTED_REDUCE_OPS("float16", float16_t);
+REGISTER_SEGMENTED_REDUCE_OPS("float32", float);
+
+#define REGISTER_REDUCE_BY_KEY(tname, type)                                            \
+    REGISTER_HOST_KERNEL("reduce_by_key_count_" tname, reduce_by_key_count<type>); \
+    REGISTER_HOST_KERNEL("reduce_by_key_scatter_" tname, reduce_by_key_scatter<type>)
+
+REGISTER_REDUCE_BY_KEY("uint32", uint32_t);
+REGISTER_REDUCE_BY_KEY("uint64", uint64_t);
+REGISTER_REDUCE_BY_KEY("int32", int32_t);
+REGISTER_REDUCE_BY_KEY("int64", int64_t);
+
+}// namespace vox
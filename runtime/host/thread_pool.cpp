@@ -0,0 +1,183 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "thread_pool.h"
+#include <algorithm>
+#include <exception>
+
+namespace vox {
+namespace {
+thread_local const ThreadPool *t_worker_pool = nullptr;
+thread_local uint32_t t_worker_index = 0;
+}// namespace
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _queues.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        _queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+
+    _threads.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        _threads.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        const std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _work_cv.notify_all();
+    for (auto &thread : _threads) {
+        thread.join();
+    }
+}
+
+uint32_t ThreadPool::local_queue_index() {
+    if (t_worker_pool == this) {
+        return t_worker_index;
+    }
+    return _next_queue.fetch_add(1, std::memory_order_relaxed) % size();
+}
+
+void ThreadPool::submit(Task task) {
+    auto &queue = *_queues[local_queue_index()];
+    _pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        const std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.push_back(std::move(task));
+    }
+    _queued.fetch_add(1, std::memory_order_release);
+
+    // Pairs with the predicate check in run() so that the wake-up can't be lost
+    { const std::lock_guard<std::mutex> lock(_mtx); }
+    _work_cv.notify_one();
+}
+
+bool ThreadPool::try_pop(uint32_t index, Task &task) {
+    // Own queue, newest first for cache locality
+    {
+        auto &queue = *_queues[index];
+        const std::lock_guard<std::mutex> lock(queue.mtx);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task of another worker
+    for (uint32_t i = 1; i < size(); ++i) {
+        auto &victim = *_queues[(index + i) % size()];
+        const std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task &task) {
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    task = nullptr;
+
+    if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        { const std::lock_guard<std::mutex> lock(_mtx); }
+        _idle_cv.notify_all();
+    }
+}
+
+void ThreadPool::run(uint32_t index) {
+    t_worker_pool = this;
+    t_worker_index = index;
+
+    Task task;
+    while (true) {
+        if (try_pop(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mtx);
+        _work_cv.wait(lock, [this] {
+            return _stop || _queued.load(std::memory_order_acquire) > 0;
+        });
+        if (_stop && _queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &task) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        task(0);
+        return;
+    }
+
+    // Lives on the stack of the caller, the tasks notify under the lock so it can't be gone before they return
+    struct State {
+        std::mutex mtx;
+        std::condition_variable done;
+        size_t remaining;
+        std::exception_ptr error;
+    } state;
+    state.remaining = count;
+
+    for (size_t i = 0; i < count; ++i) {
+        submit([&task, &state, i] {
+            std::exception_ptr error;
+            try {
+                task(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            const std::lock_guard<std::mutex> lock(state.mtx);
+            if (error && !state.error) {
+                state.error = error;
+            }
+            if (--state.remaining == 0) {
+                state.done.notify_all();
+            }
+        });
+    }
+
+    // Help with the work, then block until the tasks taken by the other threads finished
+    auto index = t_worker_pool == this ? t_worker_index : 0u;
+    Task local;
+    while (try_pop(index, local)) {
+        execute(local);
+    }
+    {
+        std::unique_lock<std::mutex> lock(state.mtx);
+        state.done.wait(lock, [&state] { return state.remaining == 0; });
+    }
+
+    // The first exception thrown by a task, the others ran to completion
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _idle_cv.wait(lock, [this] {
+        return _pending.load(std::memory_order_acquire) == 0;
+    });
+}
+
+}// namespace vox
@@ -0,0 +1,80 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vox {
+/**
+ * @brief Work-stealing thread pool.
+ *
+ * Every worker owns a deque, tasks submitted from a worker go to its own deque and
+ * are popped LIFO, idle workers steal FIFO from the others.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// num_threads == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(uint32_t num_threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] uint32_t size() const {
+        return static_cast<uint32_t>(_threads.size());
+    }
+
+    void submit(Task task);
+
+    /// Run task(i) for every i in [0, count) and return when all of them finished.
+    /// The calling thread executes tasks while it waits. If tasks throw, the first exception is rethrown
+    /// once all of them finished.
+    void parallel_for(size_t count, const std::function<void(size_t)> &task);
+
+    /// Block until every submitted task has finished.
+    void wait();
+
+private:
+    struct WorkQueue {
+        std::deque<Task> tasks;
+        std::mutex mtx;
+    };
+
+    bool try_pop(uint32_t index, Task &task);
+
+    void execute(Task &task);
+
+    void run(uint32_t index);
+
+    // index of the deque owned by the calling thread, or a round-robin one for external threads
+    uint32_t local_queue_index();
+
+private:
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
+    std::vector<std::thread> _threads;
+
+    std::atomic<size_t> _queued{0};
+    std::atomic<size_t> _pending{0};
+    std::atomic<uint32_t> _next_queue{0};
+
+    std::mutex _mtx;
+    std::condition_variable _work_cv;
+    std::condition_variable _idle_cv;
+    bool _stop{false};
+};
+
+}// namespace vox
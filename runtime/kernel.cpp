@@ -4,6 +4,7 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <cstring>
 #include "kernel.h"
 #include "helpers.h"
 #include "stream.h"
@@ -28,38 +29,51 @@ Kernel::Builder &Kernel::Builder::hash_name(std::string name) {
     _hash_name = std::move(name);
     return *this;
 }
-Kernel::Builder &Kernel::Builder::func_consts(MTLFCList consts) {
+Kernel::Builder &Kernel::Builder::func_consts(FunctionConstantList consts) {
     _func_consts = std::move(consts);
     return *this;
 }
-Kernel::Builder &Kernel::Builder::linked_functions(std::vector<MTL::Function *> functions) {
+Kernel::Builder &Kernel::Builder::linked_functions(std::vector<std::string> functions) {
     _linked_functions = std::move(functions);
     return *this;
 }
 
 Kernel Kernel::Builder::build() const {
     if (!_source.empty()) {
-        device().get_library(_lib_name, _source);
+        device().register_source(_lib_name, _source);
     }
 
     auto pso = device().get_kernel(_base_name, _lib_name, _hash_name, _func_consts, _linked_functions);
     return Kernel(pso);
 }
 
-Kernel::Kernel(MTL::ComputePipelineState *pso) : _pso{pso} {}
+Kernel::Kernel(Pipeline *pso) : _pso{pso} {}
 
 void Kernel::operator()(const std::vector<Argument> &args,
                         uint32_t stream) {
-    static constexpr auto argument_buffer_size = 65536u;
-    static constexpr auto argument_alignment = 8u;
-    static thread_local std::array<std::byte, argument_buffer_size> argument_buffer;
+    // size of the argument bytes, to take them from the argument ring at once
+    auto size = static_cast<size_t>(0u);
+    for (const Argument &arg : args) {
+        std::visit(
+            [&](auto &&arg) {
+                using T = std::decay_t<decltype(arg)>;
+                if constexpr (std::is_same_v<T, UniformArgument>) {
+                    size = align(size, detail::argument_alignment) + arg.size();
+                } else if constexpr (std::is_same_v<T, ArrayArgument>) {
+                    size = align(size, detail::argument_alignment) + sizeof(uint64_t);
+                }
+            },
+            arg);
+    }
+
+    auto &s = device().stream(stream);
+    auto arguments = s.argument_ring().allocate(size);
 
     // encode arguments
     auto argument_offset = static_cast<size_t>(0u);
-    auto copy = [&argument_offset](const void *ptr, size_t size) mutable noexcept {
-        argument_offset = align(argument_offset, argument_alignment);
-        assert(argument_offset + size <= argument_buffer_size);
-        std::memcpy(argument_buffer.data() + argument_offset, ptr, size);
+    auto copy = [&](const void *ptr, size_t size) mutable noexcept {
+        argument_offset = align(argument_offset, detail::argument_alignment);
+        std::memcpy(arguments.data + argument_offset, ptr, size);
         return argument_offset += size;
     };
 
@@ -70,53 +84,80 @@ void Kernel::operator()(const std::vector<Argument> &args,
                 if constexpr (std::is_same_v<T, UniformArgument>) {
                     copy(arg.data(), arg.size());
                 } else if constexpr (std::is_same_v<T, ArrayArgument>) {
-                    auto binding = arg.buffer().address();
+                    auto binding = arg.address();
                     copy(&binding, sizeof(binding));
                 }
             },
             arg);
     };
 
-    auto mark_usage = [&, index = 0u](MTL::ComputeCommandEncoder *compute_encoder, const Argument &arg) mutable noexcept {
+    auto mark_usage = [&](CommandEncoder *compute_encoder, const Argument &arg, size_t index) mutable noexcept {
         std::visit(
             [&](auto &&arg) {
                 using T = std::decay_t<decltype(arg)>;
                 if constexpr (std::is_same_v<T, UniformArgument>) {
                     return;
                 } else if constexpr (std::is_same_v<T, ArrayArgument>) {
-                    compute_encoder->useResource(arg.buffer().ptr(), MTL::ResourceUsageWrite | MTL::ResourceUsageRead);
+                    compute_encoder->use_resource(arg.buffer(), argument_usage(index));
+                    // Dropping the Array must not recycle the buffer while the kernel can still access it
+                    s.retain(arg.data_shared_ptr());
                 }
             },
             arg);
     };
 
-    auto &s = device().stream(stream);
-    auto encoder = s.get_command_encoder();
-    encoder->setComputePipelineState(_pso);
-    for (const Argument &arg : args) {
-        encode(arg);
-        mark_usage(encoder, arg);
+    auto encoder = s.encoder();
+    encoder->set_pipeline(_pso);
+    for (size_t index = 0; index < args.size(); index++) {
+        encode(args[index]);
+        mark_usage(encoder, args[index], index);
     }
-    encoder->setBytes(argument_buffer.data(), align(argument_offset, argument_alignment), 0u);
+    dispatch(s, encoder, arguments);
+}
+
+void Kernel::encode(Stream &s, CommandEncoder *encoder, std::byte *slot, const Array &array, ResourceUsage usage) {
+    const uint64_t binding = array.address();
+    std::memcpy(slot, &binding, sizeof(binding));
+    encoder->use_resource(array.buffer(), usage);
+    // Dropping the Array must not recycle the buffer while the kernel can still access it
+    s.retain(array.data_shared_ptr());
+}
+
+void Kernel::dispatch(Stream &s, CommandEncoder *encoder, const ArgumentRing::Allocation &arguments) {
+    for (const auto &array : _referenced_arrays) {
+        encoder->use_resource(array.buffer(), _referenced_usage);
+        s.retain(array.data_shared_ptr());
+    }
+    encoder->set_buffer(arguments.buffer, arguments.offset, arguments.size, 0u);
 
     std::visit(
         [&](auto &&arg) {
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, Array>) {
                 auto &indirect = arg;
-                encoder->dispatchThreadgroups(indirect.buffer().ptr(), 0, _threads_per_thread_group);
+                s.retain(indirect.data_shared_ptr());
+                encoder->dispatch_indirect(indirect.buffer(), indirect.offset(), _threads_per_thread_group);
             } else if constexpr (std::is_same_v<T, std::array<uint32_t, 3>>) {
                 auto &thread_groups = arg;
-                encoder->dispatchThreadgroups(MTL::Size{thread_groups[0], thread_groups[1], thread_groups[2]},
-                                              _threads_per_thread_group);
-            } else if constexpr (std::is_same_v<T, MTL::Size>) {
+                encoder->dispatch_thread_groups(Size3{thread_groups[0], thread_groups[1], thread_groups[2]},
+                                                _threads_per_thread_group);
+            } else if constexpr (std::is_same_v<T, Size3>) {
                 auto &threads = arg;
-                encoder->dispatchThreads(threads, _threads_per_thread_group);
+                encoder->dispatch_threads(threads, _threads_per_thread_group);
             }
         },
         _dispatch_threads);
 }
 
+void Kernel::set_argument_usage(std::vector<ResourceUsage> usage) {
+    _argument_usage = std::move(usage);
+}
+
+void Kernel::set_referenced_arrays(std::vector<Array> arrays, ResourceUsage usage) {
+    _referenced_arrays = std::move(arrays);
+    _referenced_usage = usage;
+}
+
 void Kernel::set_indirect_threads(const Array &array) {
     _dispatch_threads = array;
 }
@@ -126,19 +167,19 @@ void Kernel::set_thread_groups(uint32_t groups_x, uint32_t groups_y, uint32_t gr
 }
 
 void Kernel::set_threads(uint32_t threads_x, uint32_t threads_y, uint32_t threads_z) {
-    _dispatch_threads = MTL::Size{threads_x, threads_y, threads_z};
+    _dispatch_threads = Size3{threads_x, threads_y, threads_z};
 }
 
 std::uintptr_t Kernel::max_total_threads_per_threadgroup() const {
-    return _pso->maxTotalThreadsPerThreadgroup();
+    return _pso->max_total_threads_per_threadgroup();
 }
 
 void Kernel::set_threads_per_thread_group(uint32_t threads_per_thread_group_x,
                                           uint32_t threads_per_thread_group_y,
                                           uint32_t threads_per_thread_group_z) {
-    _threads_per_thread_group = MTL::Size{threads_per_thread_group_x,
-                                          threads_per_thread_group_y,
-                                          threads_per_thread_group_z};
+    _threads_per_thread_group = Size3{threads_per_thread_group_x,
+                                      threads_per_thread_group_y,
+                                      threads_per_thread_group_z};
 }
 
 }// namespace vox
\ No newline at end of file
@@ -6,11 +6,56 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
 #include "device.h"
 #include "argument.h"
 #include "array.h"
+#include "argument_ring.h"
+#include "stream.h"
+#include "common/helpers.h"
 
 namespace vox {
+namespace detail {
+// Every argument starts 8 bytes aligned in the argument buffer, like the members of the shader Arguments structs
+constexpr size_t argument_alignment = 8;
+
+// Arrays are bound by their device address
+template<typename T>
+constexpr size_t argument_size() {
+    if constexpr (std::is_same_v<T, Array>) {
+        return sizeof(uint64_t);
+    } else {
+        return sizeof(T);
+    }
+}
+
+// Types aligned beyond 8 bytes, like float4, keep their alignment as members of the shader structs
+template<typename T>
+constexpr size_t argument_align() {
+    if constexpr (std::is_same_v<T, Array>) {
+        return std::max(argument_alignment, alignof(uint64_t));
+    } else {
+        return std::max(argument_alignment, alignof(T));
+    }
+}
+
+// Offset of every argument, then the size of the bytes, padded to the largest alignment like a struct
+template<typename... Args>
+constexpr std::array<size_t, sizeof...(Args) + 1> argument_offsets() {
+    std::array<size_t, sizeof...(Args) + 1> offsets{};
+    size_t offset = 0;
+    size_t index = 0;
+    size_t alignment = argument_alignment;
+    ((offsets[index++] = align(offset, argument_align<Args>()), offset = offsets[index - 1] + argument_size<Args>(),
+      alignment = std::max(alignment, argument_align<Args>())),
+     ...);
+    offsets[index] = align(offset, alignment);
+    return offsets;
+}
+}// namespace detail
 
 class Kernel {
 public:
@@ -29,25 +74,87 @@ public:
                                       uint32_t threads_per_thread_group_y = 1,
                                       uint32_t threads_per_thread_group_z = 1);
 
+    /**
+     * @brief Access of the kernel to its Array arguments, by position in the argument list.
+     *
+     * Arrays without a usage are ReadWrite. A dispatch waits for the previous ones only when it reads
+     * an Array they write or writes one they access, so Read inputs let independent dispatches overlap.
+     * Ex. kernel.set_argument_usage({ResourceUsage::Read, ResourceUsage::Write});
+     */
+    void set_argument_usage(std::vector<ResourceUsage> usage);
+
+    /**
+     * @brief Arrays the kernel reaches through device addresses in its uniforms, like the buffers of a HashGrid.
+     *
+     * They order the dispatches with usage and are kept alive like the Array arguments.
+     */
+    void set_referenced_arrays(std::vector<Array> arrays, ResourceUsage usage = ResourceUsage::Read);
+
     void operator()(const std::vector<Argument> &args,
                     uint32_t stream = 0);
 
-private:
-    explicit Kernel(MTL::ComputePipelineState *pso);
-    MTL::ComputePipelineState *_pso;
+    /**
+     * @brief Same as operator() without building Arguments, the bytes are encoded in place in the argument ring.
+     *
+     * Arrays bind their device address, any other trivially copyable value is copied inline as a uniform.
+     * The offsets are computed at compile time.
+     * Ex. kernel.launch(stream, in, out, uint64_t(size));
+     */
+    template<typename... Args>
+    void launch(uint32_t stream, const Args &...args);
+
+protected:
+    explicit Kernel(Pipeline *pso);
+
+    [[nodiscard]] ResourceUsage argument_usage(size_t index) const {
+        return index < _argument_usage.size() ? _argument_usage[index] : ResourceUsage::ReadWrite;
+    }
+
+    // Binds the device address of array at slot and keeps its buffer alive
+    static void encode(Stream &s, CommandEncoder *encoder, std::byte *slot, const Array &array, ResourceUsage usage);
+
+    template<typename T>
+    static void encode(Stream &s, CommandEncoder *encoder, std::byte *slot, const T &uniform, ResourceUsage usage) {
+        std::memcpy(slot, &uniform, sizeof(T));
+    }
+
+    // Binds the argument bytes and dispatches with the current thread configuration
+    void dispatch(Stream &s, CommandEncoder *encoder, const ArgumentRing::Allocation &arguments);
+
+    Pipeline *_pso;
     // none, indirect, thread_groups_per_grid, threads_per_grid
-    std::variant<std::monostate, Array, std::array<uint32_t, 3>, MTL::Size> _dispatch_threads;
-    MTL::Size _threads_per_thread_group{1, 1, 1};
+    std::variant<std::monostate, Array, std::array<uint32_t, 3>, Size3> _dispatch_threads;
+    Size3 _threads_per_thread_group{1, 1, 1};
+    std::vector<ResourceUsage> _argument_usage;
+    std::vector<Array> _referenced_arrays;
+    ResourceUsage _referenced_usage{ResourceUsage::Read};
 };
 
+template<typename... Args>
+void Kernel::launch(uint32_t stream, const Args &...args) {
+    static_assert(((std::is_same_v<Args, Array> || std::is_trivially_copyable_v<Args>) && ...),
+                  "Kernel arguments are Arrays or trivially copyable uniforms");
+    static_assert(((detail::argument_align<Args>() <= ArgumentRing::alignment) && ...),
+                  "The argument ring aligns the arguments to 256 bytes");
+    static constexpr auto offsets = detail::argument_offsets<Args...>();
+
+    auto &s = device().stream(stream);
+    auto arguments = s.argument_ring().allocate(offsets.back());
+    auto encoder = s.encoder();
+    encoder->set_pipeline(_pso);
+    size_t index = 0;
+    ((encode(s, encoder, arguments.data + offsets[index], args, argument_usage(index)), index++), ...);
+    dispatch(s, encoder, arguments);
+}
+
 class Kernel::Builder {
 public:
     Kernel::Builder &source(std::string code);
     Kernel::Builder &entry(std::string entry);
     Kernel::Builder &lib_name(std::string name);
     Kernel::Builder &hash_name(std::string name);
-    Kernel::Builder &func_consts(MTLFCList consts);
-    Kernel::Builder &linked_functions(std::vector<MTL::Function *> functions);
+    Kernel::Builder &func_consts(FunctionConstantList consts);
+    Kernel::Builder &linked_functions(std::vector<std::string> functions);
 
     [[nodiscard]] Kernel build() const;
 
@@ -56,8 +163,8 @@ private:
     std::string _base_name;
     std::string _lib_name = "metal_kernel";
     std::string _hash_name;
-    MTLFCList _func_consts = {};
-    std::vector<MTL::Function *> _linked_functions = {};
+    FunctionConstantList _func_consts = {};
+    std::vector<std::string> _linked_functions = {};
 };
 
 }// namespace vox
\ No newline at end of file
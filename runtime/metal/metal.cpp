@@ -5,7 +5,7 @@
 //  property of any third parties.
 
 #include "metal.h"
-#include "device.h"
+#include <Metal/Metal.hpp>
 
 namespace vox {
 std::shared_ptr<void> new_scoped_memory_pool() {
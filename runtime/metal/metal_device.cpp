@@ -0,0 +1,450 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "metal_device.h"
+#include "metal_stream.h"
+#include "allocator.h"
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "metal.h"
+#include <dlfcn.h>
+#include <unistd.h>
+#include <filesystem>
+
+namespace vox {
+inline std::string get_colocated_mtllib_path(const std::string &lib_name) {
+    Dl_info info;
+    std::string mtllib_path;
+    std::string lib_ext = lib_name + ".metallib";
+
+    int success = dladdr((void *)get_colocated_mtllib_path, &info);
+    if (success) {
+        auto mtllib = std::filesystem::path(info.dli_fname).remove_filename() / lib_ext;
+        mtllib_path = mtllib.c_str();
+    }
+
+    return mtllib_path;
+}
+
+namespace {
+
+constexpr const char *default_mtllib_path = METAL_PATH;
+
+auto load_device() {
+    auto devices = MTL::CopyAllDevices();
+    auto device = static_cast<MTL::Device *>(devices->object(0));
+    if (!device) {
+        throw std::runtime_error("Failed to load device");
+    }
+    return device;
+}
+
+std::pair<MTL::Library *, NS::Error *> load_library_from_path(
+    MTL::Device *device,
+    const char *path) {
+    auto library = NS::String::string(path, NS::UTF8StringEncoding);
+    NS::Error *error;
+    auto lib = device->newLibrary(library, &error);
+
+    return std::make_pair(lib, error);
+}
+
+MTL::Library *load_library(
+    MTL::Device *device,
+    const std::string &lib_name = "metal_kernel",
+    const char *lib_path = default_mtllib_path) {
+    // Firstly, search for the metallib in the same path as this binary
+    std::string first_path = get_colocated_mtllib_path(lib_name);
+    if (!first_path.empty()) {
+        auto [lib, error] = load_library_from_path(device, first_path.c_str());
+        if (lib) {
+            return lib;
+        }
+    }
+
+    // Couldn't find it so let's load it from default_mtllib_path
+    {
+        auto [lib, error] = load_library_from_path(device, lib_path);
+        if (!lib) {
+            ERROR("{}", error->localizedDescription()->utf8String());
+        }
+        return lib;
+    }
+}
+
+}// namespace
+
+MetalDevice::MetalDevice()
+    : _device{load_device()} {
+    library_map_ = {{"metal_kernel", load_library(_device)}};
+}
+
+MetalDevice::~MetalDevice() {
+    // streams and pipelines hold objects created by the device
+    stream_map_.clear();
+    kernel_map_.clear();
+    for (auto &[_, lib] : library_map_) {
+        lib->release();
+    }
+    _device->release();
+}
+
+MTL::Device *MetalDevice::handle() {
+    return _device;
+}
+
+std::string MetalDevice::name() {
+    return _device->name()->utf8String();
+}
+
+MetalStream &MetalDevice::stream(uint32_t index) {
+    return static_cast<MetalStream &>(Device::stream(index));
+}
+
+std::unique_ptr<Stream> MetalDevice::new_stream(uint32_t index) {
+    return std::make_unique<MetalStream>(index, *this);
+}
+
+Buffer MetalDevice::new_buffer(size_t size) {
+    auto thread_pool = new_scoped_memory_pool();
+
+    // Dispatches are ordered by the barriers of MetalCommandEncoder, by a fence across encoders
+    size_t res_opt = MTL::ResourceStorageModeShared;
+    res_opt |= MTL::ResourceHazardTrackingModeUntracked;
+    auto buf = _device->newBuffer(size, res_opt);
+    if (!buf) {
+        return Buffer{nullptr};
+    }
+    return Buffer{buf, buf->contents(), buf->gpuAddress(), size};
+}
+
+Buffer MetalDevice::new_buffer_no_copy(void *ptr, size_t size) {
+    // newBufferWithBytesNoCopy maps whole VM pages
+    const auto page_size = static_cast<size_t>(getpagesize());
+    if (reinterpret_cast<uintptr_t>(ptr) % page_size != 0) {
+        return Buffer{nullptr};
+    }
+
+    auto thread_pool = new_scoped_memory_pool();
+
+    size_t res_opt = MTL::ResourceStorageModeShared;
+    res_opt |= MTL::ResourceHazardTrackingModeUntracked;
+    // No deallocator, the owner frees the memory once the buffer is released
+    auto buf = _device->newBuffer(ptr, align(size, page_size), res_opt, nullptr);
+    if (!buf) {
+        return Buffer{nullptr};
+    }
+    return Buffer{buf, buf->contents(), buf->gpuAddress(), size};
+}
+
+void MetalDevice::release_buffer(Buffer buffer) {
+    static_cast<MTL::Buffer *>(buffer.ptr())->release();
+}
+
+size_t MetalDevice::current_allocated_size() const {
+    return _device->currentAllocatedSize();
+}
+
+size_t MetalDevice::recommended_max_working_set_size() const {
+    return _device->recommendedMaxWorkingSetSize();
+}
+
+void MetalDevice::register_source(const std::string &lib_name, const std::string &source) {
+    get_library(lib_name, source);
+}
+
+std::unique_ptr<Pipeline> MetalDevice::new_kernel(const std::string &base_name,
+                                                  const std::string &lib_name,
+                                                  const std::string &kname,
+                                                  const FunctionConstantList &func_consts,
+                                                  const std::vector<std::string> &linked_functions) {
+    // Search for cached metal lib
+    MTL::Library *mtl_lib = get_library_cache_(lib_name);
+
+    MTLFCList mtl_func_consts;
+    mtl_func_consts.reserve(func_consts.size());
+    for (auto [value, type, index] : func_consts) {
+        mtl_func_consts.emplace_back(value, static_cast<MTL::DataType>(type), index);
+    }
+
+    std::vector<MTL::Function *> mtl_linked_functions;
+    mtl_linked_functions.reserve(linked_functions.size());
+    for (const auto &name : linked_functions) {
+        mtl_linked_functions.push_back(get_function_(name, mtl_lib));
+    }
+
+    auto kernel = new_kernel(base_name, mtl_lib, kname, mtl_func_consts, mtl_linked_functions);
+    for (auto function : mtl_linked_functions) {
+        function->release();
+    }
+    return kernel;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetalDevice::register_library(const std::string &lib_name,
+                              const std::string &lib_path) {
+    if (auto it = library_map_.find(lib_name); it == library_map_.end()) {
+        auto new_lib = load_library(_device, lib_name, lib_path.c_str());
+        library_map_.insert({lib_name, new_lib});
+    }
+}
+
+void MetalDevice::register_library(const std::string &lib_name,
+                              const std::function<std::string(const std::string &)> &lib_path_func) {
+    if (auto it = library_map_.find(lib_name); it == library_map_.end()) {
+        std::string new_lib_path = lib_path_func(lib_name);
+        auto new_lib = load_library(_device, lib_name, new_lib_path.c_str());
+        library_map_.insert({lib_name, new_lib});
+    }
+}
+
+MTL::Library *MetalDevice::get_library_cache_(const std::string &lib_name) {
+    // Search for cached metal lib
+    MTL::Library *mtl_lib;
+    if (auto it = library_map_.find(lib_name); it != library_map_.end()) {
+        mtl_lib = it->second;
+    } else {// Look for metallib alongside library
+        register_library(lib_name, get_colocated_mtllib_path);
+        mtl_lib = library_map_[lib_name];
+    }
+
+    return mtl_lib;
+}
+
+MTL::Function *MetalDevice::get_function_(const std::string &name,
+                                     MTL::Library *mtl_lib) {
+    // Pull kernel from library
+    auto ns_name = NS::String::string(name.c_str(), NS::ASCIIStringEncoding);
+    auto mtl_function = mtl_lib->newFunction(ns_name);
+
+    return mtl_function;
+}
+
+MTL::Function *MetalDevice::get_function_(const std::string &name,
+                                     const std::string &specialized_name,
+                                     const MTLFCList &func_consts,
+                                     MTL::Library *mtl_lib) {
+    if (func_consts.empty() && (specialized_name == name)) {
+        return get_function_(name, mtl_lib);
+    }
+
+    // Prepare function constants
+    auto mtl_func_consts = MTL::FunctionConstantValues::alloc()->init();
+
+    for (auto [value, type, index] : func_consts) {
+        mtl_func_consts->setConstantValue(value, type, index);
+    }
+
+    // Prepare function desc
+    auto desc = MTL::FunctionDescriptor::functionDescriptor();
+    desc->setName(NS::String::string(name.c_str(), NS::ASCIIStringEncoding));
+    desc->setSpecializedName(
+        NS::String::string(specialized_name.c_str(), NS::ASCIIStringEncoding));
+    desc->setConstantValues(mtl_func_consts);
+
+    // Pull kernel from library
+    NS::Error *error = nullptr;
+    auto mtl_function = mtl_lib->newFunction(desc, &error);
+
+    // Throw error if unable to build metal function
+    if (!mtl_function) {
+        ERROR("[metal::Device] Unable to load function {}", name);
+        ERROR("{}", error->localizedDescription()->utf8String());
+    }
+
+    mtl_func_consts->release();
+    desc->release();
+
+    return mtl_function;
+}
+
+MTL::Function *MetalDevice::get_function(const std::string &base_name,
+                                    MTL::Library *mtl_lib,
+                                    const std::string &specialized_name /* = "" */,
+                                    const MTLFCList &func_consts /* = {} */) {
+    return get_function_(base_name, specialized_name, func_consts, mtl_lib);
+}
+
+MTL::Function *MetalDevice::get_function(const std::string &base_name,
+                                    const std::string &lib_name /* = "mlx" */,
+                                    const std::string &specialized_name /*  = "" */,
+                                    const MTLFCList &func_consts /* = {} */) {
+    // Search for cached metal lib
+    MTL::Library *mtl_lib = get_library_cache_(lib_name);
+
+    return get_function(base_name, mtl_lib, specialized_name, func_consts);
+}
+
+MTL::LinkedFunctions *MetalDevice::get_linked_functions_(const std::vector<MTL::Function *> &funcs) {
+    if (funcs.empty()) {
+        return nullptr;
+    }
+
+    auto lfuncs = MTL::LinkedFunctions::linkedFunctions();
+
+    std::vector<NS::Object *> objs(funcs.size());
+    for (int i = 0; i < funcs.size(); i++) {
+        objs[i] = funcs[i];
+    }
+
+    NS::Array *funcs_arr = NS::Array::array(objs.data(), funcs.size());
+
+    lfuncs->setPrivateFunctions(funcs_arr);
+
+    return lfuncs;
+}
+
+MTL::ComputePipelineState *MetalDevice::get_kernel_(const std::string &name,
+                                               const MTL::Function *mtl_function) {
+    // Compile kernel to compute pipeline
+    NS::Error *error = nullptr;
+    MTL::ComputePipelineState *kernel;
+
+    if (mtl_function) {
+        kernel = _device->newComputePipelineState(mtl_function, &error);
+    }
+
+    // Throw error if unable to compile metal function
+    if (!mtl_function || !kernel) {
+        ERROR("[metal::Device] Unable to load kernel {}", name);
+        ERROR("{}", error->localizedDescription()->utf8String());
+    }
+
+    return kernel;
+}
+
+MTL::ComputePipelineState *MetalDevice::get_kernel_(const std::string &name,
+                                               const MTL::Function *mtl_function,
+                                               const MTL::LinkedFunctions *linked_functions) {
+    // Check inputs
+    if (!linked_functions) {
+        return get_kernel_(name, mtl_function);
+    }
+
+    if (!mtl_function) {
+        ERROR("[metal::Device] Unable to load kernel {}", name);
+    }
+
+    // Prepare compute pipeline state descriptor
+    auto desc = MTL::ComputePipelineDescriptor::alloc()->init();
+    desc->setComputeFunction(mtl_function);
+    desc->setLinkedFunctions(linked_functions);
+
+    // Compile kernel to compute pipeline
+    NS::Error *error = nullptr;
+    auto kernel = _device->newComputePipelineState(
+        desc, MTL::PipelineOptionNone, nullptr, &error);
+
+    // Throw error if unable to compile metal function
+    if (!kernel) {
+        ERROR("[metal::Device] Unable to load kernel {}", name);
+        ERROR("{}", error->localizedDescription()->utf8String());
+    }
+
+    return kernel;
+}
+
+std::unique_ptr<MetalPipeline> MetalDevice::new_kernel(const std::string &base_name,
+                                                       MTL::Library *mtl_lib,
+                                                       const std::string &kname,
+                                                       const MTLFCList &func_consts /* = {} */,
+                                                       const std::vector<MTL::Function *> &linked_functions /* = {} */) {
+    auto pool = new_scoped_memory_pool();
+
+    // Pull kernel from library
+    auto mtl_function = get_function_(base_name, kname, func_consts, mtl_lib);
+
+    // Compile kernel to compute pipeline
+    auto mtl_linked_funcs = get_linked_functions_(linked_functions);
+    auto kernel = get_kernel_(kname, mtl_function, mtl_linked_funcs);
+    mtl_function->release();
+    if (mtl_linked_funcs) {
+        mtl_linked_funcs->release();
+    }
+
+    return std::make_unique<MetalPipeline>(kernel);
+}
+
+MTL::Library *MetalDevice::get_library_(const std::string &source_string) {
+    auto pool = new_scoped_memory_pool();
+
+    auto ns_code =
+        NS::String::string(source_string.c_str(), NS::ASCIIStringEncoding);
+
+    NS::Error *error = nullptr;
+    auto mtl_lib = _device->newLibrary(ns_code, nullptr, &error);
+
+    // Throw error if unable to compile library
+    if (!mtl_lib) {
+        ERROR("[metal::Device] Unable to build metal library from source");
+        ERROR("{}", error->localizedDescription()->utf8String());
+    }
+
+    return mtl_lib;
+}
+
+MTL::Library *MetalDevice::get_library_(const MTL::StitchedLibraryDescriptor *desc) {
+    auto pool = new_scoped_memory_pool();
+
+    NS::Error *error = nullptr;
+    auto mtl_lib = _device->newLibrary(desc, &error);
+
+    // Throw error if unable to compile library
+    if (!mtl_lib) {
+        ERROR("[metal::Device] Unable to load build stitched metal library");
+        ERROR("{}", error->localizedDescription()->utf8String());
+    }
+
+    return mtl_lib;
+}
+
+MTL::Library *MetalDevice::get_library(const std::string &name,
+                                  const std::string &source,
+                                  bool cache /* = true */) {
+    if (cache) {
+        if (auto it = library_map_.find(name); it != library_map_.end()) {
+            return it->second;
+        }
+    }
+
+    auto mtl_lib = get_library_(source);
+
+    if (cache) {
+        library_map_.insert({name, mtl_lib});
+    }
+
+    return mtl_lib;
+}
+
+MTL::Library *MetalDevice::get_library(const std::string &name,
+                                  const MTL::StitchedLibraryDescriptor *desc,
+                                  bool cache /* = true */) {
+    if (cache) {
+        if (auto it = library_map_.find(name); it != library_map_.end()) {
+            return it->second;
+        }
+    }
+
+    auto mtl_lib = get_library_(desc);
+
+    if (cache) {
+        library_map_.insert({name, mtl_lib});
+    }
+
+    return mtl_lib;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MetalDevice &metal_device() {
+    static MetalDevice metal_device;
+    return metal_device;
+}
+
+MetalStream &metal_stream(uint32_t index) {
+    return metal_device().stream(index);
+}
+
+}// namespace vox
@@ -0,0 +1,150 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <functional>
+#include <string>
+#include "device.h"
+
+namespace vox {
+class MetalStream;
+
+using MTLFCList = std::vector<std::tuple<const void *, MTL::DataType, NS::UInteger>>;
+
+class MetalPipeline final : public Pipeline {
+public:
+    explicit MetalPipeline(MTL::ComputePipelineState *pso) : _pso{pso} {}
+
+    ~MetalPipeline() override;
+
+    [[nodiscard]] size_t max_total_threads_per_threadgroup() const override;
+
+    [[nodiscard]] MTL::ComputePipelineState *handle() const {
+        return _pso;
+    }
+
+private:
+    MTL::ComputePipelineState *_pso;
+};
+
+class MetalDevice final : public Device {
+public:
+    MetalDevice();
+
+    ~MetalDevice() override;
+
+    MTL::Device *handle();
+
+    std::string name() override;
+
+    MetalStream &stream(uint32_t index);
+
+public:
+    Buffer new_buffer(size_t size) override;
+
+    Buffer new_buffer_no_copy(void *ptr, size_t size) override;
+
+    void release_buffer(Buffer buffer) override;
+
+    [[nodiscard]] size_t current_allocated_size() const override;
+
+    [[nodiscard]] size_t recommended_max_working_set_size() const override;
+
+    [[nodiscard]] bool supports_atomics() const override {
+        return true;
+    }
+
+    void register_source(const std::string &lib_name, const std::string &source) override;
+
+protected:
+    std::unique_ptr<Stream> new_stream(uint32_t index) override;
+
+    std::unique_ptr<Pipeline> new_kernel(
+        const std::string &base_name,
+        const std::string &lib_name,
+        const std::string &kname,
+        const FunctionConstantList &func_consts,
+        const std::vector<std::string> &linked_functions) override;
+
+private:
+    void register_library(
+        const std::string &lib_name,
+        const std::string &lib_path);
+
+    void register_library(
+        const std::string &lib_name,
+        const std::function<std::string(const std::string &)> &lib_path_func);
+
+    MTL::Library *get_library_cache_(const std::string &name);
+
+private:
+    static MTL::Function *get_function_(const std::string &name, MTL::Library *mtl_lib);
+
+    static MTL::Function *get_function_(
+        const std::string &name,
+        const std::string &specialized_name,
+        const MTLFCList &func_consts,
+        MTL::Library *mtl_lib);
+
+    static MTL::Function *get_function(
+        const std::string &base_name,
+        MTL::Library *mtl_lib,
+        const std::string &specialized_name = "",
+        const MTLFCList &func_consts = {});
+
+    MTL::Function *get_function(
+        const std::string &base_name,
+        const std::string &lib_name = "metal_kernel",
+        const std::string &specialized_name = "",
+        const MTLFCList &func_consts = {});
+
+private:
+    static MTL::LinkedFunctions *get_linked_functions_(
+        const std::vector<MTL::Function *> &funcs);
+
+    MTL::ComputePipelineState *get_kernel_(
+        const std::string &name,
+        const MTL::Function *mtl_function);
+
+    MTL::ComputePipelineState *get_kernel_(
+        const std::string &name,
+        const MTL::Function *mtl_function,
+        const MTL::LinkedFunctions *linked_functions);
+
+    std::unique_ptr<MetalPipeline> new_kernel(
+        const std::string &base_name,
+        MTL::Library *mtl_lib,
+        const std::string &kname,
+        const MTLFCList &func_consts = {},
+        const std::vector<MTL::Function *> &linked_functions = {});
+
+private:
+    MTL::Library *get_library_(const std::string &source_string);
+
+    MTL::Library *get_library_(const MTL::StitchedLibraryDescriptor *desc);
+
+    MTL::Library *get_library(
+        const std::string &name,
+        const std::string &source_string,
+        bool cache = true);
+
+    MTL::Library *get_library(
+        const std::string &name,
+        const MTL::StitchedLibraryDescriptor *desc,
+        bool cache = true);
+
+private:
+    MTL::Device *_device{nullptr};
+    std::unordered_map<std::string, MTL::Library *> library_map_;
+};
+
+MetalDevice &metal_device();
+
+MetalStream &metal_stream(uint32_t index);
+
+}// namespace vox
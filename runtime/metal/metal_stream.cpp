@@ -0,0 +1,186 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "metal_stream.h"
+#include "metal_device.h"
+#include "allocator.h"
+#include "metal.h"
+#include "common/logging.h"
+
+namespace vox {
+namespace {
+MTL::Size to_mtl_size(Size3 size) {
+    return MTL::Size{size.x, size.y, size.z};
+}
+
+MTL::ResourceUsage to_mtl_usage(ResourceUsage usage) {
+    MTL::ResourceUsage result = 0;
+    if (static_cast<uint8_t>(usage) & static_cast<uint8_t>(ResourceUsage::Read)) {
+        result |= MTL::ResourceUsageRead;
+    }
+    if (static_cast<uint8_t>(usage) & static_cast<uint8_t>(ResourceUsage::Write)) {
+        result |= MTL::ResourceUsageWrite;
+    }
+    return result;
+}
+}// namespace
+
+void MetalCommandEncoder::set_pipeline(Pipeline *pipeline) {
+    _encoder->setComputePipelineState(static_cast<MetalPipeline *>(pipeline)->handle());
+}
+
+void MetalCommandEncoder::set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) {
+    _encoder->setBuffer(static_cast<const MTL::Buffer *>(buffer.ptr()), buffer.offset() + offset, index);
+}
+
+void MetalCommandEncoder::use_resource(const Buffer &buffer, ResourceUsage usage) {
+    _hazards.use(buffer, usage);
+    _encoder->useResource(static_cast<const MTL::Buffer *>(buffer.ptr()), to_mtl_usage(usage));
+}
+
+void MetalCommandEncoder::barrier_if_needed() {
+    if (_hazards.end_dispatch()) {
+        _encoder->memoryBarrier(MTL::BarrierScopeBuffers);
+    }
+}
+
+void MetalCommandEncoder::dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) {
+    barrier_if_needed();
+    _encoder->dispatchThreadgroups(to_mtl_size(thread_groups), to_mtl_size(threads_per_thread_group));
+}
+
+void MetalCommandEncoder::dispatch_threads(Size3 threads, Size3 threads_per_thread_group) {
+    barrier_if_needed();
+    _encoder->dispatchThreads(to_mtl_size(threads), to_mtl_size(threads_per_thread_group));
+}
+
+void MetalCommandEncoder::dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) {
+    _hazards.use(indirect, ResourceUsage::Read);
+    barrier_if_needed();
+    // sub-allocated buffers start at an offset of their slab
+    _encoder->dispatchThreadgroups(static_cast<const MTL::Buffer *>(indirect.ptr()), indirect.offset() + offset,
+                                   to_mtl_size(threads_per_thread_group));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MetalStream::MetalStream(uint32_t index, MetalDevice &device)
+    : Stream{index}, _argument_ring{device} {
+    // Multiple threads can ask the device for queues
+    // We lock this as a critical section for safety
+    const std::lock_guard<std::mutex> lock(mtx_);
+    _queue = device.handle()->newCommandQueue();
+    if (!_queue) {
+        throw std::runtime_error(
+            "[metal::Device] Failed to make new command queue.");
+    }
+    _fence = device.handle()->newFence();
+    _event = device.handle()->newEvent();
+}
+
+MetalStream::~MetalStream() {
+    synchronize(true);
+
+    auto pool = new_scoped_memory_pool();
+    _event->release();
+    _fence->release();
+    _queue->release();
+}
+
+MTL::CommandBuffer *MetalStream::get_command_buffer() {
+    if (!_command_buffer) {
+        _command_buffer = _queue->commandBuffer();
+
+        if (!_command_buffer) {
+            throw std::runtime_error(
+                "[metal::Device] Unable to create new command buffer");
+        }
+        // Kept until it retired, see retire_command_buffers
+        _command_buffer->retain();
+    }
+    return _command_buffer;
+}
+
+MetalCommandEncoder *MetalStream::get_command_encoder() {
+    if (!_encoder) {
+        auto cb = get_command_buffer();
+        _encoder = cb->computeCommandEncoder(MTL::DispatchTypeConcurrent);
+        _encoder->waitForFence(_fence);
+        _encoder_wrapper = std::make_unique<MetalCommandEncoder>(_encoder);
+    }
+    return _encoder_wrapper.get();
+}
+
+void MetalStream::end_encoding() {
+    if (_encoder) {
+        _encoder->updateFence(_fence);
+        _encoder->endEncoding();
+        _encoder->release();
+        _encoder = nullptr;
+        _encoder_wrapper.reset();
+    }
+}
+
+uint64_t MetalStream::signal_event() {
+    end_encoding();
+    get_command_buffer()->encodeSignalEvent(_event, ++_event_value);
+    synchronize();
+    return _event_value;
+}
+
+void MetalStream::wait_for(Stream &producer) {
+    if (&producer == this) {
+        return;
+    }
+    auto &metal_producer = static_cast<MetalStream &>(producer);
+    const auto value = metal_producer.signal_event();
+    end_encoding();
+    get_command_buffer()->encodeWait(metal_producer._event, value);
+}
+
+void MetalStream::synchronize(bool wait) {
+    end_encoding();
+    if (_command_buffer) {
+#ifndef NDEBUG
+        _command_buffer->addCompletedHandler(^(MTL::CommandBuffer *cb) noexcept {
+            if (auto error = cb->error()) {
+                WARNING("CommandBuffer execution error: {}.",
+                        error->localizedDescription()->utf8String());
+            }
+            if (auto logs = cb->logs()) {
+                compute_metal_stream_print_function_logs(logs);
+            }
+        });
+#endif
+
+        _command_buffer->commit();
+        _in_flight.push_back({_command_buffer, std::move(_retained), _argument_ring.commit()});
+        _retained.clear();
+        _command_buffer = nullptr;
+    }
+
+    retire_command_buffers(wait);
+}
+
+void MetalStream::retain_resource(std::shared_ptr<void> resource) {
+    _retained.push_back(std::move(resource));
+}
+
+void MetalStream::retire_command_buffers(bool wait) {
+    // Command buffers of a queue complete in order
+    while (!_in_flight.empty()) {
+        auto &command_buffer = _in_flight.front();
+        if (wait) {
+            command_buffer.handle->waitUntilCompleted();
+        } else if (command_buffer.handle->status() < MTL::CommandBufferStatusCompleted) {
+            break;
+        }
+        command_buffer.handle->release();
+        _argument_ring.release(command_buffer.arguments);
+        _in_flight.pop_front();
+    }
+}
+
+}// namespace vox
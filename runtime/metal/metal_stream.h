@@ -0,0 +1,108 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "stream.h"
+#include "argument_ring.h"
+#include "hazard_tracker.h"
+
+namespace vox {
+class MetalDevice;
+
+extern "C" void compute_metal_stream_print_function_logs(MTL::LogContainer *logs);
+
+// Concurrent compute encoder, a memory barrier goes before the dispatches whose resources conflict
+// with the dispatches since the last one
+class MetalCommandEncoder final : public CommandEncoder {
+public:
+    explicit MetalCommandEncoder(MTL::ComputeCommandEncoder *encoder) : _encoder{encoder} {}
+
+    [[nodiscard]] MTL::ComputeCommandEncoder *handle() const {
+        return _encoder;
+    }
+
+    void set_pipeline(Pipeline *pipeline) override;
+
+    void set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) override;
+
+    void use_resource(const Buffer &buffer, ResourceUsage usage) override;
+
+    void dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) override;
+
+    void dispatch_threads(Size3 threads, Size3 threads_per_thread_group) override;
+
+    void dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) override;
+
+private:
+    void barrier_if_needed();
+
+    MTL::ComputeCommandEncoder *_encoder;
+    HazardTracker _hazards;
+};
+
+class MetalStream final : public Stream {
+public:
+    MetalStream(uint32_t index, MetalDevice &device);
+
+    inline MTL::CommandQueue *queue() {
+        return _queue;
+    }
+
+    MTL::CommandBuffer *get_command_buffer();
+
+    MetalCommandEncoder *get_command_encoder() override;
+
+    void synchronize(bool wait = false) override;
+
+    // The next command buffer waits on the GPU for an event signaled after the work of producer
+    void wait_for(Stream &producer) override;
+
+    ArgumentRing &argument_ring() override {
+        return _argument_ring;
+    }
+
+    ~MetalStream() override;
+
+protected:
+    void retain_resource(std::shared_ptr<void> resource) override;
+
+private:
+    // Ends the encoder of the command buffer, the commands which aren't dispatches can be encoded after it
+    void end_encoding();
+
+    // Commits the work recorded so far with a signal of the event, returns the value signaled
+    uint64_t signal_event();
+
+    // Release the completed command buffers and the resources they kept alive
+    void retire_command_buffers(bool wait);
+
+    struct InFlightCommandBuffer {
+        MTL::CommandBuffer *handle;
+        std::vector<std::shared_ptr<void>> retained;
+        ArgumentRing::Mark arguments;
+    };
+
+    MTL::CommandQueue *_queue;
+    // Resources are untracked, every encoder waits for the one before it
+    MTL::Fence *_fence;
+    // Signaled by the command buffers other streams wait for, with increasing values
+    MTL::Event *_event;
+    uint64_t _event_value{0};
+    MTL::CommandBuffer *_command_buffer{};
+    MTL::ComputeCommandEncoder *_encoder{};
+    std::unique_ptr<MetalCommandEncoder> _encoder_wrapper{};
+    std::vector<std::shared_ptr<void>> _retained;
+    std::deque<InFlightCommandBuffer> _in_flight;
+    ArgumentRing _argument_ring;
+    std::mutex mtx_;
+};
+}// namespace vox
@@ -0,0 +1,110 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "neighbor_list.h"
+#include "device.h"
+#include "kernel.h"
+#include "ops.h"
+#include "transforms.h"
+#include "primitives/scan.h"
+#include "primitives/primitive_utils.h"
+
+namespace vox {
+namespace {
+void dispatch(const std::string &entry, size_t threads, const std::vector<Argument> &args, uint32_t stream,
+              const HashGrid *grid = nullptr) {
+    auto kernel = Kernel::builder().entry(entry).build();
+    if (grid) {
+        kernel.set_referenced_arrays(grid->referenced_arrays());
+    }
+    kernel.set_threads(threads);
+    kernel.set_threads_per_thread_group(std::min(threads, size_t(kernel.max_total_threads_per_threadgroup())));
+    kernel(args, stream);
+}
+
+void check_points(const Array &points, const std::string &name) {
+    if (points.dtype() != float3 || !points.is_contiguous()) {
+        throw std::invalid_argument("[NeighborList::" + name + "] The points must be a contiguous float3 Array.");
+    }
+}
+}// namespace
+
+NeighborList::NeighborList(uint32_t stream)
+    : _stream{stream},
+      _counts(scratch(1, int32)),
+      _offsets(scratch(1, int32)),
+      _indices(scratch(0, int32)),
+      _reference(scratch(0, float3)) {
+    _offsets.data<int32_t>()[0] = 0;
+}
+
+void NeighborList::build(const HashGrid &grid, const Array &points, float radius, float skin) {
+    check_points(points, "build");
+    if (int(points.size()) != grid.num_points()) {
+        throw std::invalid_argument("[NeighborList::build] The grid must be built from the points.");
+    }
+    if (radius < 0.f || skin < 0.f) {
+        throw std::invalid_argument("[NeighborList::build] The radius and the skin can't be negative.");
+    }
+    const int num_points = int(points.size());
+    if (num_points + 1 > int(_offsets.size())) {
+        _counts = scratch(num_points + 1, int32);
+        _offsets = scratch(num_points + 1, int32);
+        _reference = scratch(num_points, float3);
+    }
+    _num_points = num_points;
+    _cutoff = radius + skin;
+    _skin = skin;
+    _built = true;
+
+    const uint64_t no_indices = 0;
+    std::vector<Argument> args{points, _reference, _counts, uniform(no_indices), uniform(grid.id()),
+                               uniform(uint64_t(num_points)), uniform(_cutoff)};
+    dispatch("neighbor_list_count", num_points + 1, args, _stream, &grid);
+
+    // The trailing 0 makes offsets[num_points] the total
+    auto scanned = offsets();
+    Scan{_stream, ReduceType::Sum, false}.eval({slice(_counts, {0}, {num_points + 1})}, scanned);
+    synchronize(true, _stream);
+    _num_neighbors = _offsets.data<int32_t>(num_points);
+
+    // Headroom so that the lists of the next builds fit as the points move
+    if (_num_neighbors > int(_indices.size())) {
+        _indices = scratch(_num_neighbors + _num_neighbors / 4, int32);
+    }
+    args[2] = _offsets;
+    args[3] = _indices;
+    dispatch("neighbor_list_fill", std::max(num_points, 1), args, _stream, &grid);
+}
+
+bool NeighborList::needs_rebuild(const Array &points) const {
+    check_points(points, "needs_rebuild");
+    if (!_built || int(points.size()) != _num_points) {
+        return true;
+    }
+    if (_num_points == 0) {
+        return false;
+    }
+    auto displacement = scratch(_num_points, float32);
+    dispatch("neighbor_list_displacement", _num_points,
+             {points, _reference, displacement, uniform(uint64_t(_num_points))}, _stream);
+    auto max_displacement = reduce(displacement, ReduceType::Max, _stream);
+    eval({max_displacement});
+    synchronize(true, _stream);
+    const float half_skin = 0.5f * _skin;
+    return max_displacement.data<float>(0) > half_skin * half_skin;
+}
+
+Array NeighborList::offsets() const {
+    return slice(_offsets, {0}, {_num_points + 1});
+}
+
+Array NeighborList::indices() const {
+    return slice(_indices, {0}, {_num_neighbors});
+}
+
+}// namespace vox
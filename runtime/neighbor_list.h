@@ -0,0 +1,67 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "hash_grid.h"
+
+namespace vox {
+/**
+ * @brief Neighbors of every point in compressed sparse rows, built from HashGrid queries.
+ *
+ * The neighbors of point i are indices[offsets[i], offsets[i + 1]), every point within radius + skin
+ * including i itself. The list stays valid while no point moved more than skin / 2 since the build,
+ * so solvers rebuild it only when needs_rebuild() and filter the neighbors by radius themselves.
+ */
+class NeighborList {
+public:
+    explicit NeighborList(uint32_t stream = 0);
+
+    /// Count, scan and fill the neighbors of the float3 points, grid must have been built from points.
+    /// Waits for the stream once to size indices.
+    void build(const HashGrid &grid, const Array &points, float radius, float skin = 0.f);
+
+    /// True if the list was never built for as many points or a point moved more than skin / 2, waits for the stream
+    [[nodiscard]] bool needs_rebuild(const Array &points) const;
+
+    [[nodiscard]] int num_points() const {
+        return _num_points;
+    }
+
+    [[nodiscard]] int num_neighbors() const {
+        return _num_neighbors;
+    }
+
+    /// radius + skin of the last build
+    [[nodiscard]] float cutoff() const {
+        return _cutoff;
+    }
+
+    [[nodiscard]] float skin() const {
+        return _skin;
+    }
+
+    /// int32 views of num_points + 1 and num_neighbors elements
+    [[nodiscard]] Array offsets() const;
+    [[nodiscard]] Array indices() const;
+
+private:
+    uint32_t _stream;
+    int _num_points{0};
+    int _num_neighbors{0};
+    bool _built{false};
+    float _cutoff{0.f};
+    float _skin{0.f};
+
+    // Capacity of num_points + 1 for the counts and the offsets
+    Array _counts;
+    Array _offsets;
+    Array _indices;
+    // Points of the last build
+    Array _reference;
+};
+
+}// namespace vox
@@ -0,0 +1,209 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include "ops.h"
+#include "utils.h"
+#include "device.h"
+
+namespace vox {
+namespace {
+int normalize_axis(int axis, size_t ndim, const char *op) {
+    const int n = static_cast<int>(ndim);
+    if (axis < -n || axis >= n) {
+        std::ostringstream msg;
+        msg << "[" << op << "] Invalid axis " << axis << " for array with " << ndim << " dimensions.";
+        throw std::invalid_argument(msg.str());
+    }
+    return axis < 0 ? axis + n : axis;
+}
+
+std::vector<int64_t> row_major_strides(const std::vector<int> &shape) {
+    std::vector<int64_t> strides(shape.size());
+    int64_t stride = 1;
+    for (int i = shape.size() - 1; i >= 0; --i) {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    return strides;
+}
+
+void copy_strided(const std::byte *src, std::byte *&dst, const Array &a, size_t dim) {
+    const auto itemsize = static_cast<int64_t>(a.itemsize());
+    const auto step = a.strides()[dim] * itemsize;
+    for (int i = 0; i < a.shape(dim); i++, src += step) {
+        if (dim + 1 == a.ndim()) {
+            std::memcpy(dst, src, itemsize);
+            dst += itemsize;
+        } else {
+            copy_strided(src, dst, a, dim + 1);
+        }
+    }
+}
+}// namespace
+
+Array slice(const Array &a,
+            std::vector<int> start,
+            std::vector<int> stop,
+            std::vector<int> strides) {
+    if (start.size() != a.ndim() || stop.size() != a.ndim() || strides.size() != a.ndim()) {
+        std::ostringstream msg;
+        msg << "[slice] Invalid number of indices or strides for array with " << a.ndim() << " dimensions.";
+        throw std::invalid_argument(msg.str());
+    }
+
+    std::vector<int> shape(a.ndim());
+    std::vector<int64_t> view_strides(a.ndim());
+    int64_t offset = 0;
+    for (size_t i = 0; i < a.ndim(); i++) {
+        const int n = a.shape(i);
+        const int step = strides[i];
+        if (step == 0) {
+            throw std::invalid_argument("[slice] Strides must be non-zero.");
+        }
+        // Same clamping as numpy, negative indices count from the end
+        auto clamp = [n, step](int index) {
+            index = index < 0 ? index + n : index;
+            return step > 0 ? std::clamp(index, 0, n) : std::clamp(index, -1, n - 1);
+        };
+        const int first = clamp(start[i]);
+        const int last = clamp(stop[i]);
+        shape[i] = step > 0 ? std::max(0, (last - first + step - 1) / step)
+                            : std::max(0, (first - last - step - 1) / -step);
+        view_strides[i] = a.strides()[i] * step;
+        if (shape[i] > 0) {
+            offset += first * a.strides()[i];
+        }
+    }
+    if (std::find(shape.begin(), shape.end(), 0) != shape.end()) {
+        offset = 0;
+    }
+    return a.view(shape, view_strides, offset);
+}
+
+Array slice(const Array &a,
+            const std::vector<int> &start,
+            const std::vector<int> &stop) {
+    return slice(a, start, stop, std::vector<int>(a.ndim(), 1));
+}
+
+Array take(const Array &a, int index, int axis) {
+    axis = normalize_axis(axis, a.ndim(), "take");
+    const int n = a.shape(axis);
+    if (index < -n || index >= n) {
+        std::ostringstream msg;
+        msg << "[take] Index " << index << " is out of bounds for axis " << axis << " with size " << n << ".";
+        throw std::invalid_argument(msg.str());
+    }
+    index = index < 0 ? index + n : index;
+
+    auto shape = a.shape();
+    auto strides = a.strides();
+    shape.erase(shape.begin() + axis);
+    strides.erase(strides.begin() + axis);
+    return a.view(shape, strides, index * a.strides()[axis]);
+}
+
+Array reshape(const Array &a, std::vector<int> shape) {
+    size_t size = 1;
+    int infer_dim = -1;
+    for (int i = 0; i < shape.size(); i++) {
+        if (shape[i] == -1) {
+            if (infer_dim >= 0) {
+                throw std::invalid_argument("[reshape] Reshape can only infer one dimension.");
+            }
+            infer_dim = i;
+        } else {
+            size *= shape[i];
+        }
+    }
+    if (infer_dim >= 0) {
+        if (size == 0) {
+            // Any size fits the inferred dimension, like numpy
+            std::ostringstream msg;
+            msg << "[reshape] Cannot infer the unspecified dimension of shape " << shape << ", its other dimensions"
+                << " have a size of 0.";
+            throw std::invalid_argument(msg.str());
+        }
+        shape[infer_dim] = static_cast<int>(a.size() / size);
+        size *= shape[infer_dim];
+    }
+    if (size != a.size()) {
+        std::ostringstream msg;
+        msg << "[reshape] Cannot reshape array of size " << a.size() << " into shape " << shape << ".";
+        throw std::invalid_argument(msg.str());
+    }
+
+    return contiguous(a).view(shape, row_major_strides(shape));
+}
+
+Array transpose(const Array &a, std::vector<int> axes) {
+    if (axes.empty()) {
+        axes.resize(a.ndim());
+        std::iota(axes.rbegin(), axes.rend(), 0);
+    }
+    if (axes.size() != a.ndim()) {
+        throw std::invalid_argument("[transpose] Axes don't match array dimensions.");
+    }
+
+    std::vector<bool> seen(a.ndim(), false);
+    std::vector<int> shape(a.ndim());
+    std::vector<int64_t> strides(a.ndim());
+    for (size_t i = 0; i < axes.size(); i++) {
+        const int axis = normalize_axis(axes[i], a.ndim(), "transpose");
+        if (seen[axis]) {
+            throw std::invalid_argument("[transpose] Repeated axes.");
+        }
+        seen[axis] = true;
+        shape[i] = a.shape(axis);
+        strides[i] = a.strides()[axis];
+    }
+    return a.view(shape, strides);
+}
+
+Array broadcast_to(const Array &a, const std::vector<int> &shape) {
+    if (shape.size() < a.ndim()) {
+        throw std::invalid_argument("[broadcast_to] Cannot broadcast to fewer dimensions.");
+    }
+
+    const size_t leading = shape.size() - a.ndim();
+    std::vector<int64_t> strides(shape.size(), 0);
+    for (size_t i = 0; i < a.ndim(); i++) {
+        const int in = a.shape(i);
+        const int out = shape[leading + i];
+        if (in == out) {
+            strides[leading + i] = a.strides()[i];
+        } else if (in != 1) {
+            std::ostringstream msg;
+            msg << "[broadcast_to] Shape " << a.shape() << " cannot be broadcast to " << shape << ".";
+            throw std::invalid_argument(msg.str());
+        }
+    }
+    return a.view(shape, strides);
+}
+
+Array contiguous(const Array &a) {
+    if (a.is_contiguous()) {
+        return a;
+    }
+    if (a.has_primitive()) {
+        throw std::invalid_argument("[contiguous] The array must be evaluated first.");
+    }
+    // The host reads the elements, the Array doesn't know which stream wrote them
+    device().synchronize(true);
+
+    Array out(a.shape(), a.dtype(), nullptr, {});
+    out.allocate();
+    auto dst = out.data<std::byte>();
+    if (a.ndim() > 0 && a.size() > 0) {
+        copy_strided(a.data<std::byte>(), dst, a, 0);
+    }
+    return out;
+}
+
+}// namespace vox
@@ -0,0 +1,42 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "array.h"
+
+namespace vox {
+// Views share the Data of their input, kernels see the offset address of the first element
+// and must index non-contiguous views with Array::strides().
+
+/** Elements start <= i < stop (start >= i > stop for negative strides) of every dimension. */
+Array slice(const Array &a,
+            std::vector<int> start,
+            std::vector<int> stop,
+            std::vector<int> strides);
+
+Array slice(const Array &a,
+            const std::vector<int> &start,
+            const std::vector<int> &stop);
+
+/** Take the index along axis and drop the dimension. */
+Array take(const Array &a, int index, int axis = 0);
+
+/** A single dimension may be -1 and is inferred, copies if a is not contiguous. */
+Array reshape(const Array &a, std::vector<int> shape);
+
+/** Permute the dimensions, reverses them if axes is empty. */
+Array transpose(const Array &a, std::vector<int> axes = {});
+
+/** Numpy broadcasting, the repeated dimensions get a stride of 0. */
+Array broadcast_to(const Array &a, const std::vector<int> &shape);
+
+/**
+ *  a itself if contiguous, otherwise a row major copy made on the host. a must be evaluated,
+ *  the copy waits for the work recorded on every stream first. */
+Array contiguous(const Array &a);
+
+}// namespace vox
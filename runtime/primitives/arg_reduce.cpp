@@ -0,0 +1,135 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "arg_reduce.h"
+#include "reduce.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+// Threads of a simdgroup, the threadgroups of arg_reduce are a multiple of it
+constexpr size_t simd_size = 32;
+// The flattened reduction splits into at most as many rows, the second pass runs in a single threadgroup
+constexpr size_t max_thread_groups = 1024;
+// Rows shorter than this don't pay for a second pass
+constexpr size_t min_row_size = 4096;
+
+std::string op_name(ArgReduceType reduce_type) {
+    return reduce_type == ArgReduceType::ArgMin ? "argmin" : "argmax";
+}
+
+// Best element of every row of row_size elements, one threadgroup per row
+void arg_reduce_rows(const std::string &name, const Array &in, const Array *in_index, size_t in_size,
+                     size_t row_size, bool absolute_index, Array &out_value, Array &out_index, uint32_t stream) {
+    auto kernel = Kernel::builder().entry("arg_reduce_" + name).build();
+    kernel.set_thread_groups((in_size + row_size - 1) / row_size);
+    kernel.set_threads_per_thread_group(
+        std::min(align(row_size, simd_size), size_t(kernel.max_total_threads_per_threadgroup())));
+
+    const uint64_t no_index = 0;
+    kernel.set_argument_usage({ResourceUsage::Read, ResourceUsage::Read});
+    kernel({in, in_index ? Argument{*in_index} : Argument{uniform(no_index)}, out_value, out_index,
+            uniform(uint64_t(in_size)), uniform(uint64_t(row_size)), uniform(uint64_t(absolute_index))},
+           stream);
+}
+
+Array arg_reduce(const Array &src, ArgReduceType reduce_type, std::optional<int> axis, bool keepdims,
+                 uint32_t stream) {
+    const int ndim = int(src.ndim());
+    std::vector<int> out_shape;
+    if (axis) {
+        if (*axis < -ndim || *axis >= ndim) {
+            throw std::invalid_argument("[" + op_name(reduce_type) + "] Invalid axis " + std::to_string(*axis) +
+                                        " for an array with " + std::to_string(ndim) + " dimensions.");
+        }
+        axis = *axis < 0 ? *axis + ndim : *axis;
+        if (src.shape(*axis) == 0) {
+            throw std::invalid_argument("[" + op_name(reduce_type) + "] The reduced axis is empty.");
+        }
+        out_shape = src.shape();
+        if (keepdims) {
+            out_shape[*axis] = 1;
+        } else {
+            out_shape.erase(out_shape.begin() + *axis);
+        }
+    } else if (src.size() == 0) {
+        throw std::invalid_argument("[" + op_name(reduce_type) + "] The array is empty.");
+    }
+    return apply_primitive(out_shape, uint32, std::make_shared<ArgReduce>(stream, reduce_type, axis), {src});
+}
+}// namespace
+
+void ArgReduce::eval(const std::vector<Array> &inputs, Array &out) {
+    auto &in = inputs[0];
+    out.allocate();
+    const auto name = op_name(_reduce_type) + type_to_name(in.dtype());
+    const size_t out_size = out.size();
+    if (out_size == 0) {
+        return;
+    }
+
+    // The reduced elements are contiguous rows if no larger dimension follows the axis
+    bool rows = in.is_contiguous();
+    for (int d = _axis ? *_axis + 1 : int(in.ndim()); d < int(in.ndim()); d++) {
+        rows &= in.shape(d) == 1;
+    }
+
+    if (rows && _axis) {
+        auto values = scratch(out_size, in.dtype());
+        arg_reduce_rows(name, in, nullptr, in.size(), in.shape(*_axis), false, values, out, stream());
+        return;
+    }
+    if (rows) {
+        // Two passes over the flattened input, the partial results keep their absolute index
+        const size_t row_size = std::max(min_row_size, (in.size() + max_thread_groups - 1) / max_thread_groups);
+        const size_t partial_count = (in.size() + row_size - 1) / row_size;
+        auto values = scratch(partial_count, in.dtype());
+        if (partial_count == 1) {
+            arg_reduce_rows(name, in, nullptr, in.size(), in.size(), true, values, out, stream());
+            return;
+        }
+        auto indices = scratch(partial_count, uint32);
+        arg_reduce_rows(name, in, nullptr, in.size(), row_size, true, values, indices, stream());
+        auto value = scratch(1, in.dtype());
+        arg_reduce_rows(name, values, &indices, partial_count, partial_count, true, value, out, stream());
+        return;
+    }
+
+    // Any layout, one thread per output
+    std::vector<bool> reduced(in.ndim(), !_axis);
+    if (_axis) {
+        reduced[*_axis] = true;
+    }
+    auto layout = general_reduce_layout(in, reduced);
+    auto kernel = Kernel::builder().entry("general_arg_reduce_" + name).build();
+    kernel.set_threads(out_size);
+    kernel.set_threads_per_thread_group(std::min(out_size, size_t(kernel.max_total_threads_per_threadgroup())));
+    kernel.set_argument_usage({ResourceUsage::Read});
+    kernel({in, out, uniform(layout)}, stream());
+}
+
+Array argmin(const Array &src, uint32_t stream) {
+    return arg_reduce(src, ArgReduceType::ArgMin, std::nullopt, false, stream);
+}
+
+Array argmin(const Array &src, int axis, bool keepdims, uint32_t stream) {
+    return arg_reduce(src, ArgReduceType::ArgMin, axis, keepdims, stream);
+}
+
+Array argmax(const Array &src, uint32_t stream) {
+    return arg_reduce(src, ArgReduceType::ArgMax, std::nullopt, false, stream);
+}
+
+Array argmax(const Array &src, int axis, bool keepdims, uint32_t stream) {
+    return arg_reduce(src, ArgReduceType::ArgMax, axis, keepdims, stream);
+}
+
+}// namespace vox
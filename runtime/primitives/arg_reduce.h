@@ -0,0 +1,45 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <optional>
+#include "primitive.h"
+
+namespace vox {
+enum class ArgReduceType { ArgMin, ArgMax };
+
+// uint32 indices of the smallest or largest elements, the lowest index wins ties
+class ArgReduce final : public Primitive {
+public:
+    // Index into the flattened input if axis is empty
+    ArgReduce(uint32_t stream, ArgReduceType reduce_type, std::optional<int> axis)
+        : Primitive{stream}, _reduce_type{reduce_type}, _axis{axis} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "ArgReduce";
+    }
+
+private:
+    ArgReduceType _reduce_type;
+    std::optional<int> _axis;
+};
+
+/** Row major index of the smallest element. The values are reduce(src, ReduceType::Min). */
+Array argmin(const Array &src, uint32_t stream = 0);
+
+/** Indices along axis of the smallest elements, the dimension is removed unless keepdims. */
+Array argmin(const Array &src, int axis, bool keepdims = false, uint32_t stream = 0);
+
+/** Row major index of the largest element. The values are reduce(src, ReduceType::Max). */
+Array argmax(const Array &src, uint32_t stream = 0);
+
+/** Indices along axis of the largest elements, the dimension is removed unless keepdims. */
+Array argmax(const Array &src, int axis, bool keepdims = false, uint32_t stream = 0);
+
+}// namespace vox
@@ -0,0 +1,209 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "compact.h"
+#include "scan.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+std::string predicate_name(const std::optional<CompareType> &compare_type) {
+    if (!compare_type) {
+        return "mask";
+    }
+    switch (*compare_type) {
+        case CompareType::Equal:
+            return "eq";
+        case CompareType::NotEqual:
+            return "ne";
+        case CompareType::Less:
+            return "lt";
+        case CompareType::LessEqual:
+            return "le";
+        case CompareType::Greater:
+            return "gt";
+        case CompareType::GreaterEqual:
+            return "ge";
+    }
+    return "";
+}
+
+// value converted to dtype, in the first bytes of a 64 bits argument. Integer dtypes take resolved values,
+// see resolve_compare
+UniformArgument compare_value(Dtype dtype, double value) {
+    UniformArgument bytes(sizeof(uint64_t), 0);
+    auto write = [&](auto converted) { std::memcpy(bytes.data(), &converted, sizeof(converted)); };
+    switch (dtype) {
+        case uint8:
+            write(uint8_t(value));
+            break;
+        case uint16:
+            write(uint16_t(value));
+            break;
+        case uint32:
+            write(uint32_t(value));
+            break;
+        case uint64:
+            write(uint64_t(value));
+            break;
+        case int8:
+            write(int8_t(value));
+            break;
+        case int16:
+            write(int16_t(value));
+            break;
+        case int32:
+            write(int32_t(value));
+            break;
+        case int64:
+            write(int64_t(value));
+            break;
+        case float16:
+            write(float16_t(float(value)));
+            break;
+        case float32:
+            write(float(value));
+            break;
+        default:
+            throw std::invalid_argument("[compact] Only numeric elements can be compared.");
+    }
+    return bytes;
+}
+
+// Smallest value of an integer dtype and the one past the largest, both exact as doubles
+std::optional<std::pair<double, double>> integer_range(Dtype dtype) {
+    auto range = [](auto type) {
+        using T = decltype(type);
+        return std::make_pair(double(std::numeric_limits<T>::min()), std::ldexp(1.0, std::numeric_limits<T>::digits));
+    };
+    switch (dtype) {
+        case uint8:
+            return range(uint8_t{});
+        case uint16:
+            return range(uint16_t{});
+        case uint32:
+            return range(uint32_t{});
+        case uint64:
+            return range(uint64_t{});
+        case int8:
+            return range(int8_t{});
+        case int16:
+            return range(int16_t{});
+        case int32:
+            return range(int32_t{});
+        case int64:
+            return range(int64_t{});
+        default:
+            return std::nullopt;
+    }
+}
+
+// The same selection with a value integer elements can hold, so converting it doesn't change the result.
+// Less than the smallest element selects nothing, greater or equal to it selects everything.
+std::pair<CompareType, double> resolve_compare(Dtype dtype, CompareType compare_type, double value) {
+    const auto range = integer_range(dtype);
+    if (!range) {
+        return {compare_type, value};
+    }
+    const auto [lowest, end] = *range;
+    const std::pair<CompareType, double> none{CompareType::Less, lowest};
+    const std::pair<CompareType, double> all{CompareType::GreaterEqual, lowest};
+    if (std::isnan(value)) {
+        return compare_type == CompareType::NotEqual ? all : none;
+    }
+    const double floor = std::floor(value);
+    const double ceil = std::ceil(value);
+    switch (compare_type) {
+        case CompareType::Equal:
+        case CompareType::NotEqual: {
+            const bool held = floor == value && value >= lowest && value < end;
+            if (!held) {
+                return compare_type == CompareType::Equal ? none : all;
+            }
+            return {compare_type, value};
+        }
+        // e < v is e < ceil(v)
+        case CompareType::Less:
+            return ceil <= lowest ? none : ceil >= end ? all : std::make_pair(compare_type, ceil);
+        // e <= v is e <= floor(v)
+        case CompareType::LessEqual:
+            return floor < lowest ? none : floor >= end ? all : std::make_pair(compare_type, floor);
+        // e > v is e > floor(v)
+        case CompareType::Greater:
+            return floor < lowest ? all : floor >= end ? none : std::make_pair(compare_type, floor);
+        // e >= v is e >= ceil(v)
+        case CompareType::GreaterEqual:
+            return ceil <= lowest ? all : ceil >= end ? none : std::make_pair(compare_type, ceil);
+    }
+    return {compare_type, value};
+}
+}// namespace
+
+void Compact::eval(const std::vector<Array> &inputs, Array &out) {
+    auto outputs = out.outputs();
+    for (auto &output : outputs) {
+        output.allocate();
+    }
+    auto &in = inputs[0];
+    const size_t size = in.size();
+    const auto name = predicate_name(_compare_type) + type_to_name(in.dtype());
+
+    // A single empty block still writes the count
+    const size_t block_size = balanced_block_size(size);
+    const size_t blocks = std::max<size_t>(1, (size + block_size - 1) / block_size);
+    auto counts = scratch(blocks + 1, uint32);
+    auto offsets = Array({int(blocks + 1)}, uint32, nullptr, {});
+
+    const uint64_t no_mask = 0;
+    std::vector<Argument> args{in, _compare_type ? Argument{uniform(no_mask)} : Argument{inputs[1]},
+                               outputs[0], outputs[1], counts, uniform(uint64_t(size)),
+                               uniform(uint64_t(block_size)),
+                               _compare_type ? compare_value(in.dtype(), _value) : uniform(uint64_t(0))};
+    auto count = Kernel::builder().entry("compact_count_" + name).build();
+    auto scatter = Kernel::builder().entry("compact_scatter_" + name).build();
+    for (auto kernel : {&count, &scatter}) {
+        kernel->set_thread_groups(blocks);
+        kernel->set_threads_per_thread_group(block_thread_group_size);
+    }
+    count(args, stream());
+
+    // Where every block starts writing, the trailing 0 becomes the total
+    Scan{stream(), ReduceType::Sum, false}.eval({counts}, offsets);
+
+    args[4] = offsets;
+    scatter(args, stream());
+}
+
+std::pair<Array, Array> compact(const Array &src, const Array &mask, uint32_t stream) {
+    if (!is_numeric(src.dtype()) && src.dtype() != float2 && src.dtype() != float3 && src.dtype() != float4) {
+        throw std::invalid_argument("[compact] The elements must be numeric, float2, float3 or float4.");
+    }
+    if (mask.size() != src.size() || (mask.dtype() != uint8 && mask.dtype() != int8)) {
+        throw std::invalid_argument("[compact] The mask must be uint8 with the size of the input.");
+    }
+    check_contiguous({src, mask}, "compact");
+    auto outputs = apply_primitive({{int(src.size())}, {1}}, {src.dtype(), uint32}, std::make_shared<Compact>(stream),
+                                   {src, mask});
+    return {outputs[0], outputs[1]};
+}
+
+std::pair<Array, Array> compact(const Array &src, CompareType compare_type, double value, uint32_t stream) {
+    const auto [resolved_type, resolved_value] = resolve_compare(src.dtype(), compare_type, value);
+    compare_value(src.dtype(), resolved_value);// throws for the types which can't be compared
+    check_contiguous({src}, "compact");
+    auto outputs = apply_primitive({{int(src.size())}, {1}}, {src.dtype(), uint32},
+                                   std::make_shared<Compact>(stream, resolved_type, resolved_value), {src});
+    return {outputs[0], outputs[1]};
+}
+
+}// namespace vox
@@ -0,0 +1,45 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <optional>
+#include "primitive.h"
+
+namespace vox {
+enum class CompareType { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+// Stable selection of the flattened input, by the uint8 mask of the second input or by comparing with a value
+class Compact final : public Primitive {
+public:
+    // Selects where the mask input is non zero if compare_type is empty
+    Compact(uint32_t stream, std::optional<CompareType> compare_type = std::nullopt, double value = 0)
+        : Primitive{stream}, _compare_type{compare_type}, _value{value} {}
+
+    // Outputs the selected elements followed by unspecified ones, then their uint32 count
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "Compact";
+    }
+
+private:
+    std::optional<CompareType> _compare_type;
+    double _value;
+};
+
+/**
+ *  The elements of src whose uint8 mask is non zero, in order. The first Array has the size of src
+ *  and starts with the selected elements, the second holds their count so that it stays on the device.
+ *  Numeric, float2, float3 and float4 elements. */
+std::pair<Array, Array> compact(const Array &src, const Array &mask, uint32_t stream = 0);
+
+/**
+ *  The elements e of the numeric src for which e compare_type value holds, e.g. Greater than 0.
+ *  Integer elements are compared with the value as is, e.g. int32 elements Less than 0.5 include 0. */
+std::pair<Array, Array> compact(const Array &src, CompareType compare_type, double value, uint32_t stream = 0);
+
+}// namespace vox
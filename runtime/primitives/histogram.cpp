@@ -0,0 +1,101 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "histogram.h"
+#include "reduce.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+// MAX_SHARED_BINS in shader/builtin/histogram.metal, more bins are counted with device atomics
+constexpr size_t max_shared_bins = 4096;
+// Without atomics every block has its own histogram, each one counts at least values_per_bin
+// times more values than it has bins so that summing the histograms stays cheap
+constexpr size_t values_per_bin = 16;
+
+// Tail of the arguments, one 16 bytes argument
+struct HistogramRange {
+    float lower;
+    float upper;
+    float scale;
+    float padding;
+};
+}// namespace
+
+void Histogram::eval(const std::vector<Array> &inputs, Array &out) {
+    auto &in = inputs[0];
+    out.allocate();
+    const size_t size = in.size();
+    const size_t bins = _bins;
+    const auto name = type_to_name(in.dtype());
+    const HistogramRange range{float(_lower), float(_upper), float(double(_bins) / (_upper - _lower)), 0.f};
+
+    if (device().supports_atomics()) {
+        auto clear = Kernel::builder().entry("isumuint32").build();
+        clear.set_threads(bins);
+        clear.set_threads_per_thread_group(std::min(bins, size_t(clear.max_total_threads_per_threadgroup())));
+        clear({out}, stream());
+        if (size == 0) {
+            return;
+        }
+
+        const size_t block_size = balanced_block_size(size);
+        const size_t blocks = (size + block_size - 1) / block_size;
+        const std::vector<Argument> args{in, out, uniform(uint64_t(size)), uniform(uint64_t(block_size)),
+                                         uniform(uint64_t(bins)), uniform(range)};
+        // Threads contend on threadgroup memory and the blocks only merge the bins they saw,
+        // unless the bins don't fit and are sparse enough to be counted with device atomics
+        const std::string pass = bins <= max_shared_bins ? "histogram_shared_" : "histogram_global_";
+        auto kernel = Kernel::builder().entry(pass + name).build();
+        kernel.set_thread_groups(blocks);
+        kernel.set_threads_per_thread_group(block_thread_group_size);
+        kernel.set_argument_usage({ResourceUsage::Read});
+        kernel(args, stream());
+        return;
+    }
+
+    // Private histogram per block, then the sum of the blocks for every bin
+    const size_t block_size = std::max({min_block_size, bins * values_per_bin, (size + max_blocks - 1) / max_blocks});
+    const size_t blocks = std::max<size_t>(1, (size + block_size - 1) / block_size);
+    Array partials({int(blocks), int(bins)}, uint32, nullptr, {});
+    if (blocks > 1) {
+        partials.allocate();
+    }
+
+    auto kernel = Kernel::builder().entry("histogram_blocks_" + name).build();
+    kernel.set_thread_groups(blocks);
+    kernel.set_threads_per_thread_group(1);
+    kernel.set_argument_usage({ResourceUsage::Read});
+    kernel({in, blocks > 1 ? partials : out, uniform(uint64_t(size)), uniform(uint64_t(block_size)),
+            uniform(uint64_t(bins)), uniform(range)},
+           stream());
+    if (blocks > 1) {
+        Reduce{stream(), ReduceType::Sum, {0}}.eval({partials}, out);
+    }
+}
+
+Array histogram(const Array &src, int bins, double lower, double upper, uint32_t stream) {
+    if (!is_numeric(src.dtype())) {
+        throw std::invalid_argument("[histogram] The elements must be numeric.");
+    }
+    if (bins <= 0) {
+        throw std::invalid_argument("[histogram] The number of bins must be positive.");
+    }
+    if (!std::isfinite(lower) || !std::isfinite(upper) || !(float(lower) < float(upper))) {
+        throw std::invalid_argument("[histogram] The range must be finite with lower < upper.");
+    }
+    check_contiguous({src}, "histogram");
+    return apply_primitive({bins}, uint32, std::make_shared<Histogram>(stream, bins, lower, upper), {src});
+}
+
+}// namespace vox
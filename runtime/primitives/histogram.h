@@ -0,0 +1,36 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "primitive.h"
+
+namespace vox {
+// Counts of the flattened input in bins of equal width over [lower, upper]
+class Histogram final : public Primitive {
+public:
+    Histogram(uint32_t stream, int bins, double lower, double upper)
+        : Primitive{stream}, _bins{bins}, _lower{lower}, _upper{upper} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "Histogram";
+    }
+
+private:
+    int _bins;
+    double _lower;
+    double _upper;
+};
+
+/**
+ *  uint32 counts of the numeric elements of src in bins of width (upper - lower) / bins. Bin i holds
+ *  lower + i * width <= x < lower + (i + 1) * width, the last bin also holds upper. Elements outside
+ *  [lower, upper] and NaN aren't counted. The bins are computed in float32. */
+Array histogram(const Array &src, int bins, double lower, double upper, uint32_t stream = 0);
+
+}// namespace vox
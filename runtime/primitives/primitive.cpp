@@ -0,0 +1,14 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "primitive.h"
+
+namespace vox {
+void View::eval(const std::vector<Array> &inputs, Array &out) {
+    out.copy_shared_buffer(inputs[0].view(_shape, _strides, _offset));
+}
+
+}// namespace vox
@@ -0,0 +1,61 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../array.h"
+
+namespace vox {
+/**
+ * @brief Operation which computes an Array from its inputs.
+ *
+ * Arrays made by a primitive keep it with their inputs until eval() encodes it, so the work
+ * of several operations can be recorded first and dispatched together.
+ */
+class Primitive {
+public:
+    explicit Primitive(uint32_t stream) : _stream{stream} {}
+
+    virtual ~Primitive() = default;
+
+    Primitive(const Primitive &) = delete;
+    Primitive &operator=(const Primitive &) = delete;
+
+    // Encode the work on stream(), the inputs are evaluated. out.allocate() unless out aliases an input.
+    // A primitive with several outputs is called once, with any of them, and writes all of out.outputs().
+    virtual void eval(const std::vector<Array> &inputs, Array &out) = 0;
+
+    [[nodiscard]] virtual std::string name() const = 0;
+
+    [[nodiscard]] uint32_t stream() const {
+        return _stream;
+    }
+
+private:
+    uint32_t _stream;
+};
+
+// A view of an Array which was not evaluated yet, shares its Data once it is
+class View final : public Primitive {
+public:
+    View(uint32_t stream, std::vector<int> shape, std::vector<int64_t> strides, int64_t offset)
+        : Primitive{stream}, _shape{std::move(shape)}, _strides{std::move(strides)}, _offset{offset} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "View";
+    }
+
+private:
+    std::vector<int> _shape;
+    std::vector<int64_t> _strides;
+    int64_t _offset;
+};
+
+}// namespace vox
@@ -0,0 +1,79 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "reduce.h"
+#include "../argument.h"
+#include "../array.h"
+#include "common/helpers.h"
+
+// Helpers shared by the implementations of the primitives and of the kernels built on them
+namespace vox {
+// Blocks of the multi block primitives: radix sort, compact, histogram and segmented reduce. The per block
+// results of at most max_blocks blocks are scanned or summed in a single threadgroup.
+constexpr size_t block_thread_group_size = 256;
+constexpr size_t min_block_size = 4096;
+constexpr size_t max_blocks = 1024;
+
+// Elements per block for size elements, a multiple of granularity
+inline size_t balanced_block_size(size_t size, size_t granularity = block_thread_group_size) {
+    return std::max(min_block_size, align((size + max_blocks - 1) / max_blocks, granularity));
+}
+
+// The bytes of value as a Kernel argument
+template<typename T>
+UniformArgument uniform(const T &value) {
+    UniformArgument bytes(sizeof(value));
+    std::memcpy(bytes.data(), &value, sizeof(value));
+    return bytes;
+}
+
+// Allocated and uninitialized, for the intermediate results of a primitive
+inline Array scratch(size_t size, Dtype dtype) {
+    Array array({int(size)}, dtype, nullptr, {});
+    array.allocate();
+    return array;
+}
+
+// Scalar types the numeric kernels are instantiated for
+inline bool is_numeric(Dtype dtype) {
+    return dtype == uint8 || dtype == uint16 || dtype == uint32 || dtype == uint64 || dtype == int8 ||
+           dtype == int16 || dtype == int32 || dtype == int64 || dtype == float16 || dtype == float32;
+}
+
+// The kernels read the inputs as flat buffers. Checked by the functions creating the primitives, an error thrown by
+// eval would leave a lazy graph half encoded.
+inline void check_contiguous(const std::vector<Array> &inputs, const std::string &primitive) {
+    for (auto &input : inputs) {
+        if (!input.is_contiguous()) {
+            throw std::invalid_argument("[" + primitive + "] The inputs must be contiguous, see contiguous().");
+        }
+    }
+}
+
+// Kernel name of the operations of the scans, primitive names the caller in the error for And and Or
+inline std::string scan_op_name(ReduceType reduce_type, const std::string &primitive) {
+    switch (reduce_type) {
+        case ReduceType::Sum:
+            return "sum";
+        case ReduceType::Prod:
+            return "prod";
+        case ReduceType::Min:
+            return "min_";
+        case ReduceType::Max:
+            return "max_";
+        default:
+            throw std::invalid_argument("[" + primitive + "] Only Sum, Prod, Min and Max are supported.");
+    }
+}
+
+}// namespace vox
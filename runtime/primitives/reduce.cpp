@@ -4,46 +4,244 @@
 //  personal capacity and am not conveying any rights to any intellectual
 //  property of any third parties.
 
+#include <algorithm>
+#include <cstring>
 #include "reduce.h"
 #include "kernel.h"
+#include "transforms.h"
 #include "utils.h"
+#include "primitive_utils.h"
 
 namespace vox {
-void reduce(const Array &src, Array &dst, ReduceType reduce_type, uint32_t stream) {
-    std::string op_name;
+namespace {
+// Elements read per thread and pass, REDUCE_N_READS in shader/builtin/reduce.metal
+constexpr size_t n_reads = 16;
+// Bounds the partial results of the first pass, the second one runs in a single threadgroup
+constexpr size_t max_thread_groups = 1024;
+std::string op_name(ReduceType reduce_type) {
     switch (reduce_type) {
         case ReduceType::And:
-            op_name = "and";
-            break;
+            return "and";
         case ReduceType::Or:
-            op_name = "or";
-            break;
+            return "or";
         case ReduceType::Sum:
-            op_name = "sum";
-            break;
+            return "sum";
         case ReduceType::Prod:
-            op_name = "prod";
-            break;
+            return "prod";
         case ReduceType::Min:
-            op_name = "min_";
-            break;
+            return "min_";
         case ReduceType::Max:
-            op_name = "max_";
-            break;
+            return "max_";
+    }
+    return "";
+}
+
+// Reduce in_size elements of in, one result per threadgroup unless the kernel uses atomics.
+// Returns the number of threadgroups.
+size_t all_reduce(const std::string &kernel_name, const Array &in, size_t in_size, Array &out, uint32_t stream) {
+    auto kernel = Kernel::builder().entry(kernel_name).build();
+
+    size_t nthreads = (in_size + n_reads - 1) / n_reads;
+    size_t thread_group_size = std::min(nthreads, size_t(kernel.max_total_threads_per_threadgroup()));
+    size_t thread_groups = std::min((nthreads + thread_group_size - 1) / thread_group_size, max_thread_groups);
+    kernel.set_thread_groups(thread_groups);
+    kernel.set_threads_per_thread_group(thread_group_size);
+    kernel.set_argument_usage({ResourceUsage::Read});
+    kernel({in, out, uniform(uint64_t(in_size))}, stream);
+    return thread_groups;
+}
+
+void fill_identity(const std::string &name, Array &out, size_t out_size, uint32_t stream) {
+    auto init = Kernel::builder().entry("i" + name).build();
+    init.set_threads(out_size);
+    init.set_threads_per_thread_group(std::min(out_size, size_t(init.max_total_threads_per_threadgroup())));
+    init({out}, stream);
+}
+}// namespace
+
+GeneralReduceLayout general_reduce_layout(const Array &in, const std::vector<bool> &reduced) {
+    const int ndim = int(in.ndim());
+    GeneralReduceLayout layout{};
+    layout.out_size = 1;
+    layout.reduction_size = 1;
+    int previous = -1;
+    for (int d = 0; d < ndim; d++) {
+        if (in.shape(d) == 1) {
+            continue;
+        }
+        const bool is_reduced = reduced[d];
+        (is_reduced ? layout.reduction_size : layout.out_size) *= in.shape(d);
+        int32_t *shape = is_reduced ? layout.reduce_shape : layout.out_shape;
+        int64_t *strides = is_reduced ? layout.reduce_strides : layout.out_strides;
+        int32_t &count = is_reduced ? layout.reduce_ndim : layout.out_ndim;
+        if (previous >= 0 && reduced[previous] == is_reduced &&
+            in.strides()[previous] == in.strides()[d] * in.shape(d)) {
+            shape[count - 1] *= in.shape(d);
+            strides[count - 1] = in.strides()[d];
+        } else {
+            if (count == max_reduce_dims) {
+                throw std::invalid_argument("[reduce] Too many dimensions, see reshape() or contiguous().");
+            }
+            shape[count] = in.shape(d);
+            strides[count] = in.strides()[d];
+            count++;
+        }
+        previous = d;
+    }
+    if (layout.reduce_ndim == 0) {
+        // Only dimensions of size 1 are reduced
+        layout.reduce_shape[0] = 1;
+        layout.reduce_ndim = 1;
+    }
+    return layout;
+}
+
+void Reduce::eval(const std::vector<Array> &inputs, Array &out) {
+    auto &src = inputs[0];
+    out.allocate();
+    if (!(_axes.empty() || _axes.size() == src.ndim()) || !src.is_contiguous()) {
+        eval_axes(src, out);
+        return;
+    }
+    auto &dst = out;
+    const auto name = op_name(_reduce_type) + type_to_name(dst.dtype());
+
+    // Start from the identity, it is also the result of an empty input
+    if (src.size() == 0) {
+        fill_identity(name, dst, dst.size(), stream());
+        return;
+    }
+
+    // The atomic updates of And, Or and 64 bit types aren't instantiated
+    const bool use_atomics = device().supports_atomics() && size_of(src.dtype()) <= 4 &&
+                             _reduce_type != ReduceType::And && _reduce_type != ReduceType::Or;
+    if (use_atomics) {
+        fill_identity(name, dst, dst.size(), stream());
+        all_reduce("all_reduce_" + name, src, src.size(), dst, stream());
+        return;
+    }
+
+    // Two passes, the partials die with the command buffer
+    Array partials({int(max_thread_groups)}, dst.dtype(), nullptr, {});
+    partials.allocate();
+    auto partial_count = all_reduce("all_reduce_no_atomics_" + name, src, src.size(), partials, stream());
+    all_reduce("all_reduce_no_atomics_" + name, partials, partial_count, dst, stream());
+}
+
+void Reduce::eval_axes(const Array &in, Array &out) {
+    const auto name = op_name(_reduce_type) + type_to_name(out.dtype());
+    const int ndim = int(in.ndim());
+    std::vector<bool> reduced(ndim, _axes.empty());
+    for (auto axis : _axes) {
+        reduced[axis] = true;
+    }
+
+    size_t out_size = 1;
+    size_t reduction_size = 1;
+    for (int d = 0; d < ndim; d++) {
+        (reduced[d] ? reduction_size : out_size) *= in.shape(d);
+    }
+    if (out_size == 0) {
+        return;
+    }
+    if (reduction_size == 0) {
+        fill_identity(name, out, out_size, stream());
+        return;
+    }
+
+    // Dimensions of size 1 can be counted as reduced or kept, they don't move the data
+    int first = ndim;
+    int last = -1;
+    for (int d = 0; d < ndim; d++) {
+        if (reduced[d] && in.shape(d) > 1) {
+            first = std::min(first, d);
+            last = d;
+        }
+    }
+    bool adjacent = true;
+    for (int d = first; d <= last; d++) {
+        adjacent &= reduced[d] || in.shape(d) == 1;
+    }
+
+    // A contiguous input with adjacent reduced axes is [outer, reduction_size, inner] in row major
+    if (in.is_contiguous() && adjacent) {
+        size_t inner = 1;
+        for (int d = last + 1; d < ndim; d++) {
+            inner *= in.shape(d);
+        }
+        if (inner == 1) {
+            // Contiguous rows, a threadgroup shares every row
+            auto kernel = Kernel::builder().entry("row_reduce_" + name).build();
+            size_t nthreads = (reduction_size + n_reads - 1) / n_reads;
+            kernel.set_thread_groups(out_size);
+            kernel.set_threads_per_thread_group(
+                std::min(nthreads, size_t(kernel.max_total_threads_per_threadgroup())));
+            kernel.set_argument_usage({ResourceUsage::Read});
+            kernel({in, out, uniform(uint64_t(out_size)), uniform(uint64_t(reduction_size)), uniform(uint64_t(1))},
+                   stream());
+        } else {
+            // Strided columns, neighbouring outputs read neighbouring elements
+            auto kernel = Kernel::builder().entry("col_reduce_" + name).build();
+            kernel.set_threads(out_size);
+            kernel.set_threads_per_thread_group(
+                std::min(out_size, size_t(kernel.max_total_threads_per_threadgroup())));
+            kernel.set_argument_usage({ResourceUsage::Read});
+            kernel({in, out, uniform(uint64_t(out_size)), uniform(uint64_t(reduction_size)), uniform(uint64_t(inner))},
+                   stream());
+        }
+        return;
     }
 
-    auto init = Kernel::builder()
-                      .entry("i" + op_name + type_to_name(dst.dtype()))
-                      .build();
-    size_t nthreads = dst.size();
-    init.set_threads(nthreads);
+    // Any layout
+    auto layout = general_reduce_layout(in, reduced);
+    auto kernel = Kernel::builder().entry("general_reduce_" + name).build();
+    kernel.set_threads(out_size);
+    kernel.set_threads_per_thread_group(std::min(out_size, size_t(kernel.max_total_threads_per_threadgroup())));
+    kernel.set_argument_usage({ResourceUsage::Read});
+    kernel({in, out, uniform(layout)}, stream());
+}
+
+void reduce(const Array &src, Array &dst, ReduceType reduce_type, uint32_t stream) {
+    dst.set_primitive(std::make_shared<Reduce>(stream, reduce_type), {src});
+    if (!lazy_evaluation()) {
+        dst.eval();
+    }
+}
 
-    NS::UInteger thread_group_size = init.max_total_threads_per_threadgroup();
-    if (thread_group_size > nthreads) {
-        thread_group_size = nthreads;
+Array reduce(const Array &src, ReduceType reduce_type, uint32_t stream) {
+    return apply_primitive({}, src.dtype(), std::make_shared<Reduce>(stream, reduce_type), {src});
+}
+
+Array reduce(const Array &src, const std::vector<int> &axes, ReduceType reduce_type, bool keepdims, uint32_t stream) {
+    const int ndim = int(src.ndim());
+    std::vector<int> sorted_axes;
+    for (auto axis : axes) {
+        const int normalized = axis < 0 ? axis + ndim : axis;
+        if (normalized < 0 || normalized >= ndim) {
+            throw std::invalid_argument("[reduce] Invalid axis " + std::to_string(axis) + " for an array with " +
+                                        std::to_string(ndim) + " dimensions.");
+        }
+        sorted_axes.push_back(normalized);
+    }
+    std::sort(sorted_axes.begin(), sorted_axes.end());
+    sorted_axes.erase(std::unique(sorted_axes.begin(), sorted_axes.end()), sorted_axes.end());
+
+    std::vector<int> out_shape;
+    for (int d = 0, i = 0; d < ndim; d++) {
+        if (i < int(sorted_axes.size()) && sorted_axes[i] == d) {
+            i++;
+            if (keepdims) {
+                out_shape.push_back(1);
+            }
+        } else {
+            out_shape.push_back(src.shape(d));
+        }
+    }
+    // Nothing to reduce, unlike the empty axes of the primitive which reduce all of them
+    if (sorted_axes.empty()) {
+        return src;
     }
-    init.set_threads_per_thread_group(thread_group_size);
-    init({dst}, stream);
+    return apply_primitive(out_shape, src.dtype(), std::make_shared<Reduce>(stream, reduce_type, sorted_axes), {src});
 }
 
-}// namespace vox
\ No newline at end of file
+}// namespace vox
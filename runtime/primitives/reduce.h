@@ -6,11 +6,57 @@
 
 #pragma once
 
-#include "../array.h"
+#include "primitive.h"
 
 namespace vox {
 enum class ReduceType { And, Or, Sum, Prod, Min, Max };
 
+// MAX_REDUCE_DIMS in shader/builtin/reduce.metal, after merging the dimensions which are contiguous
+constexpr int max_reduce_dims = 8;
+
+// Tail of the arguments of the general_reduce kernels, the output is row major over the kept dimensions
+struct GeneralReduceLayout {
+    uint64_t out_size;
+    uint64_t reduction_size;
+    int32_t out_ndim;
+    int32_t reduce_ndim;
+    int32_t out_shape[max_reduce_dims];
+    int32_t reduce_shape[max_reduce_dims];
+    int64_t out_strides[max_reduce_dims];
+    int64_t reduce_strides[max_reduce_dims];
+};
+
+// Split the dimensions of in into kept and reduced ones, merging the neighbours which are contiguous
+GeneralReduceLayout general_reduce_layout(const Array &in, const std::vector<bool> &reduced);
+
+class Reduce final : public Primitive {
+public:
+    // Reduces every axis if axes is empty, otherwise the sorted unique axes
+    Reduce(uint32_t stream, ReduceType reduce_type, std::vector<int> axes = {})
+        : Primitive{stream}, _reduce_type{reduce_type}, _axes{std::move(axes)} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "Reduce";
+    }
+
+private:
+    void eval_axes(const Array &in, Array &out);
+
+    ReduceType _reduce_type;
+    std::vector<int> _axes;
+};
+
+// Writes into dst, recorded on dst in lazy mode
 void reduce(const Array &src, Array &dst, ReduceType reduce_type, uint32_t stream = 0);
 
-}// namespace vox
\ No newline at end of file
+Array reduce(const Array &src, ReduceType reduce_type, uint32_t stream = 0);
+
+/**
+ *  Reduce over axes, negative axes count from the back. The reduced dimensions are removed
+ *  unless keepdims. Any strides are accepted, e.g. views from transpose or broadcast_to. */
+Array reduce(const Array &src, const std::vector<int> &axes, ReduceType reduce_type,
+             bool keepdims = false, uint32_t stream = 0);
+
+}// namespace vox
@@ -0,0 +1,99 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "scan.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+
+namespace vox {
+namespace {
+// Elements per thread of the single pass kernel, SCAN_N_READS in shader/builtin/scan.metal
+constexpr size_t n_reads = 8;
+constexpr size_t simd_size = 32;
+// Chunks of the two level scan, the second level combines at most max_chunks partials per chunk
+constexpr size_t min_chunk_size = 4096;
+constexpr size_t max_chunks = 1024;
+}// namespace
+
+void Scan::eval(const std::vector<Array> &inputs, Array &out) {
+    auto &in = inputs[0];
+    out.allocate();
+    const size_t size = in.size();
+    if (size == 0) {
+        return;
+    }
+    const auto name = scan_op_name(_reduce_type, "scan") + type_to_name(in.dtype());
+    const uint64_t no_flags = 0;
+    const Argument flags = inputs.size() > 1 ? Argument{inputs[1]} : Argument{uniform(no_flags)};
+
+    if (device().supports_atomics()) {
+        // Single pass, the tiles look back at the status of the previous ones
+        auto kernel = Kernel::builder().entry("scan_lookback_" + name).build();
+        const size_t thread_group_size = kernel.max_total_threads_per_threadgroup() / simd_size * simd_size;
+        const size_t tile_size = thread_group_size * n_reads;
+        const size_t tiles = (size + tile_size - 1) / tile_size;
+
+        // Zero status, the last one counts the tiles which started
+        auto status = scratch(tiles + 1, uint32);
+        auto clear = Kernel::builder().entry("isumuint32").build();
+        clear.set_threads(tiles + 1);
+        clear.set_threads_per_thread_group(std::min(tiles + 1, size_t(clear.max_total_threads_per_threadgroup())));
+        clear({status}, stream());
+
+        auto aggregates = scratch(tiles, in.dtype());
+        auto prefixes = scratch(tiles, in.dtype());
+        kernel.set_thread_groups(tiles);
+        kernel.set_threads_per_thread_group(thread_group_size);
+        kernel.set_argument_usage({ResourceUsage::Read, ResourceUsage::Read});
+        kernel({in, flags, out, status, aggregates, prefixes, uniform(uint64_t(size)), uniform(uint64_t(_inclusive))},
+               stream());
+        return;
+    }
+
+    // Two levels, the totals of the chunks then the scan of every chunk from the totals before it
+    const size_t chunk_size = std::max(min_chunk_size, (size + max_chunks - 1) / max_chunks);
+    const size_t chunks = (size + chunk_size - 1) / chunk_size;
+    auto partials = scratch(chunks, in.dtype());
+    auto partial_flags = scratch(chunks, uint32);
+    const std::vector<Argument> args{in, flags, out, partials, partial_flags, uniform(uint64_t(size)),
+                                     uniform(uint64_t(chunk_size)), uniform(uint64_t(_inclusive))};
+    for (auto pass : {"scan_partials_", "scan_chunks_"}) {
+        auto kernel = Kernel::builder().entry(pass + name).build();
+        kernel.set_thread_groups(chunks);
+        kernel.set_threads_per_thread_group(1);
+        kernel.set_argument_usage({ResourceUsage::Read, ResourceUsage::Read});
+        kernel(args, stream());
+    }
+}
+
+Array scan(const Array &src, ReduceType reduce_type, bool inclusive, uint32_t stream) {
+    scan_op_name(reduce_type, "scan");// throws for And and Or
+    if (!is_numeric(src.dtype())) {
+        throw std::invalid_argument("[scan] The elements must be numeric.");
+    }
+    check_contiguous({src}, "scan");
+    return apply_primitive({int(src.size())}, src.dtype(), std::make_shared<Scan>(stream, reduce_type, inclusive),
+                           {src});
+}
+
+Array segmented_scan(const Array &src, const Array &flags, ReduceType reduce_type, bool inclusive,
+                     uint32_t stream) {
+    scan_op_name(reduce_type, "scan");// throws for And and Or
+    if (!is_numeric(src.dtype())) {
+        throw std::invalid_argument("[segmented_scan] The elements must be numeric.");
+    }
+    if (flags.size() != src.size() || (flags.dtype() != uint8 && flags.dtype() != int8)) {
+        throw std::invalid_argument("[segmented_scan] The flags must be uint8 with the size of the input.");
+    }
+    check_contiguous({src, flags}, "segmented_scan");
+    return apply_primitive({int(src.size())}, src.dtype(), std::make_shared<Scan>(stream, reduce_type, inclusive),
+                           {src, flags});
+}
+
+}// namespace vox
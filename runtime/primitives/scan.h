@@ -0,0 +1,38 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "reduce.h"
+
+namespace vox {
+// Prefix reduction of the flattened input, restarted at the flags if there is a second input
+class Scan final : public Primitive {
+public:
+    Scan(uint32_t stream, ReduceType reduce_type, bool inclusive)
+        : Primitive{stream}, _reduce_type{reduce_type}, _inclusive{inclusive} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "Scan";
+    }
+
+private:
+    ReduceType _reduce_type;
+    bool _inclusive;
+};
+
+/**
+ *  Sum, Prod, Min or Max of the numeric elements up to i of the contiguous src, flattened.
+ *  The exclusive scan leaves out element i, out[0] is the identity of the op. */
+Array scan(const Array &src, ReduceType reduce_type, bool inclusive = true, uint32_t stream = 0);
+
+/** Scan which restarts at every element whose uint8 flag is non zero, flags has the size of src. */
+Array segmented_scan(const Array &src, const Array &flags, ReduceType reduce_type, bool inclusive = true,
+                     uint32_t stream = 0);
+
+}// namespace vox
@@ -0,0 +1,121 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "segmented_reduce.h"
+#include "scan.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+// Elements per thread of the tiles, SEGMENTED_N_READS in shader/builtin/segmented_reduce.metal
+constexpr size_t n_reads = 8;
+constexpr size_t simd_size = 32;
+// Tiles of elements reduced as a segmented scan, then one thread per segment adding the tiles it spans.
+// segment_count is the device number of segments or 0 to reduce every one of num_segments.
+void segmented_reduce_tiles(const Array &in, const Array &offsets, Array &out, const Argument &segment_count,
+                            size_t num_segments, ReduceType reduce_type, uint32_t stream) {
+    if (num_segments == 0) {
+        return;
+    }
+    const size_t size = in.size();
+    const auto name = scan_op_name(reduce_type, "segmented_reduce") + type_to_name(in.dtype());
+    auto tiles_kernel = Kernel::builder().entry("segmented_reduce_tiles_" + name).build();
+    auto fixup = Kernel::builder().entry("segmented_reduce_fixup_" + name).build();
+
+    const size_t tile_threads = tiles_kernel.max_total_threads_per_threadgroup() / simd_size * simd_size;
+    const size_t tile_size = tile_threads * n_reads;
+    const size_t tiles = std::max<size_t>(1, (size + tile_size - 1) / tile_size);
+    auto leading = scratch(tiles, in.dtype());
+    const std::vector<Argument> args{in, offsets, out, leading, segment_count, uniform(uint64_t(size)),
+                                     uniform(uint64_t(num_segments)), uniform(uint64_t(tile_size))};
+    if (size > 0) {
+        tiles_kernel.set_thread_groups(tiles);
+        tiles_kernel.set_threads_per_thread_group(tile_threads);
+        tiles_kernel(args, stream);
+    }
+
+    fixup.set_threads(num_segments);
+    fixup.set_threads_per_thread_group(std::min(num_segments, size_t(fixup.max_total_threads_per_threadgroup())));
+    fixup(args, stream);
+}
+}// namespace
+
+void SegmentedReduce::eval(const std::vector<Array> &inputs, Array &out) {
+    out.allocate();
+    const uint64_t no_count = 0;
+    segmented_reduce_tiles(inputs[0], inputs[1], out, uniform(no_count), out.size(), _reduce_type, stream());
+}
+
+void ReduceByKey::eval(const std::vector<Array> &inputs, Array &out) {
+    auto outputs = out.outputs();
+    for (auto &output : outputs) {
+        output.allocate();
+    }
+    auto &keys = inputs[0];
+    const size_t size = keys.size();
+
+    // Runs starting in every block, then the first element of every run after the ones of the blocks before
+    const size_t block_size = balanced_block_size(size);
+    const size_t blocks = std::max<size_t>(1, (size + block_size - 1) / block_size);
+    auto counts = scratch(blocks + 1, uint32);
+    auto block_offsets = Array({int(blocks + 1)}, uint32, nullptr, {});
+    auto offsets = scratch(size + 1, uint32);
+    std::vector<Argument> args{keys, outputs[0], offsets, outputs[2], counts, uniform(uint64_t(size)),
+                               uniform(uint64_t(block_size))};
+    auto count = Kernel::builder().entry("reduce_by_key_count_" + type_to_name(keys.dtype())).build();
+    auto scatter = Kernel::builder().entry("reduce_by_key_scatter_" + type_to_name(keys.dtype())).build();
+    for (auto kernel : {&count, &scatter}) {
+        kernel->set_thread_groups(blocks);
+        kernel->set_threads_per_thread_group(block_thread_group_size);
+    }
+    count(args, stream());
+    // The trailing 0 becomes the number of runs
+    Scan{stream(), ReduceType::Sum, false}.eval({counts}, block_offsets);
+    args[4] = block_offsets;
+    scatter(args, stream());
+
+    // At most one run per element, the ones past the count are skipped on the device
+    segmented_reduce_tiles(inputs[1], offsets, outputs[1], outputs[2], size, _reduce_type, stream());
+}
+
+Array segmented_reduce(const Array &src, const Array &offsets, ReduceType reduce_type, uint32_t stream) {
+    scan_op_name(reduce_type, "segmented_reduce");// throws for And and Or
+    if (!is_numeric(src.dtype())) {
+        throw std::invalid_argument("[segmented_reduce] The elements must be numeric.");
+    }
+    if (offsets.ndim() != 1 || offsets.size() == 0 || (offsets.dtype() != int32 && offsets.dtype() != uint32)) {
+        throw std::invalid_argument("[segmented_reduce] The offsets must be a non empty int32 or uint32 vector.");
+    }
+    check_contiguous({src, offsets}, "segmented_reduce");
+    return apply_primitive({int(offsets.size() - 1)}, src.dtype(), std::make_shared<SegmentedReduce>(stream, reduce_type),
+                           {src, offsets});
+}
+
+std::tuple<Array, Array, Array> reduce_by_key(const Array &keys, const Array &values, ReduceType reduce_type,
+                                              uint32_t stream) {
+    scan_op_name(reduce_type, "segmented_reduce");// throws for And and Or
+    if (keys.dtype() != uint32 && keys.dtype() != uint64 && keys.dtype() != int32 && keys.dtype() != int64) {
+        throw std::invalid_argument("[reduce_by_key] The keys must be uint32, uint64, int32 or int64.");
+    }
+    if (!is_numeric(values.dtype())) {
+        throw std::invalid_argument("[reduce_by_key] The values must be numeric.");
+    }
+    if (keys.size() != values.size()) {
+        throw std::invalid_argument("[reduce_by_key] The keys and the values must have the same size.");
+    }
+    check_contiguous({keys, values}, "reduce_by_key");
+    const int size = int(keys.size());
+    auto outputs = apply_primitive({{size}, {size}, {1}}, {keys.dtype(), values.dtype(), uint32},
+                                   std::make_shared<ReduceByKey>(stream, reduce_type), {keys, values});
+    return {outputs[0], outputs[1], outputs[2]};
+}
+
+}// namespace vox
@@ -0,0 +1,61 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <tuple>
+#include "reduce.h"
+
+namespace vox {
+// Reduction of every segment of the flattened first input, delimited by the uint32 offsets of the second input
+class SegmentedReduce final : public Primitive {
+public:
+    SegmentedReduce(uint32_t stream, ReduceType reduce_type)
+        : Primitive{stream}, _reduce_type{reduce_type} {}
+
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "SegmentedReduce";
+    }
+
+private:
+    ReduceType _reduce_type;
+};
+
+// Reduction of the values of every run of equal keys, the keys are the first input and the values the second
+class ReduceByKey final : public Primitive {
+public:
+    ReduceByKey(uint32_t stream, ReduceType reduce_type)
+        : Primitive{stream}, _reduce_type{reduce_type} {}
+
+    // Outputs the key and the reduction of every run followed by unspecified ones, then the uint32 number of runs
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "ReduceByKey";
+    }
+
+private:
+    ReduceType _reduce_type;
+};
+
+/**
+ *  Sum, Prod, Min or Max of the numeric src over every segment, segment s holds the elements
+ *  offsets[s] to offsets[s + 1]. offsets is int32 or uint32 and non decreasing, an empty segment
+ *  gets the identity of the op. The work is split in tiles of elements, long segments don't
+ *  serialize on one thread. */
+Array segmented_reduce(const Array &src, const Array &offsets, ReduceType reduce_type, uint32_t stream = 0);
+
+/**
+ *  Reduction of the values of every run of equal keys, e.g. the total mass of every body after sorting by body id.
+ *  The keys are uint32, uint64, int32 or int64 and have the size of the values. The first two Arrays have the size
+ *  of the input and start with the key and the reduction of every run, the third holds the number of runs so that
+ *  it stays on the device. */
+std::tuple<Array, Array, Array> reduce_by_key(const Array &keys, const Array &values, ReduceType reduce_type,
+                                              uint32_t stream = 0);
+
+}// namespace vox
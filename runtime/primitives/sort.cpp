@@ -0,0 +1,105 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <cstring>
+#include "sort.h"
+#include "scan.h"
+#include "kernel.h"
+#include "transforms.h"
+#include "utils.h"
+#include "primitive_utils.h"
+#include "common/helpers.h"
+
+namespace vox {
+namespace {
+// Digits of 8 bits, RADIX_SIZE in shader/builtin/radix_sort.metal
+constexpr size_t radix_bits = 8;
+constexpr size_t radix_size = 1 << radix_bits;
+
+int checked_key_bits(const Array &keys, int key_bits) {
+    if (keys.dtype() != uint32 && keys.dtype() != uint64 && keys.dtype() != int32 && keys.dtype() != float32) {
+        throw std::invalid_argument("[radix_sort] The keys must be uint32, uint64, int32 or float32.");
+    }
+    const int type_bits = int(size_of(keys.dtype()) * 8);
+    const bool is_unsigned = keys.dtype() == uint32 || keys.dtype() == uint64;
+    if (key_bits == 0) {
+        return type_bits;
+    }
+    if (key_bits < 0 || key_bits > type_bits || (!is_unsigned && key_bits != type_bits)) {
+        throw std::invalid_argument("[radix_sort] key_bits must be at most " + std::to_string(type_bits) +
+                                    ", partial keys must be unsigned.");
+    }
+    return key_bits;
+}
+}// namespace
+
+void RadixSort::eval(const std::vector<Array> &inputs, Array &out) {
+    auto outputs = out.outputs();
+    for (auto &output : outputs) {
+        output.allocate();
+    }
+    const bool has_values = inputs.size() > 1;
+    const size_t size = inputs[0].size();
+    if (size == 0) {
+        return;
+    }
+    const auto type_name = type_to_name(inputs[0].dtype());
+
+    const size_t block_size = balanced_block_size(size, radix_size);
+    const size_t blocks = (size + block_size - 1) / block_size;
+    const size_t passes = (_key_bits + radix_bits - 1) / radix_bits;
+    auto counts = scratch(radix_size * blocks, uint32);
+
+    // Ping-pong so that the last pass writes the outputs
+    std::vector<Array> scratch_outputs{scratch(size, inputs[0].dtype())};
+    if (has_values) {
+        scratch_outputs.push_back(scratch(size, uint32));
+    }
+    std::vector<Array> source = inputs;
+    auto histogram = Kernel::builder().entry("radix_histogram_" + type_name).build();
+    auto scatter = Kernel::builder().entry("radix_scatter_" + type_name).build();
+    for (auto kernel : {&histogram, &scatter}) {
+        kernel->set_thread_groups(blocks);
+        kernel->set_threads_per_thread_group(radix_size);
+    }
+    const uint64_t no_values = 0;
+    for (size_t pass = 0; pass < passes; pass++) {
+        auto &destination = (passes - 1 - pass) % 2 == 0 ? outputs : scratch_outputs;
+        auto offsets = Array({int(counts.size())}, uint32, nullptr, {});
+        const std::vector<Argument> args{
+            source[0], has_values ? Argument{source[1]} : Argument{uniform(no_values)},
+            destination[0], has_values ? Argument{destination[1]} : Argument{uniform(no_values)},
+            counts, uniform(uint64_t(size)), uniform(uint64_t(block_size)), uniform(uint64_t(pass * radix_bits))};
+        histogram(args, stream());
+
+        // Where every block writes each digit, all the smaller digits come first
+        Scan{stream(), ReduceType::Sum, false}.eval({counts}, offsets);
+
+        auto scatter_args = args;
+        scatter_args[4] = offsets;
+        scatter(scatter_args, stream());
+        source = destination;
+    }
+}
+
+Array radix_sort(const Array &keys, int key_bits, uint32_t stream) {
+    key_bits = checked_key_bits(keys, key_bits);
+    check_contiguous({keys}, "radix_sort");
+    return apply_primitive({int(keys.size())}, keys.dtype(), std::make_shared<RadixSort>(stream, key_bits), {keys});
+}
+
+std::pair<Array, Array> radix_sort(const Array &keys, const Array &values, int key_bits, uint32_t stream) {
+    key_bits = checked_key_bits(keys, key_bits);
+    if (values.dtype() != uint32 || values.size() != keys.size()) {
+        throw std::invalid_argument("[radix_sort] The values must be uint32 with the size of the keys.");
+    }
+    check_contiguous({keys, values}, "radix_sort");
+    auto outputs = apply_primitive({{int(keys.size())}, {int(keys.size())}}, {keys.dtype(), uint32},
+                                   std::make_shared<RadixSort>(stream, key_bits), {keys, values});
+    return {outputs[0], outputs[1]};
+}
+
+}// namespace vox
@@ -0,0 +1,38 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "primitive.h"
+
+namespace vox {
+// LSD radix sort of the flattened keys, the values if any move with them
+class RadixSort final : public Primitive {
+public:
+    RadixSort(uint32_t stream, int key_bits)
+        : Primitive{stream}, _key_bits{key_bits} {}
+
+    // Outputs the sorted keys, then the sorted values if there is a second input
+    void eval(const std::vector<Array> &inputs, Array &out) override;
+
+    [[nodiscard]] std::string name() const override {
+        return "RadixSort";
+    }
+
+private:
+    int _key_bits;
+};
+
+/**
+ *  Stable ascending sort of uint32, uint64, int32 or float32 keys, flattened.
+ *  Unsigned keys below 2^key_bits can skip the passes over their high zero bits,
+ *  e.g. key_bits = 20 for cell ids below 2^20. 0 sorts by every bit. */
+Array radix_sort(const Array &keys, int key_bits = 0, uint32_t stream = 0);
+
+/** The sorted keys and the uint32 values in the same order, values has the size of keys. */
+std::pair<Array, Array> radix_sort(const Array &keys, const Array &values, int key_bits = 0, uint32_t stream = 0);
+
+}// namespace vox
@@ -6,33 +6,93 @@
 
 #pragma once
 
-#include <Metal/Metal.hpp>
-#include <mutex>
+#include <cstdint>
+#include <memory>
+#include <cstddef>
 
 namespace vox {
-extern "C" void compute_metal_stream_print_function_logs(MTL::LogContainer *logs);
+class ArgumentRing;
+class Buffer;
+class CommandGraph;
+class Pipeline;
+
+struct Size3 {
+    uint32_t x{1};
+    uint32_t y{1};
+    uint32_t z{1};
+
+    [[nodiscard]] size_t volume() const {
+        return size_t(x) * y * z;
+    }
+};
+
+enum class ResourceUsage : uint8_t {
+    Read = 1 << 0,
+    Write = 1 << 1,
+    ReadWrite = Read | Write,
+};
+
+// Records compute work into the current command buffer of a stream.
+// Mirrors the subset of MTL::ComputeCommandEncoder used by Kernel.
+class CommandEncoder {
+public:
+    virtual ~CommandEncoder() = default;
+
+    virtual void set_pipeline(Pipeline *pipeline) = 0;
+
+    // Bind the size bytes of buffer starting at offset, the buffer must stay alive until the work completed
+    virtual void set_buffer(const Buffer &buffer, size_t offset, size_t size, uint32_t index) = 0;
+
+    virtual void use_resource(const Buffer &buffer, ResourceUsage usage) = 0;
+
+    virtual void dispatch_thread_groups(Size3 thread_groups, Size3 threads_per_thread_group) = 0;
+
+    virtual void dispatch_threads(Size3 threads, Size3 threads_per_thread_group) = 0;
+
+    virtual void dispatch_indirect(const Buffer &indirect, size_t offset, Size3 threads_per_thread_group) = 0;
+};
 
 class Stream {
 public:
-    explicit Stream(uint32_t index);
+    explicit Stream(uint32_t index) : _index{index} {}
+
+    virtual ~Stream() = default;
 
-    inline MTL::CommandQueue *queue() {
-        return _queue;
+    [[nodiscard]] uint32_t index() const {
+        return _index;
     }
 
-    MTL::CommandBuffer *get_command_buffer();
+    virtual CommandEncoder *get_command_encoder() = 0;
+
+    // Encoder of the next launches, the one of the CommandGraph during a capture
+    CommandEncoder *encoder();
+
+    // Commit the recorded work, wait also waits for the work committed before
+    virtual void synchronize(bool wait = false) = 0;
+
+    // The work recorded after this call starts once the work recorded on producer so far completed.
+    // Commits the work of both streams, the host doesn't wait.
+    virtual void wait_for(Stream &producer) = 0;
+
+    // Keep resource alive until the work recorded so far completed, or as long as the graph being captured
+    void retain(std::shared_ptr<void> resource);
+
+    // Argument bytes of the dispatches, recycled as the command buffers complete
+    virtual ArgumentRing &argument_ring() = 0;
+
+    // Until end_capture, the launches on the stream are recorded into graph instead of being encoded.
+    // Destroying the graph ends the capture as well, e.g. when an exception leaves the scope capturing.
+    void begin_capture(CommandGraph &graph);
 
-    MTL::ComputeCommandEncoder *get_command_encoder();
+    void end_capture();
 
-    void synchronize(bool wait = false);
+    // Record the launches of graph after the work recorded so far
+    virtual void replay(const CommandGraph &graph);
 
-    ~Stream();
+protected:
+    virtual void retain_resource(std::shared_ptr<void> resource) = 0;
 
-private:
     uint32_t _index{};
-    MTL::CommandQueue *_queue;
-    MTL::CommandBuffer *_command_buffer{};
-    MTL::ComputeCommandEncoder *_encoder{};
-    std::mutex mtx_;
+    CommandGraph *_capture{nullptr};
 };
-}// namespace vox
\ No newline at end of file
+}// namespace vox
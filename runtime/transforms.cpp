@@ -0,0 +1,117 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include "transforms.h"
+#include "primitives/primitive.h"
+#include "device.h"
+
+namespace vox {
+namespace {
+thread_local bool lazy_evaluation_ = false;
+
+// Pending Arrays in an order where the inputs come first, iterative as pipelines can be long
+std::deque<Array> topological_sort(const std::vector<Array> &outputs) {
+    std::deque<Array> tape;
+    std::unordered_set<std::uintptr_t> visited;
+    // Array and the index of its next input to visit
+    std::vector<std::pair<Array, size_t>> stack;
+    for (auto &output : outputs) {
+        if (!output.has_primitive() || !visited.insert(output.id()).second) {
+            continue;
+        }
+        stack.emplace_back(output, 0);
+        while (!stack.empty()) {
+            auto &[a, next] = stack.back();
+            if (next < a.inputs().size()) {
+                auto &input = a.inputs()[next++];
+                if (input.has_primitive() && visited.insert(input.id()).second) {
+                    stack.emplace_back(input, 0);
+                }
+                continue;
+            }
+            tape.push_back(a);
+            stack.pop_back();
+        }
+    }
+    return tape;
+}
+}// namespace
+
+void eval(std::vector<Array> outputs) {
+    auto tape = topological_sort(outputs);
+    outputs.clear();
+
+    // Stream which encoded each Array, the consumers on other streams wait for it on the device
+    std::unordered_map<std::uintptr_t, uint32_t> producers;
+    std::set<uint32_t> streams;
+    while (!tape.empty()) {
+        auto a = std::move(tape.front());
+        tape.pop_front();
+        if (!a.has_primitive()) {
+            // Encoded with a sibling
+            continue;
+        }
+
+        auto &primitive = a.primitive();
+        const auto stream = primitive.stream();
+        std::set<uint32_t> waited;
+        for (auto &input : a.inputs()) {
+            if (auto it = producers.find(input.id());
+                it != producers.end() && it->second != stream && waited.insert(it->second).second) {
+                device().stream(stream).wait_for(device().stream(it->second));
+            }
+        }
+        primitive.eval(a.inputs(), a);
+        for (auto &output : a.outputs()) {
+            producers[output.id()] = stream;
+        }
+        streams.insert(stream);
+
+        // The tape no longer holds a, the remaining users keep it alive through their inputs
+        a.detach();
+    }
+
+    for (auto stream : streams) {
+        device().stream(stream).synchronize();
+    }
+}
+
+bool set_lazy_evaluation(bool enabled) {
+    std::swap(enabled, lazy_evaluation_);
+    return enabled;
+}
+
+bool lazy_evaluation() {
+    return lazy_evaluation_;
+}
+
+Array apply_primitive(const std::vector<int> &shape,
+                      Dtype dtype,
+                      std::shared_ptr<Primitive> primitive,
+                      std::vector<Array> inputs) {
+    Array out(shape, dtype, std::move(primitive), std::move(inputs));
+    if (!lazy_evaluation()) {
+        out.eval();
+    }
+    return out;
+}
+
+std::vector<Array> apply_primitive(const std::vector<std::vector<int>> &shapes,
+                                   const std::vector<Dtype> &dtypes,
+                                   std::shared_ptr<Primitive> primitive,
+                                   std::vector<Array> inputs) {
+    auto outputs = Array::make_arrays(shapes, dtypes, primitive, inputs);
+    if (!lazy_evaluation()) {
+        eval(outputs);
+    }
+    return outputs;
+}
+
+}// namespace vox
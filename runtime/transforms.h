@@ -0,0 +1,63 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "array.h"
+
+namespace vox {
+/**
+ * @brief Encode the pending primitives the outputs depend on.
+ *
+ * The graph is scheduled in topological order and encoded into the current command buffer of
+ * each stream, which is committed once at the end. Every encoded Array drops its inputs, so an
+ * intermediate dies with its last user and its memory is recycled when the GPU is done with it.
+ * Like eager dispatch, the results can be read after synchronize(true).
+ */
+void eval(std::vector<Array> outputs);
+
+// Primitives of the calling thread record their Array instead of dispatching, returns the previous mode
+bool set_lazy_evaluation(bool enabled);
+bool lazy_evaluation();
+
+/**
+ * @brief Record the primitives called in the scope, e.g. around a multistep pipeline
+ *
+ * Ex.
+ * {
+ *     LazyEvaluation lazy;
+ *     auto partial = reduce(a, ReduceType::Sum);
+ *     ...
+ *     eval({result});
+ * }
+ */
+class LazyEvaluation {
+public:
+    LazyEvaluation() : previous_{set_lazy_evaluation(true)} {}
+    ~LazyEvaluation() {
+        set_lazy_evaluation(previous_);
+    }
+
+    LazyEvaluation(const LazyEvaluation &) = delete;
+    LazyEvaluation &operator=(const LazyEvaluation &) = delete;
+
+private:
+    bool previous_;
+};
+
+// Array computed by primitive, recorded in lazy mode and evaluated right away otherwise
+Array apply_primitive(const std::vector<int> &shape,
+                      Dtype dtype,
+                      std::shared_ptr<Primitive> primitive,
+                      std::vector<Array> inputs);
+
+// Outputs of a primitive computing several Arrays, see Array::make_arrays
+std::vector<Array> apply_primitive(const std::vector<std::vector<int>> &shapes,
+                                   const std::vector<Dtype> &dtypes,
+                                   std::shared_ptr<Primitive> primitive,
+                                   std::vector<Array> inputs);
+
+}// namespace vox
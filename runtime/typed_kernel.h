@@ -0,0 +1,100 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <tuple>
+#include "kernel.h"
+
+namespace vox {
+/**
+ * @brief Device pointer member of the Arguments struct of a TypedKernel, `device T *` in the shader.
+ *
+ * Refers to an Array without owning it, the Array must outlive the launch, which replaces the reference by the
+ * device address and keeps the buffer alive until the kernel completed. An empty one binds nullptr.
+ * DeviceArray<const T> is read by the kernel, like `const device T *`, and doesn't order the dispatches
+ * which only read it.
+ */
+template<typename T>
+class DeviceArray {
+public:
+    using value_type = T;
+
+    DeviceArray() = default;
+
+    explicit DeviceArray(const Array &array) : _array{&array} {}
+
+    // A temporary Array would be gone by the launch
+    DeviceArray(const Array &&array) = delete;
+
+    [[nodiscard]] const Array *array() const {
+        return _array;
+    }
+
+private:
+    alignas(8) const Array *_array{nullptr};
+};
+
+static_assert(sizeof(DeviceArray<float>) == sizeof(uint64_t), "DeviceArray takes the place of a device pointer");
+
+/**
+ * @brief Kernel taking the C++ mirror of its shader Arguments struct.
+ *
+ * The struct is copied at once into the argument ring of the stream, then its DeviceArray members are replaced by
+ * their device addresses. The copy keeps the layout of the struct, including the padding before float4 members
+ * and other 16 bytes aligned types. It is alignas(8) like the shader structs and lists its DeviceArray members:
+ *
+ *     struct alignas(8) FillArguments {
+ *         DeviceArray<uint32_t> buffer;
+ *         uint32_t value;
+ *         static constexpr auto arrays() { return std::make_tuple(&FillArguments::buffer); }
+ *     };
+ *     TypedKernel<FillArguments> kernel{Kernel::builder().entry("fill").build()};
+ *     kernel({DeviceArray<uint32_t>{array}, 3});
+ */
+template<typename Arguments>
+class TypedKernel : public Kernel {
+    static_assert(std::is_trivially_copyable_v<Arguments>, "Arguments must be copied as bytes");
+    static_assert(alignof(Arguments) % detail::argument_alignment == 0,
+                  "Arguments must be alignas(8) like the structs of the shaders, or more for float4 members");
+    static_assert(alignof(Arguments) <= ArgumentRing::alignment, "The argument ring aligns the structs to 256 bytes");
+    static_assert(sizeof(Arguments) % detail::argument_alignment == 0);
+
+public:
+    explicit TypedKernel(Kernel kernel) : Kernel{std::move(kernel)} {}
+
+    void operator()(const Arguments &args, uint32_t stream = 0);
+};
+
+template<typename Arguments>
+void TypedKernel<Arguments>::operator()(const Arguments &args, uint32_t stream) {
+    auto &s = device().stream(stream);
+    auto arguments = s.argument_ring().allocate(sizeof(Arguments));
+    std::memcpy(arguments.data, &args, sizeof(Arguments));
+
+    auto encoder = s.encoder();
+    encoder->set_pipeline(_pso);
+    std::apply(
+        [&](auto... members) {
+            auto bind = [&](const auto &member) {
+                using Member = std::decay_t<decltype(member)>;
+                constexpr auto usage = std::is_const_v<typename Member::value_type> ? ResourceUsage::Read
+                                                                                    : ResourceUsage::ReadWrite;
+                auto slot = arguments.data + (reinterpret_cast<const std::byte *>(&member) -
+                                            reinterpret_cast<const std::byte *>(&args));
+                if (member.array()) {
+                    encode(s, encoder, slot, *member.array(), usage);
+                } else {
+                    std::memset(slot, 0, sizeof(uint64_t));
+                }
+            };
+            (bind(args.*members), ...);
+        },
+        Arguments::arrays());
+    dispatch(s, encoder, arguments);
+}
+
+}// namespace vox
@@ -13,4 +13,10 @@ namespace vox {
 typedef __fp16 float16_t;
 }// namespace vox
 
+#elif defined(__FLT16_MAX__)
+
+namespace vox {
+typedef _Float16 float16_t;
+}// namespace vox
+
 #endif// __ARM_FEATURE_FP16_SCALAR_ARITHMETIC
\ No newline at end of file
@@ -0,0 +1,74 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#if __has_include(<simd/simd.h>)
+
+#include <simd/simd.h>
+
+#else
+
+#include <cstdint>
+
+// Minimal stand-in for Apple's <simd/simd.h> on platforms without it.
+// Layout (size and alignment) matches the Metal shading language types so
+// Arrays of these types can be shared with kernels on every backend.
+namespace simd {
+struct alignas(8) float2 {
+    float x{}, y{};
+
+    float2 &operator=(float v) {
+        x = y = v;
+        return *this;
+    }
+    float &operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+};
+
+struct alignas(16) float3 {
+    float x{}, y{}, z{};
+
+    float3 &operator=(float v) {
+        x = y = z = v;
+        return *this;
+    }
+    float &operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+};
+
+struct alignas(16) float4 {
+    float x{}, y{}, z{}, w{};
+
+    float4 &operator=(float v) {
+        x = y = z = w = v;
+        return *this;
+    }
+    float &operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+};
+
+struct float2x2 {
+    float2 columns[2];
+};
+
+struct float3x3 {
+    float3 columns[3];
+};
+
+struct float4x4 {
+    float4 columns[4];
+};
+
+struct alignas(16) quatf {
+    float4 vector{0.f, 0.f, 0.f, 1.f};
+
+    [[nodiscard]] float3 imag() const { return {vector.x, vector.y, vector.z}; }
+    [[nodiscard]] float real() const { return vector.w; }
+};
+}// namespace simd
+
+#endif
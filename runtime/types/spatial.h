@@ -6,10 +6,26 @@
 
 #pragma once
 
-#include <simd/simd.h>
+#include "simd_types.h"
 
 namespace vox {
+#if defined(__clang__)
 typedef __attribute__((__ext_vector_type__(6))) float SpatialVector;
+#else
+// Same size and alignment as the clang extended vector of 6 floats.
+struct alignas(32) SpatialVector {
+    float v[8]{};
+
+    SpatialVector &operator=(float other) {
+        for (int i = 0; i < 6; ++i) {
+            v[i] = other;
+        }
+        return *this;
+    }
+    float &operator[](int i) { return v[i]; }
+    float operator[](int i) const { return v[i]; }
+};
+#endif
 
 struct SpatialMatrix{
     SpatialVector columns[6];
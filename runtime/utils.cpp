@@ -39,7 +39,7 @@ inline void PrintFormatter::print(std::ostream &os, uint64_t val) {
     os << val;
 }
 inline void PrintFormatter::print(std::ostream &os, float16_t val) {
-    os << val;
+    os << static_cast<float>(val);
 }
 inline void PrintFormatter::print(std::ostream &os, float val) {
     os << val;
@@ -183,7 +183,7 @@ std::ostream &operator<<(std::ostream &os, const std::vector<size_t> &v) {
     return os;
 }
 
-MTL::Size get_block_dims(int dim0, int dim1, int dim2) {
+Size3 get_block_dims(int dim0, int dim1, int dim2) {
     int pows[3] = {0, 0, 0};
     int sum = 0;
     while (true) {
@@ -211,7 +211,7 @@ MTL::Size get_block_dims(int dim0, int dim1, int dim2) {
             break;
         }
     }
-    return MTL::Size{1ul << pows[0], 1ul << pows[1], 1ul << pows[2]};
+    return Size3{1u << pows[0], 1u << pows[1], 1u << pows[2]};
 }
 
 }// namespace vox
@@ -43,6 +43,6 @@ std::ostream &operator<<(std::ostream &os, const Dtype &d);
 std::ostream &operator<<(std::ostream &os, const std::vector<int> &v);
 std::ostream &operator<<(std::ostream &os, const std::vector<size_t> &v);
 
-MTL::Size get_block_dims(int dim0, int dim1, int dim2);
+Size3 get_block_dims(int dim0, int dim1, int dim2);
 
 }// namespace vox
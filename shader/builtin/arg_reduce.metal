@@ -0,0 +1,183 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_simdgroup>
+
+#include "utils.h"
+
+using namespace metal;
+
+static constant uint8_t simd_size = 32;
+
+// Must match max_reduce_dims in runtime/primitives/reduce.cpp
+static constant constexpr int MAX_REDUCE_DIMS = 8;
+
+// Same layout as the arguments encoded by runtime/primitives/arg_reduce.cpp
+template <typename T>
+struct ArgReduceArguments {
+    const device T *in;
+    // Index of every element of in, nullptr if it is the position in its row
+    const device uint32_t *in_index;
+    device T *out_value;
+    device uint32_t *out_index;
+    uint64_t in_size;
+    uint64_t row_size;
+    // The index counts from the start of in instead of the start of the row
+    uint64_t absolute_index;
+};
+
+template <typename T>
+struct GeneralArgReduceArguments {
+    const device T *in;
+    device uint32_t *out_index;
+    uint64_t out_size;
+    uint64_t reduction_size;
+    int out_ndim;
+    int reduce_ndim;
+    int out_shape[MAX_REDUCE_DIMS];
+    int reduce_shape[MAX_REDUCE_DIMS];
+    int64_t out_strides[MAX_REDUCE_DIMS];
+    int64_t reduce_strides[MAX_REDUCE_DIMS];
+};
+
+template <typename T>
+struct IndexValuePair {
+    uint32_t index;
+    T val;
+};
+
+// The lowest index wins ties, the result doesn't depend on the thread count
+template <typename U>
+struct ArgMin {
+    static constexpr constant U init = Limits<U>::max;
+
+    template <typename T>
+    bool better(IndexValuePair<T> a, IndexValuePair<T> b) {
+        return a.val < b.val || (a.val == b.val && a.index < b.index);
+    }
+};
+
+template <typename U>
+struct ArgMax {
+    static constexpr constant U init = Limits<U>::min;
+
+    template <typename T>
+    bool better(IndexValuePair<T> a, IndexValuePair<T> b) {
+        return a.val > b.val || (a.val == b.val && a.index < b.index);
+    }
+};
+
+template <typename T, typename Op>
+METAL_FUNC IndexValuePair<T> simd_arg_reduce(IndexValuePair<T> best, Op op) {
+    for (ushort offset = simd_size / 2; offset > 0; offset /= 2) {
+        IndexValuePair<T> other{simd_shuffle_down(best.index, offset),
+                                simd_shuffle_down(best.val, offset)};
+        if (op.better(other, best)) {
+            best = other;
+        }
+    }
+    return best;
+}
+
+// One threadgroup per row of row_size elements, the size of the threadgroup is a multiple of simd_size
+template <typename T, typename Op>
+[[kernel]] void arg_reduce(constant ArgReduceArguments<T> &args,
+                           uint lid [[thread_position_in_threadgroup]],
+                           uint tgid [[threadgroup_position_in_grid]],
+                           uint tg_size [[threads_per_threadgroup]],
+                           uint simd_per_group [[simdgroups_per_threadgroup]],
+                           uint simd_lane_id [[thread_index_in_simdgroup]],
+                           uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    Op op;
+    threadgroup IndexValuePair<T> local_data[simd_size];
+
+    const size_t row_start = tgid * args.row_size;
+    const size_t row_end = min(row_start + args.row_size, args.in_size);
+    const size_t index_base = args.absolute_index ? 0 : row_start;
+
+    IndexValuePair<T> best{UINT32_MAX, Op::init};
+    for (size_t i = row_start + lid; i < row_end; i += tg_size) {
+        IndexValuePair<T> candidate{args.in_index ? args.in_index[i] : uint32_t(i - index_base), args.in[i]};
+        if (op.better(candidate, best)) {
+            best = candidate;
+        }
+    }
+
+    best = simd_arg_reduce(best, op);
+    if (simd_lane_id == 0) {
+        local_data[simd_group_id] = best;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    if (simd_group_id == 0) {
+        best = simd_lane_id < simd_per_group ? local_data[simd_lane_id] : IndexValuePair<T>{UINT32_MAX, Op::init};
+        best = simd_arg_reduce(best, op);
+        if (lid == 0) {
+            args.out_value[tgid] = best.val;
+            args.out_index[tgid] = best.index;
+        }
+    }
+}
+
+// Any layout, one thread per output
+template <typename T, typename Op>
+[[kernel]] void general_arg_reduce(constant GeneralArgReduceArguments<T> &args,
+                                   uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.out_size) {
+        return;
+    }
+    Op op;
+    int64_t base = 0;
+    size_t index = gid;
+    for (int d = args.out_ndim - 1; d >= 0; d--) {
+        base += (index % args.out_shape[d]) * args.out_strides[d];
+        index /= args.out_shape[d];
+    }
+
+    IndexValuePair<T> best{UINT32_MAX, Op::init};
+    for (size_t r = 0; r < args.reduction_size; r++) {
+        int64_t offset = base;
+        size_t reduce_index = r;
+        for (int d = args.reduce_ndim - 1; d >= 0; d--) {
+            offset += (reduce_index % args.reduce_shape[d]) * args.reduce_strides[d];
+            reduce_index /= args.reduce_shape[d];
+        }
+        IndexValuePair<T> candidate{uint32_t(r), args.in[offset]};
+        if (op.better(candidate, best)) {
+            best = candidate;
+        }
+    }
+    args.out_index[gid] = best.index;
+}
+
+#define instantiate_arg_reduce_helper(name, type, op) \
+  template [[host_name("arg_reduce_" #name)]] \
+  [[kernel]] void arg_reduce<type, op>( \
+      constant ArgReduceArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]); \
+  template [[host_name("general_arg_reduce_" #name)]] \
+  [[kernel]] void general_arg_reduce<type, op>( \
+      constant GeneralArgReduceArguments<type> &args, \
+      uint gid [[thread_position_in_grid]]);
+
+#define instantiate_arg_reduce(tname, type) \
+  instantiate_arg_reduce_helper(argmin ##tname, type, ArgMin<type>) \
+  instantiate_arg_reduce_helper(argmax ##tname, type, ArgMax<type>)
+
+instantiate_arg_reduce(uint8, uint8_t)
+instantiate_arg_reduce(uint16, uint16_t)
+instantiate_arg_reduce(uint32, uint32_t)
+instantiate_arg_reduce(uint64, uint64_t)
+instantiate_arg_reduce(int8, int8_t)
+instantiate_arg_reduce(int16, int16_t)
+instantiate_arg_reduce(int32, int32_t)
+instantiate_arg_reduce(int64, int64_t)
+instantiate_arg_reduce(float16, half)
+instantiate_arg_reduce(float32, float)
@@ -0,0 +1,182 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_simdgroup>
+
+#include "utils.h"
+
+using namespace metal;
+
+static constant uint8_t simd_size = 32;
+
+// Same layout as the arguments encoded by runtime/primitives/compact.cpp
+template <typename T>
+struct CompactArguments {
+    const device T *in;
+    // Non zero for the selected elements, nullptr when comparing with value
+    const device uint8_t *mask;
+    device T *out;
+    device uint32_t *count;
+    // Selected elements per block and a trailing 0. Counts for the count, exclusive scan of them for the scatter
+    device uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+    // Bits of the T compared with, in the first bytes
+    uint64_t value;
+};
+
+template <typename T>
+METAL_FUNC T compare_value(constant CompactArguments<T> &args) {
+    return *reinterpret_cast<constant T *>(&args.value);
+}
+
+struct Masked {
+    template <typename T>
+    static bool select(constant CompactArguments<T> &args, size_t i) {
+        return args.mask[i] != 0;
+    }
+};
+
+#define define_compare(name, op)                                          \
+    struct name {                                                         \
+        template <typename T>                                             \
+        static bool select(constant CompactArguments<T> &args, size_t i) { \
+            return args.in[i] op compare_value(args);                     \
+        }                                                                 \
+    };
+
+define_compare(Equal, ==)
+define_compare(NotEqual, !=)
+define_compare(Less, <)
+define_compare(LessEqual, <=)
+define_compare(Greater, >)
+define_compare(GreaterEqual, >=)
+
+// Selected elements of every block
+template <typename T, typename Predicate>
+[[kernel]] void compact_count(constant CompactArguments<T> &args,
+                              uint lid [[thread_position_in_threadgroup]],
+                              uint tgid [[threadgroup_position_in_grid]],
+                              uint tg_size [[threads_per_threadgroup]],
+                              uint blocks [[threadgroups_per_grid]],
+                              uint simd_per_group [[simdgroups_per_threadgroup]],
+                              uint simd_lane_id [[thread_index_in_simdgroup]],
+                              uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup uint simd_counts[simd_size];
+
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    uint count = 0;
+    for (size_t i = begin + lid; i < end; i += tg_size) {
+        count += Predicate::select(args, i) ? 1 : 0;
+    }
+
+    count = simd_sum(count);
+    if (simd_lane_id == 0) {
+        simd_counts[simd_group_id] = count;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    if (lid == 0) {
+        uint total = 0;
+        for (uint group = 0; group < simd_per_group; group++) {
+            total += simd_counts[group];
+        }
+        args.block_offsets[tgid] = total;
+        if (tgid == 0) {
+            args.block_offsets[blocks] = 0;
+        }
+    }
+}
+
+// Every simdgroup ranks its selected elements with a ballot, the tiles of a block write after each other. Stable.
+template <typename T, typename Predicate>
+[[kernel]] void compact_scatter(constant CompactArguments<T> &args,
+                                uint lid [[thread_position_in_threadgroup]],
+                                uint tgid [[threadgroup_position_in_grid]],
+                                uint tg_size [[threads_per_threadgroup]],
+                                uint blocks [[threadgroups_per_grid]],
+                                uint simd_per_group [[simdgroups_per_threadgroup]],
+                                uint simd_lane_id [[thread_index_in_simdgroup]],
+                                uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup uint simd_counts[simd_size];
+
+    if (tgid == 0 && lid == 0) {
+        *args.count = args.block_offsets[blocks];
+    }
+
+    const ulong lanes_before = (ulong(1) << simd_lane_id) - 1;
+    size_t offset = args.block_offsets[tgid];
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    for (size_t tile = begin; tile < end; tile += tg_size) {
+        const size_t i = tile + lid;
+        const bool selected = i < end && Predicate::select(args, i);
+        const ulong ballot = ulong(simd_vote::vote_t(simd_ballot(selected)));
+        if (simd_lane_id == 0) {
+            simd_counts[simd_group_id] = popcount(ballot);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        uint before = 0;
+        uint total = 0;
+        for (uint group = 0; group < simd_per_group; group++) {
+            before += group < simd_group_id ? simd_counts[group] : 0;
+            total += simd_counts[group];
+        }
+        if (selected) {
+            args.out[offset + before + popcount(ballot & lanes_before)] = args.in[i];
+        }
+        offset += total;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+}
+
+#define instantiate_compact_helper(name, type, predicate) \
+  template [[host_name("compact_count_" #name)]] \
+  [[kernel]] void compact_count<type, predicate>( \
+      constant CompactArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint blocks [[threadgroups_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]); \
+  template [[host_name("compact_scatter_" #name)]] \
+  [[kernel]] void compact_scatter<type, predicate>( \
+      constant CompactArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint blocks [[threadgroups_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]);
+
+#define instantiate_compact(tname, type) \
+  instantiate_compact_helper(mask ##tname, type, Masked) \
+  instantiate_compact_helper(eq ##tname, type, Equal) \
+  instantiate_compact_helper(ne ##tname, type, NotEqual) \
+  instantiate_compact_helper(lt ##tname, type, Less) \
+  instantiate_compact_helper(le ##tname, type, LessEqual) \
+  instantiate_compact_helper(gt ##tname, type, Greater) \
+  instantiate_compact_helper(ge ##tname, type, GreaterEqual)
+
+instantiate_compact(uint8, uint8_t)
+instantiate_compact(uint16, uint16_t)
+instantiate_compact(uint32, uint32_t)
+instantiate_compact(uint64, uint64_t)
+instantiate_compact(int8, int8_t)
+instantiate_compact(int16, int16_t)
+instantiate_compact(int32, int32_t)
+instantiate_compact(int64, int64_t)
+instantiate_compact(float16, half)
+instantiate_compact(float32, float)
+
+// Vectors are only selected by a mask
+instantiate_compact_helper(maskfloat2, float2, Masked)
+instantiate_compact_helper(maskfloat3, float3, Masked)
+instantiate_compact_helper(maskfloat4, float4, Masked)
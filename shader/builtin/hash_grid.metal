@@ -0,0 +1,144 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_stdlib>
+
+using namespace metal;
+
+#include "shader/vec.h"
+#include "shader/hash_grid.h"
+
+// Same layout as the arguments encoded by runtime/hash_grid.cpp
+struct HashGridPointArguments {
+    const device float3 *points;
+    device uint32_t *point_cells;
+    device uint32_t *point_ids;
+    // Descriptor read by hash_grid_query, written from grid
+    device HashGrid *descriptor;
+    HashGrid grid;
+};
+
+struct HashGridCellArguments {
+    // Sorted cell of every point, nullptr when clearing
+    const device uint32_t *point_cells;
+    device int *cell_starts;
+    device int *cell_ends;
+    uint64_t size;
+};
+
+// The unsorted cell of every point, the first thread publishes the descriptor of the build
+[[kernel]] void hash_grid_point_cells(constant HashGridPointArguments &args,
+                                      uint gid [[thread_position_in_grid]]) {
+    HashGrid grid = args.grid;
+    if (gid == 0) {
+        *args.descriptor = grid;
+    }
+    if (gid >= uint(grid.num_points)) {
+        return;
+    }
+    const float3 p = args.points[gid];
+    args.point_cells[gid] = hash_grid_index(grid, vec3(p.x, p.y, p.z));
+    args.point_ids[gid] = gid;
+}
+
+// Every cell is empty until hash_grid_cell_ranges finds its points
+[[kernel]] void hash_grid_clear_cells(constant HashGridCellArguments &args,
+                                      uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.size) {
+        return;
+    }
+    args.cell_starts[gid] = 0;
+    args.cell_ends[gid] = 0;
+}
+
+// One thread per sorted point, the first and last point of each run of equal cells bound its range
+[[kernel]] void hash_grid_cell_ranges(constant HashGridCellArguments &args,
+                                      uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.size) {
+        return;
+    }
+    const uint32_t cell = args.point_cells[gid];
+    if (gid == 0 || args.point_cells[gid - 1] != cell) {
+        args.cell_starts[cell] = gid;
+    }
+    if (gid == args.size - 1 || args.point_cells[gid + 1] != cell) {
+        args.cell_ends[cell] = gid + 1;
+    }
+}
+
+// Same layout as the arguments encoded by runtime/neighbor_list.cpp
+struct NeighborListArguments {
+    const device float3 *points;
+    // Points of the build, the displacement since then decides when to rebuild
+    device float3 *reference;
+    // Neighbor count of every point and a trailing 0 when counting, their exclusive scan when filling
+    device int *offsets;
+    device int *indices;
+    // HashGrid::id() of the grid built from points
+    uint64_t grid;
+    uint64_t size;
+    float cutoff;
+};
+
+struct NeighborDisplacementArguments {
+    const device float3 *points;
+    const device float3 *reference;
+    device float *displacement;
+    uint64_t size;
+};
+
+// One thread per point and one for the trailing 0, which the exclusive scan turns into the total.
+// The threads take the points in the order of their cells, neighboring threads visit the same points.
+[[kernel]] void neighbor_list_count(constant NeighborListArguments &args,
+                                    uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.size) {
+        if (gid == args.size) {
+            args.offsets[gid] = 0;
+        }
+        return;
+    }
+    const int i = hash_grid_point_id(args.grid, gid);
+    const float3 p = args.points[i];
+    args.reference[i] = p;
+    hash_grid_query_t query = hash_grid_query(args.grid, vec3(p.x, p.y, p.z), args.cutoff);
+    int index;
+    int count = 0;
+    while (hash_grid_query_next(query, index)) {
+        const float3 d = args.points[index] - p;
+        count += dot(d, d) <= args.cutoff * args.cutoff;
+    }
+    args.offsets[i] = count;
+}
+
+// Same traversal as the count, the neighbors of a point follow the order of the cells of its query.
+// Every candidate is written to the next slot, which only the points within cutoff keep.
+[[kernel]] void neighbor_list_fill(constant NeighborListArguments &args,
+                                   uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.size) {
+        return;
+    }
+    const int i = hash_grid_point_id(args.grid, gid);
+    const float3 p = args.points[i];
+    hash_grid_query_t query = hash_grid_query(args.grid, vec3(p.x, p.y, p.z), args.cutoff);
+    int index;
+    int next = args.offsets[i];
+    const int end = args.offsets[i + 1];
+    while (next < end && hash_grid_query_next(query, index)) {
+        args.indices[next] = index;
+        const float3 d = args.points[index] - p;
+        next += dot(d, d) <= args.cutoff * args.cutoff;
+    }
+}
+
+// Squared distance of every point from where it was at the build
+[[kernel]] void neighbor_list_displacement(constant NeighborDisplacementArguments &args,
+                                           uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.size) {
+        return;
+    }
+    const float3 d = args.points[gid] - args.reference[gid];
+    args.displacement[gid] = dot(d, d);
+}
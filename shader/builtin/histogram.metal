@@ -0,0 +1,110 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_atomic>
+
+#include "atomic.h"
+#include "utils.h"
+
+using namespace metal;
+
+// Must match max_shared_bins in runtime/primitives/histogram.cpp, 16KB of threadgroup memory
+static constant constexpr uint MAX_SHARED_BINS = 4096;
+
+// Same layout as the arguments encoded by runtime/primitives/histogram.cpp
+template <typename T>
+struct HistogramArguments {
+    const device T *in;
+    // Zeroed before the kernel
+    device mlx_atomic<uint> *out;
+    uint64_t size;
+    uint64_t block_size;
+    uint64_t bins;
+    // One 16 bytes argument
+    float lower;
+    float upper;
+    // bins / (upper - lower)
+    float scale;
+    float padding;
+};
+
+// Bin of value, bins if it lies outside [lower, upper]. The last bin includes upper.
+template <typename T>
+METAL_FUNC uint histogram_bin(constant HistogramArguments<T> &args, T value) {
+    const float x = float(value);
+    if (!(x >= args.lower && x <= args.upper)) {
+        return uint(args.bins);
+    }
+    return min(uint((x - args.lower) * args.scale), uint(args.bins) - 1);
+}
+
+// Every threadgroup counts its block in a private histogram, then adds the bins it saw to the output
+template <typename T>
+[[kernel]] void histogram_shared(constant HistogramArguments<T> &args,
+                                 uint lid [[thread_position_in_threadgroup]],
+                                 uint tgid [[threadgroup_position_in_grid]],
+                                 uint tg_size [[threads_per_threadgroup]]) {
+    threadgroup atomic_uint local_bins[MAX_SHARED_BINS];
+    const uint bins = uint(args.bins);
+    for (uint bin = lid; bin < bins; bin += tg_size) {
+        atomic_store_explicit(&local_bins[bin], 0, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    for (size_t i = begin + lid; i < end; i += tg_size) {
+        const uint bin = histogram_bin(args, args.in[i]);
+        if (bin < bins) {
+            atomic_fetch_add_explicit(&local_bins[bin], 1, memory_order_relaxed);
+        }
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    for (uint bin = lid; bin < bins; bin += tg_size) {
+        const uint count = atomic_load_explicit(&local_bins[bin], memory_order_relaxed);
+        if (count) {
+            mlx_atomic_fetch_add_explicit(args.out, count, bin);
+        }
+    }
+}
+
+// Too many bins for threadgroup memory, they are sparse enough that device atomics contend little
+template <typename T>
+[[kernel]] void histogram_global(constant HistogramArguments<T> &args,
+                                 uint gid [[thread_position_in_grid]],
+                                 uint grid_size [[threads_per_grid]]) {
+    for (size_t i = gid; i < args.size; i += grid_size) {
+        const uint bin = histogram_bin(args, args.in[i]);
+        if (bin < args.bins) {
+            mlx_atomic_fetch_add_explicit(args.out, 1u, bin);
+        }
+    }
+}
+
+#define instantiate_histogram(tname, type) \
+  template [[host_name("histogram_shared_" #tname)]] \
+  [[kernel]] void histogram_shared<type>( \
+      constant HistogramArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]]); \
+  template [[host_name("histogram_global_" #tname)]] \
+  [[kernel]] void histogram_global<type>( \
+      constant HistogramArguments<type> &args, \
+      uint gid [[thread_position_in_grid]], \
+      uint grid_size [[threads_per_grid]]);
+
+instantiate_histogram(uint8, uint8_t)
+instantiate_histogram(uint16, uint16_t)
+instantiate_histogram(uint32, uint32_t)
+instantiate_histogram(uint64, uint64_t)
+instantiate_histogram(int8, int8_t)
+instantiate_histogram(int16, int16_t)
+instantiate_histogram(int32, int32_t)
+instantiate_histogram(int64, int64_t)
+instantiate_histogram(float16, half)
+instantiate_histogram(float32, float)
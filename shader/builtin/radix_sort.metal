@@ -0,0 +1,189 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_atomic>
+#include <metal_simdgroup>
+
+#include "utils.h"
+
+using namespace metal;
+
+// Must match radix_size in runtime/primitives/sort.cpp, every threadgroup has one thread per digit
+static constant constexpr uint RADIX_SIZE = 256;
+static constant constexpr uint RADIX_BITS = 8;
+
+static constant uint8_t simd_size = 32;
+
+// Same layout as the arguments encoded by runtime/primitives/sort.cpp
+template <typename K>
+struct RadixArguments {
+    const device K *keys_in;
+    // nullptr if the keys have no values
+    const device uint32_t *values_in;
+    device K *keys_out;
+    device uint32_t *values_out;
+    // Per digit and block, digit major. Counts of the histogram, exclusive scan of them for the scatter
+    device uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+    uint64_t shift;
+};
+
+// Unsigned bits in the order of the keys
+METAL_FUNC uint radix_bits(uint key) {
+    return key;
+}
+
+METAL_FUNC ulong radix_bits(ulong key) {
+    return key;
+}
+
+METAL_FUNC uint radix_bits(int key) {
+    return as_type<uint>(key) ^ 0x80000000u;
+}
+
+METAL_FUNC uint radix_bits(float key) {
+    const uint bits = as_type<uint>(key);
+    return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+}
+
+template <typename K>
+METAL_FUNC uint radix_digit(K key, uint shift) {
+    return uint(radix_bits(key) >> shift) & (RADIX_SIZE - 1);
+}
+
+// Digit counts of every block
+template <typename K>
+[[kernel]] void radix_histogram(constant RadixArguments<K> &args,
+                                uint lid [[thread_position_in_threadgroup]],
+                                uint tgid [[threadgroup_position_in_grid]],
+                                uint blocks [[threadgroups_per_grid]]) {
+    threadgroup atomic_uint counts[RADIX_SIZE];
+    atomic_store_explicit(&counts[lid], 0, memory_order_relaxed);
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    for (size_t i = begin + lid; i < end; i += RADIX_SIZE) {
+        atomic_fetch_add_explicit(&counts[radix_digit(args.keys_in[i], args.shift)], 1, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    args.block_offsets[size_t(lid) * blocks + tgid] = atomic_load_explicit(&counts[lid], memory_order_relaxed);
+}
+
+// Exclusive sum over the threadgroup, total is the sum of every thread
+METAL_FUNC uint threadgroup_exclusive_sum(uint value,
+                                          threadgroup uint *simd_totals,
+                                          thread uint &total,
+                                          uint simd_lane_id,
+                                          uint simd_group_id,
+                                          uint simd_per_group) {
+    const uint prefix = simd_prefix_exclusive_sum(value);
+    if (simd_lane_id == simd_size - 1) {
+        simd_totals[simd_group_id] = prefix + value;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    uint offset = 0;
+    total = 0;
+    for (uint group = 0; group < simd_per_group; group++) {
+        offset += group < simd_group_id ? simd_totals[group] : 0;
+        total += simd_totals[group];
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    return offset + prefix;
+}
+
+// Every block sorts RADIX_SIZE keys at a time by their digit in threadgroup memory with one bit splits,
+// then writes each run of equal digits after the keys of the previous blocks and tiles. Stable.
+template <typename K>
+[[kernel]] void radix_scatter(constant RadixArguments<K> &args,
+                              uint lid [[thread_position_in_threadgroup]],
+                              uint tgid [[threadgroup_position_in_grid]],
+                              uint blocks [[threadgroups_per_grid]],
+                              uint simd_per_group [[simdgroups_per_threadgroup]],
+                              uint simd_lane_id [[thread_index_in_simdgroup]],
+                              uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup uint next_offset[RADIX_SIZE];
+    threadgroup uint run_start[RADIX_SIZE];
+    threadgroup uint simd_totals[simd_size];
+    threadgroup K tile_keys[RADIX_SIZE];
+    threadgroup uint tile_values[RADIX_SIZE];
+    threadgroup uint tile_digits[RADIX_SIZE];
+
+    next_offset[lid] = args.block_offsets[size_t(lid) * blocks + tgid];
+
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    for (size_t tile = begin; tile < end; tile += RADIX_SIZE) {
+        const size_t index = tile + lid;
+        const bool valid = index < end;
+        K key = valid ? args.keys_in[index] : K(0);
+        uint value = valid && args.values_in ? args.values_in[index] : 0;
+        // The missing keys of the last tile sort after every digit
+        uint digit = valid ? radix_digit(key, args.shift) : RADIX_SIZE;
+
+        uint position = lid;
+        for (uint bit = 0; bit <= RADIX_BITS; bit++) {
+            const uint is_set = (digit >> bit) & 1;
+            uint zeros;
+            const uint zeros_before = threadgroup_exclusive_sum(1 - is_set, simd_totals, zeros,
+                                                                simd_lane_id, simd_group_id, simd_per_group);
+            position = is_set ? zeros + (lid - zeros_before) : zeros_before;
+            tile_keys[position] = key;
+            tile_values[position] = value;
+            tile_digits[position] = digit;
+            threadgroup_barrier(mem_flags::mem_threadgroup);
+            key = tile_keys[lid];
+            value = tile_values[lid];
+            digit = tile_digits[lid];
+            threadgroup_barrier(mem_flags::mem_threadgroup);
+        }
+
+        const bool run_begins = lid == 0 || tile_digits[lid - 1] != digit;
+        const bool run_ends = lid == RADIX_SIZE - 1 || tile_digits[lid + 1] != digit;
+        if (digit < RADIX_SIZE && run_begins) {
+            run_start[digit] = lid;
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        if (digit < RADIX_SIZE) {
+            const uint destination = next_offset[digit] + (lid - run_start[digit]);
+            args.keys_out[destination] = key;
+            if (args.values_in) {
+                args.values_out[destination] = value;
+            }
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+        if (digit < RADIX_SIZE && run_ends) {
+            next_offset[digit] += lid - run_start[digit] + 1;
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+}
+
+#define instantiate_radix_sort(tname, type) \
+  template [[host_name("radix_histogram_" #tname)]] \
+  [[kernel]] void radix_histogram<type>( \
+      constant RadixArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint blocks [[threadgroups_per_grid]]); \
+  template [[host_name("radix_scatter_" #tname)]] \
+  [[kernel]] void radix_scatter<type>( \
+      constant RadixArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint blocks [[threadgroups_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]);
+
+instantiate_radix_sort(uint32, uint32_t)
+instantiate_radix_sort(uint64, uint64_t)
+instantiate_radix_sort(int32, int32_t)
+instantiate_radix_sort(float32, float)
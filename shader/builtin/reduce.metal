@@ -12,102 +12,144 @@
 
 using namespace metal;
 
+// Must match n_reads in runtime/primitives/reduce.cpp
 static constant constexpr int REDUCE_N_READS = 16;
 
 static constant uint8_t simd_size = 32;
 
+// Same layout as the arguments encoded by runtime/primitives/reduce.cpp
+template <typename T>
+struct InitReduceArguments {
+    device T *out;
+};
+
+template <typename T, typename U>
+struct AllReduceArguments {
+    const device T *in;
+    device U *out;
+    uint64_t in_size;
+};
+
 template <typename T, typename Op>
-[[kernel]] void init_reduce(device T *out [[buffer(0)]],
+[[kernel]] void init_reduce(constant InitReduceArguments<T> &args,
                             uint tid [[thread_position_in_grid]]) {
-    out[tid] = Op::init;
+    args.out[tid] = Op::init;
 }
 
 #define instantiate_init_reduce(name, otype, op) \
   template [[host_name("i" #name)]] \
     [[kernel]] void init_reduce<otype, op>( \
-      device otype *out [[buffer(1)]], \
+      constant InitReduceArguments<otype> &args, \
       uint tid [[thread_position_in_grid]]);
 
 ///////////////////////////////////////////////////////////////////////////////
 //MARK: - All reduce
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename T, typename U, typename Op, int N_READS=REDUCE_N_READS>
-[[kernel]] void all_reduce(const device T *in [[buffer(0)]],
-                           device mlx_atomic<U> *out [[buffer(1)]],
-                           const device size_t& in_size [[buffer(2)]],
-                           const device size_t& in_stride [[buffer(3)]],
-                           uint gid [[thread_position_in_grid]],
-                           uint lid [[thread_position_in_threadgroup]],
-                           uint grid_size [[threads_per_grid]],
-                           uint simd_per_group [[simdgroups_per_threadgroup]],
-                           uint simd_lane_id [[thread_index_in_simdgroup]],
-                           uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+// Reduction of the values read by a threadgroup, valid in the thread with lid == 0
+template <typename T, typename Op, int N_READS=REDUCE_N_READS>
+METAL_FUNC T threadgroup_all_reduce(const device T *in,
+                                    size_t in_size,
+                                    threadgroup T *local_vals,
+                                    uint gid,
+                                    uint lid,
+                                    uint grid_size,
+                                    uint simd_per_group,
+                                    uint simd_lane_id,
+                                    uint simd_group_id) {
     // NB: this kernel assumes threads_per_threadgroup is at most
     // 1024. This way with a simd_size of 32, we are guaranteed to
     // complete the reduction in two steps of simd-level reductions.
-    
+
     Op op;
-    threadgroup T local_vals[simd_size];
-    
     T total_val = Op::init;
-    
+
     in += gid * N_READS;
-    
+
     int r = 0;
     for(; r < (int)ceildiv(in_size, grid_size * N_READS) - 1; r++) {
         T vals[N_READS] = {op.init};
-        
+
         for(int i = 0; i < N_READS; i++) {
-            vals[i] = in[i * in_stride];
+            vals[i] = in[i];
         }
         for(int i = 0; i < N_READS; i++) {
             total_val = op(vals[i], total_val);
         }
-        
+
         in += grid_size * N_READS;
     }
-    
+
     // Separate case for the last set as we close the reduction size
     size_t curr_idx = (gid + r * (size_t)grid_size) * N_READS;
     if (curr_idx < in_size) {
         int max_reads = in_size - curr_idx;
         T vals[N_READS];
-        
+
         for(int i = 0, idx = 0; i < N_READS; i++, idx++) {
             idx = idx < max_reads ? idx : max_reads - 1;
-            vals[i] = in[idx * in_stride];
+            vals[i] = in[idx];
         }
         for(int i = 0; i < N_READS; i++) {
             T val = i < max_reads ? vals[i] : Op::init;
             total_val = op(val, total_val);
         }
     }
-    
+
     // Reduction within simd group
     total_val = op.simd_reduce(total_val);
     if (simd_lane_id == 0) {
         local_vals[simd_group_id] = total_val;
     }
-    
+
     // Reduction within thread group
     threadgroup_barrier(mem_flags::mem_threadgroup);
     total_val = lid < simd_per_group ? local_vals[lid] : op.init;
-    total_val = op.simd_reduce(total_val);
-    
+    return op.simd_reduce(total_val);
+}
+
+template <typename T, typename U, typename Op, int N_READS=REDUCE_N_READS>
+[[kernel]] void all_reduce(constant AllReduceArguments<T, mlx_atomic<U>> &args,
+                           uint gid [[thread_position_in_grid]],
+                           uint lid [[thread_position_in_threadgroup]],
+                           uint grid_size [[threads_per_grid]],
+                           uint simd_per_group [[simdgroups_per_threadgroup]],
+                           uint simd_lane_id [[thread_index_in_simdgroup]],
+                           uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup T local_vals[simd_size];
+    T total_val = threadgroup_all_reduce<T, Op, N_READS>(
+        args.in, args.in_size, local_vals, gid, lid, grid_size, simd_per_group, simd_lane_id, simd_group_id);
+
     // Reduction across threadgroups
     if (lid == 0) {
-        op.atomic_update(out, total_val);
+        Op op;
+        op.atomic_update(args.out, total_val);
+    }
+}
+
+// Atomics-free variant, every threadgroup writes its partial result which a second pass reduces
+template <typename T, typename Op, int N_READS=REDUCE_N_READS>
+[[kernel]] void all_reduce_no_atomics(constant AllReduceArguments<T, T> &args,
+                                      uint gid [[thread_position_in_grid]],
+                                      uint lid [[thread_position_in_threadgroup]],
+                                      uint tgid [[threadgroup_position_in_grid]],
+                                      uint grid_size [[threads_per_grid]],
+                                      uint simd_per_group [[simdgroups_per_threadgroup]],
+                                      uint simd_lane_id [[thread_index_in_simdgroup]],
+                                      uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup T local_vals[simd_size];
+    T total_val = threadgroup_all_reduce<T, Op, N_READS>(
+        args.in, args.in_size, local_vals, gid, lid, grid_size, simd_per_group, simd_lane_id, simd_group_id);
+
+    if (lid == 0) {
+        args.out[tgid] = total_val;
     }
 }
 
 #define instantiate_all_reduce(name, itype, otype, op) \
   template [[host_name("all_reduce_" #name)]] \
   [[kernel]] void all_reduce<itype, otype, op>( \
-      const device itype *in [[buffer(0)]], \
-      device mlx_atomic<otype> *out [[buffer(1)]], \
-      const device size_t& in_size [[buffer(2)]], \
-      const device size_t& byte_stride [[buffer(3)]], \
+      constant AllReduceArguments<itype, mlx_atomic<otype>> &args, \
       uint gid [[thread_position_in_grid]], \
       uint lid [[thread_position_in_threadgroup]], \
       uint grid_size [[threads_per_grid]], \
@@ -115,47 +157,191 @@ template <typename T, typename U, typename Op, int N_READS=REDUCE_N_READS>
       uint simd_lane_id [[thread_index_in_simdgroup]], \
       uint simd_group_id [[simdgroup_index_in_threadgroup]]);
 
+#define instantiate_all_reduce_no_atomics(name, type, op) \
+  template [[host_name("all_reduce_no_atomics_" #name)]] \
+  [[kernel]] void all_reduce_no_atomics<type, op>( \
+      constant AllReduceArguments<type, type> &args, \
+      uint gid [[thread_position_in_grid]], \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint grid_size [[threads_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]);
+
+///////////////////////////////////////////////////////////////////////////////
+//MARK: - Axis reduce
+///////////////////////////////////////////////////////////////////////////////
+
+// Must match max_reduce_dims in runtime/primitives/reduce.cpp
+static constant constexpr int MAX_REDUCE_DIMS = 8;
+
+// The input viewed as [out_size / reduction_stride, reduction_size, reduction_stride]
+template <typename T>
+struct StridedReduceArguments {
+    const device T *in;
+    device T *out;
+    uint64_t out_size;
+    uint64_t reduction_size;
+    uint64_t reduction_stride;
+};
+
+template <typename T>
+struct GeneralReduceArguments {
+    const device T *in;
+    device T *out;
+    uint64_t out_size;
+    uint64_t reduction_size;
+    int out_ndim;
+    int reduce_ndim;
+    int out_shape[MAX_REDUCE_DIMS];
+    int reduce_shape[MAX_REDUCE_DIMS];
+    int64_t out_strides[MAX_REDUCE_DIMS];
+    int64_t reduce_strides[MAX_REDUCE_DIMS];
+};
+
+// One threadgroup per output, the reduced elements are contiguous
+template <typename T, typename Op, int N_READS=REDUCE_N_READS>
+[[kernel]] void row_reduce(constant StridedReduceArguments<T> &args,
+                           uint lid [[thread_position_in_threadgroup]],
+                           uint tgid [[threadgroup_position_in_grid]],
+                           uint tg_size [[threads_per_threadgroup]],
+                           uint simd_per_group [[simdgroups_per_threadgroup]],
+                           uint simd_lane_id [[thread_index_in_simdgroup]],
+                           uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    Op op;
+    threadgroup T local_vals[simd_size];
+
+    const device T *in = args.in + tgid * args.reduction_size;
+    T total_val = Op::init;
+    for (size_t i = lid * N_READS; i < args.reduction_size; i += tg_size * N_READS) {
+        for (int r = 0; r < N_READS; r++) {
+            T val = i + r < args.reduction_size ? in[i + r] : Op::init;
+            total_val = op(val, total_val);
+        }
+    }
+
+    total_val = op.simd_reduce(total_val);
+    if (simd_lane_id == 0) {
+        local_vals[simd_group_id] = total_val;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    total_val = lid < simd_per_group ? local_vals[lid] : op.init;
+    total_val = op.simd_reduce(total_val);
+
+    if (lid == 0) {
+        args.out[tgid] = total_val;
+    }
+}
+
+// One thread per output, neighbouring threads read neighbouring columns
+template <typename T, typename Op>
+[[kernel]] void col_reduce(constant StridedReduceArguments<T> &args,
+                           uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.out_size) {
+        return;
+    }
+    Op op;
+    const size_t outer = gid / args.reduction_stride;
+    const size_t column = gid % args.reduction_stride;
+    const device T *in = args.in + outer * args.reduction_size * args.reduction_stride + column;
+
+    T total_val = Op::init;
+    for (size_t i = 0; i < args.reduction_size; i++) {
+        total_val = op(in[i * args.reduction_stride], total_val);
+    }
+    args.out[gid] = total_val;
+}
+
+// Any axes of any strided layout, one thread per output
+template <typename T, typename Op>
+[[kernel]] void general_reduce(constant GeneralReduceArguments<T> &args,
+                               uint gid [[thread_position_in_grid]]) {
+    if (gid >= args.out_size) {
+        return;
+    }
+    Op op;
+    int64_t base = 0;
+    size_t index = gid;
+    for (int d = args.out_ndim - 1; d >= 0; d--) {
+        base += (index % args.out_shape[d]) * args.out_strides[d];
+        index /= args.out_shape[d];
+    }
+
+    T total_val = Op::init;
+    for (size_t r = 0; r < args.reduction_size; r++) {
+        int64_t offset = base;
+        size_t reduce_index = r;
+        for (int d = args.reduce_ndim - 1; d >= 0; d--) {
+            offset += (reduce_index % args.reduce_shape[d]) * args.reduce_strides[d];
+            reduce_index /= args.reduce_shape[d];
+        }
+        total_val = op(args.in[offset], total_val);
+    }
+    args.out[gid] = total_val;
+}
+
+#define instantiate_axis_reduce(name, type, op) \
+  template [[host_name("row_reduce_" #name)]] \
+  [[kernel]] void row_reduce<type, op>( \
+      constant StridedReduceArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]); \
+  template [[host_name("col_reduce_" #name)]] \
+  [[kernel]] void col_reduce<type, op>( \
+      constant StridedReduceArguments<type> &args, \
+      uint gid [[thread_position_in_grid]]); \
+  template [[host_name("general_reduce_" #name)]] \
+  [[kernel]] void general_reduce<type, op>( \
+      constant GeneralReduceArguments<type> &args, \
+      uint gid [[thread_position_in_grid]]);
+
 instantiate_all_reduce(sum_float4, float4, float, Sum<float4>)
 instantiate_all_reduce(sum_float2, float2, float, Sum<float2>)
 instantiate_all_reduce(prod_float4, float4, float, Prod<float4>)
 instantiate_all_reduce(prod_float2, float2, float, Prod<float2>)
 
+// Up to 32 bits, the atomic updates of smaller types are emulated on uint
 #define instantiate_same_reduce(name, tname, type, op) \
   instantiate_init_reduce(name ##tname, type, op<type>) \
-  instantiate_all_reduce(name ##tname, type, type, op<type>)
-
-instantiate_same_reduce(sum, uint8, uint8_t, Sum)
-instantiate_same_reduce(sum, uint16, uint16_t, Sum)
-instantiate_same_reduce(sum, uint32, uint32_t, Sum)
-instantiate_same_reduce(sum, int8, int8_t, Sum)
-instantiate_same_reduce(sum, int16, int16_t, Sum)
-instantiate_same_reduce(sum, int32, int32_t, Sum)
-instantiate_same_reduce(sum, float16, half, Sum)
-instantiate_same_reduce(sum, float32, float, Sum)
-
-instantiate_same_reduce(prod, uint8, uint8_t, Prod)
-instantiate_same_reduce(prod, uint16, uint16_t, Prod)
-instantiate_same_reduce(prod, uint32, uint32_t, Prod)
-instantiate_same_reduce(prod, int8, int8_t, Prod)
-instantiate_same_reduce(prod, int16, int16_t, Prod)
-instantiate_same_reduce(prod, int32, int32_t, Prod)
-instantiate_same_reduce(prod, float16, half, Prod)
-instantiate_same_reduce(prod, float32, float, Prod)
-
-instantiate_same_reduce(min_, uint8, uint8_t, Min)
-instantiate_same_reduce(min_, uint16, uint16_t, Min)
-instantiate_same_reduce(min_, uint32, uint32_t, Min)
-instantiate_same_reduce(min_, int8, int8_t, Min)
-instantiate_same_reduce(min_, int16, int16_t, Min)
-instantiate_same_reduce(min_, int32, int32_t, Min)
-instantiate_same_reduce(min_, float16, half, Min)
-instantiate_same_reduce(min_, float32, float, Min)
-
-instantiate_same_reduce(max_, uint8, uint8_t, Max)
-instantiate_same_reduce(max_, uint16, uint16_t, Max)
-instantiate_same_reduce(max_, uint32, uint32_t, Max)
-instantiate_same_reduce(max_, int8, int8_t, Max)
-instantiate_same_reduce(max_, int16, int16_t, Max)
-instantiate_same_reduce(max_, int32, int32_t, Max)
-instantiate_same_reduce(max_, float16, half, Max)
-instantiate_same_reduce(max_, float32, float, Max)
+  instantiate_all_reduce(name ##tname, type, type, op<type>) \
+  instantiate_all_reduce_no_atomics(name ##tname, type, op<type>) \
+  instantiate_axis_reduce(name ##tname, type, op<type>)
+
+// 64 bit types only have the two-pass path
+#define instantiate_reduce_no_atomics(name, tname, type, op) \
+  instantiate_init_reduce(name ##tname, type, op) \
+  instantiate_all_reduce_no_atomics(name ##tname, type, op) \
+  instantiate_axis_reduce(name ##tname, type, op)
+
+#define instantiate_reduce_ops(tname, type) \
+  instantiate_same_reduce(sum, tname, type, Sum) \
+  instantiate_same_reduce(prod, tname, type, Prod) \
+  instantiate_same_reduce(min_, tname, type, Min) \
+  instantiate_same_reduce(max_, tname, type, Max) \
+  instantiate_reduce_no_atomics(and, tname, type, And) \
+  instantiate_reduce_no_atomics(or, tname, type, Or)
+
+#define instantiate_reduce_ops_no_atomics(tname, type) \
+  instantiate_reduce_no_atomics(sum, tname, type, Sum<type>) \
+  instantiate_reduce_no_atomics(prod, tname, type, Prod<type>) \
+  instantiate_reduce_no_atomics(min_, tname, type, Min<type>) \
+  instantiate_reduce_no_atomics(max_, tname, type, Max<type>) \
+  instantiate_reduce_no_atomics(and, tname, type, And) \
+  instantiate_reduce_no_atomics(or, tname, type, Or)
+
+instantiate_reduce_ops(uint8, uint8_t)
+instantiate_reduce_ops(uint16, uint16_t)
+instantiate_reduce_ops(uint32, uint32_t)
+instantiate_reduce_ops(int8, int8_t)
+instantiate_reduce_ops(int16, int16_t)
+instantiate_reduce_ops(int32, int32_t)
+instantiate_reduce_ops(float16, half)
+instantiate_reduce_ops(float32, float)
+
+instantiate_reduce_ops_no_atomics(uint64, uint64_t)
+instantiate_reduce_ops_no_atomics(int64, int64_t)
@@ -0,0 +1,37 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <metal_simdgroup>
+
+#include "utils.h"
+
+static constant uint8_t simd_size = 32;
+
+// Value of a range, flag if a segment starts inside it
+template <typename T>
+struct ScanPair {
+    T val;
+    uint flag;
+};
+
+// a precedes b, a segment start in b hides a
+template <typename T, typename Op>
+METAL_FUNC ScanPair<T> combine(ScanPair<T> a, ScanPair<T> b, Op op) {
+    return ScanPair<T>{b.flag ? b.val : op(a.val, b.val), a.flag | b.flag};
+}
+
+template <typename T, typename Op>
+METAL_FUNC ScanPair<T> simd_inclusive_scan(ScanPair<T> pair, uint simd_lane_id, Op op) {
+    for (ushort offset = 1; offset < simd_size; offset <<= 1) {
+        ScanPair<T> other{simd_shuffle_up(pair.val, offset), simd_shuffle_up(pair.flag, offset)};
+        if (simd_lane_id >= offset) {
+            pair = combine(other, pair, op);
+        }
+    }
+    return pair;
+}
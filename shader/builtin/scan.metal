@@ -0,0 +1,175 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_atomic>
+#include <metal_simdgroup>
+
+#include "reduce.h"
+#include "scan.h"
+#include "utils.h"
+
+using namespace metal;
+
+// Must match n_reads in runtime/primitives/scan.cpp
+static constant constexpr int SCAN_N_READS = 8;
+
+// Tile status of the decoupled lookback, the segment flag of the tile is in the next bit
+static constant constexpr uint STATUS_AGGREGATE = 1;
+static constant constexpr uint STATUS_PREFIX = 2;
+static constant constexpr uint STATUS_FLAG = 4;
+
+// Same layout as the arguments encoded by runtime/primitives/scan.cpp
+template <typename T>
+struct ScanArguments {
+    const device T *in;
+    // Non zero where a segment starts, nullptr for a single segment
+    const device uint8_t *flags;
+    device T *out;
+    // One per tile, followed by the counter handing out the tiles in launch order
+    device atomic_uint *status;
+    device T *aggregates;
+    device T *prefixes;
+    uint64_t size;
+    uint64_t inclusive;
+};
+
+// Single pass, every tile waits for the prefix of the tiles before it by looking back at their status
+template <typename T, typename Op, int N_READS=SCAN_N_READS>
+[[kernel]] void scan_lookback(constant ScanArguments<T> &args,
+                              uint lid [[thread_position_in_threadgroup]],
+                              uint tg_size [[threads_per_threadgroup]],
+                              uint tiles [[threadgroups_per_grid]],
+                              uint simd_per_group [[simdgroups_per_threadgroup]],
+                              uint simd_lane_id [[thread_index_in_simdgroup]],
+                              uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    Op op;
+    threadgroup uint shared_tile;
+    threadgroup ScanPair<T> simd_totals[simd_size];
+    threadgroup ScanPair<T> tile_prefix;
+
+    // The tiles are numbered in the order the threadgroups start, a tile never waits on one which isn't running
+    if (lid == 0) {
+        shared_tile = atomic_fetch_add_explicit(&args.status[tiles], 1, memory_order_relaxed);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    const uint tile = shared_tile;
+
+    // Every thread scans N_READS consecutive elements
+    const size_t start = (size_t(tile) * tg_size + lid) * N_READS;
+    ScanPair<T> vals[N_READS];
+    ScanPair<T> thread_total{Op::init, 0};
+    for (int i = 0; i < N_READS; i++) {
+        const size_t index = start + i;
+        vals[i] = index < args.size ? ScanPair<T>{args.in[index], args.flags ? uint(args.flags[index] != 0) : 0}
+                                    : ScanPair<T>{Op::init, 0};
+        thread_total = combine(thread_total, vals[i], op);
+    }
+
+    // Exclusive prefix of the thread inside the tile
+    ScanPair<T> simd_scan = simd_inclusive_scan(thread_total, simd_lane_id, op);
+    if (simd_lane_id == simd_size - 1) {
+        simd_totals[simd_group_id] = simd_scan;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    if (simd_group_id == 0) {
+        ScanPair<T> total = simd_lane_id < simd_per_group ? simd_totals[simd_lane_id] : ScanPair<T>{Op::init, 0};
+        simd_totals[simd_lane_id] = simd_inclusive_scan(total, simd_lane_id, op);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    ScanPair<T> thread_prefix{Op::init, 0};
+    ScanPair<T> simd_prefix = ScanPair<T>{simd_shuffle_up(simd_scan.val, 1), simd_shuffle_up(simd_scan.flag, 1)};
+    if (simd_lane_id > 0) {
+        thread_prefix = simd_prefix;
+    }
+    if (simd_group_id > 0) {
+        thread_prefix = combine(simd_totals[simd_group_id - 1], thread_prefix, op);
+    }
+
+    if (lid == 0) {
+        const ScanPair<T> aggregate = simd_totals[simd_per_group - 1];
+        ScanPair<T> exclusive{Op::init, 0};
+        if (tile == 0) {
+            args.prefixes[tile] = aggregate.val;
+            atomic_thread_fence(mem_flags::mem_device, memory_order_seq_cst, thread_scope_device);
+            atomic_store_explicit(&args.status[tile], STATUS_PREFIX | (aggregate.flag ? STATUS_FLAG : 0),
+                                  memory_order_relaxed);
+        } else {
+            args.aggregates[tile] = aggregate.val;
+            atomic_thread_fence(mem_flags::mem_device, memory_order_seq_cst, thread_scope_device);
+            atomic_store_explicit(&args.status[tile], STATUS_AGGREGATE | (aggregate.flag ? STATUS_FLAG : 0),
+                                  memory_order_relaxed);
+
+            // Combine the tiles before until one has its prefix or starts a segment
+            for (int previous = int(tile) - 1; previous >= 0 && !exclusive.flag;) {
+                const uint status = atomic_load_explicit(&args.status[previous], memory_order_relaxed);
+                if (status == 0) {
+                    continue;
+                }
+                atomic_thread_fence(mem_flags::mem_device, memory_order_seq_cst, thread_scope_device);
+                const uint flag = (status & STATUS_FLAG) ? 1 : 0;
+                if (status & STATUS_PREFIX) {
+                    exclusive = combine(ScanPair<T>{args.prefixes[previous], flag}, exclusive, op);
+                    break;
+                }
+                exclusive = combine(ScanPair<T>{args.aggregates[previous], flag}, exclusive, op);
+                previous--;
+            }
+
+            const ScanPair<T> inclusive = combine(exclusive, aggregate, op);
+            args.prefixes[tile] = inclusive.val;
+            atomic_thread_fence(mem_flags::mem_device, memory_order_seq_cst, thread_scope_device);
+            atomic_store_explicit(&args.status[tile], STATUS_PREFIX | (inclusive.flag ? STATUS_FLAG : 0),
+                                  memory_order_relaxed);
+        }
+        tile_prefix = exclusive;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    ScanPair<T> running = combine(tile_prefix, thread_prefix, op);
+    for (int i = 0; i < N_READS; i++) {
+        const size_t index = start + i;
+        if (index >= args.size) {
+            break;
+        }
+        if (args.inclusive) {
+            running = combine(running, vals[i], op);
+            args.out[index] = running.val;
+        } else {
+            // The first element of a segment gets the identity
+            args.out[index] = vals[i].flag ? Op::init : running.val;
+            running = combine(running, vals[i], op);
+        }
+    }
+}
+
+#define instantiate_scan_helper(name, type, op) \
+  template [[host_name("scan_lookback_" #name)]] \
+  [[kernel]] void scan_lookback<type, op>( \
+      constant ScanArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint tiles [[threadgroups_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]);
+
+#define instantiate_scan(tname, type) \
+  instantiate_scan_helper(sum ##tname, type, Sum<type>) \
+  instantiate_scan_helper(prod ##tname, type, Prod<type>) \
+  instantiate_scan_helper(min_ ##tname, type, Min<type>) \
+  instantiate_scan_helper(max_ ##tname, type, Max<type>)
+
+instantiate_scan(uint8, uint8_t)
+instantiate_scan(uint16, uint16_t)
+instantiate_scan(uint32, uint32_t)
+instantiate_scan(uint64, uint64_t)
+instantiate_scan(int8, int8_t)
+instantiate_scan(int16, int16_t)
+instantiate_scan(int32, int32_t)
+instantiate_scan(int64, int64_t)
+instantiate_scan(float16, half)
+instantiate_scan(float32, float)
@@ -0,0 +1,297 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include <metal_simdgroup>
+
+#include "reduce.h"
+#include "scan.h"
+#include "utils.h"
+
+using namespace metal;
+
+// Must match n_reads in runtime/primitives/segmented_reduce.cpp
+static constant constexpr int SEGMENTED_N_READS = 8;
+
+// Same layout as the arguments encoded by runtime/primitives/segmented_reduce.cpp
+template <typename T>
+struct SegmentedReduceArguments {
+    const device T *in;
+    // Segment s holds the elements offsets[s] to offsets[s + 1], num_segments + 1 of them
+    const device uint32_t *offsets;
+    device T *out;
+    // Reduction of the elements at the start of every tile which belong to a segment starting before it
+    device T *leading;
+    // Number of segments written by reduce_by_key_scatter, nullptr to use num_segments
+    const device uint32_t *segment_count;
+    uint64_t size;
+    uint64_t num_segments;
+    uint64_t tile_size;
+};
+
+template <typename T>
+METAL_FUNC uint segment_count(constant SegmentedReduceArguments<T> &args) {
+    return args.segment_count ? *args.segment_count : uint(args.num_segments);
+}
+
+// Last segment starting at or before index, -1 if there isn't any
+template <typename T>
+METAL_FUNC int find_segment(constant SegmentedReduceArguments<T> &args, uint segments, uint index) {
+    int low = 0;
+    int high = int(segments);
+    while (low < high) {
+        const int middle = (low + high) / 2;
+        if (args.offsets[middle] <= index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low - 1;
+}
+
+// Every threadgroup reduces one tile of elements whatever the length of the segments, as a segmented scan.
+// The last element of a segment in the tile holds its reduction, written to out if the segment starts in
+// the tile and to leading otherwise.
+template <typename T, typename Op, int N_READS=SEGMENTED_N_READS>
+[[kernel]] void segmented_reduce_tiles(constant SegmentedReduceArguments<T> &args,
+                                       uint lid [[thread_position_in_threadgroup]],
+                                       uint tgid [[threadgroup_position_in_grid]],
+                                       uint simd_per_group [[simdgroups_per_threadgroup]],
+                                       uint simd_lane_id [[thread_index_in_simdgroup]],
+                                       uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    Op op;
+    threadgroup ScanPair<T> simd_totals[simd_size];
+
+    const uint segments = segment_count(args);
+    const size_t tile_begin = size_t(tgid) * args.tile_size;
+    const size_t tile_end = min(tile_begin + args.tile_size, args.size);
+
+    // Segment of every element read by the thread, -1 outside of the segments
+    const size_t start = tile_begin + size_t(lid) * N_READS;
+    int segment = find_segment(args, segments, uint(start));
+    ScanPair<T> vals[N_READS];
+    int ids[N_READS];
+    ScanPair<T> thread_total{Op::init, 0};
+    for (int i = 0; i < N_READS; i++) {
+        const size_t index = start + i;
+        while (segment + 1 < int(segments) && args.offsets[segment + 1] <= index) {
+            segment++;
+        }
+        const bool valid = index < tile_end && segment >= 0 && index < args.offsets[segment + 1];
+        ids[i] = valid ? segment : -1;
+        vals[i] = valid ? ScanPair<T>{args.in[index], uint(args.offsets[segment] == index)} : ScanPair<T>{Op::init, 1};
+        thread_total = combine(thread_total, vals[i], op);
+    }
+
+    // Exclusive prefix of the thread inside the tile
+    ScanPair<T> simd_scan = simd_inclusive_scan(thread_total, simd_lane_id, op);
+    if (simd_lane_id == simd_size - 1) {
+        simd_totals[simd_group_id] = simd_scan;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    if (simd_group_id == 0) {
+        ScanPair<T> total = simd_lane_id < simd_per_group ? simd_totals[simd_lane_id] : ScanPair<T>{Op::init, 0};
+        simd_totals[simd_lane_id] = simd_inclusive_scan(total, simd_lane_id, op);
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+
+    ScanPair<T> running{Op::init, 0};
+    ScanPair<T> simd_prefix = ScanPair<T>{simd_shuffle_up(simd_scan.val, 1), simd_shuffle_up(simd_scan.flag, 1)};
+    if (simd_lane_id > 0) {
+        running = simd_prefix;
+    }
+    if (simd_group_id > 0) {
+        running = combine(simd_totals[simd_group_id - 1], running, op);
+    }
+
+    for (int i = 0; i < N_READS; i++) {
+        running = combine(running, vals[i], op);
+        const int id = ids[i];
+        const size_t index = start + i;
+        if (id >= 0 && (index + 1 == tile_end || index + 1 == args.offsets[id + 1])) {
+            if (args.offsets[id] >= tile_begin) {
+                args.out[id] = running.val;
+            } else {
+                args.leading[tgid] = running.val;
+            }
+        }
+    }
+}
+
+// One thread per segment, adds the leading reductions of the tiles the segment spans after its first one
+template <typename T, typename Op>
+[[kernel]] void segmented_reduce_fixup(constant SegmentedReduceArguments<T> &args,
+                                       uint gid [[thread_position_in_grid]]) {
+    if (gid >= segment_count(args)) {
+        return;
+    }
+    Op op;
+    const size_t begin = args.offsets[gid];
+    const size_t end = args.offsets[gid + 1];
+    if (begin >= end) {
+        args.out[gid] = Op::init;
+        return;
+    }
+    T total = args.out[gid];
+    for (size_t tile = begin / args.tile_size + 1; tile <= (end - 1) / args.tile_size; tile++) {
+        total = op(total, args.leading[tile]);
+    }
+    args.out[gid] = total;
+}
+
+// Same layout as the arguments encoded by runtime/primitives/segmented_reduce.cpp
+template <typename K>
+struct ReduceByKeyArguments {
+    const device K *keys;
+    device K *keys_out;
+    // Index of the first element of every run, followed by size
+    device uint32_t *offsets;
+    device uint32_t *count;
+    // Runs starting in every block and a trailing 0. Counts for the count, exclusive scan of them for the scatter
+    device uint32_t *block_offsets;
+    uint64_t size;
+    uint64_t block_size;
+};
+
+template <typename K>
+METAL_FUNC bool run_starts(constant ReduceByKeyArguments<K> &args, size_t i) {
+    return i == 0 || args.keys[i] != args.keys[i - 1];
+}
+
+// Runs starting in every block, like compact_count
+template <typename K>
+[[kernel]] void reduce_by_key_count(constant ReduceByKeyArguments<K> &args,
+                                    uint lid [[thread_position_in_threadgroup]],
+                                    uint tgid [[threadgroup_position_in_grid]],
+                                    uint tg_size [[threads_per_threadgroup]],
+                                    uint blocks [[threadgroups_per_grid]],
+                                    uint simd_per_group [[simdgroups_per_threadgroup]],
+                                    uint simd_lane_id [[thread_index_in_simdgroup]],
+                                    uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup uint simd_counts[simd_size];
+
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    uint count = 0;
+    for (size_t i = begin + lid; i < end; i += tg_size) {
+        count += run_starts(args, i) ? 1 : 0;
+    }
+
+    count = simd_sum(count);
+    if (simd_lane_id == 0) {
+        simd_counts[simd_group_id] = count;
+    }
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    if (lid == 0) {
+        uint total = 0;
+        for (uint group = 0; group < simd_per_group; group++) {
+            total += simd_counts[group];
+        }
+        args.block_offsets[tgid] = total;
+        if (tgid == 0) {
+            args.block_offsets[blocks] = 0;
+        }
+    }
+}
+
+// Key and first element of every run, ranked with a ballot like compact_scatter
+template <typename K>
+[[kernel]] void reduce_by_key_scatter(constant ReduceByKeyArguments<K> &args,
+                                      uint lid [[thread_position_in_threadgroup]],
+                                      uint tgid [[threadgroup_position_in_grid]],
+                                      uint tg_size [[threads_per_threadgroup]],
+                                      uint blocks [[threadgroups_per_grid]],
+                                      uint simd_per_group [[simdgroups_per_threadgroup]],
+                                      uint simd_lane_id [[thread_index_in_simdgroup]],
+                                      uint simd_group_id [[simdgroup_index_in_threadgroup]]) {
+    threadgroup uint simd_counts[simd_size];
+
+    if (tgid == 0 && lid == 0) {
+        const uint runs = args.block_offsets[blocks];
+        *args.count = runs;
+        args.offsets[runs] = uint(args.size);
+    }
+
+    const ulong lanes_before = (ulong(1) << simd_lane_id) - 1;
+    size_t offset = args.block_offsets[tgid];
+    const size_t begin = size_t(tgid) * args.block_size;
+    const size_t end = min(begin + args.block_size, args.size);
+    for (size_t tile = begin; tile < end; tile += tg_size) {
+        const size_t i = tile + lid;
+        const bool head = i < end && run_starts(args, i);
+        const ulong ballot = ulong(simd_vote::vote_t(simd_ballot(head)));
+        if (simd_lane_id == 0) {
+            simd_counts[simd_group_id] = popcount(ballot);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        uint before = 0;
+        uint total = 0;
+        for (uint group = 0; group < simd_per_group; group++) {
+            before += group < simd_group_id ? simd_counts[group] : 0;
+            total += simd_counts[group];
+        }
+        if (head) {
+            const size_t run = offset + before + popcount(ballot & lanes_before);
+            args.keys_out[run] = args.keys[i];
+            args.offsets[run] = uint(i);
+        }
+        offset += total;
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+}
+
+#define instantiate_segmented_reduce_helper(name, type, op) \
+  template [[host_name("segmented_reduce_tiles_" #name)]] \
+  [[kernel]] void segmented_reduce_tiles<type, op>( \
+      constant SegmentedReduceArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]); \
+  template [[host_name("segmented_reduce_fixup_" #name)]] \
+  [[kernel]] void segmented_reduce_fixup<type, op>( \
+      constant SegmentedReduceArguments<type> &args, \
+      uint gid [[thread_position_in_grid]]);
+
+#define instantiate_segmented_reduce(tname, type) \
+  instantiate_segmented_reduce_helper(sum ##tname, type, Sum<type>) \
+  instantiate_segmented_reduce_helper(prod ##tname, type, Prod<type>) \
+  instantiate_segmented_reduce_helper(min_ ##tname, type, Min<type>) \
+  instantiate_segmented_reduce_helper(max_ ##tname, type, Max<type>)
+
+instantiate_segmented_reduce(uint8, uint8_t)
+instantiate_segmented_reduce(uint16, uint16_t)
+instantiate_segmented_reduce(uint32, uint32_t)
+instantiate_segmented_reduce(uint64, uint64_t)
+instantiate_segmented_reduce(int8, int8_t)
+instantiate_segmented_reduce(int16, int16_t)
+instantiate_segmented_reduce(int32, int32_t)
+instantiate_segmented_reduce(int64, int64_t)
+instantiate_segmented_reduce(float16, half)
+instantiate_segmented_reduce(float32, float)
+
+#define instantiate_reduce_by_key_kernel(kname, tname, type) \
+  template [[host_name("reduce_by_key_" #kname "_" #tname)]] \
+  [[kernel]] void reduce_by_key_ ##kname<type>( \
+      constant ReduceByKeyArguments<type> &args, \
+      uint lid [[thread_position_in_threadgroup]], \
+      uint tgid [[threadgroup_position_in_grid]], \
+      uint tg_size [[threads_per_threadgroup]], \
+      uint blocks [[threadgroups_per_grid]], \
+      uint simd_per_group [[simdgroups_per_threadgroup]], \
+      uint simd_lane_id [[thread_index_in_simdgroup]], \
+      uint simd_group_id [[simdgroup_index_in_threadgroup]]);
+
+#define instantiate_reduce_by_key(tname, type) \
+  instantiate_reduce_by_key_kernel(count, tname, type) \
+  instantiate_reduce_by_key_kernel(scatter, tname, type)
+
+instantiate_reduce_by_key(uint32, uint32_t)
+instantiate_reduce_by_key(uint64, uint64_t)
+instantiate_reduce_by_key(int32, int32_t)
+instantiate_reduce_by_key(int64, int64_t)
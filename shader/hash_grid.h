@@ -114,7 +114,8 @@ inline hash_grid_query_t hash_grid_query(uint64_t id, vec3 pos, float radius) {
     return query;
 }
 
-inline bool hash_grid_query_next(thread hash_grid_query_t &query, int index) {
+// writes the next point in index, false once every cell of the query was visited
+inline bool hash_grid_query_next(thread hash_grid_query_t &query, thread int &index) {
     const thread HashGrid &grid = query.grid;
     if (!grid.point_cells)
         return false;